@@ -25,8 +25,11 @@
  * https://github.com/surge-synthesizer/shortcircuit-xt
  */
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <chrono>
+#include <cstring>
 
 #include "scxt-plugin.h"
 #include "version.h"
@@ -279,13 +282,39 @@ clap_process_status SCXTPlugin::process(const clap_process *process) noexcept
         nextEvent = ev->get(ev, nextEventIndex);
     }
 
-    for (auto s = 0U; s < process->frames_count; ++s)
+    // Aux outputs are copied a block at a time if their bus is in use and otherwise zeroed
+    // once here. Usage is read once per process call, so routing changes land on the next.
+    auto frames = process->frames_count;
+    auto auxCount = std::min((uint32_t)scxt::numNonMainPluginOutputs,
+                             process->audio_outputs_count - 1);
+    std::array<float **, scxt::numNonMainPluginOutputs> auxOut{};
+    for (uint32_t i = 0; i < auxCount; ++i)
+    {
+        float **pout = process->audio_outputs[i + 1].data32;
+        if (!pout || process->audio_outputs[i + 1].channel_count < 2)
+            continue;
+        if (ptch->usesOutputBus(i + 1))
+        {
+            auxOut[i] = pout;
+        }
+        else
+        {
+            memset(pout[0], 0, frames * sizeof(float));
+            memset(pout[1], 0, frames * sizeof(float));
+        }
+    }
+    auto &auxBus = ptch->busses.pluginNonMainOutputs;
+
+    uint32_t s{0};
+    while (s < frames)
     {
         if (blockPos == 0)
         {
-            // Only realy need to run events when we do the block process
-            while (nextEvent && nextEvent->time <= s)
+            // Run every event which lands in the block we are about to render, telling the
+            // engine where in the block it falls so notes start on their exact frame
+            while (nextEvent && nextEvent->time < s + scxt::blockSize)
             {
+                engine->setEventSampleOffset((int32_t)nextEvent->time - (int32_t)s);
                 handleEvent(nextEvent);
                 nextEventIndex++;
                 if (nextEventIndex < sz)
@@ -293,6 +322,7 @@ clap_process_status SCXTPlugin::process(const clap_process *process) noexcept
                 else
                     nextEvent = nullptr;
             }
+            engine->setEventSampleOffset(0);
 
             engine->processAudio();
             engine->transport.timeInBeats += (double)scxt::blockSize * engine->transport.tempo *
@@ -359,33 +389,26 @@ clap_process_status SCXTPlugin::process(const clap_process *process) noexcept
             }
         }
 
-        // TODO: this can be way more efficient and block wise and stuff
-        out[0][s] = main[0][blockPos];
-        out[1][s] = main[1][blockPos];
-        for (int i = 0; i < scxt::numNonMainPluginOutputs; ++i)
+        // Copy as much of the rendered block as the host buffer takes. Only the first and
+        // last copies of a call are partial, and only if frames isn't a multiple of blockSize
+        auto n = std::min((uint32_t)(scxt::blockSize - blockPos), frames - s);
+        memcpy(out[0] + s, main[0] + blockPos, n * sizeof(float));
+        memcpy(out[1] + s, main[1] + blockPos, n * sizeof(float));
+        for (uint32_t i = 0; i < auxCount; ++i)
         {
-            float **pout = process->audio_outputs[i + 1].data32;
-
-            if (pout)
-            {
-                pout[0][s] = 0.f;
-                pout[1][s] = 0.f;
-            }
-            if (engine->getPatch()->usesOutputBus(i + 1))
-            {
-                if (pout)
-                {
-                    pout[0][s] = engine->getPatch()->busses.pluginNonMainOutputs[i][0][blockPos];
-                    pout[1][s] = engine->getPatch()->busses.pluginNonMainOutputs[i][0][blockPos];
-                }
-            }
+            if (!auxOut[i])
+                continue;
+            memcpy(auxOut[i][0] + s, auxBus[i][0] + blockPos, n * sizeof(float));
+            memcpy(auxOut[i][1] + s, auxBus[i][1] + blockPos, n * sizeof(float));
         }
 
-        blockPos = (blockPos + 1) & (scxt::blockSize - 1);
+        s += n;
+        blockPos = (blockPos + n) & (scxt::blockSize - 1);
     }
 
     // CLean up past-last-process events since we only sweep when processing in main loop to avoid
-    // per sample if
+    // per sample if. These fall in a block which already started rendering, so they go at the
+    // top of the next one.
     while (nextEvent)
     {
         handleEvent(nextEvent);
@@ -0,0 +1,318 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+/*
+ * scxt-render: play a MIDI file through a multi (or anything the engine can load as a
+ * sample, sfz included) and write the result to WAV as fast as the machine allows.
+ *
+ * There is no audio or serialization thread here. The message controller is stopped and
+ * this thread does both jobs, calling runSerializationHousekeeping between blocks, so a
+ * render is repeatable run to run.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "engine/engine.h"
+#include "messaging/messaging.h"
+#include "patch_io/patch_io.h"
+#include "sample/sample_manager.h"
+#include "sst/voicemanager/midi1_to_voicemanager.h"
+
+#include "smf_reader.h"
+
+namespace
+{
+/*
+ * 32 bit float stereo WAV. Sizes are patched in on close.
+ */
+struct WavWriter
+{
+    std::ofstream of;
+    uint32_t frames{0};
+    std::vector<float> interleaved;
+
+    bool open(const fs::path &p, uint32_t sampleRate)
+    {
+        of.open(p, std::ios::binary | std::ios::trunc);
+        if (!of.is_open())
+            return false;
+
+        auto u32 = [this](uint32_t v) { of.write(reinterpret_cast<const char *>(&v), 4); };
+        auto u16 = [this](uint16_t v) { of.write(reinterpret_cast<const char *>(&v), 2); };
+        of.write("RIFF", 4);
+        u32(0);
+        of.write("WAVEfmt ", 8);
+        u32(16);
+        u16(3); // WAVE_FORMAT_IEEE_FLOAT
+        u16(2);
+        u32(sampleRate);
+        u32(sampleRate * 2 * sizeof(float));
+        u16(2 * sizeof(float));
+        u16(32);
+        of.write("data", 4);
+        u32(0);
+        return of.good();
+    }
+
+    void write(const float *l, const float *r, uint32_t n)
+    {
+        interleaved.resize(n * 2);
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            interleaved[2 * i] = l[i];
+            interleaved[2 * i + 1] = r[i];
+        }
+        of.write(reinterpret_cast<const char *>(interleaved.data()), n * 2 * sizeof(float));
+        frames += n;
+    }
+
+    bool close()
+    {
+        uint32_t dataBytes = frames * 2 * sizeof(float);
+        uint32_t riffBytes = dataBytes + 36;
+        of.seekp(4);
+        of.write(reinterpret_cast<const char *>(&riffBytes), 4);
+        of.seekp(40);
+        of.write(reinterpret_cast<const char *>(&dataBytes), 4);
+        of.close();
+        return !of.fail();
+    }
+};
+
+void usage(const char *argv0)
+{
+    std::cout << "Usage: " << argv0 << " [options] (patch) (midifile) (out.wav)\n"
+              << "  patch is a .scm multi, or anything the engine loads as a sample (sfz, sf2,\n"
+              << "  wav, ...)\n\n"
+              << "Options:\n"
+              << "  --sample-rate N   render at N Hz (default 48000)\n"
+              << "  --stems           also write out-partNN.wav for every active part\n"
+              << "  --tail S          keep rendering S seconds after the last voice ends "
+                 "(default 2)\n"
+              << std::endl;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    using namespace scxt;
+
+    double sampleRate{48000};
+    double tailSeconds{2};
+    bool writeStems{false};
+    std::vector<std::string> positional;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        if (a == "--sample-rate" && i + 1 < argc)
+            sampleRate = std::atof(argv[++i]);
+        else if (a == "--tail" && i + 1 < argc)
+            tailSeconds = std::atof(argv[++i]);
+        else if (a == "--stems")
+            writeStems = true;
+        else if (a == "--help" || a == "-h")
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else
+            positional.push_back(a);
+    }
+
+    if (positional.size() != 3 || sampleRate < 8000 || tailSeconds < 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    auto patchPath = fs::path{positional[0]};
+    auto midiPath = fs::path{positional[1]};
+    auto outPath = fs::path{positional[2]};
+
+    std::string midiError;
+    auto midi = render::readMidiFile(midiPath, midiError);
+    if (!midi.has_value())
+    {
+        std::cerr << "Unable to read " << midiPath.u8string() << ": " << midiError << std::endl;
+        return 2;
+    }
+
+    auto engine = std::make_unique<engine::Engine>();
+    auto &cont = engine->getMessageController();
+    cont->stop();
+    cont->threadingChecker.registerAsSerialThread();
+    cont->threadingChecker.registerAsAudioThread();
+    engine->runningEnvironment = "scxt-render";
+    engine->prepareToPlay(sampleRate);
+
+    if (!fs::exists(patchPath))
+    {
+        std::cerr << "No such file " << patchPath.u8string() << std::endl;
+        return 2;
+    }
+    if (extensionMatches(patchPath, ".scm"))
+    {
+        if (!patch_io::loadMulti(patchPath, *engine))
+        {
+            std::cerr << "Unable to load multi " << patchPath.u8string() << std::endl;
+            return 2;
+        }
+    }
+    else
+    {
+        engine->loadSampleIntoSelectedPartAndGroup(patchPath);
+    }
+
+    // Multis decode their samples in the background; wait for all of them
+    auto loadStart = std::chrono::steady_clock::now();
+    cont->runSerializationHousekeeping();
+    while (engine->getSampleManager()->hasPendingLoads())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        cont->runSerializationHousekeeping();
+    }
+    auto loadSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+
+    const auto &patch = engine->getPatch();
+    WavWriter mainOut;
+    if (!mainOut.open(outPath, (uint32_t)sampleRate))
+    {
+        std::cerr << "Unable to write " << outPath.u8string() << std::endl;
+        return 3;
+    }
+
+    std::vector<std::pair<int, std::unique_ptr<WavWriter>>> stems;
+    if (writeStems)
+    {
+        for (int p = 0; p < numParts; ++p)
+        {
+            if (!patch->getPart(p)->isActive())
+                continue;
+            auto sp = outPath;
+            sp.replace_filename(outPath.stem().u8string() + fmt::format("-part{:02d}.wav", p + 1));
+            auto w = std::make_unique<WavWriter>();
+            if (!w->open(sp, (uint32_t)sampleRate))
+            {
+                std::cerr << "Unable to write " << sp.u8string() << std::endl;
+                return 3;
+            }
+            stems.emplace_back(p, std::move(w));
+        }
+    }
+
+    engine->transport.tempo = midi->tempos.empty() ? 120 : midi->tempos.front().bpm;
+    engine->transport.status = engine::Transport::Status::PLAYING;
+    engine->onTransportUpdated();
+
+    auto renderStart = std::chrono::steady_clock::now();
+    const auto &events = midi->events;
+    const auto &tempos = midi->tempos;
+    size_t nextEvent{0}, nextTempo{0};
+    uint64_t blockStart{0};
+    auto endOfMidi = (uint64_t)std::ceil(midi->length * sampleRate);
+    auto tailSamples = (uint64_t)std::ceil(tailSeconds * sampleRate);
+    uint64_t silentSince{0};
+    bool voicesDone{false};
+
+    // Every event is placed by its rounded frame alone, so the block it lands in and its
+    // offset within that block always agree
+    auto frameOf = [sampleRate](double t) {
+        return (uint64_t)std::max(0.0, std::round(t * sampleRate));
+    };
+
+    while (true)
+    {
+        // Events land on the block they fall in, and notes on their frame within it
+        auto blockEnd = blockStart + blockSize;
+        while (nextTempo < tempos.size() && frameOf(tempos[nextTempo].time) < blockEnd)
+        {
+            engine->transport.tempo = tempos[nextTempo++].bpm;
+            engine->onTransportUpdated();
+        }
+        while (nextEvent < events.size())
+        {
+            auto frame = frameOf(events[nextEvent].time);
+            if (frame >= blockEnd)
+                break;
+            // Earlier blocks took every frame before blockStart, so this is in range
+            engine->setEventSampleOffset((int32_t)(frame - blockStart));
+            sst::voicemanager::applyMidi1Message(engine->voiceManager, 0,
+                                                 events[nextEvent++].data);
+        }
+        engine->setEventSampleOffset(0);
+
+        engine->processAudio();
+        engine->transport.timeInBeats +=
+            (double)blockSize * engine->transport.tempo * engine->getSampleRateInv() / 60.0;
+        engine->transport.hostTimeInBeats = engine->transport.timeInBeats;
+
+        const auto &main = patch->busses.mainBus.output;
+        mainOut.write(main[0], main[1], blockSize);
+        for (auto &[p, w] : stems)
+        {
+            const auto &po = patch->busses.partBusses[p].output;
+            w->write(po[0], po[1], blockSize);
+        }
+
+        cont->runSerializationHousekeeping();
+        blockStart = blockEnd;
+
+        if (nextEvent < events.size() || blockStart < endOfMidi)
+            continue;
+        if (!voicesDone && engine->activeVoices == 0)
+        {
+            voicesDone = true;
+            silentSince = blockStart;
+        }
+        if (voicesDone && blockStart >= silentSince + tailSamples)
+            break;
+    }
+
+    auto renderSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count();
+
+    bool ok = mainOut.close();
+    for (auto &[p, w] : stems)
+        ok = w->close() && ok;
+
+    auto audioSeconds = blockStart / sampleRate;
+    std::cout << "Rendered " << audioSeconds << "s of audio in " << renderSeconds << "s ("
+              << (renderSeconds > 0 ? audioSeconds / renderSeconds : 0) << "x realtime) after "
+              << loadSeconds << "s of sample loading" << std::endl;
+
+    return ok ? 0 : 3;
+}
@@ -0,0 +1,256 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "smf_reader.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace scxt::render
+{
+namespace
+{
+struct Reader
+{
+    const std::vector<uint8_t> &d;
+    size_t pos{0}, end{0};
+
+    bool has(size_t n) const { return pos + n <= end; }
+    uint8_t u8() { return d[pos++]; }
+    uint32_t be(int bytes)
+    {
+        uint32_t r{0};
+        for (int i = 0; i < bytes; ++i)
+            r = (r << 8) | d[pos++];
+        return r;
+    }
+    bool vlq(uint32_t &r)
+    {
+        r = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            if (!has(1))
+                return false;
+            auto b = u8();
+            r = (r << 7) | (b & 0x7F);
+            if (!(b & 0x80))
+                return true;
+        }
+        return false;
+    }
+};
+
+struct TickEvent
+{
+    uint64_t tick{0};
+    uint32_t order{0}; // file order, so simultaneous events keep their sequence
+    bool isTempo{false};
+    uint32_t usPerQuarter{500000};
+    uint8_t data[3]{0, 0, 0};
+};
+
+int channelMessageSize(uint8_t status)
+{
+    switch (status & 0xF0)
+    {
+    case 0xC0:
+    case 0xD0:
+        return 2;
+    default:
+        return 3;
+    }
+}
+} // namespace
+
+std::optional<MidiFile> readMidiFile(const fs::path &p, std::string &error)
+{
+    std::ifstream in(p, std::ios::binary);
+    if (!in.is_open())
+    {
+        error = "Unable to open " + p.u8string();
+        return std::nullopt;
+    }
+    std::vector<uint8_t> d((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    Reader r{d, 0, d.size()};
+    if (!r.has(14) || r.be(4) != 0x4D546864) // MThd
+    {
+        error = "Not a standard MIDI file";
+        return std::nullopt;
+    }
+    auto headerLength = r.be(4);
+    auto format = r.be(2);
+    auto trackCount = r.be(2);
+    auto division = r.be(2);
+    r.pos = 8 + headerLength;
+
+    if (format > 1)
+    {
+        error = "MIDI file format " + std::to_string(format) + " is not supported";
+        return std::nullopt;
+    }
+
+    // SMPTE divisions give a fixed tick length; otherwise ticks are per quarter note
+    double smpteSecondsPerTick{0};
+    if (division & 0x8000)
+    {
+        auto fps = -(int8_t)(division >> 8);
+        auto ticksPerFrame = division & 0xFF;
+        if (fps <= 0 || ticksPerFrame == 0)
+        {
+            error = "Invalid SMPTE division";
+            return std::nullopt;
+        }
+        smpteSecondsPerTick = 1.0 / (fps * ticksPerFrame);
+    }
+    else if (division == 0)
+    {
+        error = "Invalid division";
+        return std::nullopt;
+    }
+
+    std::vector<TickEvent> tickEvents;
+    uint64_t lastTick{0};
+    uint32_t order{0};
+    for (uint32_t t = 0; t < trackCount && r.has(8); ++t)
+    {
+        auto chunk = r.be(4);
+        auto chunkLength = r.be(4);
+        auto chunkEnd = std::min(r.pos + chunkLength, d.size());
+        if (chunk != 0x4D54726B) // MTrk; skip anything else
+        {
+            r.pos = chunkEnd;
+            continue;
+        }
+
+        Reader tr{d, r.pos, chunkEnd};
+        uint64_t tick{0};
+        uint8_t runningStatus{0};
+        bool trackEnded{false};
+        while (!trackEnded && tr.has(1))
+        {
+            uint32_t delta;
+            if (!tr.vlq(delta) || !tr.has(1))
+                break;
+            tick += delta;
+
+            auto status = d[tr.pos];
+            if (status & 0x80)
+                tr.pos++;
+            else if (runningStatus)
+                status = runningStatus;
+            else
+                break; // data byte with no running status; the track is corrupt
+
+            if (status == 0xFF)
+            {
+                runningStatus = 0;
+                uint32_t len;
+                if (!tr.has(1))
+                    break;
+                auto type = tr.u8();
+                if (!tr.vlq(len) || !tr.has(len))
+                    break;
+                if (type == 0x51 && len == 3)
+                {
+                    TickEvent te;
+                    te.tick = tick;
+                    te.order = order++;
+                    te.isTempo = true;
+                    te.usPerQuarter = tr.be(3);
+                    tickEvents.push_back(te);
+                }
+                else
+                {
+                    tr.pos += len;
+                }
+                trackEnded = (type == 0x2F);
+            }
+            else if (status == 0xF0 || status == 0xF7)
+            {
+                runningStatus = 0;
+                uint32_t len;
+                if (!tr.vlq(len) || !tr.has(len))
+                    break;
+                tr.pos += len;
+            }
+            else if (status >= 0x80 && status < 0xF0)
+            {
+                runningStatus = status;
+                auto sz = channelMessageSize(status);
+                if (!tr.has(sz - 1))
+                    break;
+                TickEvent te;
+                te.tick = tick;
+                te.order = order++;
+                te.data[0] = status;
+                for (int i = 1; i < sz; ++i)
+                    te.data[i] = tr.u8();
+                tickEvents.push_back(te);
+            }
+            else
+            {
+                break; // system common or realtime bytes don't belong in a file
+            }
+        }
+        lastTick = std::max(lastTick, tick);
+        r.pos = chunkEnd;
+    }
+
+    std::stable_sort(tickEvents.begin(), tickEvents.end(), [](const auto &a, const auto &b) {
+        return a.tick < b.tick || (a.tick == b.tick && a.order < b.order);
+    });
+
+    // Walk the merged list turning ticks into seconds through the tempo map
+    MidiFile res;
+    double secondsPerTick = smpteSecondsPerTick > 0 ? smpteSecondsPerTick : 0.5 / division;
+    double time{0};
+    uint64_t tick{0};
+    for (const auto &te : tickEvents)
+    {
+        time += (te.tick - tick) * secondsPerTick;
+        tick = te.tick;
+        if (te.isTempo)
+        {
+            if (smpteSecondsPerTick > 0 || te.usPerQuarter == 0)
+                continue;
+            secondsPerTick = te.usPerQuarter * 1e-6 / division;
+            res.tempos.push_back({time, 60.0e6 / te.usPerQuarter});
+        }
+        else
+        {
+            MidiEvent me;
+            me.time = time;
+            std::copy(std::begin(te.data), std::end(te.data), std::begin(me.data));
+            res.events.push_back(me);
+        }
+    }
+    res.length = time + (lastTick - tick) * secondsPerTick;
+    return res;
+}
+} // namespace scxt::render
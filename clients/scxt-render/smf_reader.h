@@ -0,0 +1,66 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_CLIENTS_SCXT_RENDER_SMF_READER_H
+#define SCXT_CLIENTS_SCXT_RENDER_SMF_READER_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "filesystem/import.h"
+
+namespace scxt::render
+{
+/*
+ * A minimal Standard MIDI File reader. Formats 0 and 1 are supported; all tracks are
+ * merged into one time ordered list of channel messages with times already resolved
+ * through the tempo map. Sysex and meta events other than tempo are dropped.
+ */
+struct MidiEvent
+{
+    double time{0}; // seconds
+    uint8_t data[3]{0, 0, 0};
+};
+
+struct TempoChange
+{
+    double time{0}; // seconds
+    double bpm{120};
+};
+
+struct MidiFile
+{
+    std::vector<MidiEvent> events;
+    std::vector<TempoChange> tempos;
+    double length{0}; // time of the last event, including end of track, in seconds
+};
+
+std::optional<MidiFile> readMidiFile(const fs::path &p, std::string &error);
+} // namespace scxt::render
+#endif // SCXT_CLIENTS_SCXT_RENDER_SMF_READER_H
@@ -229,6 +229,7 @@ struct SCXTEditor : sst::jucegui::components::WindowPanel, juce::DragAndDropCont
     void onBrowserRefresh(const bool);
 
     void onDebugInfoGenerated(const scxt::messaging::client::debugResponse_t &);
+    void onRenderProfileGenerated(const scxt::messaging::client::renderProfile_t &);
 
     std::vector<dsp::processor::ProcessorDescription> allProcessors;
     void onAllProcessorDescriptions(const std::vector<dsp::processor::ProcessorDescription> &v)
@@ -29,6 +29,7 @@
 #include "app/SCXTEditor.h"
 
 #include "VariantDisplay.h"
+#include "sample/sample_summary.h"
 
 namespace scxt::ui::app::edit_screen
 {
@@ -159,14 +160,23 @@ void SampleWaveform::rebuildEnvelopePaths()
     auto startSample = std::clamp((int)std::floor(l * pctStart) - samplePad, 0, (int)l);
     auto numSamples = (int)std::ceil(1.f * l / zoomFactor);
     auto endSample = std::clamp(startSample + numSamples + 2 * samplePad, 0, (int)l);
+    // A streamed sample only has its head in memory; draw what we have
+    endSample = std::min(endSample, (int)samp->getResidentSampleLength());
     auto fac = std::max(1.0 * numSamples / r.getWidth(), 1.0);
+    // Samples played from a mapped file are interleaved
+    auto stride = samp->getFrameStride();
+    // Zoomed out past a summary bucket a pixel, draw from the summary rather than the data
+    std::shared_ptr<const sample::SampleSummary> summary;
+    if (fac >= sample::SampleSummary::baseBucketFrames)
+        summary = samp->getSummary();
 
     for (int ch = 0; ch < usedChannels; ++ch)
     {
         std::vector<std::pair<size_t, float>> topLine, bottomLine;
 
-        auto downSampleForUI = [startSample, endSample, fac, &topLine, &bottomLine](auto *data) {
-            using T = std::remove_pointer_t<decltype(data)>;
+        // valueAt(s) is frame s of this channel
+        auto downSampleForUI = [startSample, endSample, fac, &topLine, &bottomLine](auto valueAt) {
+            using T = decltype(valueAt(0));
             double c = startSample;
             int ct = 0;
             auto seedmx = std::numeric_limits<T>::min();
@@ -200,20 +210,36 @@ void SampleWaveform::rebuildEnvelopePaths()
                     mx = seedmx;
                     mn = seedmn;
                 }
-                mx = std::max(data[s], mx);
-                mn = std::min(data[s], mn);
+                mx = std::max(valueAt(s), mx);
+                mn = std::min(valueAt(s), mn);
             }
         };
 
-        if (samp->bitDepth == sample::Sample::BD_I16)
+        if (summary)
+        {
+            for (double c = startSample; c < endSample; c += fac)
+            {
+                auto e = std::min((int)(c + fac), endSample);
+                auto rg = summary->range(*samp, ch, (size_t)c, e);
+                topLine.emplace_back(e, rg.max);
+                bottomLine.emplace_back(e, rg.min);
+            }
+        }
+        else if (samp->bitDepth == sample::Sample::BD_I16)
         {
             auto d = samp->GetSamplePtrI16(ch);
-            downSampleForUI(d);
+            downSampleForUI([d, stride](int s) { return d[s * stride]; });
         }
         else if (samp->bitDepth == sample::Sample::BD_F32)
         {
             auto d = samp->GetSamplePtrF32(ch);
-            downSampleForUI(d);
+            downSampleForUI([d, stride](int s) { return d[s * stride]; });
+        }
+        else if (samp->bitDepth == sample::Sample::BD_I24)
+        {
+            auto d = samp->GetSamplePtrI24(ch);
+            downSampleForUI(
+                [d, stride](int s) { return sample::Sample::unpackI24(d + s * stride * 3); });
         }
         else
         {
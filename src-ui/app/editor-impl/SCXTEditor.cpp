@@ -305,7 +305,7 @@ void SCXTEditor::drainCallbackQueue()
         if (itemsToDrain)
         {
             assert(msgCont.threadingChecker.isClientThread());
-            cmsg::clientThreadExecuteSerializationMessage(queueMsg, this);
+            cmsg::clientThreadExecuteSerializationMessage(queueMsg, this, msgCont);
 #if BUILD_IS_DEBUG
             inboundMessageCount++;
             inboundMessageBytes += queueMsg.size();
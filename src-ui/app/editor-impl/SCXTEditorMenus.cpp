@@ -117,6 +117,23 @@ void SCXTEditor::showMainMenu()
             return;
         w->sendToSerialization(cmsg::RequestDebugAction{cmsg::DebugActions::pretty_json_part});
     });
+    dp.addSeparator();
+    dp.addItem("Start Render Profile", [w = juce::Component::SafePointer(this)]() {
+        if (!w)
+            return;
+        w->sendToSerialization(cmsg::RequestDebugAction{cmsg::DebugActions::render_profile_start});
+    });
+    dp.addItem("Stop Render Profile", [w = juce::Component::SafePointer(this)]() {
+        if (!w)
+            return;
+        w->sendToSerialization(cmsg::RequestDebugAction{cmsg::DebugActions::render_profile_stop});
+    });
+    dp.addItem("Copy Render Profile (Folded Stacks)", [w = juce::Component::SafePointer(this)]() {
+        if (!w)
+            return;
+        w->sendToSerialization(
+            cmsg::RequestDebugAction{cmsg::DebugActions::render_profile_report});
+    });
     // dp.addItem("Focus Debugger Toggle", []() {});
     dp.addSeparator();
     dp.addItem("Dump Colormap JSON", [this]() { SCLOG(themeApplier.colors->toJson()); });
@@ -341,6 +341,14 @@ void SCXTEditor::onDebugInfoGenerated(const scxt::messaging::client::debugRespon
     }
 }
 
+void SCXTEditor::onRenderProfileGenerated(const scxt::messaging::client::renderProfile_t &p)
+{
+    const auto &[blocks, pct, folded] = p;
+    SCLOG("Render profile over " << blocks << " blocks; patch at " << pct << "% of realtime");
+    juce::SystemClipboard::copyTextToClipboard(folded);
+    SCLOG("Folded stacks copied to the clipboard");
+}
+
 void SCXTEditor::onMacroFullState(const scxt::messaging::client::macroFullState_t &s)
 {
     const auto &[part, index, macro] = s;
@@ -239,7 +239,7 @@ struct TxnGuard
 struct WriterWorker
 {
     static constexpr const char *schema_version =
-        "1003"; // I will rebuild if this is not my version
+        "1004"; // I will rebuild if this is not my version
 
     static constexpr const char *setup_sql = R"SQL(
 DROP TABLE IF EXISTS "DebugJunk";
@@ -257,6 +257,14 @@ CREATE TABLE DebugJunk (
 CREATE TABLE IF NOT EXISTS DeviceLocations (
     id integer primary key,
     path varchar(2048)
+);
+-- This is a cache, so blowing it away on a schema change is fine
+DROP TABLE IF EXISTS "FileMD5";
+CREATE TABLE FileMD5 (
+    path varchar(2048) primary key,
+    size integer,
+    mtime integer,
+    md5 varchar(64)
 );
     )SQL";
     struct EnQAble
@@ -279,6 +287,18 @@ CREATE TABLE IF NOT EXISTS DeviceLocations (
         void go(WriterWorker &w) override { w.addDeviceLocation(path); }
     };
 
+    struct EnQFileMD5 : public EnQAble
+    {
+        fs::path path;
+        int64_t size, mtime;
+        std::string md5;
+        EnQFileMD5(const fs::path &p, int64_t s, int64_t m, const std::string &md)
+            : path(p), size(s), mtime(m), md5(md)
+        {
+        }
+        void go(WriterWorker &w) override { w.addFileMD5(path, size, mtime, md5); }
+    };
+
     void openDb()
     {
 #if TRACE_DB
@@ -593,6 +613,29 @@ CREATE TABLE IF NOT EXISTS DeviceLocations (
         }
     }
 
+    void addFileMD5(const fs::path &p, int64_t size, int64_t mtime, const std::string &md5)
+    {
+        try
+        {
+            auto there = SQL::Statement(dbh, "INSERT OR REPLACE INTO FileMD5 "
+                                             "(\"path\", \"size\", \"mtime\", \"md5\") "
+                                             "VALUES (?1, ?2, ?3, ?4)");
+
+            std::string res = p.u8string();
+            there.bind(1, res);
+            there.bindi64(2, size);
+            there.bindi64(3, mtime);
+            there.bind(4, md5);
+
+            there.step();
+            there.finalize();
+        }
+        catch (const SQL::Exception &e)
+        {
+            SCLOG(e.what());
+        }
+    }
+
     // FIXME for now I am coding this with a locked vector but probably a
     // thread safe queue is the way to go
     std::thread qThread;
@@ -614,6 +657,10 @@ CREATE TABLE IF NOT EXISTS DeviceLocations (
         qCV.notify_all();
     }
 
+    /*
+     * The read only connection is opened lazily and NOMUTEX, so callers must hold
+     * BrowserDB::readLock both for this call and for as long as they use the result.
+     */
     sqlite3 *getReadOnlyConn(bool notifyOnError = true)
     {
         if (!rodbh)
@@ -667,8 +714,11 @@ void BrowserDB::addDeviceLocation(const fs::path &p)
 
 std::vector<fs::path> BrowserDB::getDeviceLocations()
 {
+    std::lock_guard<std::mutex> g(readLock);
     auto conn = writerWorker->getReadOnlyConn();
     std::vector<fs::path> res;
+    if (!conn)
+        return res;
 
     // language=SQL
     std::string query = "SELECT path FROM DeviceLocations;";
@@ -689,6 +739,41 @@ std::vector<fs::path> BrowserDB::getDeviceLocations()
     return res;
 }
 
+std::optional<std::string> BrowserDB::lookupMD5Sum(const fs::path &path, uint64_t size,
+                                                   int64_t mtime)
+{
+    std::lock_guard<std::mutex> g(readLock);
+    auto conn = writerWorker->getReadOnlyConn(false);
+    if (!conn)
+        return std::nullopt;
+
+    std::optional<std::string> res;
+    try
+    {
+        // language=SQL
+        auto q = SQL::Statement(conn, "SELECT md5 FROM FileMD5 WHERE path = ?1 AND size = ?2 "
+                                      "AND mtime = ?3;");
+        std::string ps = path.u8string();
+        q.bind(1, ps);
+        q.bindi64(2, (int64_t)size);
+        q.bindi64(3, mtime);
+        if (q.step())
+            res = q.col_str(0);
+        q.finalize();
+    }
+    catch (SQL::Exception &e)
+    {
+        SCLOG(e.what());
+    }
+    return res;
+}
+
+void BrowserDB::storeMD5Sum(const fs::path &path, uint64_t size, int64_t mtime,
+                            const std::string &md5)
+{
+    writerWorker->enqueueWorkItem(new WriterWorker::EnQFileMD5(path, (int64_t)size, mtime, md5));
+}
+
 int BrowserDB::numberOfJobsOutstanding() const
 {
     std::lock_guard<std::mutex> guard(writerWorker->qLock);
@@ -29,13 +29,15 @@
 #define SCXT_SRC_BROWSER_BROWSER_DB_H
 
 #include "filesystem/import.h"
+#include "infrastructure/md5support.h"
 #include <memory>
+#include <mutex>
 #include <vector>
 
 namespace scxt::browser
 {
 struct WriterWorker;
-struct BrowserDB
+struct BrowserDB : infrastructure::MD5SumCache
 {
     BrowserDB(const fs::path &);
     ~BrowserDB();
@@ -45,11 +47,23 @@ struct BrowserDB
 
     std::vector<fs::path> getDeviceLocations();
 
+    /*
+     * The (path, size, mtime) -> md5 table. Lookups can come from any loading thread;
+     * stores go through the writer queue so may take a moment to become visible.
+     */
+    std::optional<std::string> lookupMD5Sum(const fs::path &path, uint64_t size,
+                                            int64_t mtime) override;
+    void storeMD5Sum(const fs::path &path, uint64_t size, int64_t mtime,
+                     const std::string &md5) override;
+
     int numberOfJobsOutstanding() const;
     int waitForJobsOutstandingComplete(int maxWaitInMS) const;
 
   private:
     std::unique_ptr<WriterWorker> writerWorker;
+    // The read only connection is opened lazily and NOMUTEX, so every read only query takes
+    // this around both the open and its use of the connection
+    std::mutex readLock;
 };
 } // namespace scxt::browser
 #endif // SHORTCIRCUITXT_BROWSER_DB_H
@@ -26,7 +26,9 @@
  */
 
 #include "generator.h"
+#include "generator_sinc_block.h"
 #include "infrastructure/sse_include.h"
+#include "infrastructure/cpu_features.h"
 
 #include "resampling.h"
 #include "data_tables.h"
@@ -92,15 +94,63 @@
  * And everything is templated so we can constexpr out the code we don't need
  * and use a function pointer at voice on with the appropriate compile time config.
  *
+ * Finally the sinc kernel can run in blocks. Unless the generator is bound at
+ * SincKernelLevel::PerSample, frames which need no fade and no loop end temporary
+ * are not interpolated on the spot; their read pointers and sub positions are queued
+ * and a block kernel from generator_sinc_block.h renders up to eight at a time.
+ * Frames which do need the fade or temporary flush the queue and go through the
+ * per-sample kernel, so the two paths never overlap.
+ *
  * Good luck!
  */
 
 namespace scxt::dsp
 {
-constexpr float I16InvScale = (1.f / (16384.f * 32768.f));
 constexpr float I16InvScale2 = (1.f / (32768.f));
+constexpr float I24InvScale = (1.f / (8388608.f));
 const __m128 I16InvScale_m128 = _mm_set1_ps(I16InvScale);
 
+/*
+ * Unpack the 16 packed 24 bit taps at src to float. The byte shuffle this wants is SSSE3,
+ * past our SSE2 baseline, so as with the I24 kernels in pcm_convert it is compiled for AVX2
+ * and used only when the CPU has that; otherwise the taps unpack one at a time, to the same
+ * floats. Each load holds four values, shuffled into the top of each lane and shifted back
+ * down to sign extend. The last load starts at byte 32 rather than 36 so nothing past the
+ * 48 bytes of taps is read.
+ */
+#if SCXT_HAS_AVX2_KERNELS
+SCXT_TARGET_AVX2 void unpackI24TapsShuffled(const uint8_t *src, float *dest)
+{
+    const auto scale = _mm_set1_ps(I24InvScale);
+    const auto lo = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const auto hi = _mm_setr_epi8(-1, 4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15);
+    for (int q = 0; q < 4; ++q)
+    {
+        auto in = _mm_loadu_si128((const __m128i *)(src + (q == 3 ? 32 : q * 12)));
+        auto v = _mm_srai_epi32(_mm_shuffle_epi8(in, q == 3 ? hi : lo), 8);
+        _mm_storeu_ps(dest + q * 4, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+}
+const bool unpackI24TapsWithShuffle{infrastructure::cpuFeatures().avx2};
+#endif
+
+inline void unpackI24Taps(const uint8_t *src, float *dest)
+{
+#if SCXT_HAS_AVX2_KERNELS
+    if (unpackI24TapsWithShuffle)
+    {
+        unpackI24TapsShuffled(src, dest);
+        return;
+    }
+#endif
+    for (int k = 0; k < 16; ++k)
+    {
+        auto p = src + k * 3;
+        auto v = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8;
+        dest[k] = v * I24InvScale;
+    }
+}
+
 inline float getFadeGainToAmp(float g)
 {
     // return std::cbrt(g);
@@ -523,7 +573,7 @@ void KernelOp<InterpolationTypes::Sinc, int16_t>::Process(
     }
 }
 
-template <int compoundConfig>
+template <int compoundConfig, SincKernelLevel sincLevel>
 void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO);
 
 int toLoopValue(bool active, bool forward, bool whileGated, bool isFloat, bool isStereo)
@@ -545,24 +595,48 @@ constexpr std::array<bool, 5> fromLoopValue(int lv)
 namespace detail
 {
 using genOp_t = GeneratorFPtr (*)();
-template <size_t I> GeneratorFPtr implGeneratorGetImpl() { return GeneratorSample<I>; }
+template <SincKernelLevel L, size_t I> GeneratorFPtr implGeneratorGetImpl()
+{
+    return GeneratorSample<I, L>;
+}
 
-template <size_t... Is> auto generatorGet(size_t ft, std::index_sequence<Is...>)
+template <SincKernelLevel L, size_t... Is> auto generatorGet(size_t ft, std::index_sequence<Is...>)
 {
-    constexpr genOp_t fnc[] = {detail::implGeneratorGetImpl<Is>...};
+    constexpr genOp_t fnc[] = {detail::implGeneratorGetImpl<L, Is>...};
     return fnc[ft]();
 }
 } // namespace detail
 
 GeneratorFPtr GetFPtrGeneratorSample(bool Stereo, bool Float, bool loopActive, bool loopForward,
                                      bool loopWhileGated)
+{
+    return GetFPtrGeneratorSample(Stereo, Float, loopActive, loopForward, loopWhileGated,
+                                  bestSincKernelLevel());
+}
+
+GeneratorFPtr GetFPtrGeneratorSample(bool Stereo, bool Float, bool loopActive, bool loopForward,
+                                     bool loopWhileGated, SincKernelLevel level)
 {
     auto loopValue = toLoopValue(loopActive, loopForward, loopWhileGated, Float, Stereo);
     assert(loopValue >= 0 && loopValue < (1 << 5));
-    return detail::generatorGet(loopValue, std::make_index_sequence<(1 << 5)>());
+    level = std::min(level, fastestSincKernelLevel());
+
+    constexpr auto lvs = std::make_index_sequence<(1 << 5)>();
+    switch (level)
+    {
+    case SincKernelLevel::PerSample:
+        return detail::generatorGet<SincKernelLevel::PerSample>(loopValue, lvs);
+    case SincKernelLevel::SSE2:
+        return detail::generatorGet<SincKernelLevel::SSE2>(loopValue, lvs);
+    case SincKernelLevel::AVX2:
+        return detail::generatorGet<SincKernelLevel::AVX2>(loopValue, lvs);
+    case SincKernelLevel::AVX2FMA:
+        return detail::generatorGet<SincKernelLevel::AVX2FMA>(loopValue, lvs);
+    }
+    return detail::generatorGet<SincKernelLevel::PerSample>(loopValue, lvs);
 }
 
-template <int loopValue>
+template <int loopValue, SincKernelLevel sincLevel>
 void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
 {
     static constexpr auto mode = fromLoopValue(loopValue);
@@ -576,6 +650,8 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
     int SampleSubPos = GD->sampleSubPos;
     int IsFinished = GD->isFinished;
     int WaveSize = IO->waveSize;
+    int Stride = IO->interleavedStride;
+    bool Packed24 = IO->packed24;
     int LoopOffset = std::max(1, GD->loopUpperBound - GD->loopLowerBound);
     int Ratio = GD->ratio;
     int RatioSign = Ratio < 0 ? -1 : 1;
@@ -611,6 +687,50 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
     }
 
     static constexpr int resampFIRSize{16};
+
+    /*
+     * Interleaved data (see GeneratorIO::interleavedStride) has no zero pads, so reads outside
+     * the wave are the pad value. The read pointers below are still formed as if the data were
+     * planar; for interleaved data they only carry a tap position and gatherTaps copies the
+     * taps from there into a padded run the kernels can read. Packed 24 bit data goes the same
+     * way through the float generator, unpacking each tap as it is gathered.
+     */
+    auto tapAt = [WaveSize, Stride, Packed24](auto *data, int q) {
+        using T = std::remove_pointer_t<decltype(data)>;
+        if constexpr (std::is_same_v<T, float>)
+        {
+            if (Packed24)
+            {
+                if (Stride && (q < 0 || q >= WaveSize))
+                    return 0.f;
+                auto p = (const uint8_t *)data + (ptrdiff_t)q * 3 * std::max(Stride, 1);
+                auto v = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 |
+                                   (uint32_t)p[2] << 24) >>
+                         8;
+                return v * I24InvScale;
+            }
+        }
+        if (!Stride)
+            return data[q];
+        return (q >= 0 && q < WaveSize) ? data[(ptrdiff_t)q * Stride] : T{0};
+    };
+    auto gatherTaps = [&](auto *&read, auto *base, auto *dest) {
+        auto pos = (int)(read - base);
+        if constexpr (fp)
+        {
+            if (Packed24 && !Stride)
+            {
+                // Planar packed data has its pads, so the taps can be read as a run
+                unpackI24Taps((const uint8_t *)base + (ptrdiff_t)pos * 3, dest);
+                read = dest;
+                return;
+            }
+        }
+        for (int k = 0; k < resampFIRSize; ++k)
+            dest[k] = tapAt(base, pos + k);
+        read = dest;
+    };
+
     int16_t *__restrict readSampleL = nullptr;
     int16_t *__restrict readSampleR = nullptr;
     int16_t *__restrict readFadeSampleL = nullptr;
@@ -646,9 +766,9 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
                     auto q = k + SamplePos - FIRoffset;
                     if (q >= GD->loopUpperBound || q >= WaveSize)
                         q -= LoopOffset;
-                    loopEndBufferLF32[k] = SampleDataFL[q];
+                    loopEndBufferLF32[k] = tapAt(SampleDataFL, q);
                     if (stereo)
-                        loopEndBufferRF32[k] = SampleDataFR[q];
+                        loopEndBufferRF32[k] = tapAt(SampleDataFR, q);
                 }
                 readSampleLF32 = loopEndBufferLF32;
                 if (stereo)
@@ -680,9 +800,9 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
                     if (q >= GD->loopUpperBound || q >= WaveSize)
                         q -= LoopOffset;
 
-                    loopEndBufferL[k] = SampleDataL[q];
+                    loopEndBufferL[k] = tapAt(SampleDataL, q);
                     if (stereo)
-                        loopEndBufferR[k] = SampleDataR[q];
+                        loopEndBufferR[k] = tapAt(SampleDataR, q);
                 }
                 readSampleL = loopEndBufferL;
                 if (stereo)
@@ -693,6 +813,43 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
 
     int NSamples = GD->blockSize;
 
+    using sinc_t = typename std::conditional<fp, float, int16_t>::type;
+    static constexpr bool blockSinc{sincLevel != SincKernelLevel::PerSample};
+    bool useBlockSinc{blockSinc && GD->interpolationType == InterpolationTypes::Sinc};
+    sincblock::Batch<sinc_t> sincBatch;
+    auto flushSincBatch = [&]() {
+        if constexpr (blockSinc)
+        {
+            if (sincBatch.count == 0)
+                return;
+            auto outR = stereo ? OutputR + sincBatch.outputStart : nullptr;
+            sincblock::process<sincLevel>(sincBatch, stereo ? 2 : 1,
+                                          OutputL + sincBatch.outputStart, outR);
+            sincBatch.count = 0;
+        }
+    };
+
+    // Gathered taps for interleaved or packed data, one run per batch slot so queued frames
+    // keep theirs
+    sinc_t gatherL[sincblock::maxFrames][resampFIRSize];
+    sinc_t gatherR[sincblock::maxFrames][resampFIRSize];
+    sinc_t gatherFadeL[resampFIRSize], gatherFadeR[resampFIRSize];
+    sinc_t *baseL{nullptr}, *baseR{nullptr}, *loopEndL{nullptr};
+    if constexpr (fp)
+    {
+        baseL = SampleDataFL;
+        loopEndL = loopEndBufferLF32;
+        if (stereo)
+            baseR = SampleDataFR;
+    }
+    else
+    {
+        baseL = SampleDataL;
+        loopEndL = loopEndBufferL;
+        if (stereo)
+            baseR = SampleDataR;
+    }
+
     int i{0};
     for (i = 0; i < NSamples && !IsFinished; i++)
     {
@@ -725,51 +882,101 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
             readFadeR = readFadeSampleR;
         }
 
-        // 2. Resample
-        unsigned int m0 = ((SampleSubPos >> 12) & 0xff0);
-        if (stereo)
+        if (Stride || Packed24)
         {
-            switch (GD->interpolationType)
-            {
-            case InterpolationTypes::Sinc:
+            auto slot = sincBatch.count;
+            if (readL != loopEndL)
             {
-                KPStereo(InterpolationTypes::Sinc, type_from_cond, 2, readL, readR, readFadeL,
-                         readFadeR);
-                break;
-            }
-            case InterpolationTypes::Linear:
-            {
-                KPStereo(InterpolationTypes::Linear, type_from_cond, 2, readL, readR, readFadeL,
-                         readFadeR);
-                break;
+                gatherTaps(readL, baseL, gatherL[slot]);
+                if (stereo)
+                    gatherTaps(readR, baseR, gatherR[slot]);
             }
-            case InterpolationTypes::ZeroOrderHold:
+            if (loopActive && fadeActive)
             {
-                KPStereo(InterpolationTypes::ZeroOrderHold, type_from_cond, 2, readL, readR,
-                         readFadeL, readFadeR);
-                break;
-            }
+                gatherTaps(readFadeL, baseL, gatherFadeL);
+                if (stereo)
+                    gatherTaps(readFadeR, baseR, gatherFadeR);
             }
         }
-        else
+
+        // 2. Resample
+        unsigned int m0 = ((SampleSubPos >> 12) & 0xff0);
+        bool queuedForBlock{false};
+        if constexpr (blockSinc)
         {
-            switch (GD->interpolationType)
+            if (useBlockSinc)
             {
-            case InterpolationTypes::Sinc:
-            {
-                KPMono(InterpolationTypes::Sinc, type_from_cond, 1, readL, readFadeL);
-                break;
+                bool usesTemporary{false};
+                if constexpr (fp)
+                    usesTemporary = readL == loopEndBufferLF32;
+                else
+                    usesTemporary = readL == loopEndBufferL;
+
+                if (usesTemporary || (loopActive && fadeActive))
+                {
+                    flushSincBatch();
+                }
+                else
+                {
+                    if (sincBatch.count == 0)
+                        sincBatch.outputStart = i;
+                    sincBatch.readL[sincBatch.count] = readL;
+                    sincBatch.readR[sincBatch.count] = readR;
+                    sincBatch.subPos[sincBatch.count] = SampleSubPos;
+                    sincBatch.count++;
+                    if (sincBatch.count == sincblock::maxFrames)
+                        flushSincBatch();
+                    queuedForBlock = true;
+                }
             }
-            case InterpolationTypes::Linear:
+        }
+
+        if (!queuedForBlock)
+        {
+            if (stereo)
             {
-                KPMono(InterpolationTypes::Linear, type_from_cond, 1, readL, readFadeL);
-                break;
+                switch (GD->interpolationType)
+                {
+                case InterpolationTypes::Sinc:
+                {
+                    KPStereo(InterpolationTypes::Sinc, type_from_cond, 2, readL, readR, readFadeL,
+                             readFadeR);
+                    break;
+                }
+                case InterpolationTypes::Linear:
+                {
+                    KPStereo(InterpolationTypes::Linear, type_from_cond, 2, readL, readR, readFadeL,
+                             readFadeR);
+                    break;
+                }
+                case InterpolationTypes::ZeroOrderHold:
+                {
+                    KPStereo(InterpolationTypes::ZeroOrderHold, type_from_cond, 2, readL, readR,
+                             readFadeL, readFadeR);
+                    break;
+                }
+                }
             }
-            case InterpolationTypes::ZeroOrderHold:
+            else
             {
-                KPMono(InterpolationTypes::ZeroOrderHold, type_from_cond, 1, readL, readFadeL);
-                break;
-            }
+                switch (GD->interpolationType)
+                {
+                case InterpolationTypes::Sinc:
+                {
+                    KPMono(InterpolationTypes::Sinc, type_from_cond, 1, readL, readFadeL);
+                    break;
+                }
+                case InterpolationTypes::Linear:
+                {
+                    KPMono(InterpolationTypes::Linear, type_from_cond, 1, readL, readFadeL);
+                    break;
+                }
+                case InterpolationTypes::ZeroOrderHold:
+                {
+                    KPMono(InterpolationTypes::ZeroOrderHold, type_from_cond, 1, readL, readFadeL);
+                    break;
+                }
+                }
             }
         }
 
@@ -957,9 +1164,9 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
                         auto q = k + SamplePos - FIRoffset;
                         if (q >= GD->loopUpperBound || q >= WaveSize)
                             q -= LoopOffset;
-                        loopEndBufferLF32[k] = SampleDataFL[q];
+                        loopEndBufferLF32[k] = tapAt(SampleDataFL, q);
                         if (stereo)
-                            loopEndBufferRF32[k] = SampleDataFR[q];
+                            loopEndBufferRF32[k] = tapAt(SampleDataFR, q);
                     }
                     readSampleLF32 = loopEndBufferLF32;
                     if (stereo)
@@ -991,9 +1198,9 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
                         auto q = k + SamplePos - FIRoffset;
                         if (q >= GD->loopUpperBound || q >= WaveSize)
                             q -= LoopOffset;
-                        loopEndBufferL[k] = SampleDataL[q];
+                        loopEndBufferL[k] = tapAt(SampleDataL, q);
                         if (stereo)
-                            loopEndBufferR[k] = SampleDataR[q];
+                            loopEndBufferR[k] = tapAt(SampleDataR, q);
                     }
                     readSampleL = loopEndBufferL;
                     if (stereo)
@@ -1023,6 +1230,8 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
         }
     }
 
+    flushSincBatch();
+
     // Clean up any items left
     for (; i < NSamples; ++i)
     {
@@ -78,12 +78,41 @@ struct GeneratorIO
     void *__restrict sampleDataL{nullptr};
     void *__restrict sampleDataR{nullptr};
     int waveSize{0};
+    // Non-zero for unpadded interleaved data (a mapped file) with frames this many values
+    // apart. Zero is the usual planar data with FIRoffset zero pads either side.
+    int interleavedStride{0};
+    // Packed little endian 24 bit data, played by the float generator which unpacks each tap
+    bool packed24{false};
 };
 
+/*
+ * Which sinc kernel a generator uses. PerSample is the original one-frame-at-a-time
+ * kernel; the others batch frames (see generator_sinc_block.h). SSE2 and AVX2 are bit
+ * identical to PerSample, AVX2FMA is not.
+ */
+enum class SincKernelLevel
+{
+    PerSample,
+    SSE2,
+    AVX2,
+    AVX2FMA
+};
+
+/*
+ * bestSincKernelLevel is the default: the fastest level this CPU supports which renders
+ * bit identically to PerSample, so output doesn't change from machine to machine.
+ * fastestSincKernelLevel may be AVX2FMA, which callers only get by asking for it.
+ */
+SincKernelLevel bestSincKernelLevel();
+SincKernelLevel fastestSincKernelLevel();
+
 typedef void (*GeneratorFPtr)(GeneratorState *__restrict, GeneratorIO *__restrict);
 // TODO Loop Mode should be an enum
 GeneratorFPtr GetFPtrGeneratorSample(bool isStereo, bool isFloat, bool loopActive, bool loopForward,
                                      bool loopWhileGated);
+// As above with an explicit sinc kernel; levels above fastestSincKernelLevel() are clamped
+GeneratorFPtr GetFPtrGeneratorSample(bool isStereo, bool isFloat, bool loopActive, bool loopForward,
+                                     bool loopWhileGated, SincKernelLevel level);
 
 } // namespace scxt::dsp
 #endif // SCXT_SRC_DSP_GENERATOR_H
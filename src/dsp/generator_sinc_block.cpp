@@ -0,0 +1,409 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "generator_sinc_block.h"
+#include "infrastructure/sse_include.h"
+#include "data_tables.h"
+
+#include <algorithm>
+
+namespace scxt::dsp
+{
+SincKernelLevel fastestSincKernelLevel()
+{
+    static const SincKernelLevel level = []() {
+        const auto &cpu = infrastructure::cpuFeatures();
+        if (!cpu.avx2)
+            return SincKernelLevel::SSE2;
+        return cpu.fma ? SincKernelLevel::AVX2FMA : SincKernelLevel::AVX2;
+    }();
+    return level;
+}
+
+SincKernelLevel bestSincKernelLevel()
+{
+    return std::min(fastestSincKernelLevel(), SincKernelLevel::AVX2);
+}
+
+namespace sincblock
+{
+namespace
+{
+/*
+ * Frames past b.count in the last group are computed from the final valid frame so every
+ * read stays inside the sample, and then only the valid outputs are stored.
+ */
+template <typename T> inline int frameIndex(const Batch<T> &b, int f)
+{
+    return std::min(f, (int)b.count - 1);
+}
+
+inline void storeFrames(__m128 v, float *out, int n)
+{
+    if (n >= 4)
+    {
+        _mm_storeu_ps(out, v);
+    }
+    else
+    {
+        float tmp alignas(16)[4];
+        _mm_store_ps(tmp, v);
+        for (int i = 0; i < n; ++i)
+            out[i] = tmp[i];
+    }
+}
+
+/*
+ * Lane k of acc holds taps k, k + 4, k + 8, k + 12 summed left to right, the same as
+ * sL4 in the per-sample kernel.
+ */
+template <int NUM_CHANNELS>
+inline void frameF32(const Batch<float> &b, int f, __m128 &accL, __m128 &accR)
+{
+    auto m0 = (b.subPos[f] >> 12) & 0xff0;
+    auto lipol = _mm_set1_ps((float)(b.subPos[f] & 0xffff));
+    __m128 c[4];
+    for (int k = 0; k < 4; ++k)
+        c[k] = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&sincTable.SincOffsetF32[m0 + 4 * k]), lipol),
+                          _mm_load_ps(&sincTable.SincTableF32[m0 + 4 * k]));
+
+    accL = _mm_mul_ps(c[0], _mm_loadu_ps(b.readL[f]));
+    for (int k = 1; k < 4; ++k)
+        accL = _mm_add_ps(accL, _mm_mul_ps(c[k], _mm_loadu_ps(b.readL[f] + 4 * k)));
+
+    if constexpr (NUM_CHANNELS == 2)
+    {
+        accR = _mm_mul_ps(c[0], _mm_loadu_ps(b.readR[f]));
+        for (int k = 1; k < 4; ++k)
+            accR = _mm_add_ps(accR, _mm_mul_ps(c[k], _mm_loadu_ps(b.readR[f] + 4 * k)));
+    }
+}
+
+// Four accumulators to four outputs, lanes added as (0 + 1) + (2 + 3) like the double hadd
+inline __m128 reduceF32(__m128 a0, __m128 a1, __m128 a2, __m128 a3)
+{
+    _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+    return _mm_add_ps(_mm_add_ps(a0, a1), _mm_add_ps(a2, a3));
+}
+
+template <int NUM_CHANNELS>
+void processF32SSE2(const Batch<float> &b, float *outL, float *outR)
+{
+    for (int g = 0; g < b.count; g += 4)
+    {
+        __m128 aL[4], aR[4];
+        for (int j = 0; j < 4; ++j)
+            frameF32<NUM_CHANNELS>(b, frameIndex(b, g + j), aL[j], aR[j]);
+
+        storeFrames(reduceF32(aL[0], aL[1], aL[2], aL[3]), outL + g, b.count - g);
+        if constexpr (NUM_CHANNELS == 2)
+            storeFrames(reduceF32(aR[0], aR[1], aR[2], aR[3]), outR + g, b.count - g);
+    }
+}
+
+template <int NUM_CHANNELS>
+inline void frameI16(const Batch<int16_t> &b, int f, __m128i &accL, __m128i &accR)
+{
+    auto m0 = (b.subPos[f] >> 12) & 0xff0;
+    auto lipol = _mm_set1_epi16(b.subPos[f] & 0xffff);
+    auto c0 = _mm_add_epi16(
+        _mm_mulhi_epi16(_mm_load_si128((const __m128i *)&sincTable.SincOffsetI16[m0]), lipol),
+        _mm_load_si128((const __m128i *)&sincTable.SincTableI16[m0]));
+    auto c1 = _mm_add_epi16(
+        _mm_mulhi_epi16(_mm_load_si128((const __m128i *)&sincTable.SincOffsetI16[m0 + 8]), lipol),
+        _mm_load_si128((const __m128i *)&sincTable.SincTableI16[m0 + 8]));
+
+    accL = _mm_add_epi32(_mm_madd_epi16(c0, _mm_loadu_si128((const __m128i *)b.readL[f])),
+                         _mm_madd_epi16(c1, _mm_loadu_si128((const __m128i *)(b.readL[f] + 8))));
+    if constexpr (NUM_CHANNELS == 2)
+        accR =
+            _mm_add_epi32(_mm_madd_epi16(c0, _mm_loadu_si128((const __m128i *)b.readR[f])),
+                          _mm_madd_epi16(c1, _mm_loadu_si128((const __m128i *)(b.readR[f] + 8))));
+}
+
+inline __m128 reduceI16(__m128i a0, __m128i a1, __m128i a2, __m128i a3)
+{
+    auto t0 = _mm_unpacklo_epi32(a0, a1);
+    auto t1 = _mm_unpacklo_epi32(a2, a3);
+    auto t2 = _mm_unpackhi_epi32(a0, a1);
+    auto t3 = _mm_unpackhi_epi32(a2, a3);
+    auto s = _mm_add_epi32(_mm_add_epi32(_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1)),
+                           _mm_add_epi32(_mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3)));
+    return _mm_mul_ps(_mm_cvtepi32_ps(s), _mm_set1_ps(I16InvScale));
+}
+
+template <int NUM_CHANNELS>
+void processI16SSE2(const Batch<int16_t> &b, float *outL, float *outR)
+{
+    for (int g = 0; g < b.count; g += 4)
+    {
+        __m128i aL[4], aR[4];
+        for (int j = 0; j < 4; ++j)
+            frameI16<NUM_CHANNELS>(b, frameIndex(b, g + j), aL[j], aR[j]);
+
+        storeFrames(reduceI16(aL[0], aL[1], aL[2], aL[3]), outL + g, b.count - g);
+        if constexpr (NUM_CHANNELS == 2)
+            storeFrames(reduceI16(aR[0], aR[1], aR[2], aR[3]), outR + g, b.count - g);
+    }
+}
+
+#if SCXT_HAS_AVX2_KERNELS
+/*
+ * The AVX2 kernels work on eight frames with frame j in the low half of a register and
+ * frame j + 4 in the high half. Each half then follows the SSE2 arithmetic exactly, and
+ * the in-lane transpose below leaves outputs 0-3 and 4-7 in order.
+ */
+SCXT_TARGET_AVX2 inline __m256 loadPair(const float *lo, const float *hi)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(lo)), _mm_loadu_ps(hi), 1);
+}
+
+SCXT_TARGET_AVX2 inline __m256 lipolPair(int32_t lo, int32_t hi)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps((float)(lo & 0xffff))),
+                                _mm_set1_ps((float)(hi & 0xffff)), 1);
+}
+
+SCXT_TARGET_AVX2 inline void storeFrames(__m256 v, float *out, int n)
+{
+    if (n >= 8)
+    {
+        _mm256_storeu_ps(out, v);
+    }
+    else
+    {
+        float tmp alignas(32)[8];
+        _mm256_store_ps(tmp, v);
+        for (int i = 0; i < n; ++i)
+            out[i] = tmp[i];
+    }
+}
+
+SCXT_TARGET_AVX2 inline __m256 reduceF32(__m256 a0, __m256 a1, __m256 a2, __m256 a3)
+{
+    auto t0 = _mm256_unpacklo_ps(a0, a1);
+    auto t1 = _mm256_unpacklo_ps(a2, a3);
+    auto t2 = _mm256_unpackhi_ps(a0, a1);
+    auto t3 = _mm256_unpackhi_ps(a2, a3);
+    auto r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+    auto r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+    auto r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    auto r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    return _mm256_add_ps(_mm256_add_ps(r0, r1), _mm256_add_ps(r2, r3));
+}
+
+template <int NUM_CHANNELS>
+SCXT_TARGET_AVX2 void processF32AVX2(const Batch<float> &b, float *outL, float *outR)
+{
+    if (b.count <= 4)
+    {
+        processF32SSE2<NUM_CHANNELS>(b, outL, outR);
+        return;
+    }
+
+    __m256 aL[4], aR[4];
+    for (int j = 0; j < 4; ++j)
+    {
+        auto lo = j;
+        auto hi = frameIndex(b, j + 4);
+        auto m0lo = (b.subPos[lo] >> 12) & 0xff0;
+        auto m0hi = (b.subPos[hi] >> 12) & 0xff0;
+        auto lipol = lipolPair(b.subPos[lo], b.subPos[hi]);
+
+        __m256 c[4];
+        for (int k = 0; k < 4; ++k)
+            c[k] = _mm256_add_ps(
+                _mm256_mul_ps(loadPair(&sincTable.SincOffsetF32[m0lo + 4 * k],
+                                       &sincTable.SincOffsetF32[m0hi + 4 * k]),
+                              lipol),
+                loadPair(&sincTable.SincTableF32[m0lo + 4 * k],
+                         &sincTable.SincTableF32[m0hi + 4 * k]));
+
+        aL[j] = _mm256_mul_ps(c[0], loadPair(b.readL[lo], b.readL[hi]));
+        for (int k = 1; k < 4; ++k)
+            aL[j] = _mm256_add_ps(
+                aL[j], _mm256_mul_ps(c[k], loadPair(b.readL[lo] + 4 * k, b.readL[hi] + 4 * k)));
+
+        if constexpr (NUM_CHANNELS == 2)
+        {
+            aR[j] = _mm256_mul_ps(c[0], loadPair(b.readR[lo], b.readR[hi]));
+            for (int k = 1; k < 4; ++k)
+                aR[j] = _mm256_add_ps(aR[j], _mm256_mul_ps(c[k], loadPair(b.readR[lo] + 4 * k,
+                                                                          b.readR[hi] + 4 * k)));
+        }
+    }
+
+    storeFrames(reduceF32(aL[0], aL[1], aL[2], aL[3]), outL, b.count);
+    if constexpr (NUM_CHANNELS == 2)
+        storeFrames(reduceF32(aR[0], aR[1], aR[2], aR[3]), outR, b.count);
+}
+
+// Same shape as processF32AVX2 with the table lerp and tap sums fused
+template <int NUM_CHANNELS>
+SCXT_TARGET_AVX2FMA void processF32AVX2FMA(const Batch<float> &b, float *outL, float *outR)
+{
+    __m256 aL[4], aR[4];
+    for (int j = 0; j < 4; ++j)
+    {
+        auto lo = frameIndex(b, j);
+        auto hi = frameIndex(b, j + 4);
+        auto m0lo = (b.subPos[lo] >> 12) & 0xff0;
+        auto m0hi = (b.subPos[hi] >> 12) & 0xff0;
+        auto lipol = lipolPair(b.subPos[lo], b.subPos[hi]);
+
+        __m256 c[4];
+        for (int k = 0; k < 4; ++k)
+            c[k] = _mm256_fmadd_ps(loadPair(&sincTable.SincOffsetF32[m0lo + 4 * k],
+                                            &sincTable.SincOffsetF32[m0hi + 4 * k]),
+                                   lipol,
+                                   loadPair(&sincTable.SincTableF32[m0lo + 4 * k],
+                                            &sincTable.SincTableF32[m0hi + 4 * k]));
+
+        aL[j] = _mm256_mul_ps(c[0], loadPair(b.readL[lo], b.readL[hi]));
+        for (int k = 1; k < 4; ++k)
+            aL[j] = _mm256_fmadd_ps(c[k], loadPair(b.readL[lo] + 4 * k, b.readL[hi] + 4 * k),
+                                    aL[j]);
+
+        if constexpr (NUM_CHANNELS == 2)
+        {
+            aR[j] = _mm256_mul_ps(c[0], loadPair(b.readR[lo], b.readR[hi]));
+            for (int k = 1; k < 4; ++k)
+                aR[j] = _mm256_fmadd_ps(c[k],
+                                        loadPair(b.readR[lo] + 4 * k, b.readR[hi] + 4 * k),
+                                        aR[j]);
+        }
+    }
+
+    storeFrames(reduceF32(aL[0], aL[1], aL[2], aL[3]), outL, b.count);
+    if constexpr (NUM_CHANNELS == 2)
+        storeFrames(reduceF32(aR[0], aR[1], aR[2], aR[3]), outR, b.count);
+}
+
+/*
+ * For int16 one 256 bit madd covers all 16 taps of a frame. Integer sums are exact in
+ * any order, so folding the halves and pairing frames j and j + 4 is still bit identical.
+ */
+SCXT_TARGET_AVX2 inline __m256i frameI16AVX2(const int16_t *d, int32_t subPos)
+{
+    auto m0 = (subPos >> 12) & 0xff0;
+    auto lipol = _mm256_set1_epi16(subPos & 0xffff);
+    auto c = _mm256_add_epi16(
+        _mm256_mulhi_epi16(_mm256_loadu_si256((const __m256i *)&sincTable.SincOffsetI16[m0]),
+                           lipol),
+        _mm256_loadu_si256((const __m256i *)&sincTable.SincTableI16[m0]));
+    return _mm256_madd_epi16(c, _mm256_loadu_si256((const __m256i *)d));
+}
+
+SCXT_TARGET_AVX2 inline __m256i foldPair(__m256i lo, __m256i hi)
+{
+    return _mm256_add_epi32(_mm256_permute2x128_si256(lo, hi, 0x20),
+                            _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+SCXT_TARGET_AVX2 inline __m256 reduceI16(__m256i a0, __m256i a1, __m256i a2, __m256i a3)
+{
+    auto t0 = _mm256_unpacklo_epi32(a0, a1);
+    auto t1 = _mm256_unpacklo_epi32(a2, a3);
+    auto t2 = _mm256_unpackhi_epi32(a0, a1);
+    auto t3 = _mm256_unpackhi_epi32(a2, a3);
+    auto s = _mm256_add_epi32(
+        _mm256_add_epi32(_mm256_unpacklo_epi64(t0, t1), _mm256_unpackhi_epi64(t0, t1)),
+        _mm256_add_epi32(_mm256_unpacklo_epi64(t2, t3), _mm256_unpackhi_epi64(t2, t3)));
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(s), _mm256_set1_ps(I16InvScale));
+}
+
+template <int NUM_CHANNELS>
+SCXT_TARGET_AVX2 void processI16AVX2(const Batch<int16_t> &b, float *outL, float *outR)
+{
+    if (b.count <= 4)
+    {
+        processI16SSE2<NUM_CHANNELS>(b, outL, outR);
+        return;
+    }
+
+    __m256i aL[4], aR[4];
+    for (int j = 0; j < 4; ++j)
+    {
+        auto lo = j;
+        auto hi = frameIndex(b, j + 4);
+        aL[j] = foldPair(frameI16AVX2(b.readL[lo], b.subPos[lo]),
+                         frameI16AVX2(b.readL[hi], b.subPos[hi]));
+        if constexpr (NUM_CHANNELS == 2)
+            aR[j] = foldPair(frameI16AVX2(b.readR[lo], b.subPos[lo]),
+                             frameI16AVX2(b.readR[hi], b.subPos[hi]));
+    }
+
+    storeFrames(reduceI16(aL[0], aL[1], aL[2], aL[3]), outL, b.count);
+    if constexpr (NUM_CHANNELS == 2)
+        storeFrames(reduceI16(aR[0], aR[1], aR[2], aR[3]), outR, b.count);
+}
+#endif
+} // namespace
+
+void processSSE2(const Batch<float> &b, int channels, float *outL, float *outR)
+{
+    if (channels == 2)
+        processF32SSE2<2>(b, outL, outR);
+    else
+        processF32SSE2<1>(b, outL, outR);
+}
+
+void processSSE2(const Batch<int16_t> &b, int channels, float *outL, float *outR)
+{
+    if (channels == 2)
+        processI16SSE2<2>(b, outL, outR);
+    else
+        processI16SSE2<1>(b, outL, outR);
+}
+
+#if SCXT_HAS_AVX2_KERNELS
+void processAVX2(const Batch<float> &b, int channels, float *outL, float *outR)
+{
+    if (channels == 2)
+        processF32AVX2<2>(b, outL, outR);
+    else
+        processF32AVX2<1>(b, outL, outR);
+}
+
+void processAVX2(const Batch<int16_t> &b, int channels, float *outL, float *outR)
+{
+    if (channels == 2)
+        processI16AVX2<2>(b, outL, outR);
+    else
+        processI16AVX2<1>(b, outL, outR);
+}
+
+void processAVX2FMA(const Batch<float> &b, int channels, float *outL, float *outR)
+{
+    if (channels == 2)
+        processF32AVX2FMA<2>(b, outL, outR);
+    else
+        processF32AVX2FMA<1>(b, outL, outR);
+}
+#endif
+} // namespace sincblock
+} // namespace scxt::dsp
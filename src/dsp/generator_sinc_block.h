@@ -0,0 +1,89 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_DSP_GENERATOR_SINC_BLOCK_H
+#define SCXT_SRC_DSP_GENERATOR_SINC_BLOCK_H
+
+#include <cstdint>
+#include <type_traits>
+#include "generator.h"
+#include "infrastructure/cpu_features.h"
+
+namespace scxt::dsp
+{
+constexpr float I16InvScale = (1.f / (16384.f * 32768.f));
+
+/*
+ * Block sinc kernels. The per-sample sinc kernel in generator.cpp reduces its 16 tap
+ * products with a pair of horizontal adds for every output frame. These kernels instead
+ * take a batch of frames the generator has already positioned, accumulate each frame
+ * vertically and then transpose four frames at a time so one vector add tree produces
+ * four outputs.
+ *
+ * The sums are formed in exactly the order the per-sample kernel uses, so the SSE2 and
+ * AVX2 kernels are bit identical to it. The FMA kernel fuses the multiply-adds and
+ * differs in the last bits, which is why it is a separate level.
+ */
+namespace sincblock
+{
+static constexpr int maxFrames{8};
+
+template <typename T> struct Batch
+{
+    const T *readL[maxFrames];
+    const T *readR[maxFrames];
+    int32_t subPos[maxFrames];
+    int32_t outputStart{0};
+    int32_t count{0};
+};
+
+void processSSE2(const Batch<float> &b, int channels, float *outL, float *outR);
+void processSSE2(const Batch<int16_t> &b, int channels, float *outL, float *outR);
+#if SCXT_HAS_AVX2_KERNELS
+void processAVX2(const Batch<float> &b, int channels, float *outL, float *outR);
+void processAVX2(const Batch<int16_t> &b, int channels, float *outL, float *outR);
+void processAVX2FMA(const Batch<float> &b, int channels, float *outL, float *outR);
+#endif
+
+template <SincKernelLevel L, typename T>
+inline void process(const Batch<T> &b, int channels, float *outL, float *outR)
+{
+    static_assert(L != SincKernelLevel::PerSample);
+#if SCXT_HAS_AVX2_KERNELS
+    if constexpr (L == SincKernelLevel::AVX2FMA && std::is_same_v<T, float>)
+        processAVX2FMA(b, channels, outL, outR);
+    else if constexpr (L == SincKernelLevel::AVX2 || L == SincKernelLevel::AVX2FMA)
+        processAVX2(b, channels, outL, outR);
+    else
+        processSSE2(b, channels, outL, outR);
+#else
+    processSSE2(b, channels, outL, outR);
+#endif
+}
+} // namespace sincblock
+} // namespace scxt::dsp
+#endif // SCXT_SRC_DSP_GENERATOR_SINC_BLOCK_H
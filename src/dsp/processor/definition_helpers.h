@@ -76,4 +76,10 @@
         static constexpr float defaultMix{mix};                                                    \
     };
 
+#define PROC_NEEDS_OVERSAMPLING(proct)                                                             \
+    template <> struct ProcessorNeedsOversampling<proct>                                           \
+    {                                                                                              \
+        static constexpr bool needsOversampling{true};                                             \
+    };
+
 #endif // SHORTCIRCUITXT_DEFINITION_HELPERS_H
@@ -28,6 +28,7 @@
 #include "processor.h"
 #include "datamodel/metadata.h"
 #include "processor_defs.h"
+#include "engine/memory_pool.h"
 
 #include <functional>
 #include <new>
@@ -121,6 +122,11 @@ template <size_t I> float implGetProcessorDefaultMix()
     return ProcessorDefaultMix<(ProcessorType)I>::defaultMix;
 }
 
+template <size_t I> bool implGetProcessorNeedsOversampling()
+{
+    return ProcessorNeedsOversampling<(ProcessorType)I>::needsOversampling;
+}
+
 template <size_t... Is> auto getProcessorDisplayGroup(size_t ft, std::index_sequence<Is...>)
 {
     constexpr constCharOp_t fnc[] = {detail::implGetProcessorDisplayGroup<Is>...};
@@ -132,6 +138,32 @@ template <size_t... Is> auto getProcessorDefaultMix(size_t ft, std::index_sequen
     constexpr floatOp_t fnc[] = {detail::implGetProcessorDefaultMix<Is>...};
     return fnc[ft]();
 }
+template <size_t I> size_t implGetProcessorMemorySize(bool oversample)
+{
+    if constexpr (I == ProcessorType::proct_none)
+        return 0;
+    else if constexpr (std::is_same<typename ProcessorImplementor<(ProcessorType)I>::T,
+                                    unimpl_t>::value)
+        return 0;
+    else
+        return oversample ? sizeof(typename ProcessorImplementor<(ProcessorType)I>::TOS)
+                          : sizeof(typename ProcessorImplementor<(ProcessorType)I>::T);
+}
+
+template <size_t... Is>
+auto getProcessorMemorySize(size_t ft, bool oversample, std::index_sequence<Is...>)
+{
+    using sizeOp_t = size_t (*)(bool);
+    constexpr sizeOp_t fnc[] = {detail::implGetProcessorMemorySize<Is>...};
+    return fnc[ft](oversample);
+}
+
+template <size_t... Is> auto getProcessorNeedsOversampling(size_t ft, std::index_sequence<Is...>)
+{
+    constexpr boolOp_t fnc[] = {detail::implGetProcessorNeedsOversampling<Is>...};
+    return fnc[ft]();
+}
+
 template <size_t I>
 Processor *returnSpawnOnto(uint8_t *m, engine::MemoryPool *mp, const ProcessorStorage &ps, float *f,
                            int *i, bool needsMetadata)
@@ -222,6 +254,28 @@ float getProcessorDefaultMix(ProcessorType id)
         id, std::make_index_sequence<(size_t)ProcessorType::proct_num_types>());
 }
 
+size_t getProcessorMemorySize(ProcessorType id, bool oversample)
+{
+    return detail::getProcessorMemorySize(
+        id, oversample, std::make_index_sequence<(size_t)ProcessorType::proct_num_types>());
+}
+
+void reserveVoiceMemory(engine::MemoryPool &pool, ProcessorType id)
+{
+    for (auto os : {false, true})
+    {
+        auto sz = getProcessorMemorySize(id, os);
+        if (sz > 0)
+            pool.preReservePool(sz, maxVoices);
+    }
+}
+
+bool getProcessorNeedsOversampling(ProcessorType id)
+{
+    return detail::getProcessorNeedsOversampling(
+        id, std::make_index_sequence<(size_t)ProcessorType::proct_num_types>());
+}
+
 std::optional<ProcessorType> fromProcessorStreamingName(const std::string &s)
 {
     // A bit gross but hey
@@ -262,13 +316,13 @@ processorList_t getAllProcessorDescriptions()
 
 /**
  * Spawn with in-place new onto a pre-allocated block. The memory must
- * be a 16byte aligned block of at least size processorMemoryBufferSize.
+ * be a 16byte aligned block of at least getProcessorMemorySize(id, oversample).
  */
 Processor *spawnProcessorInPlace(ProcessorType id, engine::MemoryPool *mp, uint8_t *memory,
                                  size_t memorySize, const ProcessorStorage &ps, float *f, int *i,
                                  bool oversample, bool needsMetadata)
 {
-    assert(memorySize >= processorMemoryBufferSize);
+    assert(memorySize >= getProcessorMemorySize(id, oversample));
     if (id == proct_none)
     {
         return nullptr;
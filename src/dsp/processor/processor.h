@@ -160,6 +160,8 @@ const char *getProcessorName(ProcessorType id);
 const char *getProcessorStreamingName(ProcessorType id);
 const char *getProcessorDisplayGroup(ProcessorType id);
 float getProcessorDefaultMix(ProcessorType id);
+// Nonlinear and audio rate processors alias at base rate; voices run these at 2x if they can
+bool getProcessorNeedsOversampling(ProcessorType id);
 std::optional<ProcessorType> fromProcessorStreamingName(const std::string &s);
 
 struct ProcessorDescription
@@ -177,6 +179,19 @@ processorList_t getAllProcessorDescriptions();
  */
 static constexpr size_t processorMemoryBufferSize{1028 * 16};
 
+/**
+ * The block size a given processor actually needs, which is usually far smaller than the
+ * above. Voices check blocks this size out of the memory pool. 0 for none or unimplemented.
+ */
+size_t getProcessorMemorySize(ProcessorType id, bool oversample);
+
+/**
+ * Make sure the pool holds a block of both the plain and oversampled size for every
+ * voice, so a chord of new voices never allocates on the audio thread. This allocates,
+ * so call it before the type reaches the audio thread; after that it is a no-op.
+ */
+void reserveVoiceMemory(engine::MemoryPool &pool, ProcessorType id);
+
 struct ProcessorStorage
 {
     ProcessorStorage()
@@ -325,7 +340,8 @@ struct Processor : MoveableOnly<Processor>, SampleRateSupport
 
 /**
  * Spawn with in-place new onto a pre-allocated block. The memory must
- * be a 16byte aligned block of at least size processorMemoryBufferSize.
+ * be a 16byte aligned block of at least getProcessorMemorySize(id, oversample);
+ * processorMemoryBufferSize is enough for any processor.
  */
 Processor *spawnProcessorInPlace(ProcessorType id, engine::MemoryPool *mp, uint8_t *memory,
                                  size_t memorySize, const ProcessorStorage &ps, float *f, int *i,
@@ -349,6 +365,11 @@ template <ProcessorType ft> struct ProcessorDefaultMix
     static constexpr float defaultMix{1.0};
 };
 
+template <ProcessorType ft> struct ProcessorNeedsOversampling
+{
+    static constexpr bool needsOversampling{false};
+};
+
 } // namespace scxt::dsp::processor
 
 SC_DESCRIBE(scxt::dsp::processor::ProcessorStorage,
@@ -56,6 +56,10 @@
  *      };
  *
  *  and then include the h here and everything will work
+ *
+ * 4. If the processor is nonlinear or makes audio rate sidebands, so aliases at base rate,
+ *    add PROC_NEEDS_OVERSAMPLING(proct_foo). In an oversampled group, voices only run at 2x
+ *    when they hold one of these or are pitched well up (see Voice::chooseOversampling).
  */
 
 #include "definition_helpers.h"
@@ -112,15 +116,19 @@ DEFINE_PROC(MicroGate, sst::voice_effects::delay::MicroGate<SCXTVFXConfig<1>>,
 DEFINE_PROC(BitCrusher, sst::voice_effects::distortion::BitCrusher<SCXTVFXConfig<1>>,
             sst::voice_effects::distortion::BitCrusher<SCXTVFXConfig<2>>, proct_fx_bitcrusher,
             "BitCrusher", "Distortion", "bit-crusher-fx");
+PROC_NEEDS_OVERSAMPLING(proct_fx_bitcrusher);
 DEFINE_PROC(WaveShaper, sst::voice_effects::waveshaper::WaveShaper<SCXTVFXConfig<1>>,
             sst::voice_effects::waveshaper::WaveShaper<SCXTVFXConfig<2>>, proct_fx_waveshaper,
             "WaveShaper", "Distortion", "waveshaper-fx");
+PROC_NEEDS_OVERSAMPLING(proct_fx_waveshaper);
 DEFINE_PROC(Slewer, sst::voice_effects::distortion::Slewer<SCXTVFXConfig<1>>,
             sst::voice_effects::distortion::Slewer<SCXTVFXConfig<2>>, proct_fx_slewer, "Slewer",
             "Distortion", "slewer-fx");
+PROC_NEEDS_OVERSAMPLING(proct_fx_slewer);
 DEFINE_PROC(TreeMonster, sst::voice_effects::distortion::TreeMonster<SCXTVFXConfig<1>>,
             sst::voice_effects::distortion::TreeMonster<SCXTVFXConfig<2>>, proct_fx_treemonster,
             "Treemonster", "Distortion", "treemonster-voice");
+PROC_NEEDS_OVERSAMPLING(proct_fx_treemonster);
 
 DEFINE_PROC(Compressor, sst::voice_effects::dynamics::Compressor<SCXTVFXConfig<1>>,
             sst::voice_effects::dynamics::Compressor<SCXTVFXConfig<2>>, proct_Compressor,
@@ -170,6 +178,7 @@ PROC_DEFAULT_MIX(proct_osc_tiltnoise, 0.5);
 DEFINE_PROC(StringResonator, sst::voice_effects::delay::StringResonator<SCXTVFXConfig<1>>,
             sst::voice_effects::delay::StringResonator<SCXTVFXConfig<2>>, proct_stringResonator,
             "String Resonator", "Generators", "stringex-fx", dsp::surgeSincTable);
+PROC_NEEDS_OVERSAMPLING(proct_stringResonator);
 
 DEFINE_PROC(CytomicSVF, sst::voice_effects::filter::CytomicSVF<SCXTVFXConfig<1>>,
             sst::voice_effects::filter::CytomicSVF<SCXTVFXConfig<2>>, proct_CytomicSVF, "Fast SVF",
@@ -177,6 +186,7 @@ DEFINE_PROC(CytomicSVF, sst::voice_effects::filter::CytomicSVF<SCXTVFXConfig<1>>
 DEFINE_PROC(SSTFilters, sst::voice_effects::filter::SSTFilters<SCXTVFXConfig<1>>,
             sst::voice_effects::filter::SSTFilters<SCXTVFXConfig<2>>, proct_SurgeFilters,
             "Surge Filters", "Filters", "filt-sstfilters");
+PROC_NEEDS_OVERSAMPLING(proct_SurgeFilters);
 DEFINE_PROC(StaticPhaser, sst::voice_effects::filter::StaticPhaser<SCXTVFXConfig<1>>,
             sst::voice_effects::filter::StaticPhaser<SCXTVFXConfig<2>>, proct_StaticPhaser,
             "Static Phaser", "Filters", "filt-statph");
@@ -187,15 +197,19 @@ DEFINE_PROC(FreqShiftMod, sst::voice_effects::modulation::FreqShiftMod<SCXTVFXCo
 DEFINE_PROC(PhaseMod, sst::voice_effects::modulation::PhaseMod<SCXTVFXConfig<1>>,
             sst::voice_effects::modulation::PhaseMod<SCXTVFXConfig<2>>, proct_osc_phasemod,
             "Phase Mod", "Audio Rate Mod", "osc-phase-mod");
+PROC_NEEDS_OVERSAMPLING(proct_osc_phasemod);
 DEFINE_PROC(FMFilter, sst::voice_effects::modulation::FMFilter<SCXTVFXConfig<1>>,
             sst::voice_effects::modulation::FMFilter<SCXTVFXConfig<2>>, proct_fmfilter, "FM Filter",
             "Audio Rate Mod", "filt-fm");
+PROC_NEEDS_OVERSAMPLING(proct_fmfilter);
 DEFINE_PROC(RingMod, sst::voice_effects::modulation::RingMod<SCXTVFXConfig<1>>,
             sst::voice_effects::modulation::RingMod<SCXTVFXConfig<2>>, proct_fx_ringmod, "Ring Mod",
             "Audio Rate Mod", "ringmod-fx");
+PROC_NEEDS_OVERSAMPLING(proct_fx_ringmod);
 DEFINE_PROC(NoiseAM, sst::voice_effects::modulation::NoiseAM<SCXTVFXConfig<1>>,
             sst::voice_effects::modulation::NoiseAM<SCXTVFXConfig<2>>, proct_noise_am, "Noise AM",
             "Audio Rate Mod", "noise-am");
+PROC_NEEDS_OVERSAMPLING(proct_noise_am);
 
 DEFINE_PROC(Tremolo, sst::voice_effects::modulation::Tremolo<SCXTVFXConfig<1>>,
             sst::voice_effects::modulation::Tremolo<SCXTVFXConfig<2>>, proct_Tremolo, "Tremolo",
@@ -31,6 +31,7 @@
 #include "sst/basic-blocks/mechanics/block-ops.h"
 
 #include "processor.h"
+#include "engine/render_profiler.h"
 
 namespace scxt::dsp::processor
 {
@@ -44,6 +45,7 @@ inline void runSingleProcessor(int i, float fpitch, Processor *processors[engine
     namespace mech = sst::basic_blocks::mechanics;
 
     float tempbuf alignas(16)[2][N];
+    engine::RenderProfiler::ProcessorScope profile(processors[i]->getType());
 
     endpoints->processorTarget[i].snapValues();
 
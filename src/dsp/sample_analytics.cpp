@@ -26,65 +26,37 @@
  */
 
 #include "sample_analytics.h"
-#include <limits>
-#include <cmath>
+#include "sample/sample_summary.h"
 
 namespace scxt::dsp::sample_analytics
 {
+// Both answer from the top of the sample's summary, which covers every frame, including
+// those of a streamed sample which are only on disk
 float computePeak(const std::shared_ptr<sample::Sample> &s)
 {
+    auto summary = s->getSummary();
     float peak = 0.0f;
-    for (size_t i = 0; i < s->getSampleLength(); i++)
+    for (int chan = 0; chan < summary->channels; chan++)
     {
-        for (int chan = 0; chan < s->channels; chan++)
-        {
-            float sample = 0.0;
-            switch (s->bitDepth)
-            {
-            case sample::Sample::BD_I16:
-                sample = static_cast<float>(s->GetSamplePtrI16(chan)[i]) /
-                         std::numeric_limits<int16_t>::max();
-                break;
-            case sample::Sample::BD_F32:
-                sample = s->GetSamplePtrF32(chan)[i];
-                break;
-            }
-            peak = std::max(peak, std::abs(sample));
-        }
+        peak = std::max(peak, summary->whole(chan).peak());
     }
     return peak;
 }
 
 float computeRMS(const std::shared_ptr<sample::Sample> &s)
 {
-    float ms = 0.0f;
-    const float divisor_recip =
-        1.0f / (static_cast<float>(s->channels) * static_cast<float>(s->getSampleLength()));
-    for (size_t i = 0; i < s->getSampleLength(); i++)
+    auto summary = s->getSummary();
+    if (summary->frames == 0 || summary->channels == 0)
     {
-        for (int chan = 0; chan < s->channels; chan++)
-        {
-            float sample = 0.0;
-            switch (s->bitDepth)
-            {
-            case sample::Sample::BD_I16:
-                sample = static_cast<float>(s->GetSamplePtrI16(chan)[i]) /
-                         std::numeric_limits<int16_t>::max();
-                break;
-            case sample::Sample::BD_F32:
-                sample = s->GetSamplePtrF32(chan)[i];
-                break;
-            }
-            ms += std::pow(sample, 2.0f) * divisor_recip;
-        }
+        // What should the RMS of an empty sample be?
+        return 0.0f;
     }
 
-    if (s->getSampleLength() > 0)
+    double sumSquares = 0.0;
+    for (int chan = 0; chan < summary->channels; chan++)
     {
-        return std::sqrt(ms);
+        sumSquares += summary->whole(chan).sumSquares;
     }
-
-    // What should the RMS of an empty sample be?
-    return 0.0f;
+    return std::sqrt(sumSquares / (static_cast<double>(summary->channels) * summary->frames));
 }
 } // namespace scxt::dsp::sample_analytics
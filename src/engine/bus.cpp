@@ -240,6 +240,7 @@ void Bus::process()
     {
         if (fx && busEffectStorage[idx].isActive)
         {
+            RenderProfiler::BusEffectScope profile(address, idx);
             fx->process(output[0], output[1]);
         }
         idx++;
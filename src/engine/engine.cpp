@@ -75,6 +75,8 @@ Engine::Engine()
     sampleManager = std::make_unique<sample::SampleManager>(messageController->threadingChecker);
     patch = std::make_unique<Patch>();
     patch->parentEngine = this;
+    partRenderPool = std::make_unique<PartRenderPool>();
+    renderProfiler = std::make_unique<RenderProfiler>();
 
     auto tdp = setupUserStorageDirectory();
     if (tdp.has_value())
@@ -86,10 +88,42 @@ Engine::Engine()
                 SCLOG("Defaults Parse Error :" << em << " " << t << std::endl);
             });
 
+        sampleManager->setStreamingPreloadFrames(std::max(
+            0, defaults->getUserDefaultValue(infrastructure::DefaultKeys::streamingPreloadFrames,
+                                             0)));
+        sampleManager->setMapWavInPlace(
+            defaults->getUserDefaultValue(infrastructure::DefaultKeys::mapWavInPlace, 0) == 1);
+        sampleManager->setCompressedHeadFrames(std::max(
+            0, defaults->getUserDefaultValue(
+                   infrastructure::DefaultKeys::compressedSampleHeadFrames, 0)));
+        // 0 leaves sample memory unbounded
+        sampleManager->setMemoryBudgetBytes(
+            (uint64_t)std::max(0, defaults->getUserDefaultValue(
+                                      infrastructure::DefaultKeys::sampleMemoryBudgetMB, 0))
+            << 20);
+
+        // 0 turns the decoded sample cache off
+        sampleManager->setupDecodedSampleCache(
+            *tdp / "DecodedSampleCache",
+            (uint64_t)std::max(0, defaults->getUserDefaultValue(
+                                      infrastructure::DefaultKeys::decodedSampleCacheMB, 2048))
+                << 20);
+
+        // 0 is adaptive, 1 always runs voices in oversampled groups at 2x
+        voiceOversampling =
+            defaults->getUserDefaultValue(infrastructure::DefaultKeys::voiceOversampling, 0) == 1
+                ? ALWAYS
+                : ADAPTIVE;
+
+        // Workers in addition to the audio thread; 0 renders every part on the audio thread
+        partRenderPool->start(
+            defaults->getUserDefaultValue(infrastructure::DefaultKeys::partRenderWorkers, 0));
+
         browserDb = std::make_unique<browser::BrowserDB>(*tdp);
         browser = std::make_unique<browser::Browser>(
             *browserDb, *defaults, *tdp,
             [this](const auto &a, const auto &b) { messageController->reportErrorToClient(a, b); });
+        sampleManager->setMD5SumCache(browserDb.get());
     }
     else
     {
@@ -127,6 +161,8 @@ Engine::Engine()
 
 Engine::~Engine()
 {
+    partRenderPool->stop();
+
     for (auto &v : voices)
     {
         if (v)
@@ -136,6 +172,8 @@ Engine::~Engine()
         }
     }
     messageController->stop();
+    // The browser db goes away before the sample manager
+    sampleManager->setMD5SumCache(nullptr);
     sampleManager->purgeUnreferencedSamples();
 
     /*
@@ -154,6 +192,53 @@ thread_local bool Engine::isFullEngineUnstream{false};
 thread_local Engine::StreamReason Engine::streamReason{StreamReason::IN_PROCESS};
 thread_local uint64_t Engine::fullEngineUnstreamStreamingVersion{0};
 
+size_t Engine::findZoneByScan(int16_t channel, int16_t key, int32_t noteId, int16_t velocity,
+                              std::array<pathToZone_t, maxVoices> &res)
+{
+    size_t idx{0};
+    for (const auto &[pidx, part] : sst::cpputils::enumerate(*patch))
+    {
+        if (!part->configuration.mute &&
+            (part->configuration.channel == channel ||
+             part->configuration.channel == Part::PartConfiguration::omniChannel))
+        {
+            for (const auto &[gidx, group] : sst::cpputils::enumerate(*part))
+            {
+                for (const auto &[zidx, zone] : sst::cpputils::enumerate(*group))
+                {
+                    if (zone->mapping.keyboardRange.includes(key) &&
+                        zone->mapping.velocityRange.includes(velocity))
+                    {
+                        res[idx] = {(size_t)pidx, (size_t)gidx, (size_t)zidx,
+                                    channel,      key,          noteId};
+                        idx++;
+                    }
+                }
+            }
+        }
+    }
+    return idx;
+}
+
+void Engine::rebuildZoneMappingIndexIfStale()
+{
+    assert(messageController->threadingChecker.isSerialThread());
+    auto gen = zoneMappingGeneration.load(std::memory_order_acquire);
+    if (gen == zoneMappingIndexBuiltGeneration)
+        return;
+    zoneMappingIndexBuiltGeneration = gen;
+
+    // The holder carries the new index to the audio thread and carries the old one
+    // back, so both the allocation and the free happen here on serial
+    auto holder = std::make_shared<std::unique_ptr<ZoneMappingIndex>>(
+        std::make_unique<ZoneMappingIndex>());
+    (*holder)->build(*patch, gen);
+
+    messageController->scheduleAudioThreadCallback(
+        [holder](auto &e) { std::swap(e.zoneMappingIndex, *holder); },
+        [holder](const auto &) { holder->reset(); });
+}
+
 voice::Voice *Engine::initiateVoice(const pathToZone_t &path)
 {
 #if DEBUG_VOICE_LIFECYCLE
@@ -182,6 +267,7 @@ voice::Voice *Engine::initiateVoice(const pathToZone_t &path)
             voices[idx]->channel = path.channel;
             voices[idx]->key = path.key;
             voices[idx]->noteId = path.noteid;
+            voices[idx]->startOffset = (int16_t)eventSampleOffset;
             voices[idx]->setSampleRate(sampleRate, sampleRateInv);
             voices[idx]->endpoints = std::move(mp);
             activeVoices++;
@@ -317,6 +403,7 @@ bool Engine::processAudio()
     updateTransportPhasors();
 
     getPatch()->process(*this);
+    renderProfiler->endBlock();
 
     auto &bl = sharedUIMemoryState.busVULevels;
     const auto &bs = getPatch()->busses;
@@ -387,6 +474,25 @@ bool Engine::processAudio()
     //  or...
     auto pct = time_span.count() * sampleRate * blockSizeInv * 100.0;
     sharedUIMemoryState.cpuLevel = std::max(sharedUIMemoryState.cpuLevel * 0.9995, pct);
+    sharedUIMemoryState.streamingUnderruns =
+        sampleManager->streamer->underruns.load(std::memory_order_relaxed);
+    sharedUIMemoryState.streamingFallbacks =
+        sampleManager->streamer->fallbacks.load(std::memory_order_relaxed);
+    sharedUIMemoryState.streamingWindowsExhausted =
+        sampleManager->streamer->windowsExhausted.load(std::memory_order_relaxed);
+    sharedUIMemoryState.memoryPoolMisses = memoryPool->getTotalMisses();
+    sharedUIMemoryState.sampleBudgetHits =
+        sampleManager->residentHits.load(std::memory_order_relaxed);
+    sharedUIMemoryState.sampleBudgetMisses =
+        sampleManager->evictedMisses.load(std::memory_order_relaxed);
+    if (memoryPool->takeRefillRequest())
+    {
+        messaging::audio::sendMemoryPoolRefill(*messageController);
+    }
+    if (sampleManager->takeReloadRequest())
+    {
+        messaging::audio::sendSampleReloadRequest(*messageController);
+    }
     return true;
 }
 
@@ -538,9 +644,12 @@ void Engine::loadSampleIntoSelectedPartAndGroup(const fs::path &p, int16_t rootK
     }
     else if (extensionMatches(p, ".sfz"))
     {
-        // TODO ok this refresh and restart is a bit unsatisfactory
-        messageController->stopAudioThreadThenRunOnSerial([this, p](const auto &) {
-            auto res = sfz_support::importSFZ(p, *this);
+        // Decode the samples while the audio thread keeps playing, then stop it to build
+        // the zones
+        auto prepared =
+            std::make_shared<sfz_support::PreparedSFZ>(sfz_support::prepareSFZImport(p, *this));
+        messageController->stopAudioThreadThenRunOnSerial([this, prepared](const auto &) {
+            auto res = sfz_support::applySFZImport(*prepared, *this);
             if (!res)
                 messageController->reportErrorToClient("SFZ Import Failed", "Dunno why");
             messageController->restartAudioThreadFromSerial();
@@ -684,7 +793,7 @@ void Engine::loadSf2MultiSampleIntoSelectedPart(const fs::path &p)
     {
         auto riff = std::make_unique<RIFF::File>(p.u8string());
         auto sf = std::make_unique<sf2::File>(riff.get());
-        auto md5 = infrastructure::createMD5SumFromFile(p);
+        auto md5 = infrastructure::createMD5SumFromFile(p, sampleManager->md5SumCache);
 
         auto pt = getSelectionManager()->selectedPart;
 
@@ -1007,6 +1116,193 @@ void Engine::sendFullRefreshToClient() const
     getSelectionManager()->sendOtherTabsSelectionToClient();
 }
 
+void Engine::startAsyncSampleLoads()
+{
+    assert(messageController->threadingChecker.isSerialThread());
+    if (!sampleManager->hasPendingLoads())
+        return;
+
+    // Unstream already reported anything missing up front
+    sampleManager->resetMissingList();
+    sampleManager->startPendingLoads();
+    messageController->updateClientActivityNotification(
+        fmt::format("Loading {} samples", sampleManager->pendingLoadTotal()), 1);
+}
+
+// Points every zone variant using one of samples at it. Runs on the audio thread
+static void attachSamplesToZones(Engine &e,
+                                 const std::vector<std::shared_ptr<sample::Sample>> &samples)
+{
+    for (auto &part : *e.getPatch())
+    {
+        for (auto &group : *part)
+        {
+            for (auto &zone : *group)
+            {
+                auto nbSampleLoaded{zone->getNumSampleLoaded()};
+                for (auto i = 0; i < nbSampleLoaded; ++i)
+                {
+                    const auto &sid = zone->variantData.variants[i].sampleID;
+                    for (const auto &smp : samples)
+                    {
+                        if (smp->id == sid)
+                            zone->samplePointers[i] = smp;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Engine::integrateAsyncSampleLoads()
+{
+    assert(messageController->threadingChecker.isSerialThread());
+    auto loaded = sampleManager->integrateCompletedLoads();
+    auto finished = !sampleManager->hasPendingLoads();
+
+    if (!loaded.empty())
+    {
+        auto attach = [samples = std::move(loaded)](Engine &e) {
+            attachSamplesToZones(e, samples);
+        };
+        auto attached = [finished](const Engine &e) {
+            if (finished)
+                e.sendFullRefreshToClient();
+        };
+
+        if (messageController->isAudioRunning)
+        {
+            messageController->scheduleAudioThreadCallback(attach, attached);
+        }
+        else
+        {
+            attach(*this);
+            attached(*this);
+        }
+    }
+    else if (finished)
+    {
+        sendFullRefreshToClient();
+    }
+
+    if (!finished)
+    {
+        if (!loaded.empty())
+        {
+            messageController->updateClientActivityNotification(
+                fmt::format("Loaded {} of {} samples", sampleManager->pendingLoadCompleted(),
+                            sampleManager->pendingLoadTotal()),
+                -1);
+        }
+        return;
+    }
+
+    messageController->updateClientActivityNotification("Samples loaded", 0);
+    if (!sampleManager->missingList.empty())
+    {
+        std::ostringstream oss;
+        oss << "On load, sample manager could not load the following files:\n";
+        for (const auto &p : sampleManager->missingList)
+        {
+            oss << "  " << p.u8string() << "\n";
+        }
+        messageController->reportErrorToClient("Missing Samples", oss.str());
+        sampleManager->resetMissingList();
+    }
+}
+
+void Engine::swapCandidateSamples(sample::SampleManager::Eviction &ev)
+{
+    for (const auto *v : voices)
+    {
+        if (v && v->isVoiceAssigned && v->zone && v->sampleIndex >= 0)
+        {
+            if (auto c = ev.find(v->zone->samplePointers[v->sampleIndex].get()))
+                c->playing = true;
+        }
+    }
+    for (auto &part : *patch)
+    {
+        for (auto &group : *part)
+        {
+            for (auto &zone : *group)
+            {
+                for (auto &sp : zone->samplePointers)
+                {
+                    // The manager still holds the sample so this never frees it here
+                    auto c = ev.find(sp.get());
+                    if (c && !c->playing)
+                        sp = c->standIn;
+                }
+            }
+        }
+    }
+}
+
+void Engine::enforceSampleMemoryBudget()
+{
+    assert(messageController->threadingChecker.isSerialThread());
+    auto ev = sampleManager->beginEviction();
+    if (!ev)
+        return;
+
+    auto swap = [ev](Engine &e) { e.swapCandidateSamples(*ev); };
+    auto done = [ev](const Engine &e) { e.getSampleManager()->completeEviction(*ev); };
+
+    if (messageController->isAudioRunning)
+    {
+        messageController->scheduleAudioThreadCallback(swap, done);
+    }
+    else
+    {
+        swap(*this);
+        done(*this);
+    }
+}
+
+void Engine::applyResidentSampleUpgrades()
+{
+    assert(messageController->threadingChecker.isSerialThread());
+    auto up = sampleManager->beginResidentUpgrade();
+    if (!up)
+        return;
+
+    auto swap = [up](Engine &e) { e.swapCandidateSamples(*up); };
+    auto done = [up](const Engine &e) { e.getSampleManager()->completeResidentUpgrade(*up); };
+
+    if (messageController->isAudioRunning)
+    {
+        messageController->scheduleAudioThreadCallback(swap, done);
+    }
+    else
+    {
+        swap(*this);
+        done(*this);
+    }
+}
+
+void Engine::integrateEvictedSampleReloads()
+{
+    assert(messageController->threadingChecker.isSerialThread());
+    auto loaded = sampleManager->integrateEvictedReloads();
+    if (loaded.empty())
+        return;
+
+    // The stand ins ride along so the audio thread never drops their last reference
+    auto attach = [samples = std::move(loaded),
+                   retired = sampleManager->takeRetiredSamples()](Engine &e) {
+        attachSamplesToZones(e, samples);
+    };
+    if (messageController->isAudioRunning)
+    {
+        messageController->scheduleAudioThreadCallback(attach);
+    }
+    else
+    {
+        attach(*this);
+    }
+}
+
 void Engine::clearAll()
 {
     selectionManager = std::make_unique<selection::SelectionManager>(*this);
@@ -41,6 +41,7 @@
 #include "sample/sample.h"
 #include "sample/sample_manager.h"
 
+#include <algorithm>
 #include <filesystem>
 #include <memory>
 #include <set>
@@ -49,6 +50,9 @@
 
 #include "selection/selection_manager.h"
 #include "memory_pool.h"
+#include "zone_mapping_index.h"
+#include "part_render_pool.h"
+#include "render_profiler.h"
 #include "tuning/midikey_retuner.h"
 #include "sst/basic-blocks/dsp/RNG.h"
 
@@ -118,8 +122,6 @@ struct Engine : MoveableOnly<Engine>, SampleRateSupport
      * blockSize sample block
      */
 
-    // TODO: This is obviusly a pretty inefficient search method. We can definitel
-    // pre-cache some of this lookup when the patch mutates
     struct pathToZone_t
     {
         size_t part{0};
@@ -130,9 +132,23 @@ struct Engine : MoveableOnly<Engine>, SampleRateSupport
         int16_t key{-1};
         int32_t noteid{-1};
     };
+
+    /**
+     * Find the zones which should sound for a channel / key / velocity. In the steady
+     * state this is answered from the ZoneMappingIndex, only visiting zones mapped to
+     * the key. If the index is stale (the patch mutated and the rebuild hasn't landed
+     * on the audio thread yet) we fall back to a full scan of the patch, which gives
+     * identical results in identical order.
+     */
     size_t findZone(int16_t channel, int16_t key, int32_t noteId, int16_t velocity,
                     std::array<pathToZone_t, maxVoices> &res)
     {
+        if (!isZoneMappingIndexCurrent() || key < 0 || key >= ZoneMappingIndex::numKeys)
+        {
+            return findZoneByScan(channel, key, noteId, velocity, res);
+        }
+
+        const auto *zmi = zoneMappingIndex.get();
         size_t idx{0};
         for (const auto &[pidx, part] : sst::cpputils::enumerate(*patch))
         {
@@ -140,23 +156,79 @@ struct Engine : MoveableOnly<Engine>, SampleRateSupport
                 (part->configuration.channel == channel ||
                  part->configuration.channel == Part::PartConfiguration::omniChannel))
             {
-                for (const auto &[gidx, group] : sst::cpputils::enumerate(*part))
+                const auto &span = zmi->spans[pidx][key];
+                for (auto i = span.begin; i < span.end; ++i)
                 {
-                    for (const auto &[zidx, zone] : sst::cpputils::enumerate(*group))
+                    const auto &en = zmi->entries[i];
+                    if (velocity >= 0 && velocity >= en.velStart && velocity <= en.velEnd)
                     {
-                        if (zone->mapping.keyboardRange.includes(key) &&
-                            zone->mapping.velocityRange.includes(velocity))
-                        {
-                            res[idx] = {(size_t)pidx, (size_t)gidx, (size_t)zidx,
-                                        channel,      key,          noteId};
-                            idx++;
-                        }
+                        res[idx] = {(size_t)pidx, en.group, en.zone, channel, key, noteId};
+                        idx++;
                     }
                 }
             }
         }
         return idx;
     }
+    // The walk over the whole patch which findZone falls back on
+    size_t findZoneByScan(int16_t channel, int16_t key, int32_t noteId, int16_t velocity,
+                          std::array<pathToZone_t, maxVoices> &res);
+    // Audio thread. Whether findZone answers from the index, which it does once the
+    // rebuild for the latest mapping generation has landed
+    bool isZoneMappingIndexCurrent() const
+    {
+        return zoneMappingIndex && zoneMappingIndex->generation ==
+                                       zoneMappingGeneration.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Any change to the zones in a group, the groups in a part, or a zone keyboard
+     * or velocity range must call this (after the change is made) so the zone mapping
+     * index gets rebuilt. It is safe to call from the audio or serialization thread.
+     */
+    void invalidateZoneMappingIndex()
+    {
+        zoneMappingGeneration.fetch_add(1, std::memory_order_acq_rel);
+    }
+    // Bumped by every invalidateZoneMappingIndex; parts key cached structure answers on it
+    uint64_t getZoneMappingGeneration() const
+    {
+        return zoneMappingGeneration.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Called from the serialization thread with the structure lock held. If the
+     * patch has changed since the last build, build a new index and swap it onto
+     * the audio thread.
+     */
+    void rebuildZoneMappingIndexIfStale();
+    bool isZoneMappingIndexStale() const
+    {
+        return zoneMappingGeneration.load(std::memory_order_acquire) !=
+               zoneMappingIndexBuiltGeneration;
+    }
+
+    /**
+     * Progressive sample loading for multis. startAsyncSampleLoads decodes whatever the
+     * sample manager deferred during unstream on its worker pool. integrateAsyncSampleLoads
+     * is polled from the serialization loop with the structure lock held while loads are
+     * pending; it attaches finished samples to their zones, so each zone becomes playable
+     * as its sample arrives, and keeps the client's activity notification up to date.
+     */
+    void startAsyncSampleLoads();
+    void integrateAsyncSampleLoads();
+
+    /**
+     * The sample memory budget (see SampleManager::memoryBudgetBytes), also polled from the
+     * serialization loop. enforceSampleMemoryBudget evicts on the audio thread any of the
+     * manager's chosen samples which no voice is playing, swapping their zones to the stand
+     * ins; integrateEvictedSampleReloads swaps reloaded samples back in the same way.
+     * applyResidentSampleUpgrades swaps streamed samples for their fully resident loads
+     * (see SampleManager::requestFullyResident) by the same route as an eviction.
+     */
+    void enforceSampleMemoryBudget();
+    void integrateEvictedSampleReloads();
+    void applyResidentSampleUpgrades();
 
     tuning::MidikeyRetuner midikeyRetuner;
 
@@ -230,6 +302,16 @@ struct Engine : MoveableOnly<Engine>, SampleRateSupport
     voice::Voice *initiateVoice(const pathToZone_t &path);
     void releaseVoice(int16_t channel, int16_t key, int32_t noteid, int32_t releaseVelocity);
 
+    /*
+     * Sample accurate note starts. A host with timestamped events sets this to the frame
+     * within the next processAudio block at which the event it is about to dispatch falls,
+     * and voices started by that event begin that many frames into the block rather than
+     * at its top. Other events still apply at the block. Audio thread only; clear it (or
+     * set the next event's offset) after dispatching.
+     */
+    int32_t eventSampleOffset{0};
+    void setEventSampleOffset(int32_t o) { eventSampleOffset = std::clamp(o, 0, blockSize - 1); }
+
     void releaseAllVoices();
     void stopAllSounds();
 
@@ -237,6 +319,17 @@ struct Engine : MoveableOnly<Engine>, SampleRateSupport
     void assertActiveVoiceCount();
     std::atomic<uint32_t> activeVoices{0};
 
+    /*
+     * How voices in an oversampled group pick their rate. ADAPTIVE runs a voice at 2x only
+     * when its pitch or its processors call for it and the zone brings the rest up to 2x;
+     * ALWAYS runs every voice in the group at 2x. Voices in base rate groups are unaffected.
+     */
+    enum VoiceOversampling
+    {
+        ADAPTIVE,
+        ALWAYS
+    } voiceOversampling{ADAPTIVE};
+
     const std::unique_ptr<messaging::MessageController> &getMessageController() const
     {
         return messageController;
@@ -331,6 +424,11 @@ struct Engine : MoveableOnly<Engine>, SampleRateSupport
 
         std::atomic<float> cpuLevel{0};
         std::atomic<float> ramUsage{0};
+        std::atomic<uint64_t> streamingUnderruns{0};
+        // Voices held in a streamed sample's head; of those, the ones which found no window
+        std::atomic<uint64_t> streamingFallbacks{0}, streamingWindowsExhausted{0};
+        std::atomic<uint64_t> memoryPoolMisses{0};
+        std::atomic<uint64_t> sampleBudgetHits{0}, sampleBudgetMisses{0};
     } sharedUIMemoryState;
 
     /* When we actually unstream an entire engine we want to know if we are doing
@@ -451,12 +549,25 @@ struct Engine : MoveableOnly<Engine>, SampleRateSupport
      */
     pgzStructure_t getPartGroupZoneStructure() const;
 
-    const std::unique_ptr<MemoryPool> &getMemoryPool()
+    const std::unique_ptr<MemoryPool> &getMemoryPool() const
     {
         assert(memoryPool);
         return memoryPool;
     }
 
+    const std::unique_ptr<PartRenderPool> &getPartRenderPool()
+    {
+        assert(partRenderPool);
+        return partRenderPool;
+    }
+
+    // Const so the debug actions, which get a const engine, can start and stop it
+    const std::unique_ptr<RenderProfiler> &getRenderProfiler() const
+    {
+        assert(renderProfiler);
+        return renderProfiler;
+    }
+
     std::atomic<int32_t> stopEngineRequests{0};
 
     /*
@@ -507,8 +618,13 @@ struct Engine : MoveableOnly<Engine>, SampleRateSupport
     std::optional<fs::path> setupUserStorageDirectory();
 
   private:
+    // Audio thread. Moves every zone not playing a candidate's sample to its stand in
+    void swapCandidateSamples(sample::SampleManager::Eviction &);
+
     std::unique_ptr<Patch> patch;
     std::unique_ptr<MemoryPool> memoryPool;
+    std::unique_ptr<PartRenderPool> partRenderPool;
+    std::unique_ptr<RenderProfiler> renderProfiler;
     std::unique_ptr<sample::SampleManager> sampleManager;
     std::unique_ptr<browser::BrowserDB> browserDb;
     std::unique_ptr<browser::Browser> browser;
@@ -517,6 +633,12 @@ struct Engine : MoveableOnly<Engine>, SampleRateSupport
     std::unique_ptr<uint8_t[]> voiceInPlaceBuffer{nullptr};
     std::unique_ptr<messaging::MessageController> messageController;
     std::unique_ptr<selection::SelectionManager> selectionManager;
+
+    // The audio thread owns zoneMappingIndex; the serialization thread owns the built
+    // generation and hands new indices over with an audio thread callback
+    std::unique_ptr<ZoneMappingIndex> zoneMappingIndex;
+    std::atomic<uint64_t> zoneMappingGeneration{1};
+    uint64_t zoneMappingIndexBuiltGeneration{0};
 };
 } // namespace scxt::engine
 #endif
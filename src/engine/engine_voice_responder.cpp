@@ -134,7 +134,14 @@ int32_t Engine::VoiceManagerResponder::initializeMultipleVoices(
                 }
             }
 
-            if (!z->samplePointers[z->sampleIndex])
+            auto &smp = z->samplePointers[z->sampleIndex];
+            if (smp)
+            {
+                // An evicted sample counts a miss and asks for a reload; the zone is silent
+                engine.getSampleManager()->noteSampleTriggered(*smp);
+            }
+
+            if (!smp || smp->isEvicted())
             {
                 // SCLOG( "Skipping voice with missing sample data" );
             }
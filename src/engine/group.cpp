@@ -78,6 +78,7 @@ template <bool OS> void Group::processWithOS(scxt::engine::Engine &e)
     if (lastOversample != outputInfo.oversample)
     {
         lastOversample = outputInfo.oversample;
+        parentPart->invalidateRendersOnlyToOwnBus();
         attack();
         for (int i = 0; i < engine::processorCount; ++i)
         {
@@ -143,7 +144,10 @@ template <bool OS> void Group::processWithOS(scxt::engine::Engine &e)
     {
         if (z->isActive())
         {
-            z->process(e);
+            {
+                RenderProfiler::ZonesScope profile;
+                z->process(e);
+            }
             /*
              * This is just an optimization to not accumulate. The zone will
              * have already routed to the approprite other bus and output will
@@ -290,6 +294,8 @@ void Group::addActiveZone()
     // isActive to be accurate with processor ringout
     activeZones++;
     ringoutTime = 0;
+    // Which zones are active decides whether the part can render on the pool
+    parentPart->invalidateRendersOnlyToOwnBus();
 }
 
 bool Group::updateRingout()
@@ -326,6 +332,7 @@ void Group::removeActiveZone()
 {
     assert(activeZones);
     activeZones--;
+    parentPart->invalidateRendersOnlyToOwnBus();
     if (activeZones == 0)
     {
         ringoutMax = 0;
@@ -348,6 +355,13 @@ const engine::Engine *Group::getEngine() const
     return nullptr;
 }
 
+void Group::invalidateZoneMappingIndex()
+{
+    auto *e = getEngine();
+    if (e)
+        e->invalidateZoneMappingIndex();
+}
+
 void Group::setupOnUnstream(const engine::Engine &e)
 {
     onRoutingChanged();
@@ -357,7 +371,7 @@ void Group::setupOnUnstream(const engine::Engine &e)
     {
         stepLfos[i].setSampleRate(sampleRate, sampleRateInv);
 
-        stepLfos[i].assign(&modulatorStorage[i], endpoints.lfo[i].rateP, nullptr, getEngine()->rng);
+        stepLfos[i].assign(&modulatorStorage[i], endpoints.lfo[i].rateP, nullptr, parentPart->rng);
     }
 
     for (int p = 0; p < processorCount; ++p)
@@ -469,7 +483,7 @@ void Group::resetLFOs(int whichLFO)
             stepLfos[i].setSampleRate(sampleRate, sampleRateInv);
 
             stepLfos[i].assign(&modulatorStorage[i], endpoints.lfo[i].rateP, nullptr,
-                               getEngine()->rng);
+                               parentPart->rng);
         }
         else if (lfoEvaluator[i] == CURVE)
         {
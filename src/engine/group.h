@@ -105,6 +105,7 @@ struct Group : MoveableOnly<Group>,
     {
         z->parentGroup = this;
         zones.push_back(std::move(z));
+        invalidateZoneMappingIndex();
         return zones.size();
     }
 
@@ -112,10 +113,15 @@ struct Group : MoveableOnly<Group>,
     {
         z->parentGroup = this;
         zones.push_back(std::move(z));
+        invalidateZoneMappingIndex();
         return zones.size();
     }
 
-    void clearZones() { zones.clear(); }
+    void clearZones()
+    {
+        zones.clear();
+        invalidateZoneMappingIndex();
+    }
 
     int getZoneIndex(const ZoneID &zid) const
     {
@@ -149,14 +155,22 @@ struct Group : MoveableOnly<Group>,
         auto res = std::move(zones[idx]);
         zones.erase(zones.begin() + idx);
         res->parentGroup = nullptr;
+        invalidateZoneMappingIndex();
         return res;
     }
 
     void swapZonesByIndex(size_t zoneIndex0, size_t zoneIndex1)
     {
         std::swap(zones[zoneIndex0], zones[zoneIndex1]);
+        invalidateZoneMappingIndex();
     }
 
+    /*
+     * The engine keeps a key/velocity index of zones for note on. Anything which changes
+     * the zone list or a zone mapping in a group attached to an engine calls this.
+     */
+    void invalidateZoneMappingIndex();
+
     bool isActive() const;
     void addActiveZone();
     void removeActiveZone();
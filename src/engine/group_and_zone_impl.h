@@ -83,6 +83,13 @@ void HasGroupZoneProcessors<T>::setupProcessorControlDescriptions(
         return;
     }
 
+    if constexpr (!forGroup)
+    {
+        // Voices check their processor out of the memory pool at its exact size. The
+        // set processor type message reserves before it gets here; this covers loads.
+        dsp::processor::reserveVoiceMemory(*asT()->getEngine()->getMemoryPool(), type);
+    }
+
     auto *tmpProcessor = tmpProcessorFromAfar;
 
     uint8_t memory[dsp::processor::processorMemoryBufferSize];
@@ -26,111 +26,248 @@
  */
 
 #include "memory_pool.h"
+#include <algorithm>
 #include <cassert>
+#include <new>
 
 namespace scxt::engine
 {
-/*
- * A massive TODO here. Right now this allocates on the audio thread but we
- * can instead have this have a message contrller refecence at construction time
- * and instead try to ask the audio thread to allocate.
- */
-
 MemoryPool::~MemoryPool()
 {
     assert(debugCheckouts == debugReturns);
 
-    for (auto &[sz, s] : cache)
+    for (auto &sc : classes)
     {
-        while (!s.empty())
+        auto cap = std::min(sc.capacity.load(), maxBlocksPerClass);
+        for (auto i = 0U; i < cap; ++i)
         {
-            delete[] s.front();
-            s.pop();
+            auto h = sc.blocks[i].load();
+            if (h)
+            {
+                h->~BlockHeader();
+                delete[] reinterpret_cast<data_t *>(h);
+            }
         }
     }
 }
 
-#define ALLOCATE_IMPLEMENTATION 0
-#if ALLOCATE_IMPLEMENTATION
-void MemoryPool::preReservePool(size_t blockSize) {}
-MemoryPool::data_t *MemoryPool::checkoutBlock(size_t blockSize)
+int MemoryPool::findClass(size_t blockSize) const
 {
-    // Technically don't need this in the naive impl but lets avoid some bugs
-    debugCheckouts++;
-    auto ubs = nearestBlock(blockSize);
-    return new data_t[ubs];
+    auto n = classCount.load(std::memory_order_acquire);
+    for (auto i = 0U; i < n; ++i)
+    {
+        if (classes[i].blockSize.load(std::memory_order_acquire) == blockSize)
+            return (int)i;
+    }
+    return -1;
 }
-void MemoryPool::returnBlock(data_t *block, size_t blockSize)
+
+int MemoryPool::findOrRegisterClass(size_t blockSize)
 {
-    debugReturns++;
-    delete[] block;
+    while (true)
+    {
+        auto idx = findClass(blockSize);
+        if (idx >= 0)
+            return idx;
+
+        auto n = classCount.load(std::memory_order_acquire);
+        if (n >= maxSizeClasses)
+            return -1;
+
+        // Slots are claimed in order so a racing registration of the same size
+        // shows up in the rescan rather than landing in a second slot
+        size_t expected{0};
+        if (classes[n].blockSize.compare_exchange_strong(expected, blockSize,
+                                                         std::memory_order_acq_rel))
+        {
+            classCount.store(n + 1, std::memory_order_release);
+            return (int)n;
+        }
+        while (classCount.load(std::memory_order_acquire) == n)
+            ;
+    }
+}
+
+MemoryPool::BlockHeader *MemoryPool::allocateBlock(uint32_t classIndex, bool addToClass)
+{
+    auto &sc = classes[classIndex];
+    auto mem = new data_t[headerSize + sc.blockSize.load(std::memory_order_relaxed)];
+    auto h = new (mem) BlockHeader();
+    h->sizeClass = classIndex;
+
+    if (addToClass)
+    {
+        auto idx = sc.capacity.fetch_add(1, std::memory_order_acq_rel);
+        if (idx < maxBlocksPerClass)
+        {
+            h->index = idx;
+            sc.blocks[idx].store(h, std::memory_order_release);
+        }
+        else
+        {
+            sc.capacity.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+    return h;
+}
+
+void MemoryPool::push(SizeClass &sc, BlockHeader *h)
+{
+    auto cur = sc.head.load(std::memory_order_relaxed);
+    uint64_t nxt;
+    do
+    {
+        h->next.store((uint32_t)(cur & 0xFFFFFFFF), std::memory_order_relaxed);
+        nxt = (((cur >> 32) + 1) << 32) | h->index;
+    } while (!sc.head.compare_exchange_weak(cur, nxt, std::memory_order_release,
+                                            std::memory_order_relaxed));
+    sc.available.fetch_add(1, std::memory_order_relaxed);
+}
+
+MemoryPool::BlockHeader *MemoryPool::pop(SizeClass &sc)
+{
+    auto cur = sc.head.load(std::memory_order_acquire);
+    while (true)
+    {
+        auto idx = (uint32_t)(cur & 0xFFFFFFFF);
+        if (idx == noIndex)
+            return nullptr;
+
+        // Headers are never freed while the pool lives, so reading 'next' of a block
+        // someone else just popped is harmless; the tag makes our CAS fail in that case
+        auto h = sc.blocks[idx].load(std::memory_order_acquire);
+        auto nxt = (((cur >> 32) + 1) << 32) | h->next.load(std::memory_order_relaxed);
+        if (sc.head.compare_exchange_weak(cur, nxt, std::memory_order_acq_rel,
+                                          std::memory_order_acquire))
+        {
+            sc.available.fetch_sub(1, std::memory_order_relaxed);
+            return h;
+        }
+    }
+}
+
+void MemoryPool::growClass(uint32_t classIndex, uint32_t byEntries)
+{
+    auto &sc = classes[classIndex];
+    for (auto i = 0U; i < byEntries; ++i)
+    {
+        auto h = allocateBlock(classIndex, true);
+        if (h->index == noIndex)
+        {
+            h->~BlockHeader();
+            delete[] reinterpret_cast<data_t *>(h);
+            break;
+        }
+        push(sc, h);
+    }
+}
+
+void MemoryPool::preReservePool(size_t requestBlockSize, uint32_t minBlocks)
+{
+    auto blockSize = nearestBlock(requestBlockSize);
+    auto idx = findOrRegisterClass(blockSize);
+    assert(idx >= 0); // If you hit this raise maxSizeClasses
+    if (idx < 0)
+        return;
+
+    auto &sc = classes[idx];
+    auto want = std::min(minBlocks, maxBlocksPerClass);
+    auto cap = sc.capacity.load(std::memory_order_acquire);
+    if (cap < want)
+    {
+        growClass(idx, want - cap);
+    }
 }
-#else
 
-static constexpr size_t initialPoolSize{16};
 MemoryPool::data_t *MemoryPool::checkoutBlock(size_t requestBlockSize)
 {
-    // Technically don't need this in the naive impl but lets avoid some bugs
     auto blockSize = nearestBlock(requestBlockSize);
-    auto cacheP = cache.find(blockSize);
-    assert(cacheP != cache.end()); // If you hit this you didn't pre-reserve
-    if (cacheP == cache.end())
+    auto idx = findClass(blockSize);
+    assert(idx >= 0); // If you hit this you didn't pre-reserve
+    if (idx < 0)
     {
         return nullptr;
     }
-    if (cacheP->second.empty())
+
+    auto &sc = classes[idx];
+    debugCheckouts++;
+    sc.checkouts.fetch_add(1, std::memory_order_relaxed);
+
+    auto h = pop(sc);
+    if (sc.available.load(std::memory_order_relaxed) < lowWaterMark)
     {
-        growBlock(requestBlockSize, initialPoolSize);
-        return checkoutBlock(requestBlockSize);
+        refillRequested.store(true, std::memory_order_release);
     }
 
-    debugCheckouts++;
-    auto res = cacheP->second.front();
-    cacheP->second.pop();
+    if (!h)
+    {
+        // The class ran dry before the refill got to it. Allocate here and let the
+        // block join the class when it comes back.
+        sc.misses.fetch_add(1, std::memory_order_relaxed);
+        totalMisses.fetch_add(1, std::memory_order_relaxed);
+        h = allocateBlock(idx, true);
+    }
 
     // Please leave these in. Handy to debug
-    // SCLOG(blockSize << " : Post checkout size is " << cacheP->second.size());
-    return res;
+    // SCLOG(blockSize << " : Post checkout size is " << sc.available);
+    return dataFor(h);
 }
+
 void MemoryPool::returnBlock(data_t *block, size_t requestBlockSize)
 {
     debugReturns++;
-    auto blockSize = nearestBlock(requestBlockSize);
-    auto cacheP = cache.find(blockSize);
-    assert(cacheP != cache.end()); // If you hit this you didn't pre-reserve
+    auto h = headerFor(block);
+    assert(classes[h->sizeClass].blockSize == nearestBlock(requestBlockSize));
 
-    cacheP->second.push(block);
+    if (h->index == noIndex)
+    {
+        // Only happens if a class overflowed maxBlocksPerClass on a miss
+        h->~BlockHeader();
+        delete[] reinterpret_cast<data_t *>(h);
+        return;
+    }
+    push(classes[h->sizeClass], h);
 
-    // SCLOG(blockSize << ": Post return size is " << cacheP->second.size());
+    // SCLOG(blockSize << ": Post return size is " << sc.available);
 }
 
-void MemoryPool::growBlock(size_t requestBlockSize, size_t byEntries)
+void MemoryPool::refill()
 {
-    auto blockSize = nearestBlock(requestBlockSize);
-    // SCLOG(blockSize << ": Growing pool " << blockSize);
-    auto cacheP = cache.find(blockSize);
-    assert(cacheP != cache.end()); // If you hit this you didn't pre-reserve
-
-    for (auto i = 0U; i < initialPoolSize; ++i)
+    auto n = classCount.load(std::memory_order_acquire);
+    for (auto i = 0U; i < n; ++i)
     {
-        cacheP->second.push(new data_t[blockSize]);
+        auto &sc = classes[i];
+        if (sc.available.load(std::memory_order_relaxed) >= lowWaterMark)
+            continue;
+
+        // Grow geometrically so a class under steady pressure stops asking
+        auto cap = sc.capacity.load(std::memory_order_relaxed);
+        auto by = std::min(std::max(initialPoolSize, cap / 2), maxBlocksPerClass - cap);
+        growClass(i, by);
+
+        auto misses = sc.misses.load(std::memory_order_relaxed);
+        if (misses != sc.missesAtLastRefill)
+        {
+            SCLOG("MemoryPool " << sc.blockSize << " byte class missed "
+                                << misses - sc.missesAtLastRefill
+                                << " checkouts since last refill. Capacity now " << sc.capacity);
+            sc.missesAtLastRefill = misses;
+        }
     }
-    // SCLOG(blockSize << ": Post grow size is " << cacheP->second.size());
 }
 
-void MemoryPool::preReservePool(size_t requestBlockSize)
+MemoryPool::SizeClassStats MemoryPool::getSizeClassStats(size_t idx) const
 {
-    auto blockSize = nearestBlock(requestBlockSize);
-    auto cacheP = cache.find(blockSize);
-    if (cacheP == cache.end())
-    {
-        auto cacheSet = pool_t();
-
-        cache.insert({blockSize, cacheSet});
-        growBlock(requestBlockSize, initialPoolSize);
-    }
-    // SCLOG(blockSize << ": Pre-Reserve cache found " << cache.at(blockSize).size() << " entries")
+    SizeClassStats res;
+    if (idx >= getSizeClassCount())
+        return res;
+    auto &sc = classes[idx];
+    res.blockSize = sc.blockSize.load(std::memory_order_relaxed);
+    res.capacity = sc.capacity.load(std::memory_order_relaxed);
+    res.available = sc.available.load(std::memory_order_relaxed);
+    res.checkouts = sc.checkouts.load(std::memory_order_relaxed);
+    res.misses = sc.misses.load(std::memory_order_relaxed);
+    return res;
 }
-#endif
 
-} // namespace scxt::engine
\ No newline at end of file
+} // namespace scxt::engine
@@ -28,38 +28,116 @@
 #ifndef SCXT_SRC_ENGINE_MEMORY_POOL_H
 #define SCXT_SRC_ENGINE_MEMORY_POOL_H
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <cctype>
-#include <unordered_map>
-#include <unordered_set>
-#include <queue>
 
 #include "utils.h"
 
 namespace scxt::engine
 {
+/*
+ * The memory pool hands fixed size blocks to processors (delay lines and the like).
+ * Blocks are grouped into size classes (the request rounded up to 1k) and each class
+ * keeps an intrusive lock-free free list, so checkoutBlock and returnBlock never lock
+ * and never allocate as long as the class has blocks.
+ *
+ * When a class drops below its low water mark a refill is requested. The audio thread
+ * forwards that to the serialization thread as a message and refill() grows the class
+ * there. If a class is actually empty at checkout we have no choice but to allocate
+ * on the calling thread; that is counted as a miss so we can see it and tune the pool.
+ *
+ * Registering a new class (preReservePool with a new size) allocates its initial blocks,
+ * and asking for more blocks than a class holds grows it to that. The engine reserves a
+ * block per voice on the serialization thread when a processor type is selected, so
+ * voice spawns on the audio thread find their classes already filled.
+ */
 struct MemoryPool : MoveableOnly<MemoryPool>
 {
     typedef uint8_t data_t;
 
+    static constexpr size_t maxSizeClasses{64};
+    static constexpr uint32_t maxBlocksPerClass{1024};
+    static constexpr uint32_t initialPoolSize{16};
+    static constexpr int32_t lowWaterMark{initialPoolSize / 4};
+
+    MemoryPool() = default;
     ~MemoryPool();
 
-    void preReservePool(size_t blockSize);
+    void preReservePool(size_t blockSize, uint32_t minBlocks = initialPoolSize);
 
     data_t *checkoutBlock(size_t blockSize);
     void returnBlock(data_t *block, size_t blockSize);
 
+    /*
+     * Low water handling. Any thread can raise the request; the audio thread takes it
+     * and posts a2s_memory_pool_refill, and the serialization thread runs refill().
+     */
+    bool isRefillRequested() const { return refillRequested.load(std::memory_order_acquire); }
+    bool takeRefillRequest() { return refillRequested.exchange(false, std::memory_order_acq_rel); }
+    void refill();
+
+    struct SizeClassStats
+    {
+        size_t blockSize{0};
+        uint32_t capacity{0};
+        int32_t available{0};
+        uint64_t checkouts{0}, misses{0};
+    };
+    size_t getSizeClassCount() const { return classCount.load(std::memory_order_acquire); }
+    SizeClassStats getSizeClassStats(size_t idx) const;
+    uint64_t getTotalMisses() const { return totalMisses.load(std::memory_order_relaxed); }
+
   private:
     template <size_t N = 10> static inline size_t nearestBlock(size_t x)
     {
         return ((x >> N) + 1) * (1 << N);
     }
-    void growBlock(size_t blockSize, size_t byEntries);
-    using pool_t = std::queue<data_t *>;
-    using cache_t = std::unordered_map<size_t, pool_t>;
-    cache_t cache;
 
-    int64_t debugCheckouts{0}, debugReturns{0};
+    static constexpr uint32_t noIndex{0xFFFFFFFF};
+
+    // Lives in front of every block we hand out. 'next' is the free list link.
+    struct alignas(16) BlockHeader
+    {
+        uint32_t sizeClass{0};
+        uint32_t index{noIndex}; // noIndex means the block is not owned by the class
+        std::atomic<uint32_t> next{noIndex};
+    };
+    static constexpr size_t headerSize{sizeof(BlockHeader)};
+    static_assert(headerSize % 16 == 0);
+
+    struct SizeClass
+    {
+        std::atomic<size_t> blockSize{0};
+        // low 32 bits index of the top free block, high 32 bits an ABA tag
+        std::atomic<uint64_t> head{noIndex};
+        std::atomic<uint32_t> capacity{0};
+        std::atomic<int32_t> available{0};
+        std::atomic<uint64_t> checkouts{0}, misses{0}, missesAtLastRefill{0};
+        std::array<std::atomic<BlockHeader *>, maxBlocksPerClass> blocks{};
+    };
+
+    static BlockHeader *headerFor(data_t *d)
+    {
+        return reinterpret_cast<BlockHeader *>(d - headerSize);
+    }
+    static data_t *dataFor(BlockHeader *h) { return reinterpret_cast<data_t *>(h) + headerSize; }
+
+    int findClass(size_t blockSize) const;
+    int findOrRegisterClass(size_t blockSize);
+    BlockHeader *allocateBlock(uint32_t classIndex, bool addToClass);
+    void growClass(uint32_t classIndex, uint32_t byEntries);
+
+    void push(SizeClass &sc, BlockHeader *h);
+    BlockHeader *pop(SizeClass &sc);
+
+    std::array<SizeClass, maxSizeClasses> classes;
+    std::atomic<size_t> classCount{0};
+    std::atomic<bool> refillRequested{false};
+    std::atomic<uint64_t> totalMisses{0};
+
+    std::atomic<int64_t> debugCheckouts{0}, debugReturns{0};
 };
 } // namespace scxt::engine
 
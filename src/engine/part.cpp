@@ -29,6 +29,7 @@
 #include "bus.h"
 #include "patch.h"
 #include "engine.h"
+#include "voice/voice.h"
 
 #include "selection/selection_manager.h"
 
@@ -37,20 +38,31 @@
 
 namespace scxt::engine
 {
+void Part::invalidateZoneMappingIndex()
+{
+    if (parentPatch && parentPatch->parentEngine)
+        parentPatch->parentEngine->invalidateZoneMappingIndex();
+}
+
 void Part::process(Engine &e)
 {
     namespace blk = sst::basic_blocks::mechanics;
+    RenderProfiler::PartScope profile(*e.getRenderProfiler(), partNumber);
 
     for (auto &sm : midiCCSmoothers)
         if (sm.active)
             sm.step();
     pitchBendSmoother.step();
 
+    int groupIndex{0};
     for (const auto &g : groups)
     {
         if (g->isActive())
         {
-            g->process(e);
+            {
+                RenderProfiler::GroupScope profileGroup(groupIndex);
+                g->process(e);
+            }
 
             auto bi = g->outputInfo.routeTo;
             if (bi == DEFAULT_BUS)
@@ -63,9 +75,48 @@ void Part::process(Engine &e)
             blk::accumulate_from_to<blockSize>(g->output[0], obus.output[0]);
             blk::accumulate_from_to<blockSize>(g->output[1], obus.output[1]);
         }
+        groupIndex++;
     }
 }
 
+bool Part::rendersOnlyToOwnBus(const Engine &e)
+{
+    auto gen = e.getZoneMappingGeneration();
+    if (!ownBusOnlyStale && gen == ownBusOnlyGeneration)
+        return ownBusOnly;
+    ownBusOnlyStale = false;
+    ownBusOnlyGeneration = gen;
+
+    auto walk = [this]() {
+        auto ownBus = (BusAddress)(PART_0 + partNumber);
+        for (const auto &g : groups)
+        {
+            if (!g->isActive())
+                continue;
+            if (g->outputInfo.routeTo != DEFAULT_BUS && g->outputInfo.routeTo != ownBus)
+                return false;
+            // Toggling oversample respawns group processors from the shared memory pool
+            if (g->lastOversample != g->outputInfo.oversample)
+                return false;
+            for (const auto &z : *g)
+            {
+                if (z->isActive() && z->outputInfo.routeTo != DEFAULT_BUS)
+                    return false;
+            }
+        }
+        return true;
+    };
+    ownBusOnly = walk();
+    return ownBusOnly;
+}
+
+void Part::runDeferredVoiceCleanup()
+{
+    for (size_t i = 0; i < deferredCleanupCount; ++i)
+        deferredCleanup[i]->cleanupVoice();
+    deferredCleanupCount = 0;
+}
+
 Part::zoneMappingSummary_t Part::getZoneMappingSummary()
 {
     zoneMappingSummary_t res;
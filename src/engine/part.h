@@ -40,6 +40,13 @@
 #include "bus.h"
 #include "macros.h"
 
+#include "sst/basic-blocks/dsp/RNG.h"
+
+namespace scxt::voice
+{
+struct Voice;
+}
+
 namespace scxt::engine
 {
 struct Patch;
@@ -79,6 +86,33 @@ struct Part : MoveableOnly<Part>, SampleRateSupport
     } configuration;
     void process(Engine &onto);
 
+    /*
+     * A part can render on the PartRenderPool as long as everything it plays lands on its
+     * own part bus, since other busses may be written by other parts at the same time.
+     * The answer is cached until the patch structure changes (see
+     * Engine::invalidateZoneMappingIndex) or invalidateRendersOnlyToOwnBus is called, which
+     * group and zone activity changes and routing or oversample edits do.
+     */
+    bool rendersOnlyToOwnBus(const Engine &e);
+    void invalidateRendersOnlyToOwnBus() { ownBusOnlyStale = true; }
+
+    /*
+     * Cleaning up a voice touches engine wide state (the voice manager, the memory pool)
+     * so while a part renders on a pool worker its zones hand finished voices here and the
+     * audio thread cleans them up after the pool joins.
+     */
+    bool deferVoiceCleanup{false};
+    void deferCleanup(voice::Voice *v)
+    {
+        assert(deferredCleanupCount < maxVoices);
+        deferredCleanup[deferredCleanupCount++] = v;
+    }
+    void runDeferredVoiceCleanup();
+
+    // Modulators in this part draw from here rather than the engine so parts rendering
+    // on different threads don't share a generator
+    sst::basic_blocks::dsp::RNG rng;
+
     // TODO: editable name
     std::string getName() const
     {
@@ -118,6 +152,7 @@ struct Part : MoveableOnly<Part>, SampleRateSupport
         g->name = cn;
 
         groups.push_back(std::move(g));
+        invalidateZoneMappingIndex();
         return groups.size();
     }
 
@@ -150,11 +185,16 @@ struct Part : MoveableOnly<Part>, SampleRateSupport
 
     uint32_t activeGroups{0};
     bool isActive() { return activeGroups != 0; }
-    void addActiveGroup() { activeGroups++; }
+    void addActiveGroup()
+    {
+        activeGroups++;
+        invalidateRendersOnlyToOwnBus();
+    }
     void removeActiveGroup()
     {
         assert(activeGroups);
         activeGroups--;
+        invalidateRendersOnlyToOwnBus();
     }
 
     std::array<dsp::Smoother, 128> midiCCSmoothers;
@@ -174,7 +214,11 @@ struct Part : MoveableOnly<Part>, SampleRateSupport
     typedef std::vector<std::unique_ptr<Group>> groupContainer_t;
 
     const groupContainer_t &getGroups() const { return groups; }
-    void clearGroups() { groups.clear(); }
+    void clearGroups()
+    {
+        groups.clear();
+        invalidateZoneMappingIndex();
+    }
     int getGroupIndex(const GroupID &zid) const
     {
         for (const auto &[idx, r] : sst::cpputils::enumerate(groups))
@@ -191,8 +235,11 @@ struct Part : MoveableOnly<Part>, SampleRateSupport
         auto res = std::move(groups[idx]);
         groups.erase(groups.begin() + idx);
         res->parentPart = nullptr;
+        invalidateZoneMappingIndex();
         return res;
     }
+    // See Group::invalidateZoneMappingIndex
+    void invalidateZoneMappingIndex();
     groupContainer_t::iterator begin() noexcept { return groups.begin(); }
     groupContainer_t::const_iterator cbegin() const noexcept { return groups.cbegin(); }
 
@@ -201,6 +248,10 @@ struct Part : MoveableOnly<Part>, SampleRateSupport
 
   private:
     groupContainer_t groups;
+    std::array<voice::Voice *, maxVoices> deferredCleanup{};
+    size_t deferredCleanupCount{0};
+    bool ownBusOnly{true}, ownBusOnlyStale{true};
+    uint64_t ownBusOnlyGeneration{0};
 };
 } // namespace scxt::engine
 
@@ -0,0 +1,203 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "part_render_pool.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "engine.h"
+#include "part.h"
+#include "infrastructure/sse_include.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SCXT_PART_RENDER_POOL_COPIES_CSR 1
+#else
+#define SCXT_PART_RENDER_POOL_COPIES_CSR 0
+#endif
+
+namespace scxt::engine
+{
+// Roughly a few tens of microseconds of pause instructions before a worker goes to sleep
+static constexpr int spinIterations{4096};
+
+PartRenderPool::~PartRenderPool() { stop(); }
+
+void PartRenderPool::start(int workerCount)
+{
+    stop();
+
+    workerCount = std::clamp(workerCount, 0, maxWorkers);
+    if (workerCount == 0)
+        return;
+
+    participants = workerCount + 1;
+    keepRunning = true;
+    for (int i = 0; i < workerCount; ++i)
+    {
+        workers.push_back(std::make_unique<std::thread>([this, i]() { runWorker(i + 1); }));
+    }
+    SCLOG("Part render pool started with " << workerCount << " workers");
+}
+
+void PartRenderPool::stop()
+{
+    if (workers.empty())
+        return;
+
+    keepRunning = false;
+    sleepCV.notify_all();
+    for (auto &w : workers)
+        w->join();
+    workers.clear();
+    participants = 1;
+}
+
+void PartRenderPool::render(Engine &e, Part *const *parts, int count)
+{
+    if (workers.empty() || count < 2)
+    {
+        for (int i = 0; i < count; ++i)
+            parts[i]->process(e);
+        return;
+    }
+
+    engine = &e;
+#if SCXT_PART_RENDER_POOL_COPIES_CSR
+    // Workers match our denormal and rounding modes so the result is the serial result
+    audioThreadCSR.store(_mm_getcsr(), std::memory_order_relaxed);
+#endif
+
+    auto nextEpoch = epoch.load(std::memory_order_relaxed) + 1;
+    std::array<int, numParts> dealt{};
+    for (int i = 0; i < count; ++i)
+    {
+        auto q = i % participants;
+        queues[q].tasks[dealt[q]++] = parts[i];
+        parts[i]->deferVoiceCleanup = true;
+    }
+    for (int q = 0; q < participants; ++q)
+    {
+        queues[q].count.store(dealt[q], std::memory_order_relaxed);
+        queues[q].state.store((uint64_t)nextEpoch << 32, std::memory_order_release);
+    }
+    remaining.store(count, std::memory_order_relaxed);
+    epoch.store(nextEpoch, std::memory_order_seq_cst);
+    // Pairs with the sleeper count in runWorker; spinning workers see the epoch anyway
+    if (sleepers.load(std::memory_order_seq_cst) > 0)
+        sleepCV.notify_all();
+
+    drain(0, nextEpoch);
+
+    // Whatever is left is being rendered by a worker. If that worker has been preempted
+    // stop spinning and let it have the core.
+    int spins{0};
+    while (remaining.load(std::memory_order_acquire) > 0)
+    {
+        if (++spins < spinIterations)
+            _mm_pause();
+        else
+            std::this_thread::yield();
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        parts[i]->deferVoiceCleanup = false;
+        parts[i]->runDeferredVoiceCleanup();
+    }
+}
+
+bool PartRenderPool::claim(Queue &q, uint32_t forEpoch, Part *&p)
+{
+    auto s = q.state.load(std::memory_order_acquire);
+    while (true)
+    {
+        if ((uint32_t)(s >> 32) != forEpoch)
+            return false;
+        auto idx = (int)(s & 0xFFFFFFFF);
+        if (idx >= q.count.load(std::memory_order_relaxed))
+            return false;
+        if (q.state.compare_exchange_weak(s, s + 1, std::memory_order_acq_rel,
+                                          std::memory_order_acquire))
+        {
+            p = q.tasks[idx];
+            return true;
+        }
+    }
+}
+
+void PartRenderPool::drain(int self, uint32_t forEpoch)
+{
+    // Our own queue first, then steal from everyone else in turn
+    for (int k = 0; k < participants; ++k)
+    {
+        auto &q = queues[(self + k) % participants];
+        Part *p{nullptr};
+        while (claim(q, forEpoch, p))
+        {
+            p->process(*engine);
+            remaining.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+}
+
+void PartRenderPool::runWorker(int self)
+{
+    auto seen = epoch.load(std::memory_order_acquire);
+    int idle{0};
+    while (keepRunning)
+    {
+        auto now = epoch.load(std::memory_order_acquire);
+        if (now != seen)
+        {
+            seen = now;
+#if SCXT_PART_RENDER_POOL_COPIES_CSR
+            auto csr = audioThreadCSR.load(std::memory_order_relaxed);
+            if (_mm_getcsr() != csr)
+                _mm_setcsr(csr);
+#endif
+            drain(self, now);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < spinIterations)
+        {
+            _mm_pause();
+            continue;
+        }
+
+        using namespace std::chrono_literals;
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        sleepCV.wait_for(lock, 1ms, [this, seen]() {
+            return !keepRunning || epoch.load(std::memory_order_seq_cst) != seen;
+        });
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+} // namespace scxt::engine
@@ -0,0 +1,111 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_ENGINE_PART_RENDER_POOL_H
+#define SCXT_SRC_ENGINE_PART_RENDER_POOL_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "configuration.h"
+#include "utils.h"
+
+namespace scxt::engine
+{
+struct Engine;
+struct Part;
+
+/**
+ * PartRenderPool renders the parts of a patch on several cores.
+ *
+ * Each block Patch::process hands over the active parts which only write their own part
+ * bus (Part::rendersOnlyToOwnBus). The audio thread deals those round robin into one queue
+ * per participant, publishes a new epoch, and then works through its own queue exactly
+ * like a worker; anyone whose queue runs dry steals from the others. Claiming a part is a
+ * compare-and-swap on the queue's (epoch, cursor) word, so participants never lock or
+ * wait on each other and a straggler from an earlier block can never claim into a newer
+ * one. Nothing is allocated once the workers are started.
+ *
+ * Workers spin for a short while after each block and then sleep on a condition variable
+ * with a short timeout. The audio thread notifies without taking the mutex, and only when
+ * a worker has said it is going to sleep, so a missed wakeup only means the audio thread
+ * renders more of that block itself.
+ *
+ * Finished voices are not cleaned up on the workers, since that touches engine wide voice
+ * state; see Part::deferVoiceCleanup.
+ */
+struct PartRenderPool : MoveableOnly<PartRenderPool>
+{
+    static constexpr int maxWorkers{numParts - 1};
+
+    PartRenderPool() = default;
+    ~PartRenderPool();
+
+    // Serialization thread only, and only when the audio thread is not processing
+    void start(int workerCount);
+    void stop();
+    int getWorkerCount() const { return (int)workers.size(); }
+
+    // Audio thread. Renders every part in parts and returns once they are all done
+    void render(Engine &e, Part *const *parts, int count);
+
+  private:
+    struct Queue
+    {
+        std::array<Part *, numParts> tasks{};
+        std::atomic<int> count{0};
+        // epoch in the high 32 bits, next task index in the low 32
+        std::atomic<uint64_t> state{0};
+    };
+
+    bool claim(Queue &q, uint32_t forEpoch, Part *&p);
+    void drain(int self, uint32_t forEpoch);
+    void runWorker(int self);
+
+    Engine *engine{nullptr};
+    int participants{1};
+    std::array<Queue, numParts> queues;
+    std::vector<std::unique_ptr<std::thread>> workers;
+
+    std::atomic<uint32_t> epoch{0};
+    std::atomic<int> remaining{0};
+    std::atomic<uint32_t> audioThreadCSR{0};
+    std::atomic<bool> keepRunning{false};
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCV;
+    std::atomic<int> sleepers{0};
+};
+} // namespace scxt::engine
+
+#endif // SCXT_SRC_ENGINE_PART_RENDER_POOL_H
@@ -26,6 +26,8 @@
  */
 
 #include "patch.h"
+#include "engine.h"
+#include "part_render_pool.h"
 #include "sst/basic-blocks/mechanics/block-ops.h"
 
 namespace scxt::engine
@@ -33,6 +35,7 @@ namespace scxt::engine
 void Patch::process(Engine &e)
 {
     namespace mech = sst::basic_blocks::mechanics;
+    RenderProfiler::PatchScope profile(*e.getRenderProfiler());
 
     // Clear the busses
     busses.mainBus.clear();
@@ -41,12 +44,33 @@ void Patch::process(Engine &e)
     for (auto &b : busses.auxBusses)
         b.clear();
 
-    // Run each of the parts, accumulating onto the engine busses
-    for (const auto &part : parts)
+    // Run each of the parts, accumulating onto the engine busses. Parts which only write
+    // their own bus can go to the render pool; anything routed elsewhere runs here first.
+    auto &pool = e.getPartRenderPool();
+    if (pool->getWorkerCount() > 0)
+    {
+        std::array<Part *, numParts> concurrent;
+        int concurrentCount{0};
+        for (const auto &part : parts)
+        {
+            if (!part->isActive())
+                continue;
+
+            if (part->rendersOnlyToOwnBus(e))
+                concurrent[concurrentCount++] = part.get();
+            else
+                part->process(e);
+        }
+        pool->render(e, concurrent.data(), concurrentCount);
+    }
+    else
     {
-        if (part->isActive())
+        for (const auto &part : parts)
         {
-            part->process(e);
+            if (part->isActive())
+            {
+                part->process(e);
+            }
         }
     }
 
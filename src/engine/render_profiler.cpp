@@ -0,0 +1,305 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "render_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "engine.h"
+
+namespace scxt::engine
+{
+thread_local RenderProfiler::Context RenderProfiler::context;
+
+static int64_t steadyNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+uint64_t RenderProfiler::ticks()
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+    uint64_t v;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return (uint64_t)steadyNanos();
+#endif
+}
+
+void RenderProfiler::start()
+{
+    if (!counters)
+    {
+        counters = std::make_unique<uint64_t[]>(slotCount);
+        published = std::make_unique<std::atomic<uint64_t>[]>(slotCount);
+        for (size_t i = 0; i < slotCount; ++i)
+            published[i].store(0, std::memory_order_relaxed);
+    }
+    resetRequested.store(true, std::memory_order_release);
+    if (!running.exchange(true, std::memory_order_acq_rel))
+        runningProfilers++;
+}
+
+void RenderProfiler::stop()
+{
+    if (running.exchange(false, std::memory_order_acq_rel))
+        runningProfilers--;
+}
+
+uint64_t *RenderProfiler::beginBlock()
+{
+    if (!running.load(std::memory_order_acquire))
+    {
+        if (blockCounters)
+        {
+            // Publish what we have so a report after stopping is complete
+            publish();
+            blockCounters = nullptr;
+        }
+        return nullptr;
+    }
+
+    if (resetRequested.exchange(false, std::memory_order_acq_rel))
+    {
+        std::memset(counters.get(), 0, slotCount * sizeof(uint64_t));
+        startTicks = ticks();
+        startNanos = steadyNanos();
+        publish();
+    }
+    blockCounters = counters.get();
+    context = Context{blockCounters, -1, -1, false};
+    return blockCounters + patchSlot;
+}
+
+void RenderProfiler::endBlock()
+{
+    if (!blockCounters)
+        return;
+
+    blockCounters[hBlocks]++;
+    if (++blocksSincePublish >= publishEveryBlocks)
+        publish();
+}
+
+void RenderProfiler::publish()
+{
+    counters[hTicks] = ticks() - startTicks;
+    counters[hNanos] = (uint64_t)(steadyNanos() - startNanos);
+
+    auto s = sequence.load(std::memory_order_relaxed);
+    sequence.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < slotCount; ++i)
+    {
+        // Most slots are idle, and skipping unchanged ones keeps their cache lines clean
+        if (published[i].load(std::memory_order_relaxed) != counters[i])
+            published[i].store(counters[i], std::memory_order_relaxed);
+    }
+    sequence.store(s + 2, std::memory_order_release);
+    blocksSincePublish = 0;
+}
+
+bool RenderProfiler::snapshot(Snapshot &into) const
+{
+    if (!published)
+        return false;
+
+    into.ticks.resize(slotCount);
+    while (true)
+    {
+        auto s0 = sequence.load(std::memory_order_acquire);
+        if (s0 & 1)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < slotCount; ++i)
+            into.ticks[i] = published[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == s0)
+            break;
+    }
+
+    into.blocks = into.ticks[hBlocks];
+    if (into.blocks == 0 || into.ticks[hTicks] == 0)
+        return false;
+    into.nanosPerTick = (double)into.ticks[hNanos] / into.ticks[hTicks];
+    into.patchNanos = into.ticks[patchSlot] * into.nanosPerTick;
+    return true;
+}
+
+std::string RenderProfiler::report(const Engine &e) const
+{
+    Snapshot snap;
+    if (!snapshot(snap))
+        return {};
+
+    const auto &t = snap.ticks;
+    std::ostringstream oss;
+    auto emit = [&](const std::string &stack, uint64_t v) {
+        auto ns = std::llround(v * snap.nanosPerTick);
+        if (ns > 0)
+            oss << stack << " " << ns << "\n";
+    };
+    auto selfOf = [](uint64_t total, uint64_t children) {
+        return total > children ? total - children : 0;
+    };
+
+    namespace proc = dsp::processor;
+    std::array<std::string, proc::proct_num_types> processorFrames;
+    for (int pt = 0; pt < proc::proct_num_types; ++pt)
+    {
+        std::string n = proc::getProcessorName((proc::ProcessorType)pt);
+        std::replace(n.begin(), n.end(), ';', ',');
+        processorFrames[pt] = n;
+    }
+
+    const auto &patch = e.getPatch();
+    uint64_t patchChildren{0};
+    for (int p = 0; p < numParts; ++p)
+    {
+        auto partTicks = t[partBase + p];
+        if (partTicks == 0)
+            continue;
+        patchChildren += partTicks;
+
+        auto partFrame = "patch;part " + std::to_string(p + 1);
+        const auto &part = patch->getPart(p);
+        auto groupCount = part ? part->getGroups().size() : 0;
+        uint64_t partChildren{0};
+        for (int g = 0; g < maxProfiledGroups; ++g)
+        {
+            const auto *run = t.data() + groupRun(p, g);
+            if (run[groupSlot] == 0)
+                continue;
+            partChildren += run[groupSlot];
+
+            auto groupFrame = partFrame + ";group " + std::to_string(g + 1);
+            if (g == maxProfiledGroups - 1 && groupCount > maxProfiledGroups)
+                groupFrame += "+";
+
+            uint64_t groupProcessors{0}, voiceProcessors{0};
+            for (int pt = 0; pt < proc::proct_num_types; ++pt)
+            {
+                auto gp = run[processorBase + pt];
+                auto vp = run[processorBase + proc::proct_num_types + pt];
+                emit(groupFrame + ";" + processorFrames[pt], gp);
+                emit(groupFrame + ";zones;voices;" + processorFrames[pt], vp);
+                groupProcessors += gp;
+                voiceProcessors += vp;
+            }
+            emit(groupFrame + ";zones;voices", selfOf(run[voicesSlot], voiceProcessors));
+            emit(groupFrame + ";zones", selfOf(run[zonesSlot], run[voicesSlot]));
+            emit(groupFrame, selfOf(run[groupSlot], run[zonesSlot] + groupProcessors));
+        }
+        emit(partFrame, selfOf(partTicks, partChildren));
+    }
+
+    for (int b = 0; b < busCount; ++b)
+    {
+        std::string busFrame;
+        if (b == MAIN_0)
+            busFrame = "patch;main bus";
+        else if (b < AUX_0)
+            busFrame = "patch;part " + std::to_string(b - PART_0 + 1) + " bus";
+        else
+            busFrame = "patch;aux " + std::to_string(b - AUX_0 + 1) + " bus";
+
+        const auto &bus = patch->busses.busByAddress((BusAddress)b);
+        for (int fx = 0; fx < maxEffectsPerBus; ++fx)
+        {
+            auto v = t[busEffectBase + b * maxEffectsPerBus + fx];
+            patchChildren += v;
+            emit(busFrame + ";fx " + std::to_string(fx + 1) + " " +
+                     toStringAvailableBusEffects(bus.busEffectStorage[fx].type),
+                 v);
+        }
+    }
+
+    emit("patch", selfOf(t[patchSlot], patchChildren));
+    return oss.str();
+}
+
+uint64_t *RenderProfiler::enterGroup(int group)
+{
+    if (!context.counters)
+        return nullptr;
+    context.group = std::min(group, maxProfiledGroups - 1);
+    return slot(groupSlot);
+}
+
+uint64_t *RenderProfiler::enterVoice()
+{
+    if (!context.counters)
+        return nullptr;
+    context.inVoice = true;
+    return slot(voicesSlot);
+}
+
+RenderProfiler::PatchScope::PatchScope(RenderProfiler &p) : timer(p.beginBlock()) {}
+
+RenderProfiler::PatchScope::~PatchScope()
+{
+    if (timer.slot)
+        context = Context{};
+}
+
+RenderProfiler::PartScope::PartScope(RenderProfiler &p, int part)
+{
+    // blockCounters is set by the audio thread before the render pool starts on the block
+    if (!p.blockCounters)
+        return;
+
+    // On the audio thread the prior context is the patch's; on a worker it is empty
+    prior = context;
+    context = Context{p.blockCounters, part, -1, false};
+    timer.slot = p.blockCounters + partBase + part;
+    timer.start = ticks();
+}
+
+RenderProfiler::PartScope::~PartScope()
+{
+    if (timer.slot)
+        context = prior;
+}
+} // namespace scxt::engine
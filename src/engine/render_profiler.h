@@ -0,0 +1,240 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_ENGINE_RENDER_PROFILER_H
+#define SCXT_SRC_ENGINE_RENDER_PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "configuration.h"
+#include "utils.h"
+#include "dsp/processor/processor.h"
+
+namespace scxt::engine
+{
+struct Engine;
+
+/**
+ * RenderProfiler is an opt-in, hierarchical CPU profile of the render.
+ *
+ * While it runs, Patch::process, Part::process, each group, the zones and voices of each
+ * group, every group and voice processor and every bus effect time themselves with the
+ * cycle counter and add into a fixed slot, so the profile reads patch > part > group >
+ * zones > voices > processor type, with the bus effects under the patch. Groups past
+ * maxProfiledGroups share the last group slot. The scopes find their slots through a
+ * thread local context which PatchScope and PartScope set up, so the parts the render
+ * pool runs on its workers land in the right place and the dsp code needs no engine.
+ * With no profile running anywhere, each scope is one relaxed load and a branch.
+ *
+ * The counters belong to the render threads. Every publishEveryBlocks blocks, and once
+ * more when profiling stops, the audio thread copies them into atomics under a sequence
+ * counter, so snapshot() and report() read them without a lock. report() writes the
+ * snapshot as folded stacks (one "patch;part 1;group 2;zones;voices;SuperSVF 1234" line
+ * per node with its self time in nanoseconds) for flamegraph.pl, speedscope and friends.
+ *
+ * Part times are summed over threads, so with the render pool running the parts can add
+ * up to more than the patch which waited for them.
+ */
+struct RenderProfiler : MoveableOnly<RenderProfiler>
+{
+    static constexpr int maxProfiledGroups{16};
+    static constexpr int busCount{1 + numParts + numAux};
+    static constexpr uint32_t publishEveryBlocks{256};
+
+    RenderProfiler() = default;
+    ~RenderProfiler() { stop(); }
+
+    // Serialization thread
+    void start();
+    void stop();
+    bool isRunning() const { return running.load(std::memory_order_acquire); }
+
+    struct Snapshot
+    {
+        uint64_t blocks{0};
+        double nanosPerTick{0};
+        double patchNanos{0};
+        std::vector<uint64_t> ticks;
+    };
+    // Serialization thread. False if nothing has been published since the last start
+    bool snapshot(Snapshot &into) const;
+    // Folded stacks of the latest snapshot, empty if there is none yet
+    std::string report(const Engine &e) const;
+
+    // Audio thread, once per block after the patch has rendered
+    void endBlock();
+
+    static uint64_t ticks();
+
+  private:
+    struct Context
+    {
+        uint64_t *counters{nullptr};
+        int part{-1};
+        int group{-1};
+        bool inVoice{false};
+    };
+
+    // How many profilers, across every engine in the process, are running
+    static inline std::atomic<int> runningProfilers{0};
+    static bool anyRunning() { return runningProfilers.load(std::memory_order_relaxed) != 0; }
+
+  public:
+    struct Timer
+    {
+        explicit Timer(uint64_t *s) : slot(s)
+        {
+            if (slot)
+                start = ticks();
+        }
+        ~Timer()
+        {
+            if (slot)
+                *slot += ticks() - start;
+        }
+        uint64_t *slot;
+        uint64_t start{0};
+    };
+
+    /*
+     * The scopes. Patch and part scopes are entered once per block and set up the thread's
+     * context; the others check runningProfilers first so that with no profile running
+     * they never touch the thread local.
+     */
+    struct PatchScope
+    {
+        explicit PatchScope(RenderProfiler &p);
+        ~PatchScope();
+        Timer timer;
+    };
+    struct PartScope
+    {
+        PartScope(RenderProfiler &p, int part);
+        ~PartScope();
+        Context prior;
+        Timer timer{nullptr};
+    };
+    struct GroupScope
+    {
+        explicit GroupScope(int group) : timer(anyRunning() ? enterGroup(group) : nullptr) {}
+        ~GroupScope()
+        {
+            if (timer.slot)
+                context.group = -1;
+        }
+        Timer timer;
+    };
+    struct ZonesScope
+    {
+        ZonesScope() : timer(anyRunning() ? slot(zonesSlot) : nullptr) {}
+        Timer timer;
+    };
+    struct VoiceScope
+    {
+        VoiceScope() : timer(anyRunning() ? enterVoice() : nullptr) {}
+        ~VoiceScope()
+        {
+            if (timer.slot)
+                context.inVoice = false;
+        }
+        Timer timer;
+    };
+    struct ProcessorScope
+    {
+        explicit ProcessorScope(dsp::processor::ProcessorType t)
+            : timer(anyRunning() ? slot(processorBase + (context.inVoice ? procTypes : 0) + t)
+                                 : nullptr)
+        {
+        }
+        Timer timer;
+    };
+    struct BusEffectScope
+    {
+        // bus is the BusAddress of the bus running the effect
+        BusEffectScope(int bus, int fxSlot)
+            : timer(anyRunning() && context.counters && bus >= 0 && bus < busCount
+                        ? context.counters + busEffectBase + bus * maxEffectsPerBus + fxSlot
+                        : nullptr)
+        {
+        }
+        Timer timer;
+    };
+
+  private:
+    /*
+     * The counters are one flat array: a small header, the patch, the parts, then a run of
+     * groupStride slots per (part, group) and the bus effects at the end. Voice processors
+     * follow the group processors in each group's run.
+     */
+    static constexpr size_t hBlocks{0}, hTicks{1}, hNanos{2}, patchSlot{3}, partBase{4};
+    static constexpr size_t groupSlot{0}, zonesSlot{1}, voicesSlot{2}, processorBase{3};
+    static constexpr size_t procTypes{dsp::processor::proct_num_types};
+    static constexpr size_t groupStride{processorBase + 2 * procTypes};
+    static constexpr size_t groupBase{partBase + numParts};
+    static constexpr size_t busEffectBase{groupBase +
+                                          numParts * maxProfiledGroups * groupStride};
+    static constexpr size_t slotCount{busEffectBase + busCount * maxEffectsPerBus};
+
+    static size_t groupRun(int part, int group)
+    {
+        return groupBase + (part * maxProfiledGroups + group) * groupStride;
+    }
+
+    static thread_local Context context;
+    static uint64_t *enterGroup(int group);
+    static uint64_t *enterVoice();
+    static uint64_t *slot(size_t inGroup)
+    {
+        auto &c = context;
+        if (!c.counters || c.group < 0)
+            return nullptr;
+        return c.counters + groupRun(c.part, c.group) + inGroup;
+    }
+
+    std::atomic<bool> running{false};
+    std::atomic<bool> resetRequested{false};
+
+    // The render threads' counters, and whether this block is being profiled
+    std::unique_ptr<uint64_t[]> counters;
+    uint64_t *blockCounters{nullptr};
+    uint64_t startTicks{0};
+    int64_t startNanos{0};
+    uint32_t blocksSincePublish{0};
+    uint64_t *beginBlock();
+
+    // What endBlock publishes; odd sequence numbers mean a publish is under way
+    std::unique_ptr<std::atomic<uint64_t>[]> published;
+    std::atomic<uint32_t> sequence{0};
+    void publish();
+};
+} // namespace scxt::engine
+
+#endif // SCXT_SRC_ENGINE_RENDER_PROFILER_H
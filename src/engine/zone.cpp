@@ -60,6 +60,31 @@ template <bool OS> void Zone::processWithOS(scxt::engine::Engine &onto)
 
     mUILag.process();
 
+    processVoiceStepLFOs();
+
+    auto accumulateToOutput = [this](float *L, float *R) {
+        if (outputInfo.routeTo == DEFAULT_BUS)
+        {
+            blk::accumulate_from_to<osBlock>(L, output[0]);
+            blk::accumulate_from_to<osBlock>(R, output[1]);
+        }
+        else if (outputInfo.routeTo >= 0)
+        {
+            auto &bs = getEngine()->getPatch()->busses;
+            auto &tb = bs.busByAddress(outputInfo.routeTo);
+            blk::accumulate_from_to<osBlock>(L, OS ? tb.outputOS[0] : tb.output[0]);
+            blk::accumulate_from_to<osBlock>(R, OS ? tb.outputOS[1] : tb.output[1]);
+            if constexpr (OS)
+            {
+                tb.hasOSSignal = true;
+            }
+        }
+    };
+
+    // Base rate voices in an oversampled group, or 2x voices in a base rate one
+    constexpr size_t otherRateBlock{blockSize << (OS ? 0 : 1)};
+    hasOtherRateSignal = false;
+
     std::array<voice::Voice *, maxVoices> toCleanUp;
     size_t cleanupIdx{0};
     gatedVoiceCount = 0;
@@ -69,23 +94,19 @@ template <bool OS> void Zone::processWithOS(scxt::engine::Engine &onto)
         {
             if (v->process())
             {
-                if (outputInfo.routeTo == DEFAULT_BUS)
+                if (v->forceOversample == OS)
                 {
-                    blk::accumulate_from_to<osBlock>(v->output[0], output[0]);
-                    blk::accumulate_from_to<osBlock>(v->output[1], output[1]);
+                    accumulateToOutput(v->output[0], v->output[1]);
                 }
-                else if (outputInfo.routeTo >= 0)
+                else
                 {
-                    auto &bs = getEngine()->getPatch()->busses;
-                    auto &tb = bs.busByAddress(outputInfo.routeTo);
-                    blk::accumulate_from_to<osBlock>(v->output[0],
-                                                     OS ? tb.outputOS[0] : tb.output[0]);
-                    blk::accumulate_from_to<osBlock>(v->output[1],
-                                                     OS ? tb.outputOS[1] : tb.output[1]);
-                    if constexpr (OS)
+                    if (!hasOtherRateSignal)
                     {
-                        tb.hasOSSignal = true;
+                        memset(otherRateOutput, 0, sizeof(otherRateOutput));
+                        hasOtherRateSignal = true;
                     }
+                    blk::accumulate_from_to<otherRateBlock>(v->output[0], otherRateOutput[0]);
+                    blk::accumulate_from_to<otherRateBlock>(v->output[1], otherRateOutput[1]);
                 }
             }
             if (!v->isVoicePlaying)
@@ -100,12 +121,41 @@ template <bool OS> void Zone::processWithOS(scxt::engine::Engine &onto)
         }
     }
 
+    if (hasOtherRateSignal)
+    {
+        // As with the bus downsampler, start the filter clean rather than from whatever it
+        // held when we last converted (or converted the other way)
+        if (!previousHadOtherRateSignal || otherRateWasUp != OS)
+        {
+            rateConverter.reset();
+        }
+        if constexpr (OS)
+        {
+            float up alignas(16)[2][blockSize << 1];
+            rateConverter.process_block_U2(otherRateOutput[0], otherRateOutput[1], up[0], up[1],
+                                           blockSize << 1);
+            accumulateToOutput(up[0], up[1]);
+        }
+        else
+        {
+            rateConverter.process_block_D2(otherRateOutput[0], otherRateOutput[1],
+                                           blockSize << 1);
+            accumulateToOutput(otherRateOutput[0], otherRateOutput[1]);
+        }
+        otherRateWasUp = OS;
+    }
+    previousHadOtherRateSignal = hasOtherRateSignal;
+
+    auto *part = parentGroup->parentPart;
     for (int i = 0; i < cleanupIdx; ++i)
     {
 #if DEBUG_VOICE_LIFECYCLE
         SCLOG("Cleanup Voice at " << SCDBGV((int)toCleanUp[i]->key));
 #endif
-        toCleanUp[i]->cleanupVoice();
+        if (part->deferVoiceCleanup)
+            part->deferCleanup(toCleanUp[i]);
+        else
+            toCleanUp[i]->cleanupVoice();
     }
 
     for (int i = 0; i < osBlock; i += 4)
@@ -116,6 +166,26 @@ template <bool OS> void Zone::processWithOS(scxt::engine::Engine &onto)
     }
 }
 
+void Zone::processVoiceStepLFOs()
+{
+    std::array<modulation::modulators::StepLFO *, maxVoices> lfos;
+    for (auto i = 0U; i < lfosPerZone; ++i)
+    {
+        size_t n{0};
+        for (auto &v : voiceWeakPointers)
+        {
+            // Same conditions under which the voice would run it
+            if (v && v->isVoiceAssigned && v->isVoicePlaying && v->lfosActive[i] &&
+                v->lfoEvaluator[i] == voice::Voice::STEP)
+            {
+                lfos[n++] = &v->stepLfos[i];
+            }
+        }
+        if (n)
+            modulation::modulators::processStepLFOBatch(lfos.data(), n);
+    }
+}
+
 void Zone::addVoice(voice::Voice *v)
 {
     if (activeVoices == 0)
@@ -35,6 +35,7 @@
 #include "keyboard.h"
 
 #include "sst/basic-blocks/dsp/Lag.h"
+#include "sst/filters/HalfRateFilter.h"
 #include "sample/sample_manager.h"
 #include "dsp/processor/processor.h"
 #include "modulation/voice_matrix.h"
@@ -159,8 +160,21 @@ struct Zone : MoveableOnly<Zone>, HasGroupZoneProcessors<Zone>, SampleRateSuppor
     static_assert(std::is_standard_layout<ZoneOutputInfo>::value);
 
     float output alignas(16)[2][blockSize << 1];
+
+    /*
+     * Voices pick their own rate (Voice::chooseOversampling), so in an oversampled group
+     * some run at base rate, and if the group toggles oversampling mid note the playing
+     * voices keep the rate they started with. Voices not at the group's rate are summed
+     * here at their own rate and brought to the group's once per block.
+     */
+    float otherRateOutput alignas(16)[2][blockSize << 1];
+    bool hasOtherRateSignal{false}, previousHadOtherRateSignal{false}, otherRateWasUp{false};
+    sst::filters::HalfRate::HalfRateFilter rateConverter{6, true};
+
     void process(Engine &onto);
     template <bool OS> void processWithOS(Engine &onto);
+    // Step LFOs for all our playing voices, batched across voices. Voices don't run their own.
+    void processVoiceStepLFOs();
 
     std::string givenName{};
     std::string getName() const
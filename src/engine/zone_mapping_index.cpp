@@ -0,0 +1,66 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "zone_mapping_index.h"
+
+#include "patch.h"
+#include "part.h"
+#include "group.h"
+#include "zone.h"
+
+namespace scxt::engine
+{
+void ZoneMappingIndex::build(const Patch &patch, uint64_t forGeneration)
+{
+    generation = forGeneration;
+    entries.clear();
+
+    // Lay the entries out part by part, key by key, keeping patch order within
+    // each key so lookups return zones in exactly the order the full scan did
+    for (int pidx = 0; pidx < numParts; ++pidx)
+    {
+        const auto &part = patch.getPart(pidx);
+        for (int16_t key = 0; key < numKeys; ++key)
+        {
+            auto &span = spans[pidx][key];
+            span.begin = entries.size();
+            for (const auto &[gidx, group] : sst::cpputils::enumerate(part->getGroups()))
+            {
+                for (const auto &[zidx, zone] : sst::cpputils::enumerate(group->getZones()))
+                {
+                    if (zone->mapping.keyboardRange.includes(key))
+                    {
+                        const auto &vr = zone->mapping.velocityRange;
+                        entries.push_back({(uint32_t)gidx, (uint32_t)zidx, vr.velStart, vr.velEnd});
+                    }
+                }
+            }
+            span.end = entries.size();
+        }
+    }
+}
+} // namespace scxt::engine
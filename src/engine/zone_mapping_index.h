@@ -0,0 +1,79 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+#ifndef SCXT_SRC_ENGINE_ZONE_MAPPING_INDEX_H
+#define SCXT_SRC_ENGINE_ZONE_MAPPING_INDEX_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "configuration.h"
+#include "utils.h"
+
+namespace scxt::engine
+{
+struct Patch;
+
+/**
+ * ZoneMappingIndex is a precomputed answer to "which zones in which parts can sound
+ * for this key". For each part and each of the 128 midi keys we keep a contiguous run
+ * of (group, zone, velocity range) entries, in patch order, so a note on only visits the
+ * zones actually mapped to its key rather than walking the entire patch.
+ *
+ * The index is built on the serialization thread from a consistent view of the patch
+ * (under the structure lock) and handed to the audio thread whole, so the audio thread
+ * never sees a partially built index. Each index is tagged with the engine mapping
+ * generation it was built from; the engine bumps that generation whenever zones, groups
+ * or mappings change, and a stale index is simply ignored until its replacement arrives.
+ *
+ * Part-level state (mute, channel) is deliberately *not* baked in. It is cheap to check
+ * at lookup time and changes without any structural mutation.
+ */
+struct ZoneMappingIndex : MoveableOnly<ZoneMappingIndex>
+{
+    static constexpr int16_t numKeys{128};
+
+    struct Entry
+    {
+        uint32_t group{0}, zone{0};
+        int16_t velStart{0}, velEnd{127};
+    };
+
+    struct Span
+    {
+        uint32_t begin{0}, end{0};
+    };
+
+    void build(const Patch &patch, uint64_t forGeneration);
+
+    uint64_t generation{0};
+    std::array<std::array<Span, numKeys>, numParts> spans{};
+    std::vector<Entry> entries;
+};
+} // namespace scxt::engine
+
+#endif // SCXT_SRC_ENGINE_ZONE_MAPPING_INDEX_H
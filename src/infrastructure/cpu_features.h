@@ -0,0 +1,95 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_INFRASTRUCTURE_CPU_FEATURES_H
+#define SCXT_SRC_INFRASTRUCTURE_CPU_FEATURES_H
+
+/*
+ * Runtime dispatch to AVX2 kernels. The kernels live in ordinary baseline translation units,
+ * marked SCXT_TARGET_AVX2 (or SCXT_TARGET_AVX2FMA) so only they use the wider instructions,
+ * and are only called once cpuFeatures() says both the CPU and the OS support them.
+ * SCXT_HAS_AVX2_KERNELS says whether this target compiles them at all.
+ */
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SCXT_HAS_AVX2_KERNELS 1
+#else
+#define SCXT_HAS_AVX2_KERNELS 0
+#endif
+
+#if SCXT_HAS_AVX2_KERNELS && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SCXT_TARGET_AVX2 __attribute__((target("avx2")))
+#define SCXT_TARGET_AVX2FMA __attribute__((target("avx2,fma")))
+#else
+#define SCXT_TARGET_AVX2
+#define SCXT_TARGET_AVX2FMA
+#endif
+
+namespace scxt::infrastructure
+{
+struct CPUFeatures
+{
+    bool avx2{false};
+    bool fma{false};
+};
+
+// Detected on first use
+inline const CPUFeatures &cpuFeatures()
+{
+    static const CPUFeatures features = []() {
+        CPUFeatures res;
+#if SCXT_HAS_AVX2_KERNELS
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return res;
+        __cpuid(info, 1);
+        auto fma = (info[2] & (1 << 12)) != 0;
+        auto osxsave = (info[2] & (1 << 27)) != 0;
+        auto avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+            return res;
+        __cpuidex(info, 7, 0);
+        res.avx2 = (info[1] & (1 << 5)) != 0;
+        res.fma = res.avx2 && fma;
+#else
+        __builtin_cpu_init();
+        res.avx2 = __builtin_cpu_supports("avx2");
+        res.fma = res.avx2 && __builtin_cpu_supports("fma");
+#endif
+#endif
+        return res;
+    }();
+    return features;
+}
+} // namespace scxt::infrastructure
+
+#endif // SCXT_SRC_INFRASTRUCTURE_CPU_FEATURES_H
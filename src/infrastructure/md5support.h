@@ -28,6 +28,8 @@
 #ifndef SCXT_SRC_INFRASTRUCTURE_MD5SUPPORT_H
 #define SCXT_SRC_INFRASTRUCTURE_MD5SUPPORT_H
 
+#include <cstdint>
+#include <optional>
 #include <string>
 #include "filesystem_import.h"
 #include "file_map_view.h"
@@ -44,5 +46,44 @@ inline std::string createMD5SumFromFile(const fs::path &path)
     return md5::MD5::Hash(fmp.data(), fmp.dataSize());
 }
 
+/*
+ * Something which remembers file MD5s across sessions (the BrowserDB does). Entries are
+ * keyed on path, size and modification time, so a changed file simply misses.
+ */
+struct MD5SumCache
+{
+    virtual ~MD5SumCache() = default;
+    virtual std::optional<std::string> lookupMD5Sum(const fs::path &path, uint64_t size,
+                                                    int64_t mtime) = 0;
+    virtual void storeMD5Sum(const fs::path &path, uint64_t size, int64_t mtime,
+                             const std::string &md5) = 0;
+};
+
+/*
+ * As above but consult the cache first, and remember the result on a miss. A null
+ * cache just hashes.
+ */
+inline std::string createMD5SumFromFile(const fs::path &path, MD5SumCache *cache)
+{
+    if (!cache)
+        return createMD5SumFromFile(path);
+
+    std::error_code ec;
+    auto size = (uint64_t)fs::file_size(path, ec);
+    if (ec)
+        return {};
+    auto mtime = (int64_t)fs::last_write_time(path, ec).time_since_epoch().count();
+    if (ec)
+        return createMD5SumFromFile(path);
+
+    if (auto res = cache->lookupMD5Sum(path, size, mtime); res.has_value())
+        return *res;
+
+    auto md5 = createMD5SumFromFile(path);
+    if (!md5.empty())
+        cache->storeMD5Sum(path, size, mtime, md5);
+    return md5;
+}
+
 } // namespace scxt::infrastructure
 #endif // SHORTCIRCUITXT_MD5SUPPORT_H
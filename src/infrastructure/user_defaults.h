@@ -42,6 +42,13 @@ enum DefaultKeys
     colormapPathIfFile,
     welcomeScreenSeen,
     playModeExpanded,
+    streamingPreloadFrames,
+    partRenderWorkers,
+    decodedSampleCacheMB,
+    voiceOversampling,
+    mapWavInPlace,
+    compressedSampleHeadFrames,
+    sampleMemoryBudgetMB,
 
     nKeys // must be last K?
 };
@@ -67,6 +74,20 @@ inline std::string defaultKeyToString(DefaultKeys k)
         return "welcomeScreenSeen";
     case playModeExpanded:
         return "playModeExpanded";
+    case streamingPreloadFrames:
+        return "streamingPreloadFrames";
+    case partRenderWorkers:
+        return "partRenderWorkers";
+    case decodedSampleCacheMB:
+        return "decodedSampleCacheMB";
+    case voiceOversampling:
+        return "voiceOversampling";
+    case mapWavInPlace:
+        return "mapWavInPlace";
+    case compressedSampleHeadFrames:
+        return "compressedSampleHeadFrames";
+    case sampleMemoryBudgetMB:
+        return "sampleMemoryBudgetMB";
     default:
         std::terminate(); // for now
     }
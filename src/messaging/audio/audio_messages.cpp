@@ -40,4 +40,22 @@ void sendStructureRefresh(MessageController &mc)
     a2s.payloadType = AudioToSerialization::NONE;
     mc.sendAudioToSerialization(a2s);
 }
+
+void sendMemoryPoolRefill(MessageController &mc)
+{
+    assert(mc.threadingChecker.isAudioThread());
+    AudioToSerialization a2s;
+    a2s.id = a2s_memory_pool_refill;
+    a2s.payloadType = AudioToSerialization::NONE;
+    mc.sendAudioToSerialization(a2s);
+}
+
+void sendSampleReloadRequest(MessageController &mc)
+{
+    assert(mc.threadingChecker.isAudioThread());
+    AudioToSerialization a2s;
+    a2s.id = a2s_sample_reload_request;
+    a2s.payloadType = AudioToSerialization::NONE;
+    mc.sendAudioToSerialization(a2s);
+}
 } // namespace scxt::messaging::audio
\ No newline at end of file
@@ -36,6 +36,8 @@ namespace scxt::messaging::audio
 // Audio thread
 void sendVoiceState(uint32_t voiceCount, MessageController &mc);
 void sendStructureRefresh(MessageController &mc);
+void sendMemoryPoolRefill(MessageController &mc);
+void sendSampleReloadRequest(MessageController &mc);
 
 } // namespace scxt::messaging::audio
 #endif // SHORTCIRCUIT_AUDIO_MESSAGES_H
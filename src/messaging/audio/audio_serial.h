@@ -54,6 +54,8 @@ enum AudioToSerializationMessageId
     a2s_processor_refresh,
     a2s_macro_updated,
     a2s_delete_this_pointer,
+    a2s_memory_pool_refill,
+    a2s_sample_reload_request,
 };
 
 /**
@@ -63,6 +63,7 @@ enum ClientToSerializationMessagesIds
     // Registration and Reset Messages
     c2s_register_client,
     c2s_reset_engine,
+    c2s_resync_serialization_message,
 
     // Stream and IO Messages
     c2s_unstream_engine_state,
@@ -157,6 +158,7 @@ enum SerializationToClientMessageIds
     s2c_report_error,
     s2c_send_initial_metadata,
     s2c_send_debug_info,
+    s2c_send_render_profile,
     s2c_send_activity_notification,
 
     s2c_engine_status,
@@ -205,6 +207,28 @@ inline bool cacheSerializationMessagesAbsentClient(SerializationToClientMessageI
     return false;
 }
 
+/*
+ * Messages which carry an object the client mirrors get sent as a delta against the
+ * previous message with the same id (see detail/client_delta.h). Small one-shot
+ * notifications aren't worth the baseline copy on either end.
+ */
+inline bool deltaEncodeSerializationMessage(SerializationToClientMessageIds id)
+{
+    switch (id)
+    {
+    case s2c_report_error:
+    case s2c_send_debug_info:
+    case s2c_send_render_profile:
+    case s2c_send_activity_notification:
+    case s2c_engine_status:
+    case s2c_update_macro_value:
+        return false;
+    default:
+        break;
+    }
+    return true;
+}
+
 typedef uint8_t unimpl_t;
 template <ClientToSerializationMessagesIds id> struct ClientToSerializationType
 {
@@ -224,7 +248,8 @@ void serializationSendToClient(SerializationToClientMessageIds id, const T &payl
 void serializationThreadExecuteClientMessage(const std::string &msgView, engine::Engine &e,
                                              MessageController &mc);
 template <typename Client>
-void clientThreadExecuteSerializationMessage(const std::string &msgView, Client *c);
+void clientThreadExecuteSerializationMessage(const std::string &msgView, Client *c,
+                                            MessageController &mc);
 
 } // namespace scxt::messaging::client
 
@@ -38,6 +38,7 @@
 #include "client_macros.h"
 #include "client_serial.h"
 #include <map>
+#include <tuple>
 #include "engine/engine.h"
 
 namespace scxt::messaging::client
@@ -45,12 +46,20 @@ namespace scxt::messaging::client
 using debugResponse_t = std::map<std::string, std::string>;
 SERIAL_TO_CLIENT(DebugInfoGenerated, s2c_send_debug_info, debugResponse_t, onDebugInfoGenerated);
 
+// blocks profiled, patch cpu as a percentage of realtime, and the profile as folded stacks
+using renderProfile_t = std::tuple<uint64_t, double, std::string>;
+SERIAL_TO_CLIENT(RenderProfileGenerated, s2c_send_render_profile, renderProfile_t,
+                 onRenderProfileGenerated);
+
 struct DebugActions
 {
     static constexpr const char *pretty_json{"pretty_json"};
     static constexpr const char *pretty_json_daw{"pretty_json_daw"};
     static constexpr const char *pretty_json_multi{"pretty_json_multi"};
     static constexpr const char *pretty_json_part{"pretty_json_part"};
+    static constexpr const char *render_profile_start{"render_profile_start"};
+    static constexpr const char *render_profile_stop{"render_profile_stop"};
+    static constexpr const char *render_profile_report{"render_profile_report"};
 };
 
 template <template <typename...> class... Transformers, template <typename...> class Traits>
@@ -93,6 +102,34 @@ inline void doDebugAction(const std::string &payload, const engine::Engine &engi
         SCLOG("Dumping json for part " << pid);
         SCLOG(oss.str());
     }
+    else if (payload == DebugActions::render_profile_start)
+    {
+        SCLOG("Starting render profile");
+        engine.getRenderProfiler()->start();
+    }
+    else if (payload == DebugActions::render_profile_stop)
+    {
+        SCLOG("Stopping render profile");
+        engine.getRenderProfiler()->stop();
+    }
+    else if (payload == DebugActions::render_profile_report)
+    {
+        const auto &prof = engine.getRenderProfiler();
+        engine::RenderProfiler::Snapshot snap;
+        if (!prof->snapshot(snap))
+        {
+            SCLOG("No render profile yet; start one and play for a moment");
+            return;
+        }
+        auto blockNanos = blockSize * 1e9 / engine.getSampleRate();
+        auto pct = 100.0 * snap.patchNanos / snap.blocks / blockNanos;
+        auto folded = prof->report(engine);
+        SCLOG("Render profile over " << snap.blocks << " blocks; patch at " << pct
+                                     << "% of realtime. Folded stacks in ns:\n"
+                                     << folded);
+        serializationSendToClient(s2c_send_render_profile,
+                                  renderProfile_t{snap.blocks, pct, folded}, cont);
+    }
     else
     {
         SCLOG("Unknown debug action " << payload);
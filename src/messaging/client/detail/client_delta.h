@@ -0,0 +1,261 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_MESSAGING_CLIENT_DETAIL_CLIENT_DELTA_H
+#define SCXT_SRC_MESSAGING_CLIENT_DETAIL_CLIENT_DELTA_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "tao/json/operators.hpp"
+
+#include "messaging/client/client_serial.h"
+#include "messaging/client/detail/client_json_details.h"
+
+/*
+ * Serialization -> client messages are usually a full object (a zone mapping, the
+ * pgz structure, a processor) re-sent after a small edit. Rather than ship the whole
+ * object again we remember the last value sent for each message id and ship a patch
+ * against it. The client keeps the same baseline, applies the patch and hands the
+ * rebuilt value to the handler, so handlers never know deltas happened.
+ *
+ * A patch is a small tagged array
+ *   [0, value]                           replace this node with value
+ *   [1, {key: patch...}, [removed keys]] patch the named members of an object
+ *   [2, newSize, [[index, patch]...]]    resize an array and patch the listed entries
+ *   [3]                                  unchanged
+ */
+namespace scxt::messaging::client::detail
+{
+struct DeltaBaselines
+{
+    std::array<std::optional<client_message_value>, num_serializationToClientMessages> values;
+
+    void reset()
+    {
+        for (auto &v : values)
+            v.reset();
+    }
+};
+
+enum DeltaOp : int64_t
+{
+    delta_replace = 0,
+    delta_object = 1,
+    delta_array = 2,
+    delta_unchanged = 3
+};
+
+inline client_message_value deltaReplace(const client_message_value &to)
+{
+    client_message_value res = tao::json::empty_array;
+    res.get_array().emplace_back((int64_t)delta_replace);
+    res.get_array().emplace_back(to);
+    return res;
+}
+
+// Returns nullopt if from and to are equal
+inline std::optional<client_message_value> makeDeltaNode(const client_message_value &from,
+                                                         const client_message_value &to)
+{
+    if (from.is_object() && to.is_object())
+    {
+        const auto &fo = from.get_object();
+        const auto &too = to.get_object();
+
+        client_message_value changed = tao::json::empty_object;
+        client_message_value removed = tao::json::empty_array;
+        size_t changeCount{0};
+        for (const auto &[k, tv] : too)
+        {
+            auto fp = fo.find(k);
+            if (fp == fo.end())
+            {
+                changed.get_object().emplace(k, deltaReplace(tv));
+                changeCount++;
+            }
+            else if (auto d = makeDeltaNode(fp->second, tv))
+            {
+                changed.get_object().emplace(k, std::move(*d));
+                changeCount++;
+            }
+        }
+        for (const auto &[k, fv] : fo)
+        {
+            if (too.find(k) == too.end())
+            {
+                removed.get_array().emplace_back(k);
+                changeCount++;
+            }
+        }
+        if (changeCount == 0)
+            return std::nullopt;
+
+        // Mostly rewritten objects are cheaper to send whole
+        if (changeCount * 2 > too.size() + 1)
+            return deltaReplace(to);
+
+        client_message_value res = tao::json::empty_array;
+        res.get_array().emplace_back((int64_t)delta_object);
+        res.get_array().emplace_back(std::move(changed));
+        res.get_array().emplace_back(std::move(removed));
+        return res;
+    }
+
+    if (from.is_array() && to.is_array())
+    {
+        const auto &fa = from.get_array();
+        const auto &ta = to.get_array();
+
+        client_message_value entries = tao::json::empty_array;
+        size_t changeCount{0};
+        for (size_t i = 0; i < ta.size(); ++i)
+        {
+            std::optional<client_message_value> d;
+            if (i < fa.size())
+                d = makeDeltaNode(fa[i], ta[i]);
+            else
+                d = deltaReplace(ta[i]);
+
+            if (d)
+            {
+                client_message_value e = tao::json::empty_array;
+                e.get_array().emplace_back((uint64_t)i);
+                e.get_array().emplace_back(std::move(*d));
+                entries.get_array().emplace_back(std::move(e));
+                changeCount++;
+            }
+        }
+        if (changeCount == 0 && fa.size() == ta.size())
+            return std::nullopt;
+
+        // An insert near the front shifts everything; just resend it
+        if (changeCount * 2 > ta.size() + 1)
+            return deltaReplace(to);
+
+        client_message_value res = tao::json::empty_array;
+        res.get_array().emplace_back((int64_t)delta_array);
+        res.get_array().emplace_back((uint64_t)ta.size());
+        res.get_array().emplace_back(std::move(entries));
+        return res;
+    }
+
+    if (from == to)
+        return std::nullopt;
+
+    return deltaReplace(to);
+}
+
+inline client_message_value makeDelta(const client_message_value &from,
+                                      const client_message_value &to)
+{
+    auto res = makeDeltaNode(from, to);
+    if (res)
+        return std::move(*res);
+
+    client_message_value unchanged = tao::json::empty_array;
+    unchanged.get_array().emplace_back((int64_t)delta_unchanged);
+    return unchanged;
+}
+
+inline bool isFullReplace(const client_message_value &patch)
+{
+    return patch.get_array()[0].as<int64_t>() == delta_replace;
+}
+
+/*
+ * Apply a patch in place. Returns false if the patch does not fit the value, which
+ * means the two ends have lost track of each other.
+ */
+inline bool applyDelta(client_message_value &base, const client_message_value &patch)
+{
+    if (!patch.is_array() || patch.get_array().empty())
+        return false;
+
+    const auto &pa = patch.get_array();
+    auto op = pa[0].as<int64_t>();
+    switch (op)
+    {
+    case delta_unchanged:
+        return true;
+    case delta_replace:
+        if (pa.size() != 2)
+            return false;
+        base = pa[1];
+        return true;
+    case delta_object:
+    {
+        if (pa.size() != 3 || !base.is_object())
+            return false;
+        auto &bo = base.get_object();
+        for (const auto &[k, p] : pa[1].get_object())
+        {
+            auto bp = bo.find(k);
+            if (bp == bo.end())
+            {
+                client_message_value nv;
+                if (!applyDelta(nv, p))
+                    return false;
+                bo.emplace(k, std::move(nv));
+            }
+            else if (!applyDelta(bp->second, p))
+            {
+                return false;
+            }
+        }
+        for (const auto &k : pa[2].get_array())
+        {
+            bo.erase(k.as<std::string>());
+        }
+        return true;
+    }
+    case delta_array:
+    {
+        if (pa.size() != 3 || !base.is_array())
+            return false;
+        auto &ba = base.get_array();
+        ba.resize(pa[1].as<uint64_t>());
+        for (const auto &e : pa[2].get_array())
+        {
+            const auto &ea = e.get_array();
+            if (ea.size() != 2)
+                return false;
+            auto idx = ea[0].as<uint64_t>();
+            if (idx >= ba.size() || !applyDelta(ba[idx], ea[1]))
+                return false;
+        }
+        return true;
+    }
+    default:
+        break;
+    }
+    return false;
+}
+} // namespace scxt::messaging::client::detail
+#endif // SCXT_SRC_MESSAGING_CLIENT_DETAIL_CLIENT_DELTA_H
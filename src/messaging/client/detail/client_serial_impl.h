@@ -40,6 +40,7 @@
 #include "tao/json/msgpack/to_string.hpp"
 
 #include "messaging/client/detail/client_json_details.h"
+#include "messaging/client/detail/client_delta.h"
 
 // This is a 'details only' file which you can safely ignore
 // once it works, basically.
@@ -94,6 +95,47 @@ template <typename T> struct client_message_traits<ResponseWrapper<T>>
     }
 };
 
+/*
+ * Encode a serialization -> client message, as a delta against the previous message
+ * with this id if we have one and the delta is actually smaller than a resend.
+ */
+template <typename T>
+std::string encodeSerializationToClient(SerializationToClientMessageIds id, const T &msg,
+                                        MessageController &mc)
+{
+    if (!mc.deltaEncodeClientMessages || !deltaEncodeSerializationMessage(id))
+    {
+        auto mw = ResponseWrapper<T>(msg, id);
+        client_message_value v = mw;
+        return encoder::to_string(v);
+    }
+
+    if (!mc.serializationDeltaBaselines)
+        mc.serializationDeltaBaselines = std::make_shared<DeltaBaselines>();
+    auto &baselines = *mc.serializationDeltaBaselines;
+    if (mc.serializationDeltaBaselinesStale.exchange(false))
+        baselines.reset();
+
+    auto iid = (int)id;
+    client_message_value ov = msg;
+    auto &base = baselines.values[id];
+    if (base.has_value())
+    {
+        auto patch = makeDelta(*base, ov);
+        if (!isFullReplace(patch))
+        {
+            client_message_value v = {{"id", iid}, {"delta", std::move(patch)}};
+            base = std::move(ov);
+            return encoder::to_string(v);
+        }
+    }
+
+    client_message_value v = {{"id", iid}, {"object", std::move(ov)}};
+    auto res = encoder::to_string(v);
+    base = std::move(v.get_object()["object"]);
+    return res;
+}
+
 template <size_t I, template <typename...> class Traits>
 void doExecOnSerialization(tao::json::basic_value<Traits> &o, engine::Engine &e,
                            MessageController &mc)
@@ -179,6 +221,50 @@ inline void clientSendToSerialization(const T &msg, messaging::MessageController
     mc.sendRawFromClient(res);
 }
 
+namespace detail
+{
+/*
+ * Turn a delta encoded serialization message back into a whole {"id","object"} message
+ * against our copy of the last one with this id. If the delta doesn't apply we have lost
+ * sync with the serialization side, so drop our copy, ask it to drop its baseline too so
+ * the next message with this id comes whole, and return false so the caller drops this one
+ * rather than show garbage.
+ */
+inline bool resolveSerializationDelta(SerializationToClientMessageIds sid, client_message_value &jv,
+                                      MessageController &mc)
+{
+    if (!deltaEncodeSerializationMessage(sid))
+        return true;
+
+    if (!mc.clientDeltaBaselines)
+        mc.clientDeltaBaselines = std::make_shared<DeltaBaselines>();
+    auto &base = mc.clientDeltaBaselines->values[sid];
+
+    auto &jo = jv.get_object();
+    auto dp = jo.find("delta");
+    if (dp == jo.end())
+    {
+        base = jo["object"];
+        return true;
+    }
+
+    if (!base.has_value() || !applyDelta(*base, dp->second))
+    {
+        SCLOG("Dropping undecodable delta for serialization message " << (int)sid
+                                                                       << "; requesting resync");
+        base.reset();
+
+        auto iid = (int)ClientToSerializationMessagesIds::c2s_resync_serialization_message;
+        client_message_value v = {{"id", iid}, {"object", (int32_t)sid}};
+        mc.sendRawFromClient(encoder::to_string(v));
+        return false;
+    }
+    jo.erase(dp);
+    jo.emplace("object", *base);
+    return true;
+}
+} // namespace detail
+
 template <typename T>
 inline void serializationSendToClient(SerializationToClientMessageIds id, const T &msg,
                                       messaging::MessageController &mc)
@@ -200,9 +286,7 @@ inline void serializationSendToClient(SerializationToClientMessageIds id, const
             return;
         }
 
-        auto mw = detail::ResponseWrapper<T>(msg, id);
-        detail::client_message_value v = mw;
-        auto res = encoder::to_string(v);
+        auto res = detail::encodeSerializationToClient(id, msg, mc);
         mc.clientCallback(res);
     }
     catch (const std::exception &e)
@@ -236,7 +320,8 @@ inline void serializationThreadExecuteClientMessage(const std::string &msgView,
 }
 
 template <typename Client>
-inline void clientThreadExecuteSerializationMessage(const std::string &msgView, Client *c)
+inline void clientThreadExecuteSerializationMessage(const std::string &msgView, Client *c,
+                                                    MessageController &mc)
 {
     using namespace tao::json;
 
@@ -245,9 +330,17 @@ inline void clientThreadExecuteSerializationMessage(const std::string &msgView,
     encoder::events::from_string(consumer, msgView);
     auto jv = std::move(consumer.value);
 
-    auto o = jv.get_object();
     int idv{-1};
-    o["id"].to(idv);
+    jv.at("id").to(idv);
+    if (idv < 0 || idv >= (int)SerializationToClientMessageIds::num_serializationToClientMessages)
+    {
+        SCLOG("Ignoring serialization message with unknown id " << idv);
+        return;
+    }
+
+    auto sid = (SerializationToClientMessageIds)idv;
+    if (!detail::resolveSerializationDelta(sid, jv, mc))
+        return;
 
     detail::executeOnClientFor(
         (SerializationToClientMessageIds)idv, jv, c,
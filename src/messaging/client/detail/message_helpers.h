@@ -68,6 +68,15 @@ updateZoneLeadMemberValue(M m, const diffMsg_t<VT> &payload, const engine::Engin
                 {
                     *(VT *)(((uint8_t *)&dat) + d) = v;
                 }
+                if constexpr (std::is_same_v<M, decltype(&engine::Zone::mapping)>)
+                {
+                    eng.invalidateZoneMappingIndex();
+                }
+                if constexpr (std::is_same_v<M, decltype(&engine::Zone::outputInfo)>)
+                {
+                    // Routing decides whether the part can render on the pool
+                    eng.getPatch()->getPart(p)->invalidateRendersOnlyToOwnBus();
+                }
             },
             responseCB);
     }
@@ -108,6 +117,16 @@ inline void updateZoneMemberValue(M m, const diffMsg_t<VT> &payload, const engin
                         *(VT *)(((uint8_t *)&dat) + d) = v;
                     }
                 }
+                if constexpr (std::is_same_v<M, decltype(&engine::Zone::mapping)>)
+                {
+                    eng.invalidateZoneMappingIndex();
+                }
+                if constexpr (std::is_same_v<M, decltype(&engine::Zone::outputInfo)>)
+                {
+                    // Routing decides whether the part can render on the pool
+                    for (const auto &[p, g, z] : zs)
+                        eng.getPatch()->getPart(p)->invalidateRendersOnlyToOwnBus();
+                }
             },
             responseCB);
     }
@@ -148,6 +167,12 @@ inline void updateGroupMemberValue(M m, const diffMsg_t<VT> &payload, const engi
                         *(VT *)(((uint8_t *)&dat) + d) = v;
                     }
                 }
+                if constexpr (std::is_same_v<M, decltype(&engine::Group::outputInfo)>)
+                {
+                    // Routing and oversample decide whether the part can render on the pool
+                    for (const auto &[p, g, z] : gs)
+                        eng.getPatch()->getPart(p)->invalidateRendersOnlyToOwnBus();
+                }
             },
             responseCB);
     }
@@ -94,6 +94,9 @@ inline void setProcessorType(const setProcessorPayload_t &whichToType, const eng
 
         if (!sz.empty() && lz.has_value())
         {
+            // Reserve the voice blocks here so setProcessorType finds them on the audio thread
+            dsp::processor::reserveVoiceMemory(*engine.getMemoryPool(),
+                                               (dsp::processor::ProcessorType)id);
             cont.scheduleAudioThreadCallback(
                 [zs = sz, which = w, type = id](auto &e) {
                     for (const auto &a : zs)
@@ -74,6 +74,21 @@ inline void doRegisterClient(engine::Engine &engine, MessageController &cont)
 }
 CLIENT_TO_SERIAL(RegisterClient, c2s_register_client, bool, doRegisterClient(engine, cont));
 
+/*
+ * The client couldn't apply a delta for this serialization message id, so forget what we
+ * last sent it and send the next one whole.
+ */
+inline void doResyncSerializationMessage(int32_t payload, MessageController &cont)
+{
+    assert(cont.threadingChecker.isSerialThread());
+    if (!cont.serializationDeltaBaselines || payload < 0 ||
+        payload >= (int32_t)SerializationToClientMessageIds::num_serializationToClientMessages)
+        return;
+    cont.serializationDeltaBaselines->values[(SerializationToClientMessageIds)payload].reset();
+}
+CLIENT_TO_SERIAL(ResyncSerializationMessage, c2s_resync_serialization_message, int32_t,
+                 doResyncSerializationMessage(payload, cont));
+
 /*
  * A message the client auto-sends when it registers just so we can respond
  */
@@ -59,6 +59,7 @@ inline void doUpdateLeadZoneMapping(const engine::Zone::ZoneMappingData &payload
             [zs = *sz, mapv = mapping](auto &eng) {
                 auto [p, g, z] = zs;
                 eng.getPatch()->getPart(p)->getGroup(g)->getZone(z)->mapping = mapv;
+                eng.invalidateZoneMappingIndex();
             },
             [p = sz->part](const auto &eng) {
                 serializationSendToClient(
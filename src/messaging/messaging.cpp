@@ -89,6 +89,12 @@ void MessageController::parseAudioMessageOnSerializationThread(
         }
     }
     break;
+    case audio::a2s_memory_pool_refill:
+        engine.getMemoryPool()->refill();
+        break;
+    case audio::a2s_sample_reload_request:
+        engine.getSampleManager()->startEvictedReloads();
+        break;
     case audio::a2s_none:
         break;
     }
@@ -113,7 +119,9 @@ void MessageController::start()
 
 void MessageController::stop()
 {
-    assert(serializationThread);
+    // An offline host may already have stopped us
+    if (!serializationThread)
+        return;
     // TODO: Send queue goes away interrupt message
     shouldRun = false;
     clientToSerializationConditionVar.notify_all();
@@ -185,6 +193,8 @@ void MessageController::stopAudioThreadThenRunOnSerial(
 void MessageController::restartAudioThreadFromSerial()
 {
     assert(threadingChecker.isSerialThread());
+    // Whatever ran while we were stopped may have restructured the patch
+    engine.invalidateZoneMappingIndex();
     scheduleAudioThreadCallback([](engine::Engine &e) { e.stopEngineRequests--; });
 }
 
@@ -233,20 +243,7 @@ void MessageController::runSerialization()
             }
 
             // TODO: Drain SerToAudioQ if there's no audio thread
-            bool tryToDrain{true};
-            prepareSerializationThreadForAudioQueueDrain();
-            while (tryToDrain && !audioToSerializationQueue.empty())
-            {
-                auto msgopt = audioToSerializationQueue.pop();
-                if (msgopt.has_value())
-                {
-                    std::lock_guard<std::mutex> g(engine.modifyStructureMutex);
-                    parseAudioMessageOnSerializationThread(*msgopt);
-                }
-                else
-                    tryToDrain = false;
-            }
-            serializationThreadPostAudioQueueDrain();
+            runSerializationHousekeeping();
         }
         else
         {
@@ -254,6 +251,64 @@ void MessageController::runSerialization()
     }
 }
 
+void MessageController::runSerializationHousekeeping()
+{
+    assert(threadingChecker.isSerialThread());
+
+    bool tryToDrain{true};
+    prepareSerializationThreadForAudioQueueDrain();
+    while (tryToDrain && !audioToSerializationQueue.empty())
+    {
+        auto msgopt = audioToSerializationQueue.pop();
+        if (msgopt.has_value())
+        {
+            std::lock_guard<std::mutex> g(engine.modifyStructureMutex);
+            parseAudioMessageOnSerializationThread(*msgopt);
+        }
+        else
+            tryToDrain = false;
+    }
+    serializationThreadPostAudioQueueDrain();
+
+    if (engine.isZoneMappingIndexStale())
+    {
+        std::lock_guard<std::mutex> g(engine.modifyStructureMutex);
+        engine.rebuildZoneMappingIndexIfStale();
+    }
+
+    if (engine.getSampleManager()->hasPendingLoads())
+    {
+        std::lock_guard<std::mutex> g(engine.modifyStructureMutex);
+        engine.integrateAsyncSampleLoads();
+    }
+
+    if (engine.getSampleManager()->hasEvictedReloads())
+    {
+        std::lock_guard<std::mutex> g(engine.modifyStructureMutex);
+        engine.integrateEvictedSampleReloads();
+    }
+
+    if (engine.getSampleManager()->hasResidentUpgrades())
+    {
+        std::lock_guard<std::mutex> g(engine.modifyStructureMutex);
+        engine.applyResidentSampleUpgrades();
+    }
+
+    if (engine.getSampleManager()->wantsEviction())
+    {
+        std::lock_guard<std::mutex> g(engine.modifyStructureMutex);
+        engine.enforceSampleMemoryBudget();
+    }
+
+    // With audio running the refill request arrives as a2s_memory_pool_refill.
+    // Without it nobody forwards the request, so take it here.
+    if (!isAudioRunning && engine.getMemoryPool()->takeRefillRequest())
+    {
+        std::lock_guard<std::mutex> g(engine.modifyStructureMutex);
+        engine.getMemoryPool()->refill();
+    }
+}
+
 bool MessageController::updateAudioRunning()
 {
     assert(threadingChecker.isSerialThread());
@@ -298,8 +353,10 @@ void MessageController::registerClient(const std::string &nm, clientCallback_t &
         std::lock_guard<std::mutex> g(clientToSerializationMutex);
 
         assert(!clientCallback);
+        serializationDeltaBaselinesStale = true;
         clientCallback = std::move(f);
     }
+    clientDeltaBaselines.reset();
 
     threadingChecker.registerAsClientThread();
     client::clientSendToSerialization(client::RegisterClient(true), *this);
@@ -319,6 +376,7 @@ void MessageController::unregisterClient()
     assert(clientCallback);
     clientCallback = nullptr;
     isClientConnected = false;
+    serializationDeltaBaselinesStale = true;
 }
 void MessageController::sendRawFromClient(const clientToSerializationMessage_t &s)
 {
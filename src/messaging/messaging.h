@@ -149,6 +149,11 @@ namespace scxt::messaging
  *
  */
 
+namespace client::detail
+{
+struct DeltaBaselines;
+}
+
 struct MessageController : MoveableOnly<MessageController>
 {
   private:
@@ -183,10 +188,18 @@ struct MessageController : MoveableOnly<MessageController>
     /**
      * stop. Called from the startup thread when the engine is destroyed.
      * Will end and join the serialization thread. Cannot be called from
-     * the serialization thread.
+     * the serialization thread. Stopping an already stopped controller does nothing.
      */
     void stop();
 
+    /**
+     * The work runSerialization does on every wakeup besides client messages: drain the
+     * audio queue, rebuild the zone mapping index, integrate background sample loads and
+     * refill the memory pool. An offline host (scxt-render) stops the controller, registers
+     * its one thread as both serial and audio thread, and calls this between blocks.
+     */
+    void runSerializationHousekeeping();
+
     /**
      * The client callback is a function a client registers which will
      * get called on the serialization thread when there's a message
@@ -200,6 +213,19 @@ struct MessageController : MoveableOnly<MessageController>
     clientCallback_t clientCallback{nullptr};
     std::vector<std::string> preClientConnectionCache;
 
+    /**
+     * Serialization to client messages are sent as deltas against the last message
+     * with the same id (see client/detail/client_delta.h). Each end keeps a baseline;
+     * the serialization one is only touched on the serialization thread and the client
+     * one only on the client thread. Registering or unregistering a client marks the
+     * serialization baseline stale so the next message of each id goes out whole.
+     * deltaEncodeClientMessages is read on the serialization thread; set it before start.
+     */
+    bool deltaEncodeClientMessages{true};
+    std::shared_ptr<client::detail::DeltaBaselines> serializationDeltaBaselines,
+        clientDeltaBaselines;
+    std::atomic<bool> serializationDeltaBaselinesStale{false};
+
     /**
      * Register a client. Called from the client thread.
      *
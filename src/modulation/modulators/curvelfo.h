@@ -51,8 +51,11 @@ struct CurveLFO : SampleRateSupport
 
     float envelope_rate_linear_nowrap(float f)
     {
-        return blockSize * sampleRateInv * dsp::twoToTheXTable.twoToThe(-f);
+        return envelopeBlockFraction * blockSize * sampleRateInv *
+               dsp::twoToTheXTable.twoToThe(-f);
     }
+    // See Voice::envelopeBlockFraction
+    float envelopeBlockFraction{1.f};
 
     void attack(float initPhase, ModulatorStorage::ModulatorShape shape)
     {
@@ -40,8 +40,11 @@ struct EnvLFO : SampleRateSupport
 
     float envelope_rate_linear_nowrap(float f)
     {
-        return blockSize * sampleRateInv * dsp::twoToTheXTable.twoToThe(-f);
+        return envelopeBlockFraction * blockSize * sampleRateInv *
+               dsp::twoToTheXTable.twoToThe(-f);
     }
+    // See Voice::envelopeBlockFraction
+    float envelopeBlockFraction{1.f};
 
     env_t envelope{this};
     float output{0.f};
@@ -31,6 +31,7 @@
 #include "tuning/equal.h"
 #include "configuration.h"
 #include "sst/basic-blocks/dsp/RNG.h"
+#include "infrastructure/sse_include.h"
 
 namespace scxt::modulation::modulators
 {
@@ -233,36 +234,42 @@ void StepLFO::UpdatePhaseIncrement()
 void StepLFO::process(int)
 {
     phase += phaseInc;
-    auto &ls = settings->stepLfoStorage;
     while (phase > 1.0f)
     {
-        // shuffle_id = (shuffle_id+1)&1;
-        // if(shuffle_id) ratemult = 1.f/std::max(0.01f,1.f - 0.5f*lfo->start_phase.val.f);
-        // else ratemult = 1.f/(1.f + 0.5f*lfo->start_phase.val.f);
-
-        state++;
-
-        if (settings->triggerMode == ModulatorStorage::ONESHOT)
-        {
-            state = std::min((long)(ls.repeat - 1), state);
-        }
-        else if (state >= ls.repeat)
-        {
-            state = 0;
-        }
-        phase -= 1.0f;
-
-        wf_history[3] = wf_history[2];
-        wf_history[2] = wf_history[1];
-        wf_history[1] = wf_history[0];
-        wf_history[0] = ls.data[state & (StepLFOStorage::stepLfoSteps - 1)];
-        if (!state)
-            UpdatePhaseIncrement();
+        advanceStep();
     }
 
+    auto &ls = settings->stepLfoStorage;
     output = std::clamp(lfo_ipol(wf_history, phase, ls.smooth, state & 1), -1.f, 1.f);
 }
 
+void StepLFO::advanceStep()
+{
+    auto &ls = settings->stepLfoStorage;
+    // shuffle_id = (shuffle_id+1)&1;
+    // if(shuffle_id) ratemult = 1.f/std::max(0.01f,1.f - 0.5f*lfo->start_phase.val.f);
+    // else ratemult = 1.f/(1.f + 0.5f*lfo->start_phase.val.f);
+
+    state++;
+
+    if (settings->triggerMode == ModulatorStorage::ONESHOT)
+    {
+        state = std::min((long)(ls.repeat - 1), state);
+    }
+    else if (state >= ls.repeat)
+    {
+        state = 0;
+    }
+    phase -= 1.0f;
+
+    wf_history[3] = wf_history[2];
+    wf_history[2] = wf_history[1];
+    wf_history[1] = wf_history[0];
+    wf_history[0] = ls.data[state & (StepLFOStorage::stepLfoSteps - 1)];
+    if (!state)
+        UpdatePhaseIncrement();
+}
+
 float lfo_ipol(float *wf_history, float phase, float smooth, int odd)
 {
     float df = smooth * 0.5f;
@@ -330,4 +337,122 @@ float lfo_ipol(float *wf_history, float phase, float smooth, int odd)
 }
 
 StepLFO::~StepLFO() {}
+
+namespace
+{
+// (1 - mu) * a + mu * b, in the same order the scalar code forms it
+inline __m128 lerp4(__m128 a, __m128 b, __m128 mu)
+{
+    return _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.f), mu), a), _mm_mul_ps(mu, b));
+}
+
+// std::max(0.f, std::min(v, 1.f)), including what that does with a NaN
+inline __m128 clamp01(__m128 v)
+{
+    return _mm_max_ps(_mm_min_ps(_mm_set1_ps(1.f), v), _mm_setzero_ps());
+}
+
+inline __m128 select4(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/*
+ * lfo_ipol for four lanes. Every branch is evaluated and the results are selected per
+ * lane in reverse order of the scalar if chain so the first matching branch wins.
+ */
+__m128 lfo_ipol4(__m128 h0, __m128 h1, __m128 h2, __m128 phase, __m128 smooth)
+{
+    const auto zero = _mm_setzero_ps();
+    const auto half = _mm_set1_ps(0.5f);
+    const auto one = _mm_set1_ps(1.f);
+    const auto two = _mm_set1_ps(2.f);
+    const auto eps = _mm_set1_ps(0.00001f);
+
+    auto df = _mm_mul_ps(smooth, half);
+    auto upperHalf = _mm_cmpgt_ps(phase, half);
+
+    // df <= -0.5
+    auto cfD = clamp01(_mm_div_ps(phase, _mm_add_ps(_mm_add_ps(two, _mm_mul_ps(two, df)), eps)));
+    auto res = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(one, cfD), h1), _mm_mul_ps(cfD, zero));
+
+    // -0.5 < df <= -0.0001
+    auto cfC = clamp01(_mm_div_ps(_mm_sub_ps(one, phase),
+                                  _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-2.f), df), eps)));
+    auto resC = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(one, cfC), zero), _mm_mul_ps(cfC, h1));
+    res = select4(_mm_cmpgt_ps(df, _mm_set1_ps(-0.5f)), resC, res);
+
+    // -0.0001 < df <= 0.5
+    auto denB = _mm_add_ps(_mm_mul_ps(two, df), eps);
+    auto cfBHi = clamp01(_mm_sub_ps(half, _mm_div_ps(_mm_sub_ps(phase, one), denB)));
+    auto cfBLo = clamp01(_mm_sub_ps(half, _mm_div_ps(phase, denB)));
+    auto resB = select4(upperHalf, lerp4(h0, h1, cfBHi), lerp4(h1, h2, cfBLo));
+    res = select4(_mm_cmpgt_ps(df, _mm_set1_ps(-0.0001f)), resB, res);
+
+    // df > 0.5
+    auto linear = select4(upperHalf, lerp4(h1, h0, _mm_sub_ps(phase, half)),
+                          lerp4(h2, h1, _mm_add_ps(phase, half)));
+    auto mu2 = _mm_mul_ps(phase, phase);
+    auto w1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(-2.f), phase), phase),
+                                    _mm_mul_ps(two, phase)),
+                         one);
+    auto w0 = _mm_add_ps(_mm_sub_ps(mu2, _mm_mul_ps(two, phase)), one);
+    auto qbs = _mm_mul_ps(
+        half, _mm_add_ps(_mm_add_ps(_mm_mul_ps(h0, mu2), _mm_mul_ps(h1, w1)), _mm_mul_ps(h2, w0)));
+    auto resA = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(two, _mm_mul_ps(two, df)), linear),
+                           _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(two, df), one), qbs));
+    res = select4(_mm_cmpgt_ps(df, half), resA, res);
+
+    // std::clamp(res, -1.f, 1.f)
+    auto lo = _mm_set1_ps(-1.f);
+    res = select4(_mm_cmplt_ps(res, lo), lo, select4(_mm_cmplt_ps(one, res), one, res));
+    return res;
+}
+} // namespace
+
+void processStepLFOBatch(StepLFO *const *lfos, size_t n)
+{
+    for (size_t b = 0; b < n; b += 4)
+    {
+        auto lanes = std::min(n - b, (size_t)4);
+
+        float ph alignas(16)[4]{}, inc alignas(16)[4]{};
+        for (size_t i = 0; i < lanes; ++i)
+        {
+            ph[i] = lfos[b + i]->phase;
+            inc[i] = lfos[b + i]->phaseInc;
+        }
+        auto phase = _mm_add_ps(_mm_load_ps(ph), _mm_load_ps(inc));
+        auto wrapped = _mm_movemask_ps(_mm_cmpgt_ps(phase, _mm_set1_ps(1.f)));
+        _mm_store_ps(ph, phase);
+
+        float h0 alignas(16)[4]{}, h1 alignas(16)[4]{}, h2 alignas(16)[4]{},
+            sm alignas(16)[4]{};
+        for (size_t i = 0; i < lanes; ++i)
+        {
+            auto *l = lfos[b + i];
+            l->phase = ph[i];
+            if (wrapped & (1 << i))
+            {
+                while (l->phase > 1.0f)
+                {
+                    l->advanceStep();
+                }
+                ph[i] = l->phase;
+            }
+            h0[i] = l->wf_history[0];
+            h1[i] = l->wf_history[1];
+            h2[i] = l->wf_history[2];
+            sm[i] = l->settings->stepLfoStorage.smooth;
+        }
+
+        float out alignas(16)[4];
+        _mm_store_ps(out, lfo_ipol4(_mm_load_ps(h0), _mm_load_ps(h1), _mm_load_ps(h2),
+                                    _mm_load_ps(ph), _mm_load_ps(sm)));
+        for (size_t i = 0; i < lanes; ++i)
+        {
+            lfos[b + i]->output = out[i];
+        }
+    }
+}
 } // namespace scxt::modulation::modulators
@@ -106,6 +106,8 @@ struct StepLFO : MoveableOnly<StepLFO>, SampleRateSupport
                 scxt::engine::Transport *td, sst::basic_blocks::dsp::RNG &);
     void sync();
     void process(int samples);
+    // Move to the next step; process does this whenever the phase passes 1
+    void advanceStep();
     float output{0.f};
 
     void UpdatePhaseIncrement();
@@ -123,6 +125,14 @@ struct StepLFO : MoveableOnly<StepLFO>, SampleRateSupport
     engine::Transport *td{nullptr};
     modulation::ModulatorStorage *settings{nullptr};
 };
+
+/*
+ * Run process(blockSize) on n step LFOs at once. The phase update and the interpolation
+ * run four LFOs per SSE op from packed copies of their state; stepping to the next value,
+ * which happens at most a few times a block, stays per LFO. The result matches calling
+ * process on each in turn.
+ */
+void processStepLFOBatch(StepLFO *const *lfos, size_t n);
 } // namespace scxt::modulation::modulators
 
 #endif // SCXT_SRC_MODULATION_MODULATORS_STEPLFO_H
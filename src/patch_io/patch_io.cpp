@@ -108,6 +108,27 @@ bool saveMulti(const fs::path &p, const scxt::engine::Engine &e)
     return true;
 }
 
+/*
+ * Unstream the structure of a multi, leaving its file based samples to decode in the
+ * background once audio is running again (see Engine::startAsyncSampleLoads).
+ */
+static void unstreamMultiWithDeferredSamples(scxt::engine::Engine &engine,
+                                             const std::string &payload)
+{
+    auto &sm = *engine.getSampleManager();
+    sm.deferFileDecodes = true;
+    try
+    {
+        scxt::json::unstreamEngineState(engine, payload, true);
+    }
+    catch (...)
+    {
+        sm.deferFileDecodes = false;
+        throw;
+    }
+    sm.deferFileDecodes = false;
+}
+
 bool loadMulti(const fs::path &p, scxt::engine::Engine &engine)
 {
     SCLOG("loadMulti " << p.u8string());
@@ -132,9 +153,10 @@ bool loadMulti(const fs::path &p, scxt::engine::Engine &engine)
             try
             {
                 nonconste.stopAllSounds();
-                scxt::json::unstreamEngineState(nonconste, payload, true);
+                unstreamMultiWithDeferredSamples(nonconste, payload);
                 auto &cont = *e.getMessageController();
                 cont.restartAudioThreadFromSerial();
+                nonconste.startAsyncSampleLoads();
             }
             catch (std::exception &err)
             {
@@ -147,7 +169,8 @@ bool loadMulti(const fs::path &p, scxt::engine::Engine &engine)
         try
         {
             engine.stopAllSounds();
-            scxt::json::unstreamEngineState(engine, payload, true);
+            unstreamMultiWithDeferredSamples(engine, payload);
+            engine.startAsyncSampleLoads();
         }
         catch (std::exception &err)
         {
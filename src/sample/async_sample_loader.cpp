@@ -0,0 +1,148 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "async_sample_loader.h"
+
+#include <algorithm>
+#include <optional>
+
+#include "pcm_convert.h"
+
+namespace scxt::sample
+{
+AsyncSampleLoader::~AsyncSampleLoader() { cancel(); }
+
+void AsyncSampleLoader::start(std::vector<Request> &&r, uint32_t streamingPreloadFrames,
+                              DecodedSampleCache *cache, infrastructure::MD5SumCache *md5Cache,
+                              bool mapInPlace, uint32_t compressHeadFrames)
+{
+    cancel();
+
+    requests = std::move(r);
+    preloadFrames = streamingPreloadFrames;
+    decodedCache = cache;
+    md5SumCache = md5Cache;
+    mapWavInPlace = mapInPlace;
+    compressedHeadFrames = compressHeadFrames;
+    nextRequest = 0;
+    completed = 0;
+    cancelled = false;
+    results.clear();
+
+    if (requests.empty())
+        return;
+
+    // Leave a core for the audio thread. Decoding is mostly IO and memory bound
+    // so there is little point going very wide.
+    auto hc = (int)std::thread::hardware_concurrency();
+    auto nWorkers = std::clamp(hc - 1, 1, 8);
+    nWorkers = std::min(nWorkers, (int)requests.size());
+
+    SCLOG("Decoding " << requests.size() << " samples on " << nWorkers << " threads");
+    // Several workers already fill the cores, so each converts its own PCM unsplit
+    auto serialConversion = nWorkers > 1;
+    for (int i = 0; i < nWorkers; ++i)
+    {
+        workers.emplace_back([this, serialConversion]() { runWorker(serialConversion); });
+    }
+}
+
+void AsyncSampleLoader::cancel()
+{
+    cancelled = true;
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+    workers.clear();
+    requests.clear();
+
+    std::lock_guard<std::mutex> g(resultsMutex);
+    results.clear();
+}
+
+void AsyncSampleLoader::wait()
+{
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+    workers.clear();
+}
+
+void AsyncSampleLoader::takeCompleted(std::vector<Result> &into)
+{
+    // Results are posted before the count moves, so if everything is complete the
+    // workers are done and every result is already in the list
+    if (isRunning() && completedCount() == totalCount())
+    {
+        for (auto &w : workers)
+        {
+            w.join();
+        }
+        workers.clear();
+    }
+
+    std::lock_guard<std::mutex> g(resultsMutex);
+    for (auto &r : results)
+        into.push_back(std::move(r));
+    results.clear();
+}
+
+void AsyncSampleLoader::runWorker(bool serialConversion)
+{
+    std::optional<pcm::SingleThreadedGuard> conversionGuard;
+    if (serialConversion)
+        conversionGuard.emplace();
+
+    while (!cancelled)
+    {
+        auto idx = nextRequest.fetch_add(1);
+        if (idx >= requests.size())
+            break;
+
+        const auto &req = requests[idx];
+        auto sp = std::make_shared<Sample>(req.id);
+        auto preload = req.fullyResident ? 0 : preloadFrames;
+        if (!sp->load(req.path, preload, decodedCache, md5SumCache, mapWavInPlace))
+        {
+            SCLOG("Failed to load sample from '" << req.path.u8string() << "'");
+            sp.reset();
+        }
+        else if (compressedHeadFrames > 0 && !req.fullyResident)
+        {
+            sp->compressBeyond(compressedHeadFrames);
+        }
+
+        {
+            std::lock_guard<std::mutex> g(resultsMutex);
+            results.push_back({req.id, req.path, std::move(sp)});
+        }
+        completed.fetch_add(1, std::memory_order_acq_rel);
+    }
+}
+} // namespace scxt::sample
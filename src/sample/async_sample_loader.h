@@ -0,0 +1,108 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_SAMPLE_ASYNC_SAMPLE_LOADER_H
+#define SCXT_SRC_SAMPLE_ASYNC_SAMPLE_LOADER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "utils.h"
+#include "sample.h"
+#include "infrastructure/filesystem_import.h"
+
+namespace scxt::sample
+{
+struct DecodedSampleCache;
+
+/**
+ * The AsyncSampleLoader decodes a batch of file based samples on a small pool of worker
+ * threads so a multi can load its structure first and fill in audio as it arrives.
+ *
+ * It only runs Sample::load (and Sample::compressBeyond, when compressing sample memory),
+ * which is self contained per file; it never touches the SampleManager's maps. The
+ * serialization thread starts a batch, periodically takes the completed results and
+ * installs them. Cancelling (a new load, a reset) joins the workers
+ * and drops whatever they had finished.
+ */
+struct AsyncSampleLoader : MoveableOnly<AsyncSampleLoader>
+{
+    struct Request
+    {
+        SampleID id;
+        fs::path path;
+        bool fullyResident{false}; // ignore the streaming preload and compressed head
+    };
+    struct Result
+    {
+        SampleID id;
+        fs::path path;
+        std::shared_ptr<Sample> sample; // null if the decode failed
+    };
+
+    AsyncSampleLoader() = default;
+    ~AsyncSampleLoader();
+
+    // Serialization thread
+    void start(std::vector<Request> &&requests, uint32_t streamingPreloadFrames,
+               DecodedSampleCache *cache = nullptr,
+               infrastructure::MD5SumCache *md5Cache = nullptr, bool mapInPlace = false,
+               uint32_t compressedHeadFrames = 0);
+    void cancel();
+    // Blocks until the workers have been through every request
+    void wait();
+    void takeCompleted(std::vector<Result> &into);
+
+    bool isRunning() const { return !workers.empty(); }
+    size_t totalCount() const { return requests.size(); }
+    size_t completedCount() const { return completed.load(std::memory_order_acquire); }
+
+  private:
+    void runWorker(bool serialConversion);
+
+    std::vector<Request> requests;
+    uint32_t preloadFrames{0};
+    DecodedSampleCache *decodedCache{nullptr};
+    infrastructure::MD5SumCache *md5SumCache{nullptr};
+    bool mapWavInPlace{false};
+    uint32_t compressedHeadFrames{0};
+
+    std::atomic<size_t> nextRequest{0}, completed{0};
+    std::atomic<bool> cancelled{false};
+
+    std::mutex resultsMutex;
+    std::vector<Result> results;
+
+    std::vector<std::thread> workers;
+};
+} // namespace scxt::sample
+
+#endif // SCXT_SRC_SAMPLE_ASYNC_SAMPLE_LOADER_H
@@ -0,0 +1,366 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "compressed_sample_store.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace scxt::sample
+{
+namespace
+{
+// A unary run this long is an escape, and the zigzagged residual follows in 32 bits
+static constexpr uint32_t escapeRun{24};
+static constexpr uint32_t maxRiceParameter{28};
+static constexpr int maxOrder{3};
+
+inline int leadingZeros(uint64_t v)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse64(&idx, v);
+    return 63 - (int)idx;
+#else
+    return __builtin_clzll(v);
+#endif
+}
+
+inline uint32_t zigzag(int32_t r) { return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31); }
+inline int32_t unzigzag(uint32_t u) { return (int32_t)(u >> 1) ^ -(int32_t)(u & 1); }
+
+struct BitWriter
+{
+    std::vector<uint8_t> &out;
+    uint64_t acc{0};
+    int count{0};
+
+    explicit BitWriter(std::vector<uint8_t> &o) : out(o) {}
+
+    // Most significant bit first; bits <= 32
+    void write(uint32_t v, int bits)
+    {
+        auto mask = bits == 32 ? 0xFFFFFFFFULL : ((1ULL << bits) - 1);
+        acc = (acc << bits) | (v & mask);
+        count += bits;
+        while (count >= 8)
+        {
+            count -= 8;
+            out.push_back((uint8_t)(acc >> count));
+        }
+    }
+    void align()
+    {
+        if (count > 0)
+            write(0, 8 - count);
+    }
+};
+
+struct BitReader
+{
+    const uint8_t *p, *end;
+    uint64_t cache{0}; // left aligned
+    int count{0};
+
+    BitReader(const uint8_t *b, const uint8_t *e) : p(b), end(e) {}
+
+    // Leaves at least 57 bits in the cache, which is enough for any one rice value
+    void refill()
+    {
+        while (count <= 56)
+        {
+            uint64_t b = p < end ? *p++ : 0;
+            cache |= b << (56 - count);
+            count += 8;
+        }
+    }
+    uint32_t take(int bits)
+    {
+        if (count < bits)
+            refill();
+        if (bits == 0)
+            return 0;
+        auto v = (uint32_t)(cache >> (64 - bits));
+        cache <<= bits;
+        count -= bits;
+        return v;
+    }
+    void skip(int bits)
+    {
+        cache <<= bits;
+        count -= bits;
+    }
+    uint32_t rice(int k)
+    {
+        refill();
+        auto q = cache ? std::min((uint32_t)leadingZeros(cache), escapeRun) : escapeRun;
+        if (q == escapeRun)
+        {
+            skip(escapeRun);
+            return take(32);
+        }
+        skip(q + 1);
+        return (q << k) | take(k);
+    }
+};
+
+int32_t readFrame(Sample::BitDepth bd, const void *data, int64_t i)
+{
+    if (bd == Sample::BD_I16)
+        return static_cast<const int16_t *>(data)[i];
+    auto *b = static_cast<const uint8_t *>(data) + i * 3;
+    return (int32_t)((uint32_t)b[0] << 8 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 24) >> 8;
+}
+
+// The FLAC fixed predictors. x[i] is predicted from x[i-1..i-order].
+inline int32_t residual(const int32_t *x, int i, int order)
+{
+    switch (order)
+    {
+    case 0:
+        return x[i];
+    case 1:
+        return x[i] - x[i - 1];
+    case 2:
+        return x[i] - 2 * x[i - 1] + x[i - 2];
+    default:
+        return x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+    }
+}
+
+uint64_t riceCost(const uint32_t *u, int n, uint32_t k)
+{
+    uint64_t bits{0};
+    for (int i = 0; i < n; ++i)
+    {
+        auto q = u[i] >> k;
+        bits += q >= escapeRun ? escapeRun + 32 : q + 1 + k;
+    }
+    return bits;
+}
+
+void encodeBlock(const int32_t *x, int n, int sampleBits, uint32_t *u, BitWriter &w)
+{
+    // Pick the predictor leaving the least residual energy
+    int64_t err[maxOrder + 1]{};
+    for (int i = maxOrder; i < n; ++i)
+        for (int o = 0; o <= maxOrder; ++o)
+            err[o] += std::abs((int64_t)residual(x, i, o));
+    int order{0};
+    for (int o = 1; o <= std::min(maxOrder, n - 1); ++o)
+        if (err[o] < err[order])
+            order = o;
+
+    w.write(order, 2);
+    for (int i = 0; i < order; ++i)
+        w.write((uint32_t)x[i], sampleBits);
+
+    for (int i = order; i < n; ++i)
+        u[i] = zigzag(residual(x, i, order));
+
+    for (int p0 = 0; p0 < n; p0 += CompressedSampleStore::partitionFrames)
+    {
+        auto s = std::max(p0, order);
+        auto e = std::min(p0 + CompressedSampleStore::partitionFrames, n);
+        auto cnt = std::max(e - s, 0);
+
+        // Start from the parameter the mean suggests and check its neighbours exactly
+        uint64_t sum{0};
+        for (int i = s; i < e; ++i)
+            sum += u[i];
+        auto mean = cnt ? sum / cnt : 0;
+        uint32_t guess{0};
+        while (guess < maxRiceParameter && (2ULL << guess) <= mean)
+            guess++;
+
+        uint32_t k{guess};
+        auto best = riceCost(u + s, cnt, guess);
+        for (auto t : {guess - 1, guess + 1})
+        {
+            if (t > maxRiceParameter) // includes guess - 1 wrapping below zero
+                continue;
+            auto c = riceCost(u + s, cnt, t);
+            if (c < best)
+            {
+                best = c;
+                k = t;
+            }
+        }
+
+        w.write(k, 5);
+        for (int i = s; i < e; ++i)
+        {
+            auto q = u[i] >> k;
+            if (q >= escapeRun)
+            {
+                w.write(0, escapeRun);
+                w.write(u[i], 32);
+            }
+            else
+            {
+                w.write(1, q + 1);
+                w.write(u[i], k);
+            }
+        }
+    }
+    w.align();
+}
+} // namespace
+
+std::unique_ptr<CompressedSampleStore>
+CompressedSampleStore::encode(Sample::BitDepth bitDepth, uint8_t channels,
+                              const void *const data[2], uint32_t firstFrame, uint32_t endFrame)
+{
+    if ((bitDepth != Sample::BD_I16 && bitDepth != Sample::BD_I24) || channels < 1 ||
+        channels > 2 || endFrame <= firstFrame)
+        return nullptr;
+
+    auto res = std::unique_ptr<CompressedSampleStore>(new CompressedSampleStore());
+    res->bitDepth = bitDepth;
+    res->channels = channels;
+    res->firstFrame = firstFrame;
+    res->endFrame = endFrame;
+
+    auto sampleBits = bitDepth == Sample::BD_I16 ? 16 : 24;
+    auto blocks = res->numBlocks();
+    res->offsets.reserve(blocks * channels + 1);
+
+    std::vector<int32_t> x(blockFrames);
+    std::vector<uint32_t> u(blockFrames);
+    BitWriter w(res->bytes);
+    for (int32_t b = 0; b < blocks; ++b)
+    {
+        int64_t start = firstFrame + (int64_t)b * blockFrames;
+        auto n = (int)std::min((int64_t)blockFrames, (int64_t)endFrame - start);
+        for (int c = 0; c < channels; ++c)
+        {
+            res->offsets.push_back(res->bytes.size());
+            for (int i = 0; i < n; ++i)
+                x[i] = readFrame(bitDepth, data[c], start + i);
+            encodeBlock(x.data(), n, sampleBits, u.data(), w);
+        }
+    }
+    res->offsets.push_back(res->bytes.size());
+    res->bytes.shrink_to_fit();
+    return res;
+}
+
+int32_t CompressedSampleStore::decodeBlock(int channel, int32_t block, int32_t *out) const
+{
+    auto n = (int32_t)std::min((int64_t)blockFrames,
+                               (int64_t)endFrame - firstFrame - (int64_t)block * blockFrames);
+    auto idx = block * channels + channel;
+    BitReader r(bytes.data() + offsets[idx], bytes.data() + offsets[idx + 1]);
+
+    auto sampleBits = bitDepth == Sample::BD_I16 ? 16 : 24;
+    auto order = (int)r.take(2);
+    for (int i = 0; i < order; ++i)
+    {
+        auto v = r.take(sampleBits);
+        out[i] = (int32_t)(v << (32 - sampleBits)) >> (32 - sampleBits);
+    }
+
+    for (int p0 = 0; p0 < n; p0 += partitionFrames)
+    {
+        auto s = std::max(p0, order);
+        auto e = std::min(p0 + partitionFrames, n);
+        auto k = (int)r.take(5);
+        for (int i = s; i < e; ++i)
+            out[i] = unzigzag(r.rice(k));
+    }
+
+    switch (order)
+    {
+    case 1:
+        for (int i = 1; i < n; ++i)
+            out[i] += out[i - 1];
+        break;
+    case 2:
+        for (int i = 2; i < n; ++i)
+            out[i] += 2 * out[i - 1] - out[i - 2];
+        break;
+    case 3:
+        for (int i = 3; i < n; ++i)
+            out[i] += 3 * out[i - 1] - 3 * out[i - 2] + out[i - 3];
+        break;
+    default:
+        break;
+    }
+    return n;
+}
+
+void CompressedSampleStore::decode(int channel, int64_t from, int64_t to, uint8_t *dest) const
+{
+    auto bpf = (int64_t)Sample::bitDepthByteSize(bitDepth);
+    auto lo = std::min(std::max(from, (int64_t)firstFrame), to);
+    auto hi = std::max(std::min(to, (int64_t)endFrame), lo);
+    if (lo > from)
+        memset(dest, 0, (lo - from) * bpf);
+    if (hi < to)
+        memset(dest + (hi - from) * bpf, 0, (to - hi) * bpf);
+    if (channel >= channels)
+    {
+        memset(dest + (lo - from) * bpf, 0, (hi - lo) * bpf);
+        return;
+    }
+
+    int32_t block[blockFrames];
+    auto f = lo;
+    while (f < hi)
+    {
+        auto b = (int32_t)((f - firstFrame) / blockFrames);
+        auto blockStart = (int64_t)firstFrame + (int64_t)b * blockFrames;
+        decodeBlock(channel, b, block);
+
+        auto e = std::min(hi, blockStart + blockFrames);
+        auto *src = block + (f - blockStart);
+        auto n = e - f;
+        auto *out = dest + (f - from) * bpf;
+        if (bitDepth == Sample::BD_I16)
+        {
+            auto *o16 = reinterpret_cast<int16_t *>(out);
+            for (int64_t i = 0; i < n; ++i)
+                o16[i] = (int16_t)src[i];
+        }
+        else
+        {
+            for (int64_t i = 0; i < n; ++i)
+            {
+                out[i * 3] = (uint8_t)src[i];
+                out[i * 3 + 1] = (uint8_t)(src[i] >> 8);
+                out[i * 3 + 2] = (uint8_t)(src[i] >> 16);
+            }
+        }
+        f = e;
+    }
+}
+} // namespace scxt::sample
@@ -0,0 +1,100 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_SAMPLE_COMPRESSED_SAMPLE_STORE_H
+#define SCXT_SRC_SAMPLE_COMPRESSED_SAMPLE_STORE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "utils.h"
+#include "sample.h"
+
+namespace scxt::sample
+{
+/**
+ * A CompressedSampleStore holds a range of integer (I16 or I24) sample frames losslessly
+ * compressed in independently decodable blocks of blockFrames frames per channel. Each
+ * block uses the FLAC fixed polynomial predictor (order 0 to 3, whichever leaves the
+ * smallest residual) and Rice codes the residual in partitions of partitionFrames, each
+ * with its own parameter. Blocks don't depend on their neighbours so a read can start
+ * anywhere at the cost of decoding at most one block it doesn't need.
+ *
+ * Encoding happens once, on whichever thread loads the sample. decode() doesn't allocate
+ * or lock; the SampleStreamer calls it from its reader thread to fill voice windows.
+ */
+struct CompressedSampleStore : MoveableOnly<CompressedSampleStore>
+{
+    static constexpr int32_t blockFrames{4096};
+    static constexpr int32_t partitionFrames{256};
+
+    /*
+     * Compress frames [firstFrame, endFrame) of channels planar channels. data[c] points at
+     * frame 0 of channel c, laid out as the Sample holds it for bitDepth (int16_t, or three
+     * packed bytes for I24). Returns nullptr for any other bit depth.
+     */
+    static std::unique_ptr<CompressedSampleStore> encode(Sample::BitDepth bitDepth,
+                                                         uint8_t channels,
+                                                         const void *const data[2],
+                                                         uint32_t firstFrame, uint32_t endFrame);
+
+    /*
+     * Decode frames [from, to) of channel into dest in the same layout. Frames outside
+     * [firstFrame, endFrame) come back as zero, as they would from the sample's pads.
+     */
+    void decode(int channel, int64_t from, int64_t to, uint8_t *dest) const;
+
+    size_t getSizeInBytes() const
+    {
+        return sizeof(*this) + bytes.size() + offsets.size() * sizeof(uint64_t);
+    }
+    size_t getUncompressedSizeInBytes() const
+    {
+        return (size_t)(endFrame - firstFrame) * channels * Sample::bitDepthByteSize(bitDepth);
+    }
+
+    Sample::BitDepth bitDepth{Sample::BD_I16};
+    uint8_t channels{0};
+    uint32_t firstFrame{0}, endFrame{0};
+
+  private:
+    // Decode block of channel into out, returning its frame count
+    int32_t decodeBlock(int channel, int32_t block, int32_t *out) const;
+
+    int32_t numBlocks() const
+    {
+        return (int32_t)((endFrame - firstFrame + blockFrames - 1) / blockFrames);
+    }
+
+    // Block b of channel c starts at bytes[offsets[b * channels + c]]
+    std::vector<uint8_t> bytes;
+    std::vector<uint64_t> offsets;
+};
+} // namespace scxt::sample
+
+#endif // SCXT_SRC_SAMPLE_COMPRESSED_SAMPLE_STORE_H
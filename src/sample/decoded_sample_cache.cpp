@@ -0,0 +1,319 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "decoded_sample_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "infrastructure/file_map_view.h"
+#include "dsp/resampling.h"
+#include "sample.h"
+
+namespace scxt::sample
+{
+namespace
+{
+constexpr char entryExtension[]{".scdc"};
+constexpr uint32_t entryVersion{1};
+constexpr size_t headerBytes{256};
+constexpr size_t channelAlign{64};
+
+struct EntryHeader
+{
+    char magic[4]{'S', 'C', 'D', 'C'};
+    uint32_t version{entryVersion};
+    uint32_t bitDepth{0}, channels{0}, sampleRate{0}, sampleLength{0};
+    uint64_t channelOffset[2]{0, 0};
+    uint64_t channelBytes{0};
+
+    int8_t keyLow{0}, keyHigh{0}, keyRoot{0}, velLow{0}, velHigh{0};
+    uint8_t playmode{0};
+    uint8_t presentFlags{0};
+    float detune{0};
+    uint32_t loopStart{0}, loopEnd{0};
+    int32_t nBeats{0};
+};
+static_assert(sizeof(EntryHeader) <= headerBytes);
+static_assert(std::is_trivially_copyable_v<EntryHeader>);
+
+enum PresentFlags : uint8_t
+{
+    rootkey = 1 << 0,
+    key = 1 << 1,
+    vel = 1 << 2,
+    loop = 1 << 3,
+    playmode = 1 << 4
+};
+
+size_t alignUp(size_t v, size_t a) { return (v + a - 1) / a * a; }
+
+// What store() writes: the header then each channel padded to the alignment
+bool isWellFormed(const EntryHeader &h, Sample::BitDepth bd, uint64_t fileBytes)
+{
+    if (memcmp(h.magic, EntryHeader().magic, 4) != 0 || h.version != entryVersion ||
+        h.bitDepth != (uint32_t)bd || h.channels < 1 || h.channels > 2 || h.sampleLength == 0)
+        return false;
+    if (h.channelBytes !=
+        (h.sampleLength + dsp::FIRipol_N) * (uint64_t)Sample::bitDepthByteSize(bd))
+        return false;
+
+    auto stride = alignUp(h.channelBytes, channelAlign);
+    for (uint32_t c = 0; c < h.channels; ++c)
+    {
+        if (h.channelOffset[c] != headerBytes + c * stride)
+            return false;
+    }
+    return fileBytes == headerBytes + h.channels * stride;
+}
+} // namespace
+
+DecodedSampleCache::DecodedSampleCache(const fs::path &dir, uint64_t budget)
+    : directory(dir), budgetBytes(budget)
+{
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+
+    uint64_t total{0};
+    for (const auto &de : fs::directory_iterator(directory, ec))
+    {
+        if (de.path().extension() == entryExtension)
+            total += de.file_size(ec);
+    }
+    cachedBytes = total;
+
+    SCLOG("Decoded sample cache at " << directory.u8string() << " holds " << (total >> 20)
+                                     << "MB of " << (budgetBytes >> 20) << "MB");
+    evictToBudget();
+}
+
+fs::path DecodedSampleCache::entryPath(const std::string &md5, int bitDepth) const
+{
+    return directory / (md5 + "-" + Sample::bitDepthName((Sample::BitDepth)bitDepth) +
+                        entryExtension);
+}
+
+bool DecodedSampleCache::load(const std::string &md5, Sample &s)
+{
+    if (md5.empty())
+        return false;
+
+    for (auto bd : {Sample::BD_I16, Sample::BD_F32, Sample::BD_I24})
+    {
+        auto p = entryPath(md5, bd);
+        std::error_code ec;
+        if (!fs::exists(p, ec))
+            continue;
+
+        // Check the header and length before mapping, so a truncated or corrupt entry
+        // never ends up behind sampleData
+        auto fileBytes = fs::file_size(p, ec);
+        if (ec)
+            continue;
+        EntryHeader h;
+        bool readHeader{false};
+        {
+            std::ifstream in(p, std::ios::binary);
+            readHeader = fileBytes >= headerBytes &&
+                         in.read(reinterpret_cast<char *>(&h), sizeof(h)).good();
+        }
+        if (!readHeader || !isWellFormed(h, bd, fileBytes))
+        {
+            SCLOG("Removing malformed decoded sample cache entry " << p.u8string());
+            removeEntry(p, fileBytes);
+            continue;
+        }
+
+        // A concurrent store renames an identical entry over this one, so the map still
+        // has to match what we checked
+        auto view = std::make_unique<infrastructure::FileMapView>(p);
+        if (!view->isMapped() || view->dataSize() != fileBytes ||
+            memcmp(view->data(), &h, sizeof(h)) != 0)
+            continue;
+
+        s.bitDepth = bd;
+        s.SetMeta(h.channels, h.sampleRate, h.sampleLength);
+        auto base = static_cast<uint8_t *>(view->data());
+        for (uint32_t c = 0; c < h.channels; ++c)
+            s.sampleData[c] = base + h.channelOffset[c];
+
+        s.meta.key_low = h.keyLow;
+        s.meta.key_high = h.keyHigh;
+        s.meta.key_root = h.keyRoot;
+        s.meta.vel_low = h.velLow;
+        s.meta.vel_high = h.velHigh;
+        s.meta.playmode = (Sample::PlayMode)h.playmode;
+        s.meta.detune = h.detune;
+        s.meta.loop_start = h.loopStart;
+        s.meta.loop_end = h.loopEnd;
+        s.meta.n_beats = h.nBeats;
+        s.meta.rootkey_present = h.presentFlags & rootkey;
+        s.meta.key_present = h.presentFlags & key;
+        s.meta.vel_present = h.presentFlags & vel;
+        s.meta.loop_present = h.presentFlags & loop;
+        s.meta.playmode_present = h.presentFlags & playmode;
+
+        s.mappedSampleData = std::move(view);
+
+        // Touch for LRU
+        fs::last_write_time(p, fs::file_time_type::clock::now(), ec);
+        return true;
+    }
+    return false;
+}
+
+void DecodedSampleCache::store(const std::string &md5, const Sample &s)
+{
+    if (md5.empty() || s.isStreamed() || s.channels < 1 || s.channels > 2 || !s.sampleData[0])
+        return;
+
+    EntryHeader h;
+    h.bitDepth = s.bitDepth;
+    h.channels = s.channels;
+    h.sampleRate = s.sample_rate;
+    h.sampleLength = s.sample_length;
+    h.channelBytes =
+        (s.sample_length + dsp::FIRipol_N) * (uint64_t)Sample::bitDepthByteSize(s.bitDepth);
+    h.channelOffset[0] = headerBytes;
+    h.channelOffset[1] = headerBytes + alignUp(h.channelBytes, channelAlign);
+
+    h.keyLow = s.meta.key_low;
+    h.keyHigh = s.meta.key_high;
+    h.keyRoot = s.meta.key_root;
+    h.velLow = s.meta.vel_low;
+    h.velHigh = s.meta.vel_high;
+    h.playmode = s.meta.playmode;
+    h.detune = s.meta.detune;
+    h.loopStart = s.meta.loop_start;
+    h.loopEnd = s.meta.loop_end;
+    h.nBeats = s.meta.n_beats;
+    h.presentFlags = (s.meta.rootkey_present ? rootkey : 0) | (s.meta.key_present ? key : 0) |
+                     (s.meta.vel_present ? vel : 0) | (s.meta.loop_present ? loop : 0) |
+                     (s.meta.playmode_present ? playmode : 0);
+
+    auto dest = entryPath(md5, s.bitDepth);
+    std::ostringstream tmpName;
+    tmpName << dest.filename().u8string() << ".tmp"
+            << std::hash<std::thread::id>()(std::this_thread::get_id());
+    auto tmp = directory / tmpName.str();
+
+    uint64_t written{0};
+    {
+        std::ofstream of(tmp, std::ios::binary);
+        if (!of.is_open())
+            return;
+
+        std::vector<char> pad(headerBytes, 0);
+        memcpy(pad.data(), &h, sizeof(h));
+        of.write(pad.data(), headerBytes);
+        for (uint32_t c = 0; c < s.channels; ++c)
+        {
+            of.write(static_cast<const char *>(s.sampleData[c]), h.channelBytes);
+            auto tail = alignUp(h.channelBytes, channelAlign) - h.channelBytes;
+            pad.assign(tail, 0);
+            of.write(pad.data(), tail);
+        }
+        written = of.tellp();
+        if (!of.good())
+            written = 0;
+    }
+
+    std::error_code ec;
+    if (written == 0)
+    {
+        fs::remove(tmp, ec);
+        return;
+    }
+    // Another thread may have stored the same content; count the bytes once
+    auto replaced = fs::file_size(dest, ec);
+    if (ec)
+        replaced = 0;
+    fs::rename(tmp, dest, ec);
+    if (ec)
+    {
+        fs::remove(tmp, ec);
+        return;
+    }
+
+    cachedBytes += written;
+    cachedBytes -= std::min<uint64_t>(replaced, cachedBytes);
+    if (cachedBytes > budgetBytes)
+        evictToBudget();
+}
+
+void DecodedSampleCache::removeEntry(const fs::path &p, uint64_t size)
+{
+    std::lock_guard<std::mutex> g(mutex);
+    std::error_code ec;
+    if (fs::remove(p, ec))
+        cachedBytes -= std::min<uint64_t>(size, cachedBytes);
+}
+
+void DecodedSampleCache::evictToBudget()
+{
+    std::lock_guard<std::mutex> g(mutex);
+    if (cachedBytes <= budgetBytes)
+        return;
+
+    struct Item
+    {
+        fs::file_time_type when;
+        fs::path path;
+        uint64_t size;
+    };
+    std::vector<Item> items;
+    uint64_t total{0};
+    std::error_code ec;
+    for (const auto &de : fs::directory_iterator(directory, ec))
+    {
+        if (de.path().extension() != entryExtension)
+            continue;
+        auto sz = de.file_size(ec);
+        items.push_back({de.last_write_time(ec), de.path(), sz});
+        total += sz;
+    }
+    std::sort(items.begin(), items.end(),
+              [](const auto &a, const auto &b) { return a.when < b.when; });
+
+    // Evict a little past the budget so we don't do this on every store
+    auto target = budgetBytes - budgetBytes / 10;
+    for (const auto &it : items)
+    {
+        if (total <= target)
+            break;
+        // A mapped entry can't be removed on some platforms; skip it and carry on
+        if (fs::remove(it.path, ec))
+            total -= it.size;
+    }
+    cachedBytes = total;
+}
+
+} // namespace scxt::sample
@@ -0,0 +1,79 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_SAMPLE_DECODED_SAMPLE_CACHE_H
+#define SCXT_SRC_SAMPLE_DECODED_SAMPLE_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "utils.h"
+#include "infrastructure/filesystem_import.h"
+
+namespace scxt::sample
+{
+struct Sample;
+
+/**
+ * A persistent, content addressed cache of decoded samples. Compressed formats (flac,
+ * mp3) and aiff are decoded once; the padded PCM exactly as it sits in
+ * Sample::sampleData is written to a file named for the source MD5 and bit depth, and
+ * later loads of the same content just map that file. A changed source hashes to a
+ * new key, so its stale entry simply ages out.
+ *
+ * The directory is kept under a byte budget by evicting least recently used entries
+ * (a hit touches the file's write time). Entries are checked against what store writes
+ * before they are mapped, and malformed ones are removed. All methods are safe to call from the sample
+ * load threads concurrently.
+ */
+struct DecodedSampleCache : MoveableOnly<DecodedSampleCache>
+{
+    DecodedSampleCache(const fs::path &directory, uint64_t budgetBytes);
+
+    // Populate s from a cached decode. On success s maps the cache file.
+    bool load(const std::string &md5, Sample &s);
+    // Write a freshly decoded s to the cache
+    void store(const std::string &md5, const Sample &s);
+
+    uint64_t getCachedBytes() const { return cachedBytes.load(); }
+
+  private:
+    fs::path entryPath(const std::string &md5, int bitDepth) const;
+    void removeEntry(const fs::path &p, uint64_t size);
+    void evictToBudget();
+
+    fs::path directory;
+    uint64_t budgetBytes{0};
+
+    std::mutex mutex;
+    std::atomic<uint64_t> cachedBytes{0};
+};
+} // namespace scxt::sample
+
+#endif // SCXT_SRC_SAMPLE_DECODED_SAMPLE_CACHE_H
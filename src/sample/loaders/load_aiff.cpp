@@ -30,6 +30,7 @@
 #include <cmath>
 
 #include "sample/sample.h"
+#include "sample/pcm_convert.h"
 
 namespace scxt::sample
 {
@@ -143,43 +144,19 @@ bool Sample::parse_aiff(void *data, size_t filesize)
 
     if (bitdepth == 32)
     {
-        if (channels == 2)
-        {
-            load_data_i32BE(0, loaddata, nsamples, 8);
-            load_data_i32BE(1, loaddata + 4, nsamples, 8);
-        }
-        else
-            load_data_i32BE(0, loaddata, nsamples, 4);
+        load_data_interleaved(pcm::Format::I32BE, channels, loaddata, nsamples);
     }
     else if (bitdepth == 24)
     {
-        if (channels == 2)
-        {
-            load_data_i24BE(0, loaddata, nsamples, 6);
-            load_data_i24BE(1, loaddata + 3, nsamples, 6);
-        }
-        else
-            load_data_i24BE(0, loaddata, nsamples, 3);
+        load_data_interleaved(pcm::Format::I24BE, channels, loaddata, nsamples);
     }
     else if (bitdepth == 16)
     {
-        if (channels == 2)
-        {
-            load_data_i16BE(0, loaddata, nsamples, 4);
-            load_data_i16BE(1, loaddata + 2, nsamples, 4);
-        }
-        else
-            load_data_i16BE(0, loaddata, nsamples, 2);
+        load_data_interleaved(pcm::Format::I16BE, channels, loaddata, nsamples);
     }
     else if (bitdepth == 8)
     {
-        if (channels == 2)
-        {
-            load_data_i8(0, loaddata, nsamples, 2);
-            load_data_i8(1, loaddata + 1, nsamples, 2);
-        }
-        else
-            load_data_i8(0, loaddata, nsamples, 1);
+        load_data_interleaved(pcm::Format::I8, channels, loaddata, nsamples);
     }
 
     this->sample_loaded = (sampleData[0] != 0);
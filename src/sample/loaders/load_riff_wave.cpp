@@ -27,13 +27,16 @@
 
 // #include "resampling.h"
 #include "sample/sample.h"
+#include "sample/pcm_convert.h"
 // #include <windows.h>
 // #include <mmreg.h>
 #include "riff_memfile.h"
 #include "riff_wave.h"
 // #include "sampler_state.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include "dsp/resampling.h"
 
 namespace scxt::sample
 {
@@ -123,7 +126,8 @@ bool Sample::save_wave_file(const fs::path &filename)
 }
 
 // TODO [prior] parse INAM etc etc metadata
-bool Sample::parse_riff_wave(void *data, size_t filesize, bool skip_riffchunk)
+bool Sample::parse_riff_wave(void *data, size_t filesize, bool skip_riffchunk,
+                             uint32_t streamingPreloadFrames, bool mapInPlace)
 {
     size_t datasize;
     scxt::sample::loaders::RIFFMemFile mf(data, filesize);
@@ -193,47 +197,93 @@ bool Sample::parse_riff_wave(void *data, size_t filesize, bool skip_riffchunk)
         return false;
     }
 
-    if (wh.wFormatTag == WAVE_FORMAT_PCM)
+    /*
+     * If we are streaming, only decode the head of the file, extended to cover the
+     * file loop (if there is one) so looping voices never need the disk. The rest
+     * stays in the file at dataOffset for the streamer.
+     */
+    streaming = StreamingSource();
+    auto loadSamples = WaveDataSamples;
+    if (streamingPreloadFrames > 0 && (uint32_t)WaveDataSamples > streamingPreloadFrames &&
+        (wh.wFormatTag == WAVE_FORMAT_PCM || wh.wFormatTag == WAVE_FORMAT_IEEE_FLOAT) &&
+        wh.nBlockAlign == wh.nChannels * wh.wBitsPerSample / 8)
     {
-        if (wh.wBitsPerSample == 8)
+        uint32_t resident = streamingPreloadFrames;
+        auto dataPos = mf.TellI();
+        mf.SeekI(wr, scxt::sample::loaders::mf_FromStart);
+        size_t smplsize;
+        if (mf.riff_descend('smpl', &smplsize))
         {
-            if (channels == 2)
+            loaders::SamplerChunk smpl_chunk;
+            loaders::SampleLoop smpl_loop;
+            mf.Read(&smpl_chunk, sizeof(loaders::SamplerChunk));
+            if (smpl_chunk.cSampleLoops > 0)
             {
-                load_data_ui8(0, loaddata, WaveDataSamples, 2);
-                load_data_ui8(1, loaddata + 1, WaveDataSamples, 2);
+                mf.Read(&smpl_loop, sizeof(loaders::SampleLoop));
+                resident = std::max(resident, (uint32_t)(smpl_loop.dwEnd + 1 + dsp::FIRipol_N));
             }
-            else
-                load_data_ui8(0, loaddata, WaveDataSamples, 1);
+        }
+        mf.SeekI(dataPos, scxt::sample::loaders::mf_FromStart);
+
+        if (resident < (uint32_t)WaveDataSamples)
+        {
+            streaming.active = true;
+            streaming.dataOffset = loaddata - (unsigned char *)data;
+            streaming.formatTag = wh.wFormatTag;
+            streaming.bitsPerSample = wh.wBitsPerSample;
+            streaming.blockAlign = wh.nBlockAlign;
+            streaming.residentLength = resident;
+            loadSamples = resident;
+        }
+    }
+
+    /*
+     * Mono or stereo PCM16, PCM24 and float32 are in a layout the generator can read, so
+     * when asked (and not streaming) point sampleData at the frames in place rather than
+     * copying them. The caller keeps the map alive. The data chunk is only word aligned by
+     * RIFF so check PCM16 and float frames are aligned for their type; packed PCM24 is read
+     * a byte at a time and needs no alignment.
+     */
+    mappedStride = 0;
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    auto isMappable = ((wh.wFormatTag == WAVE_FORMAT_PCM &&
+                        (wh.wBitsPerSample == 16 || wh.wBitsPerSample == 24)) ||
+                       (wh.wFormatTag == WAVE_FORMAT_IEEE_FLOAT && wh.wBitsPerSample == 32)) &&
+                      (channels == 1 || channels == 2) &&
+                      wh.nBlockAlign == wh.nChannels * wh.wBitsPerSample / 8 &&
+                      (wh.wBitsPerSample == 24 ||
+                       ((uintptr_t)loaddata % (wh.wBitsPerSample / 8)) == 0);
+    if (mapInPlace && isMappable && !streaming.active)
+    {
+        auto valueBytes = wh.wBitsPerSample / 8;
+        bitDepth = valueBytes == 2 ? BD_I16 : (valueBytes == 3 ? BD_I24 : BD_F32);
+        for (int c = 0; c < channels; ++c)
+            sampleData[c] = loaddata + c * valueBytes;
+        mappedStride = channels;
+    }
+#endif
+
+    if (mappedStride)
+    {
+        // nothing to decode
+    }
+    else if (wh.wFormatTag == WAVE_FORMAT_PCM)
+    {
+        if (wh.wBitsPerSample == 8)
+        {
+            load_data_interleaved(pcm::Format::U8, channels, loaddata, loadSamples);
         }
         else if (wh.wBitsPerSample == 16)
         {
-            if (channels == 2)
-            {
-                load_data_i16(0, loaddata, WaveDataSamples, 4);
-                load_data_i16(1, loaddata + 2, WaveDataSamples, 4);
-            }
-            else
-                load_data_i16(0, loaddata, WaveDataSamples, 2);
+            load_data_interleaved(pcm::Format::I16LE, channels, loaddata, loadSamples);
         }
         else if (wh.wBitsPerSample == 24)
         {
-            if (channels == 2)
-            {
-                load_data_i24(0, loaddata, WaveDataSamples, 6);
-                load_data_i24(1, loaddata + 3, WaveDataSamples, 6);
-            }
-            else
-                load_data_i24(0, loaddata, WaveDataSamples, 3);
+            load_data_interleaved(pcm::Format::I24LE, channels, loaddata, loadSamples);
         }
         else if (wh.wBitsPerSample == 32)
         {
-            if (channels == 2)
-            {
-                load_data_i32(0, loaddata, WaveDataSamples, 8);
-                load_data_i32(1, loaddata + 4, WaveDataSamples, 8);
-            }
-            else
-                load_data_i32(0, loaddata, WaveDataSamples, 4);
+            load_data_interleaved(pcm::Format::I32LE, channels, loaddata, loadSamples);
         }
         else
         {
@@ -246,23 +296,11 @@ bool Sample::parse_riff_wave(void *data, size_t filesize, bool skip_riffchunk)
     {
         if (wh.wBitsPerSample == 32)
         {
-            if (channels == 2)
-            {
-                load_data_f32(0, loaddata, WaveDataSamples, 8);
-                load_data_f32(1, loaddata + 4, WaveDataSamples, 8);
-            }
-            else
-                load_data_f32(0, loaddata, WaveDataSamples, 4);
+            load_data_interleaved(pcm::Format::F32, channels, loaddata, loadSamples);
         }
         else if (wh.wBitsPerSample == 64)
         {
-            if (channels == 2)
-            {
-                load_data_f64(0, loaddata, WaveDataSamples, 16);
-                load_data_f64(1, loaddata + 8, WaveDataSamples, 16);
-            }
-            else
-                load_data_f64(0, loaddata, WaveDataSamples, 8);
+            load_data_interleaved(pcm::Format::F64, channels, loaddata, loadSamples);
         }
         else
         {
@@ -47,7 +47,7 @@ bool importMultisample(const fs::path &p, engine::Engine &engine)
     if (!status)
         return false;
 
-    auto md5 = infrastructure::createMD5SumFromFile(p);
+    auto md5 = infrastructure::createMD5SumFromFile(p, engine.getSampleManager()->md5SumCache);
 
     // Step one: Build a zip file to index map
     std::map<std::string, int> fileToIndex;
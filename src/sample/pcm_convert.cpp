@@ -0,0 +1,544 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "pcm_convert.h"
+#include "infrastructure/sse_include.h"
+#include "sst/basic-blocks/mechanics/endian-ops.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SCXT_PCM_CONVERT_LITTLE_ENDIAN 1
+#else
+#define SCXT_PCM_CONVERT_LITTLE_ENDIAN 0
+#endif
+
+namespace scxt::sample::pcm
+{
+using namespace sst::basic_blocks::mechanics;
+
+KernelLevel bestKernelLevel()
+{
+    static const KernelLevel level = []() {
+#if !SCXT_PCM_CONVERT_LITTLE_ENDIAN
+        return KernelLevel::Scalar;
+#else
+        return infrastructure::cpuFeatures().avx2 ? KernelLevel::AVX2 : KernelLevel::SSE2;
+#endif
+    }();
+    return level;
+}
+
+namespace
+{
+/*
+ * Each kernel converts frames [from, frames) for as long as it has whole vectors and
+ * returns where it stopped; the next level down picks up from there and the scalar
+ * path finishes the tail.
+ */
+template <typename T> inline T *outAt(void *const out[2], int c) { return (T *)out[c]; }
+
+template <typename T> inline T readAs(const uint8_t *p)
+{
+    T res;
+    memcpy(&res, p, sizeof(T));
+    return res;
+}
+
+// The Sample::load_data_* conversions, value for value
+void convertScalar(Format f, const uint8_t *src, int channels, size_t from, size_t frames,
+                   void *const out[2])
+{
+    auto vb = sourceBytes(f);
+    auto fb = vb * channels;
+    for (int c = 0; c < channels; ++c)
+    {
+        auto s = src + c * vb;
+        switch (f)
+        {
+        case Format::U8:
+            for (auto i = from; i < frames; ++i)
+                outAt<int16_t>(out, c)[i] = (int16_t)((s[i * fb] - 128) * 256);
+            break;
+        case Format::I8:
+            for (auto i = from; i < frames; ++i)
+                outAt<int16_t>(out, c)[i] = (int16_t)((int8_t)s[i * fb] * 256);
+            break;
+        case Format::I16LE:
+            for (auto i = from; i < frames; ++i)
+                outAt<int16_t>(out, c)[i] = endian_read_int16LE(readAs<int16_t>(s + i * fb));
+            break;
+        case Format::I16BE:
+            for (auto i = from; i < frames; ++i)
+                outAt<int16_t>(out, c)[i] = endian_read_int16BE(readAs<int16_t>(s + i * fb));
+            break;
+        case Format::I24LE:
+            for (auto i = from; i < frames; ++i)
+                memcpy(outAt<uint8_t>(out, c) + i * 3, s + i * fb, 3);
+            break;
+        case Format::I24BE:
+            for (auto i = from; i < frames; ++i)
+            {
+                auto o = outAt<uint8_t>(out, c) + i * 3;
+                o[0] = s[i * fb + 2];
+                o[1] = s[i * fb + 1];
+                o[2] = s[i * fb];
+            }
+            break;
+        case Format::I32LE:
+            for (auto i = from; i < frames; ++i)
+            {
+                int x = endian_read_int32LE(readAs<int32_t>(s + i * fb));
+                outAt<float>(out, c)[i] = (4.6566128730772E-10f) * (float)x;
+            }
+            break;
+        case Format::I32BE:
+            for (auto i = from; i < frames; ++i)
+            {
+                int x = endian_read_int32BE(readAs<int32_t>(s + i * fb));
+                outAt<float>(out, c)[i] = (4.6566128730772E-10f) * (float)x;
+            }
+            break;
+        case Format::F32:
+            for (auto i = from; i < frames; ++i)
+                outAt<float>(out, c)[i] = readAs<float>(s + i * fb);
+            break;
+        case Format::F64:
+            for (auto i = from; i < frames; ++i)
+                outAt<float>(out, c)[i] = (float)readAs<double>(s + i * fb);
+            break;
+        }
+    }
+}
+
+#if SCXT_PCM_CONVERT_LITTLE_ENDIAN
+inline __m128i swap16(__m128i x)
+{
+    return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+inline __m128i swap32(__m128i x)
+{
+    auto mid = _mm_set1_epi32(0x00ff0000);
+    auto lo = _mm_or_si128(_mm_slli_epi32(x, 24), _mm_and_si128(_mm_slli_epi32(x, 8), mid));
+    auto hi = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(x, 8), _mm_srli_epi32(mid, 8)),
+                           _mm_srli_epi32(x, 24));
+    return _mm_or_si128(lo, hi);
+}
+
+inline __m128 i32ToF32(__m128i x)
+{
+    return _mm_mul_ps(_mm_set1_ps(4.6566128730772E-10f), _mm_cvtepi32_ps(x));
+}
+
+size_t convertSSE2(Format f, const uint8_t *src, int channels, size_t i, size_t frames,
+                   void *const out[2])
+{
+    // Mono little endian data with the target layout is a straight copy
+    if (channels == 1 && (f == Format::I16LE || f == Format::I24LE || f == Format::F32))
+    {
+        memcpy((uint8_t *)out[0] + i * sourceBytes(f), src + i * sourceBytes(f),
+               (frames - i) * sourceBytes(f));
+        return frames;
+    }
+
+    switch (f)
+    {
+    case Format::U8:
+    case Format::I8:
+    {
+        // The value in the high byte of an int16 is value << 8; U8 is offset by 128 first
+        auto flip = _mm_set1_epi8(f == Format::U8 ? (char)0x80 : 0);
+        auto o0 = outAt<int16_t>(out, 0), o1 = outAt<int16_t>(out, 1);
+        if (channels == 1)
+        {
+            for (; i + 16 <= frames; i += 16)
+            {
+                auto x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + i)), flip);
+                _mm_storeu_si128((__m128i *)(o0 + i), _mm_unpacklo_epi8(_mm_setzero_si128(), x));
+                _mm_storeu_si128((__m128i *)(o0 + i + 8),
+                                 _mm_unpackhi_epi8(_mm_setzero_si128(), x));
+            }
+        }
+        else
+        {
+            auto hiByte = _mm_set1_epi16((short)0xff00);
+            for (; i + 8 <= frames; i += 8)
+            {
+                auto x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + i * 2)), flip);
+                _mm_storeu_si128((__m128i *)(o0 + i), _mm_slli_epi16(x, 8));
+                _mm_storeu_si128((__m128i *)(o1 + i), _mm_and_si128(x, hiByte));
+            }
+        }
+        return i;
+    }
+    case Format::I16LE:
+    case Format::I16BE:
+    {
+        auto be = f == Format::I16BE;
+        auto o0 = outAt<int16_t>(out, 0), o1 = outAt<int16_t>(out, 1);
+        if (channels == 1)
+        {
+            // Only big endian gets here; little endian mono was copied above
+            for (; i + 8 <= frames; i += 8)
+            {
+                auto x = swap16(_mm_loadu_si128((const __m128i *)(src + i * 2)));
+                _mm_storeu_si128((__m128i *)(o0 + i), x);
+            }
+            return i;
+        }
+        for (; i + 8 <= frames; i += 8)
+        {
+            auto a = _mm_loadu_si128((const __m128i *)(src + i * 4));
+            auto b = _mm_loadu_si128((const __m128i *)(src + i * 4 + 16));
+            if (be)
+            {
+                a = swap16(a);
+                b = swap16(b);
+            }
+            // Each frame is an int32 with left in the low half; both halves fit the pack
+            auto l = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                                     _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+            auto r = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+            _mm_storeu_si128((__m128i *)(o0 + i), l);
+            _mm_storeu_si128((__m128i *)(o1 + i), r);
+        }
+        return i;
+    }
+    case Format::I32LE:
+    case Format::I32BE:
+    case Format::F32:
+    {
+        auto be = f == Format::I32BE;
+        auto isInt = f != Format::F32;
+        auto o0 = outAt<float>(out, 0), o1 = outAt<float>(out, 1);
+        auto toF32 = [be, isInt](__m128 v) {
+            if (!isInt)
+                return v;
+            auto x = _mm_castps_si128(v);
+            return i32ToF32(be ? swap32(x) : x);
+        };
+        if (channels == 1)
+        {
+            for (; i + 4 <= frames; i += 4)
+                _mm_storeu_ps(o0 + i, toF32(_mm_loadu_ps((const float *)(src + i * 4))));
+            return i;
+        }
+        for (; i + 4 <= frames; i += 4)
+        {
+            auto a = _mm_loadu_ps((const float *)(src + i * 8));
+            auto b = _mm_loadu_ps((const float *)(src + i * 8 + 16));
+            _mm_storeu_ps(o0 + i, toF32(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))));
+            _mm_storeu_ps(o1 + i, toF32(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+        }
+        return i;
+    }
+    case Format::F64:
+    {
+        auto o0 = outAt<float>(out, 0), o1 = outAt<float>(out, 1);
+        auto d = [src](size_t k) { return _mm_loadu_pd((const double *)(src + k * 8)); };
+        if (channels == 1)
+        {
+            for (; i + 4 <= frames; i += 4)
+                _mm_storeu_ps(o0 + i,
+                              _mm_movelh_ps(_mm_cvtpd_ps(d(i)), _mm_cvtpd_ps(d(i + 2))));
+            return i;
+        }
+        for (; i + 4 <= frames; i += 4)
+        {
+            auto f0 = d(2 * i), f1 = d(2 * i + 2), f2 = d(2 * i + 4), f3 = d(2 * i + 6);
+            _mm_storeu_ps(o0 + i, _mm_movelh_ps(_mm_cvtpd_ps(_mm_unpacklo_pd(f0, f1)),
+                                                _mm_cvtpd_ps(_mm_unpacklo_pd(f2, f3))));
+            _mm_storeu_ps(o1 + i, _mm_movelh_ps(_mm_cvtpd_ps(_mm_unpackhi_pd(f0, f1)),
+                                                _mm_cvtpd_ps(_mm_unpackhi_pd(f2, f3))));
+        }
+        return i;
+    }
+    case Format::I24LE:
+    case Format::I24BE:
+        // Three byte values want a byte shuffle, which SSE2 doesn't have
+        return i;
+    }
+    return i;
+}
+
+#if SCXT_HAS_AVX2_KERNELS
+// Four frames of packed 24 bit values, 12 bytes, from the low bytes of v
+SCXT_TARGET_AVX2 inline void storeI24x4(uint8_t *o, __m128i v)
+{
+    _mm_storel_epi64((__m128i *)o, v);
+    auto hi = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+    memcpy(o + 8, &hi, 4);
+}
+
+/*
+ * Lambdas don't take on the target of the function they are in, so the AVX2 kernel's
+ * helpers are all functions. laneOrder restores the frame order after a lane wise pack
+ * or shuffle of two registers.
+ */
+static constexpr int laneOrder = _MM_SHUFFLE(3, 1, 2, 0);
+
+SCXT_TARGET_AVX2 inline __m256i swap16x16(__m256i x)
+{
+    return _mm256_or_si256(_mm256_slli_epi16(x, 8), _mm256_srli_epi16(x, 8));
+}
+
+SCXT_TARGET_AVX2 inline __m256 i32ToF32x8(__m256 v, bool be)
+{
+    auto x = _mm256_castps_si256(v);
+    if (be)
+        x = _mm256_shuffle_epi8(x, _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14,
+                                                    13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8,
+                                                    15, 14, 13, 12));
+    return _mm256_mul_ps(_mm256_set1_ps(4.6566128730772E-10f), _mm256_cvtepi32_ps(x));
+}
+
+SCXT_TARGET_AVX2 inline __m256 inFrameOrder(__m256 v)
+{
+    return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(v), laneOrder));
+}
+
+SCXT_TARGET_AVX2 size_t convertAVX2(Format f, const uint8_t *src, int channels, size_t i,
+                                    size_t frames, void *const out[2])
+{
+    if (channels == 1 && (f == Format::I16LE || f == Format::I24LE || f == Format::F32))
+        return i;
+
+    switch (f)
+    {
+    case Format::U8:
+    case Format::I8:
+    {
+        auto flip = _mm256_set1_epi8(f == Format::U8 ? (char)0x80 : 0);
+        auto o0 = outAt<int16_t>(out, 0), o1 = outAt<int16_t>(out, 1);
+        if (channels == 1)
+        {
+            for (; i + 16 <= frames; i += 16)
+            {
+                auto x = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(src + i)));
+                x = _mm256_slli_epi16(_mm256_xor_si256(x, flip), 8);
+                _mm256_storeu_si256((__m256i *)(o0 + i), x);
+            }
+            return i;
+        }
+        auto hiByte = _mm256_set1_epi16((short)0xff00);
+        for (; i + 16 <= frames; i += 16)
+        {
+            auto x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(src + i * 2)), flip);
+            _mm256_storeu_si256((__m256i *)(o0 + i), _mm256_slli_epi16(x, 8));
+            _mm256_storeu_si256((__m256i *)(o1 + i), _mm256_and_si256(x, hiByte));
+        }
+        return i;
+    }
+    case Format::I16LE:
+    case Format::I16BE:
+    {
+        auto be = f == Format::I16BE;
+        auto o0 = outAt<int16_t>(out, 0), o1 = outAt<int16_t>(out, 1);
+        if (channels == 1)
+        {
+            for (; i + 16 <= frames; i += 16)
+                _mm256_storeu_si256((__m256i *)(o0 + i),
+                                    swap16x16(_mm256_loadu_si256((const __m256i *)(src + i * 2))));
+            return i;
+        }
+        for (; i + 16 <= frames; i += 16)
+        {
+            auto a = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+            auto b = _mm256_loadu_si256((const __m256i *)(src + i * 4 + 32));
+            if (be)
+            {
+                a = swap16x16(a);
+                b = swap16x16(b);
+            }
+            auto l = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16),
+                                        _mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16));
+            auto r = _mm256_packs_epi32(_mm256_srai_epi32(a, 16), _mm256_srai_epi32(b, 16));
+            _mm256_storeu_si256((__m256i *)(o0 + i), _mm256_permute4x64_epi64(l, laneOrder));
+            _mm256_storeu_si256((__m256i *)(o1 + i), _mm256_permute4x64_epi64(r, laneOrder));
+        }
+        return i;
+    }
+    case Format::I32LE:
+    case Format::I32BE:
+    case Format::F32:
+    {
+        auto be = f == Format::I32BE;
+        auto isInt = f != Format::F32;
+        auto o0 = outAt<float>(out, 0), o1 = outAt<float>(out, 1);
+        if (channels == 1)
+        {
+            for (; i + 8 <= frames; i += 8)
+            {
+                auto v = _mm256_loadu_ps((const float *)(src + i * 4));
+                _mm256_storeu_ps(o0 + i, isInt ? i32ToF32x8(v, be) : v);
+            }
+            return i;
+        }
+        for (; i + 8 <= frames; i += 8)
+        {
+            auto a = _mm256_loadu_ps((const float *)(src + i * 8));
+            auto b = _mm256_loadu_ps((const float *)(src + i * 8 + 32));
+            auto l = inFrameOrder(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            auto r = inFrameOrder(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+            _mm256_storeu_ps(o0 + i, isInt ? i32ToF32x8(l, be) : l);
+            _mm256_storeu_ps(o1 + i, isInt ? i32ToF32x8(r, be) : r);
+        }
+        return i;
+    }
+    case Format::F64:
+    {
+        auto o0 = outAt<float>(out, 0), o1 = outAt<float>(out, 1);
+        auto d = (const double *)src;
+        if (channels == 1)
+        {
+            for (; i + 4 <= frames; i += 4)
+                _mm_storeu_ps(o0 + i, _mm256_cvtpd_ps(_mm256_loadu_pd(d + i)));
+            return i;
+        }
+        for (; i + 4 <= frames; i += 4)
+        {
+            auto a = _mm256_loadu_pd(d + 2 * i), b = _mm256_loadu_pd(d + 2 * i + 4);
+            auto l = _mm256_permute4x64_pd(_mm256_unpacklo_pd(a, b), laneOrder);
+            auto r = _mm256_permute4x64_pd(_mm256_unpackhi_pd(a, b), laneOrder);
+            _mm_storeu_ps(o0 + i, _mm256_cvtpd_ps(l));
+            _mm_storeu_ps(o1 + i, _mm256_cvtpd_ps(r));
+        }
+        return i;
+    }
+    case Format::I24LE:
+    case Format::I24BE:
+    {
+        auto o0 = outAt<uint8_t>(out, 0), o1 = outAt<uint8_t>(out, 1);
+        // Byte k of value v, reversed for big endian; -1 leaves a zero
+        auto be = f == Format::I24BE;
+        auto b = [be](int v, int k) { return (char)(v * 3 + (be ? 2 - k : k)); };
+        if (channels == 1)
+        {
+            // Mono is big endian here. Four frames a load, which reads four bytes past them
+            auto m = _mm_setr_epi8(b(0, 0), b(0, 1), b(0, 2), b(1, 0), b(1, 1), b(1, 2), b(2, 0),
+                                   b(2, 1), b(2, 2), b(3, 0), b(3, 1), b(3, 2), -1, -1, -1, -1);
+            for (; (i + 4) * 3 + 4 <= frames * 3; i += 4)
+                storeI24x4(o0 + i * 3,
+                           _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + i * 3)), m));
+            return i;
+        }
+        /*
+         * Four stereo frames are 24 bytes, loaded as bytes 0-15 and 8-23. Value v of the
+         * 8 is at byte 3v, so the left values are 0 and 2 of the first load and 4 and 6
+         * (bytes 12 and 18, at 4 and 10 of the second load) and the right ones follow each.
+         */
+        auto lo = [&](int base) {
+            return _mm_setr_epi8(b(base, 0), b(base, 1), b(base, 2), b(base + 2, 0),
+                                 b(base + 2, 1), b(base + 2, 2), -1, -1, -1, -1, -1, -1, -1, -1,
+                                 -1, -1);
+        };
+        auto hi = [&](int base) {
+            // Here v counts from value 4, which starts at byte 4 of the second load
+            auto h = [&](int v, int k) { return (char)(b(v, k) + 4); };
+            return _mm_setr_epi8(-1, -1, -1, -1, -1, -1, h(base, 0), h(base, 1), h(base, 2),
+                                 h(base + 2, 0), h(base + 2, 1), h(base + 2, 2), -1, -1, -1, -1);
+        };
+        auto lLo = lo(0), rLo = lo(1), lHi = hi(0), rHi = hi(1);
+        for (; i + 4 <= frames; i += 4)
+        {
+            auto x0 = _mm_loadu_si128((const __m128i *)(src + i * 6));
+            auto x1 = _mm_loadu_si128((const __m128i *)(src + i * 6 + 8));
+            storeI24x4(o0 + i * 3,
+                       _mm_or_si128(_mm_shuffle_epi8(x0, lLo), _mm_shuffle_epi8(x1, lHi)));
+            storeI24x4(o1 + i * 3,
+                       _mm_or_si128(_mm_shuffle_epi8(x0, rLo), _mm_shuffle_epi8(x1, rHi)));
+        }
+        return i;
+    }
+    }
+    return i;
+}
+#endif
+#endif
+} // namespace
+
+void convert(Format f, const void *data, int channels, size_t frames, void *const out[2],
+             KernelLevel level)
+{
+    if (frames == 0)
+        return;
+
+    auto src = (const uint8_t *)data;
+    level = std::min(level, bestKernelLevel());
+    size_t i{0};
+#if SCXT_PCM_CONVERT_LITTLE_ENDIAN
+#if SCXT_HAS_AVX2_KERNELS
+    if (level >= KernelLevel::AVX2)
+        i = convertAVX2(f, src, channels, i, frames, out);
+#endif
+    if (level >= KernelLevel::SSE2)
+        i = convertSSE2(f, src, channels, i, frames, out);
+#endif
+    if (i < frames)
+        convertScalar(f, src, channels, i, frames, out);
+}
+
+thread_local bool convertOnCallingThreadOnly{false};
+
+void convertParallel(Format f, const void *data, int channels, size_t frames,
+                     void *const out[2])
+{
+    auto frameBytes = (size_t)sourceBytes(f) * channels;
+    auto hc = (int)std::thread::hardware_concurrency();
+    auto nChunks = std::min((size_t)std::clamp(hc, 1, 8),
+                            frames * frameBytes / (parallelThresholdBytes / 2) + 1);
+    if (convertOnCallingThreadOnly || frames * frameBytes <= parallelThresholdBytes ||
+        nChunks < 2)
+    {
+        convert(f, data, channels, frames, out, bestKernelLevel());
+        return;
+    }
+
+    // Chunks start on a multiple of 64 frames so every kernel runs whole vectors
+    auto chunkFrames = (frames / nChunks + 63) & ~(size_t)63;
+    auto outBytes = Sample::bitDepthByteSize(targetBitDepth(f));
+    auto convertChunk = [=](size_t start) {
+        auto n = std::min(chunkFrames, frames - start);
+        void *o[2]{nullptr, nullptr};
+        for (int c = 0; c < channels; ++c)
+            o[c] = (uint8_t *)out[c] + start * outBytes;
+        convert(f, (const uint8_t *)data + start * frameBytes, channels, n, o,
+                bestKernelLevel());
+    };
+
+    std::vector<std::thread> workers;
+    for (auto start = chunkFrames; start < frames; start += chunkFrames)
+        workers.emplace_back(convertChunk, start);
+    convertChunk(0);
+    for (auto &w : workers)
+        w.join();
+}
+} // namespace scxt::sample::pcm
@@ -0,0 +1,138 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_SAMPLE_PCM_CONVERT_H
+#define SCXT_SRC_SAMPLE_PCM_CONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sample.h"
+#include "infrastructure/cpu_features.h"
+
+/*
+ * Conversion of interleaved file PCM into the planar data a Sample holds. The scalar path
+ * is exactly the per channel Sample::load_data_* conversion; the SSE2 and AVX2 kernels
+ * read each frame once for both channels and are bit identical to it. 8 and 16 bit
+ * become I16, 24 bit stays packed little endian I24 and 32 and 64 bit become F32.
+ */
+namespace scxt::sample::pcm
+{
+enum class Format : uint8_t
+{
+    U8,
+    I8,
+    I16LE,
+    I16BE,
+    I24LE,
+    I24BE,
+    I32LE,
+    I32BE,
+    F32,
+    F64
+};
+
+constexpr int sourceBytes(Format f)
+{
+    switch (f)
+    {
+    case Format::U8:
+    case Format::I8:
+        return 1;
+    case Format::I16LE:
+    case Format::I16BE:
+        return 2;
+    case Format::I24LE:
+    case Format::I24BE:
+        return 3;
+    case Format::I32LE:
+    case Format::I32BE:
+    case Format::F32:
+        return 4;
+    case Format::F64:
+        return 8;
+    }
+    return 1;
+}
+
+constexpr Sample::BitDepth targetBitDepth(Format f)
+{
+    switch (f)
+    {
+    case Format::U8:
+    case Format::I8:
+    case Format::I16LE:
+    case Format::I16BE:
+        return Sample::BD_I16;
+    case Format::I24LE:
+    case Format::I24BE:
+        return Sample::BD_I24;
+    default:
+        return Sample::BD_F32;
+    }
+}
+
+enum class KernelLevel
+{
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// The fastest level this CPU supports, detected once. Scalar on big endian hosts.
+KernelLevel bestKernelLevel();
+
+/*
+ * Converts frames of data, channels (1 or 2) values a frame, into out[c] for each channel.
+ * Levels above bestKernelLevel() are clamped.
+ */
+void convert(Format f, const void *data, int channels, size_t frames, void *const out[2],
+             KernelLevel level);
+
+/*
+ * convert() at the best level, with more than parallelThresholdBytes of source split into
+ * frame ranges converted on several threads. A thread which is already one of several
+ * loading at once (an AsyncSampleLoader worker) holds a SingleThreadedGuard, under which
+ * everything is converted on the calling thread rather than oversubscribing the cores.
+ */
+static constexpr size_t parallelThresholdBytes{32 << 20};
+void convertParallel(Format f, const void *data, int channels, size_t frames,
+                     void *const out[2]);
+
+extern thread_local bool convertOnCallingThreadOnly;
+struct SingleThreadedGuard
+{
+    bool prior{false};
+    SingleThreadedGuard() : prior(convertOnCallingThreadOnly)
+    {
+        convertOnCallingThreadOnly = true;
+    }
+    ~SingleThreadedGuard() { convertOnCallingThreadOnly = prior; }
+};
+} // namespace scxt::sample::pcm
+
+#endif // SCXT_SRC_SAMPLE_PCM_CONVERT_H
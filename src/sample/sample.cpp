@@ -25,10 +25,16 @@
  * https://github.com/surge-synthesizer/shortcircuit-xt
  */
 
+#include <optional>
 #include <sstream>
 #include "sst/basic-blocks/mechanics/endian-ops.h"
 #include "infrastructure/file_map_view.h"
 #include "infrastructure/md5support.h"
+#include "decoded_sample_cache.h"
+#include "compressed_sample_store.h"
+#include "sample_summary.h"
+#include "pcm_convert.h"
+#include "sample_streamer.h"
 #include "dsp/resampling.h"
 #include "sample.h"
 
@@ -40,18 +46,30 @@ using namespace sst::basic_blocks::mechanics;
 
 Sample::~Sample()
 {
+    if (mappedSampleData)
+        return;
     if (sampleData[0])
         free(sampleData[0]);
     if (sampleData[1])
         free(sampleData[1]);
 }
 
-bool Sample::load(const fs::path &path)
+bool Sample::load(const fs::path &path, uint32_t streamingPreloadFrames,
+                  DecodedSampleCache *cache, infrastructure::MD5SumCache *md5Cache,
+                  bool mapInPlace)
 {
     if (!fs::exists(path))
         return false;
 
-    md5Sum = infrastructure::createMD5SumFromFile(path);
+    md5Sum = infrastructure::createMD5SumFromFile(path, md5Cache);
+
+    auto decoded = [&](SourceType t) {
+        sample_loaded = true;
+        type = t;
+        mFileName = path;
+        displayName = fmt::format("{}", path.filename().u8string());
+        return true;
+    };
 
     // If you add a type here add it in Browser::isLoadableFile also to stay in sync
     if (extensionMatches(path, ".wav"))
@@ -62,39 +80,42 @@ bool Sample::load(const fs::path &path)
 
         clear_data(); // clear to a more predictable state
 
-        bool r = parse_riff_wave(data, datasize);
+        bool r = parse_riff_wave(data, datasize, false, streamingPreloadFrames, mapInPlace);
         if (!r)
             return false;
 
-        sample_loaded = true;
-        mFileName = path;
-        displayName = fmt::format("{}", path.filename().u8string());
-        type = WAV_FILE;
-        return true;
-    }
-    else if (extensionMatches(path, ".flac"))
-    {
-        if (parseFlac(path))
-        {
-            sample_loaded = true;
-            type = FLAC_FILE;
-            mFileName = path;
-            displayName = fmt::format("{}", path.filename().u8string());
-            return true;
-        }
+        // sampleData points into the file so the map lives as long as we do
+        if (isMappedInPlace())
+            mappedSampleData = std::move(fmv);
+
+        return decoded(WAV_FILE);
     }
+
+    // Everything below here decodes, so is worth caching
+    std::optional<SourceType> decodeType;
+    if (extensionMatches(path, ".flac"))
+        decodeType = FLAC_FILE;
     else if (extensionMatches(path, ".mp3"))
-    {
-        if (parseMP3(path))
-        {
-            sample_loaded = true;
-            type = MP3_FILE;
-            mFileName = path;
-            displayName = fmt::format("{}", path.filename().u8string());
-            return true;
-        }
-    }
+        decodeType = MP3_FILE;
     else if (extensionMatches(path, ".aif") || extensionMatches(path, ".aiff"))
+        decodeType = AIFF_FILE;
+
+    if (!decodeType.has_value())
+        return false;
+
+    if (cache && cache->load(md5Sum, *this))
+        return decoded(*decodeType);
+
+    bool r{false};
+    switch (*decodeType)
+    {
+    case FLAC_FILE:
+        r = parseFlac(path);
+        break;
+    case MP3_FILE:
+        r = parseMP3(path);
+        break;
+    case AIFF_FILE:
     {
         auto fmv = std::make_unique<infrastructure::FileMapView>(path);
         auto data = fmv->data();
@@ -102,16 +123,21 @@ bool Sample::load(const fs::path &path)
 
         clear_data(); // clear to a more predictable state
 
-        bool r = parse_aiff(data, datasize);
+        parse_aiff(data, datasize);
         // TODO deal with return value
-        type = AIFF_FILE;
-        sample_loaded = true;
-        mFileName = path;
-        displayName = fmt::format("{}", path.filename().u8string());
-        return true;
+        r = true;
+    }
+    break;
+    default:
+        break;
     }
 
-    return false;
+    if (!r)
+        return false;
+
+    if (cache)
+        cache->store(md5Sum, *this);
+    return decoded(*decodeType);
 }
 
 bool Sample::loadFromSF2(const fs::path &p, sf2::File *f, int presetNum, int inst, int reg)
@@ -196,12 +222,123 @@ bool Sample::loadFromSF2(const fs::path &p, sf2::File *f, int presetNum, int ins
 }
 
 // TODO: Rename these
+size_t Sample::getDataSize() const
+{
+    auto res = getResidentSampleLength() * bitDepthByteSize(bitDepth) * channels;
+    if (streaming.compressed)
+        res += streaming.compressed->getSizeInBytes();
+    return res;
+}
+
+std::shared_ptr<Sample> Sample::createEvictedStandIn() const
+{
+    auto res = std::make_shared<Sample>(id);
+    res->type = type;
+    res->displayName = displayName;
+    res->mFileName = mFileName;
+    res->md5Sum = md5Sum;
+    res->preset = preset;
+    res->instrument = instrument;
+    res->region = region;
+    res->bitDepth = bitDepth;
+    res->channels = channels;
+    res->Embedded = Embedded;
+    res->sample_length = sample_length;
+    res->sample_rate = sample_rate;
+    res->InvSampleRate = InvSampleRate;
+    res->meta = meta;
+    memcpy(res->name, name, sizeof(name));
+    res->lastTriggered = lastTriggered.load(std::memory_order_relaxed);
+    res->evicted = true;
+    return res;
+}
+
+bool Sample::compressBeyond(uint32_t residentFrames)
+{
+    if ((bitDepth != BD_I16 && bitDepth != BD_I24) || isStreamed() || mappedSampleData ||
+        channels < 1 || channels > 2 || !sampleData[0])
+        return false;
+
+    // As with streaming, keep the file loop resident so looping voices never decode
+    auto resident = residentFrames;
+    if (meta.loop_present)
+        resident = std::max(resident, (uint32_t)(meta.loop_end + 1 + dsp::FIRipol_N));
+    if ((uint64_t)resident + CompressedSampleStore::blockFrames >= sample_length)
+        return false;
+
+    // A voice window can start up to a window before the end of the head, so the store
+    // overlaps the head by that much rather than have the streamer read both
+    auto firstFrame = resident - std::min(resident, (uint32_t)StreamingVoiceBuffer::windowFrames);
+    const void *data[2]{nullptr, nullptr};
+    for (int c = 0; c < channels; ++c)
+        data[c] = (uint8_t *)sampleData[c] + dsp::FIRoffset * bitDepthByteSize(bitDepth);
+
+    auto store =
+        CompressedSampleStore::encode(bitDepth, channels, data, firstFrame, sample_length);
+    if (!store)
+        return false;
+
+    auto saved = (int64_t)(sample_length - resident) * bitDepthByteSize(bitDepth) * channels -
+                 (int64_t)store->getSizeInBytes();
+    if (saved <= 0)
+    {
+        SCLOG("Not compressing '" << mFileName.u8string() << "'; it doesn't get smaller");
+        return false;
+    }
+
+    // Shrink the PCM to the head, keeping the FIRoffset zero pad after it
+    auto bpf = bitDepthByteSize(bitDepth);
+    void *head[2]{nullptr, nullptr};
+    for (int c = 0; c < channels; ++c)
+    {
+        head[c] = malloc((resident + dsp::FIRipol_N) * bpf);
+        if (!head[c])
+        {
+            free(head[0]);
+            return false;
+        }
+    }
+    for (int c = 0; c < channels; ++c)
+    {
+        memcpy(head[c], sampleData[c], (resident + dsp::FIRoffset) * bpf);
+        memset((uint8_t *)head[c] + (resident + dsp::FIRoffset) * bpf, 0, dsp::FIRoffset * bpf);
+        free(sampleData[c]);
+        sampleData[c] = head[c];
+    }
+
+    streaming = StreamingSource();
+    streaming.active = true;
+    streaming.residentLength = resident;
+    streaming.compressed = std::move(store);
+
+    // A summary of the longer resident data would read past the head
+    std::lock_guard<std::mutex> g(summaryMutex);
+    summary.reset();
+    return true;
+}
+
+std::shared_ptr<const SampleSummary> Sample::getSummary()
+{
+    std::lock_guard<std::mutex> g(summaryMutex);
+    if (!summary)
+        summary = SampleSummary::build(*this);
+    return summary;
+}
+
+bool Sample::hasSummary() const
+{
+    std::lock_guard<std::mutex> g(summaryMutex);
+    return summary != nullptr;
+}
+
 short *Sample::GetSamplePtrI16(int Channel)
 {
     if (bitDepth != BD_I16)
         return nullptr;
     if (!sampleData[Channel])
         return nullptr;
+    if (isMappedInPlace())
+        return (short *)sampleData[Channel];
     return &((short *)sampleData[Channel])[scxt::dsp::FIRoffset];
 }
 float *Sample::GetSamplePtrF32(int Channel)
@@ -210,8 +347,20 @@ float *Sample::GetSamplePtrF32(int Channel)
         return nullptr;
     if (!sampleData[Channel])
         return nullptr;
+    if (isMappedInPlace())
+        return (float *)sampleData[Channel];
     return &((float *)sampleData[Channel])[scxt::dsp::FIRoffset];
 }
+uint8_t *Sample::GetSamplePtrI24(int Channel)
+{
+    if (bitDepth != BD_I24)
+        return nullptr;
+    if (!sampleData[Channel])
+        return nullptr;
+    if (isMappedInPlace())
+        return (uint8_t *)sampleData[Channel];
+    return &((uint8_t *)sampleData[Channel])[scxt::dsp::FIRoffset * 3];
+}
 
 // TODO: What the heck is this doing?
 bool Sample::allocateI16(int Channel, int Samples)
@@ -250,6 +399,23 @@ bool Sample::allocateF32(int Channel, int Samples)
 
     return true;
 }
+bool Sample::allocateI24(int Channel, int Samples)
+{
+    int samplesizewithmargin = Samples + scxt::dsp::FIRipol_N;
+    if (sampleData[Channel])
+        free(sampleData[Channel]);
+    sampleData[Channel] = malloc(3 * samplesizewithmargin);
+    if (!sampleData[Channel])
+        return false;
+    bitDepth = BD_I24;
+
+    // clear pre/post zero area
+    memset(sampleData[Channel], 0, scxt::dsp::FIRoffset * 3);
+    memset((char *)sampleData[Channel] + (Samples + scxt::dsp::FIRoffset) * 3, 0,
+           scxt::dsp::FIRoffset * 3);
+
+    return true;
+}
 
 bool Sample::load_data_ui8(int channel, void *data, unsigned int samplesize, unsigned int stride)
 {
@@ -324,34 +490,35 @@ bool Sample::load_data_i32BE(int channel, void *data, unsigned int samplesize, u
     return true;
 }
 
+// 24 bit data stays packed; the generator unpacks it as it reads. See BD_I24
 bool Sample::load_data_i24(int channel, void *data, unsigned int samplesize, unsigned int stride)
 {
-    allocateF32(channel, samplesize);
-    float *sampledata = GetSamplePtrF32(channel);
+    allocateI24(channel, samplesize);
+    uint8_t *sampledata = GetSamplePtrI24(channel);
 
+    if (stride == 3)
+    {
+        memcpy(sampledata, data, samplesize * 3);
+        return true;
+    }
     for (int i = 0; i < samplesize; i++)
     {
-        unsigned char *cval = (unsigned char *)data + i * stride;
-        int value = (cval[2] << 16) | (cval[1] << 8) | cval[0];
-        value -= (value & 0x800000) << 1;
-        sampledata[i] = 0.00000011920928955078f * float(value);
-        ;
+        memcpy(sampledata + i * 3, (unsigned char *)data + i * stride, 3);
     }
     return true;
 }
 
 bool Sample::load_data_i24BE(int channel, void *data, unsigned int samplesize, unsigned int stride)
 {
-    allocateF32(channel, samplesize);
-    float *sampledata = GetSamplePtrF32(channel);
+    allocateI24(channel, samplesize);
+    uint8_t *sampledata = GetSamplePtrI24(channel);
 
     for (int i = 0; i < samplesize; i++)
     {
         unsigned char *cval = (unsigned char *)data + i * stride;
-        int value = (cval[0] << 16) | (cval[1] << 8) | cval[2];
-        value -= (value & 0x800000) << 1;
-        sampledata[i] = 0.00000011920928955078f * float(value);
-        ;
+        sampledata[i * 3] = cval[2];
+        sampledata[i * 3 + 1] = cval[1];
+        sampledata[i * 3 + 2] = cval[0];
     }
     return true;
 }
@@ -380,6 +547,37 @@ bool Sample::load_data_f64(int channel, void *data, unsigned int samplesize, uns
     return true;
 }
 
+bool Sample::load_data_interleaved(pcm::Format format, int channels, void *data,
+                                   unsigned int samplesize)
+{
+    if (channels < 1 || channels > 2)
+        return false;
+
+    void *out[2]{nullptr, nullptr};
+    for (int c = 0; c < channels; ++c)
+    {
+        switch (pcm::targetBitDepth(format))
+        {
+        case BD_I16:
+            allocateI16(c, samplesize);
+            out[c] = GetSamplePtrI16(c);
+            break;
+        case BD_I24:
+            allocateI24(c, samplesize);
+            out[c] = GetSamplePtrI24(c);
+            break;
+        case BD_F32:
+            allocateF32(c, samplesize);
+            out[c] = GetSamplePtrF32(c);
+            break;
+        }
+        if (!out[c])
+            return false;
+    }
+    pcm::convertParallel(format, data, channels, samplesize, out);
+    return true;
+}
+
 bool Sample::SetMeta(unsigned int Channels, unsigned int SampleRate, unsigned int SampleLength)
 {
     if (Channels > 2)
@@ -429,12 +627,13 @@ void Sample::dumpInformationToLog()
         for (int c = 0; c < channels; ++c)
         {
             auto *dat = GetSamplePtrI16(c);
+            auto stride = getFrameStride();
             auto mxv = std::numeric_limits<int16_t>::min();
             auto mnv = std::numeric_limits<int16_t>::max();
-            for (int i = 0; i < sample_length; ++i)
+            for (int i = 0; i < getResidentSampleLength(); ++i)
             {
-                mxv = std::max(mxv, dat[i]);
-                mnv = std::min(mnv, dat[i]);
+                mxv = std::max(mxv, dat[i * stride]);
+                mnv = std::min(mnv, dat[i * stride]);
             }
             SCLOG("Min/Max = " << mxv << " " << mnv);
 
@@ -449,6 +648,22 @@ void Sample::dumpInformationToLog()
         SCLOG("TODO: Implement Sapmle Scan for F32");
     }
     break;
+    case BD_I24:
+    {
+        for (int c = 0; c < channels; ++c)
+        {
+            auto *dat = GetSamplePtrI24(c);
+            auto stride = getFrameStride() * 3;
+            auto mxv = -2.f, mnv = 2.f;
+            for (int i = 0; i < getResidentSampleLength(); ++i)
+            {
+                mxv = std::max(mxv, unpackI24(dat + i * stride));
+                mnv = std::min(mnv, unpackI24(dat + i * stride));
+            }
+            SCLOG("Min/Max = " << mxv << " " << mnv);
+        }
+    }
+    break;
     }
 }
 
@@ -29,10 +29,23 @@
 
 #include "utils.h"
 #include "infrastructure/filesystem_import.h"
+#include "infrastructure/file_map_view.h"
+#include "infrastructure/md5support.h"
 #include "SF.h"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+
 namespace scxt::sample
 {
+struct DecodedSampleCache;
+struct CompressedSampleStore;
+struct SampleSummary;
+namespace pcm
+{
+enum class Format : uint8_t;
+}
 
 struct alignas(16) Sample : MoveableOnly<Sample>
 {
@@ -54,7 +67,19 @@ struct alignas(16) Sample : MoveableOnly<Sample>
 
     std::string displayName{};
     std::string getDisplayName() const { return displayName; }
-    bool load(const fs::path &path);
+    /*
+     * If streamingPreloadFrames is non-zero and the file supports it (today, uncompressed
+     * WAV), only that many frames are decoded into memory and the rest is left on disk
+     * for the SampleStreamer. See StreamingSource below.
+     *
+     * With a DecodedSampleCache, formats which need decoding are mapped from the cache
+     * when present and written to it when not. With an MD5SumCache an unchanged file
+     * isn't rehashed. With mapInPlace, a wav which can be played straight from the file
+     * isn't copied at all; see mappedStride below.
+     */
+    bool load(const fs::path &path, uint32_t streamingPreloadFrames = 0,
+              DecodedSampleCache *cache = nullptr,
+              infrastructure::MD5SumCache *md5Cache = nullptr, bool mapInPlace = false);
     bool loadFromSF2(const fs::path &path, sf2::File *f, int preset, int inst, int region);
 
     const fs::path &getPath() const { return mFileName; }
@@ -92,20 +117,111 @@ struct alignas(16) Sample : MoveableOnly<Sample>
                 getCompoundRegion()};
     }
 
-    size_t getDataSize() const { return sample_length * bitDepthByteSize(bitDepth) * channels; }
+    // The memory the sample data holds: the resident frames plus any compressed remainder
+    size_t getDataSize() const;
     size_t getSampleLength() const { return sample_length; }
+
+    /*
+     * A streamed sample keeps only its head (extended to cover the loop in the file's
+     * smpl chunk, if any) in sampleData. sample_length is still the full length of the
+     * sample but only getResidentSampleLength() frames may be read from sampleData; the
+     * remainder is read from dataOffset in the file by the SampleStreamer, or decoded from
+     * compressed if the sample was compressed in memory with compressBeyond().
+     */
+    struct StreamingSource
+    {
+        bool active{false};
+        size_t dataOffset{0};
+        uint16_t formatTag{0};
+        uint16_t bitsPerSample{0};
+        uint16_t blockAlign{0};
+        uint32_t residentLength{0};
+        std::shared_ptr<const CompressedSampleStore> compressed;
+    } streaming;
+    bool isStreamed() const { return streaming.active; }
+    size_t getResidentSampleLength() const
+    {
+        if (evicted)
+            return 0;
+        return streaming.active ? streaming.residentLength : sample_length;
+    }
     std::string getBitDepthText() const { return bitDepthName(bitDepth); }
 
+    /*
+     * Compressed sample memory. Keeps the first residentFrames frames (extended to cover the
+     * file loop, if there is one) as they are and holds the rest losslessly compressed in a
+     * CompressedSampleStore, which the SampleStreamer decodes into voice windows just as it
+     * reads a streamed file. Only integer (I16 and I24) samples which are neither streamed
+     * nor mapped compress, and a sample which doesn't shrink is left alone. As for streamed
+     * files, a voice looping or reversing past the head is held inside it and the sample is
+     * loaded again uncompressed (see SampleManager::requestFullyResident). Returns whether
+     * the sample is now compressed.
+     */
+    bool compressBeyond(uint32_t residentFrames);
+    bool isCompressed() const { return streaming.compressed != nullptr; }
+
+    /*
+     * Memory budget eviction (see SampleManager::memoryBudgetBytes). An evicted sample is a
+     * stand in with every field but the audio: no data is resident and no voice starts on
+     * it. The SampleManager swaps it for a fresh load when it is triggered again.
+     * lastTriggered orders samples for eviction and reloadRequested marks a stand in which
+     * has been triggered; the audio thread writes both.
+     */
+    std::shared_ptr<Sample> createEvictedStandIn() const;
+    bool isEvicted() const { return evicted; }
+    std::atomic<uint64_t> lastTriggered{0};
+    std::atomic<bool> reloadRequested{false};
+
+    /*
+     * Set on the audio thread when a voice needs more of a streamed sample than streaming
+     * can give it (see SampleManager::requestFullyResident).
+     */
+    std::atomic<bool> fullyResidentRequested{false};
+
+    /*
+     * The min / max / RMS summary of the whole sample (see SampleSummary), built on the
+     * first call unless a SampleSummaryBuilder got there first. Callable from any thread but
+     * the audio thread once the sample is loaded.
+     */
+    std::shared_ptr<const SampleSummary> getSummary();
+    bool hasSummary() const;
+    // True the first time only, so a SampleSummaryBuilder queues each sample once
+    bool claimSummaryBuild()
+    {
+        return !summaryClaimed.load(std::memory_order_relaxed) && !summaryClaimed.exchange(true);
+    }
+
     bool parseFlac(const fs::path &p);
     bool parseMP3(const fs::path &p);
 
     void *__restrict sampleData[2]{nullptr, nullptr};
+    // If set, sampleData points into this mapped file rather than malloc
+    std::unique_ptr<infrastructure::FileMapView> mappedSampleData;
+
+    /*
+     * Non-zero when sampleData points straight at the frames of a mapped wav (mono or
+     * stereo PCM16, PCM24 or float32). Channel c starts at sampleData[c], frames are mappedStride
+     * values apart and there are no FIRoffset zero pads around the data, so nothing may
+     * read outside [0, sample_length). Index with getFrameStride() to handle both layouts.
+     */
+    uint32_t mappedStride{0};
+    bool isMappedInPlace() const { return mappedStride != 0; }
+    size_t getFrameStride() const { return mappedStride ? mappedStride : 1; }
 
     // TODO: Review evertyhing from here down before moving it above this comment
-    bool parse_riff_wave(void *data, size_t filesize, bool skip_riffchunk = false);
+    bool parse_riff_wave(void *data, size_t filesize, bool skip_riffchunk = false,
+                         uint32_t streamingPreloadFrames = 0, bool mapInPlace = false);
     bool parse_aiff(void *data, size_t filesize);
     short *GetSamplePtrI16(int Channel);
     float *GetSamplePtrF32(int Channel);
+    uint8_t *GetSamplePtrI24(int Channel);
+
+    // One BD_I24 value, scaled as the F32 conversion of 24 bit data always has been
+    static float unpackI24(const uint8_t *p)
+    {
+        auto v = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8;
+        return 0.00000011920928955078f * float(v);
+    }
     char *GetName();
 
   private:
@@ -120,12 +236,13 @@ struct alignas(16) Sample : MoveableOnly<Sample>
     // public data
     enum BitDepth
     {
-        // Right now 8 -> I16 at load and 24 -> F32 at load and noone supports 12 so just make this
+        // Right now 8 -> I16 at load and noone supports 12 so just make this
         // BD_I8,
         // BD_I12,
         BD_I16,
-        // BD_I24,
-        BD_F32
+        BD_F32,
+        // Packed little endian 24 bit, three bytes a value. After F32 so stored values don't move
+        BD_I24
     } bitDepth{BD_F32};
 
     static std::string bitDepthName(BitDepth bd)
@@ -136,6 +253,8 @@ struct alignas(16) Sample : MoveableOnly<Sample>
             return "I16";
         case BD_F32:
             return "F32";
+        case BD_I24:
+            return "I24";
         default:
             return "UNKWN";
         }
@@ -149,6 +268,8 @@ struct alignas(16) Sample : MoveableOnly<Sample>
             return 2;
         case BD_F32:
             return 4;
+        case BD_I24:
+            return 3;
         default:
             return 1;
         }
@@ -206,6 +327,12 @@ struct alignas(16) Sample : MoveableOnly<Sample>
     } meta;
 
   private:
+    bool evicted{false};
+
+    mutable std::mutex summaryMutex;
+    std::shared_ptr<const SampleSummary> summary;
+    std::atomic<bool> summaryClaimed{false};
+
     void clear_data()
     {
         // TODO: Figure Out and Implement clear_data
@@ -215,6 +342,7 @@ struct alignas(16) Sample : MoveableOnly<Sample>
   public:
     bool allocateI16(int Channel, int Samples);
     bool allocateF32(int Channel, int Samples);
+    bool allocateI24(int Channel, int Samples);
 
     bool load_data_ui8(int channel, void *data, unsigned int samplesize, unsigned int stride);
     bool load_data_i8(int channel, void *data, unsigned int samplesize, unsigned int stride);
@@ -226,6 +354,13 @@ struct alignas(16) Sample : MoveableOnly<Sample>
     bool load_data_i32BE(int channel, void *data, unsigned int samplesize, unsigned int stride);
     bool load_data_f32(int channel, void *data, unsigned int samplesize, unsigned int stride);
     bool load_data_f64(int channel, void *data, unsigned int samplesize, unsigned int stride);
+    /*
+     * samplesize frames of interleaved data, channels values a frame, converted into every
+     * channel in one pass with the SIMD kernels in pcm_convert.h, across threads for very
+     * large data. The result is the same as load_data_* channel by channel.
+     */
+    bool load_data_interleaved(pcm::Format format, int channels, void *data,
+                               unsigned int samplesize);
     bool sample_loaded{false};
 
     bool SetMeta(unsigned int channels, unsigned int SampleRate, unsigned int SampleLength);
@@ -25,10 +25,13 @@
  * https://github.com/surge-synthesizer/shortcircuit-xt
  */
 
+#include <algorithm>
 #include <cassert>
 #include "sample_manager.h"
 #include "infrastructure/md5support.h"
 
+#include <unordered_set>
+
 namespace scxt::sample
 {
 
@@ -49,7 +52,15 @@ void SampleManager::restoreFromSampleAddressesAndIDs(const sampleAddressesAndIds
             case Sample::MP3_FILE:
             case Sample::AIFF_FILE:
             {
-                loadSampleByPathToID(addr.path, id);
+                if (deferFileDecodes)
+                {
+                    SampleID::guaranteeNextAbove(id);
+                    pendingLoads[id] = addr;
+                }
+                else
+                {
+                    loadSampleByPathToID(addr.path, id);
+                }
             }
             break;
             case Sample::SF2_FILE:
@@ -70,6 +81,60 @@ void SampleManager::restoreFromSampleAddressesAndIDs(const sampleAddressesAndIds
 
 SampleManager::~SampleManager() { SCLOG("Destroying Sample Manager"); }
 
+void SampleManager::startPendingLoads()
+{
+    assert(threadingChecker.isSerialThread());
+    std::vector<AsyncSampleLoader::Request> reqs;
+    reqs.reserve(pendingLoads.size());
+    for (const auto &[id, addr] : pendingLoads)
+    {
+        reqs.push_back({id, addr.path});
+    }
+    asyncLoader.start(std::move(reqs), streamingPreloadFrames, decodedCache.get(), md5SumCache,
+                      mapWavInPlace, compressedHeadFrames);
+}
+
+std::vector<std::shared_ptr<Sample>> SampleManager::integrateCompletedLoads()
+{
+    assert(threadingChecker.isSerialThread());
+    std::vector<AsyncSampleLoader::Result> done;
+    asyncLoader.takeCompleted(done);
+
+    std::vector<std::shared_ptr<Sample>> res;
+    for (auto &r : done)
+    {
+        // A reset or reload since the request means nobody wants this any more
+        if (pendingLoads.erase(r.id) == 0)
+            continue;
+
+        if (!r.sample)
+        {
+            missingList.push_back(r.path);
+            continue;
+        }
+
+        if (r.sample->isStreamed())
+            streamer->registerSample(*r.sample);
+        markTriggered(*r.sample);
+        samples[r.id] = r.sample;
+        res.push_back(std::move(r.sample));
+    }
+
+    if (!res.empty())
+        updateSampleMemory();
+    return res;
+}
+
+std::optional<SampleID> SampleManager::findPendingByPath(const fs::path &p) const
+{
+    for (const auto &[id, addr] : pendingLoads)
+    {
+        if (addr.path == p)
+            return id;
+    }
+    return std::nullopt;
+}
+
 std::optional<SampleID> SampleManager::loadSampleByPath(const fs::path &p)
 {
     for (const auto &[alreadyId, sm] : samples)
@@ -79,10 +144,68 @@ std::optional<SampleID> SampleManager::loadSampleByPath(const fs::path &p)
             return alreadyId;
         }
     }
+    if (auto pid = findPendingByPath(p))
+        return pid;
 
     return loadSampleByPathToID(p, SampleID::next());
 }
 
+std::vector<std::optional<SampleID>>
+SampleManager::loadSamplesByPath(const std::vector<fs::path> &paths)
+{
+    assert(threadingChecker.isSerialThread());
+    std::vector<std::optional<SampleID>> res(paths.size());
+
+    std::unordered_map<std::string, SampleID> byPath;
+    for (const auto &[id, sm] : samples)
+        byPath.emplace(sm->getPath().u8string(), id);
+    for (const auto &[id, addr] : pendingLoads)
+        byPath.emplace(addr.path.u8string(), id);
+
+    std::vector<AsyncSampleLoader::Request> reqs;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        auto [it, added] = byPath.emplace(paths[i].u8string(), SampleID());
+        if (added)
+        {
+            it->second = SampleID::next();
+            reqs.push_back({it->second, paths[i]});
+        }
+        res[i] = it->second;
+    }
+    if (reqs.empty())
+        return res;
+
+    AsyncSampleLoader loader;
+    loader.start(std::move(reqs), streamingPreloadFrames, decodedCache.get(), md5SumCache,
+                 mapWavInPlace, compressedHeadFrames);
+    loader.wait();
+
+    std::vector<AsyncSampleLoader::Result> done;
+    loader.takeCompleted(done);
+    std::unordered_set<SampleID> failed;
+    for (auto &r : done)
+    {
+        if (!r.sample)
+        {
+            failed.insert(r.id);
+            continue;
+        }
+        if (r.sample->isStreamed())
+            streamer->registerSample(*r.sample);
+        markTriggered(*r.sample);
+        samples[r.id] = std::move(r.sample);
+    }
+    for (auto &r : res)
+    {
+        if (r.has_value() && failed.count(*r))
+            r = std::nullopt;
+    }
+
+    updateSampleMemory();
+    return res;
+}
+
 std::optional<SampleID> SampleManager::loadSampleByPathToID(const fs::path &p, const SampleID &id)
 {
     assert(threadingChecker.isSerialThread());
@@ -103,12 +226,19 @@ std::optional<SampleID> SampleManager::loadSampleByPathToID(const fs::path &p, c
 
     auto sp = std::make_shared<Sample>(id);
 
-    if (!sp->load(p))
+    if (!sp->load(p, streamingPreloadFrames, decodedCache.get(), md5SumCache, mapWavInPlace))
     {
         SCLOG("Failed to load sample from '" << p.u8string() << "'");
         return std::nullopt;
     }
 
+    if (compressedHeadFrames > 0)
+        sp->compressBeyond(compressedHeadFrames);
+
+    if (sp->isStreamed())
+        streamer->registerSample(*sp);
+
+    markTriggered(*sp);
     samples[sp->id] = sp;
     updateSampleMemory();
     return sp->id;
@@ -134,8 +264,8 @@ std::optional<SampleID> SampleManager::loadSampleFromSF2ToID(const fs::path &p,
 
                 auto riff = std::make_unique<RIFF::File>(p.u8string());
                 auto sf = std::make_unique<sf2::File>(riff.get());
-                sf2FilesByPath[p.u8string()] = {std::move(riff), std::move(sf),
-                                                infrastructure::createMD5SumFromFile(p)};
+                auto md5 = infrastructure::createMD5SumFromFile(p, md5SumCache);
+                sf2FilesByPath[p.u8string()] = {std::move(riff), std::move(sf), md5};
             }
             catch (RIFF::Exception e)
             {
@@ -218,10 +348,13 @@ void SampleManager::purgeUnreferencedSamples()
     while (b != samples.end())
     {
         auto ct = b->second.use_count();
-        if (ct <= 1)
+        // A sample mid eviction looks unreferenced since its zones hold the stand in
+        if (ct <= 1 && !(evicting && evicting->find(b->second.get())))
         {
             SCLOG("Purging sample " << b->first.to_string() << " from "
                                     << b->second->mFileName.u8string())
+            if (b->second->isStreamed())
+                streamer->unregisterSample(b->first);
             b = samples.erase(b);
         }
         else
@@ -237,12 +370,236 @@ void SampleManager::purgeUnreferencedSamples()
     updateSampleMemory();
 }
 
+bool SampleManager::wantsEviction() const
+{
+    // A pass which couldn't get under budget (everything left is playing) retries shortly
+    static constexpr auto retryInterval = std::chrono::milliseconds(100);
+    return memoryBudgetBytes > 0 && sampleMemoryInBytes > memoryBudgetBytes && !evicting &&
+           std::chrono::steady_clock::now() - lastEviction > retryInterval;
+}
+
+SampleManager::Eviction::Candidate *SampleManager::Eviction::find(const Sample *s)
+{
+    auto it = std::lower_bound(candidates.begin(), candidates.end(), s,
+                               [](const auto &c, const Sample *v) { return c.sample.get() < v; });
+    if (it == candidates.end() || it->sample.get() != s)
+        return nullptr;
+    return &*it;
+}
+
+std::shared_ptr<SampleManager::Eviction> SampleManager::beginEviction()
+{
+    assert(threadingChecker.isSerialThread());
+    if (!wantsEviction())
+        return nullptr;
+    lastEviction = std::chrono::steady_clock::now();
+
+    std::vector<std::pair<uint64_t, std::shared_ptr<Sample>>> lru;
+    for (const auto &[id, smp] : samples)
+    {
+        switch (smp->type)
+        {
+        case Sample::WAV_FILE:
+        case Sample::FLAC_FILE:
+        case Sample::MP3_FILE:
+        case Sample::AIFF_FILE:
+            if (!smp->isEvicted() && smp->getDataSize() > 0)
+                lru.emplace_back(smp->lastTriggered.load(std::memory_order_relaxed), smp);
+            break;
+        default:
+            break;
+        }
+    }
+    std::sort(lru.begin(), lru.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    auto ev = std::make_shared<Eviction>();
+    uint64_t remaining = sampleMemoryInBytes;
+    for (auto &[t, smp] : lru)
+    {
+        if (remaining <= memoryBudgetBytes)
+            break;
+        remaining -= std::min(remaining, (uint64_t)smp->getDataSize());
+        auto standIn = smp->createEvictedStandIn();
+        ev->candidates.push_back({std::move(smp), std::move(standIn)});
+    }
+    if (ev->candidates.empty())
+        return nullptr;
+
+    std::sort(ev->candidates.begin(), ev->candidates.end(),
+              [](const auto &a, const auto &b) { return a.sample.get() < b.sample.get(); });
+    evicting = ev;
+    return ev;
+}
+
+void SampleManager::completeEviction(const Eviction &ev)
+{
+    assert(threadingChecker.isSerialThread());
+    size_t count{0};
+    for (const auto &c : ev.candidates)
+    {
+        if (c.playing)
+            continue;
+        // A reset or a reload since the eviction began means this isn't ours to replace
+        auto it = samples.find(c.sample->id);
+        if (it == samples.end() || it->second != c.sample)
+            continue;
+
+        if (c.sample->isStreamed())
+            streamer->unregisterSample(c.sample->id);
+        it->second = c.standIn;
+        count++;
+    }
+    evicting.reset();
+    updateSampleMemory();
+    SCLOG("Evicted " << count << " of " << ev.candidates.size() << " samples; "
+                     << sampleMemoryInBytes << " bytes resident against a budget of "
+                     << memoryBudgetBytes);
+}
+
+void SampleManager::startEvictedReloads()
+{
+    assert(threadingChecker.isSerialThread());
+    // Requests which arrive while a batch runs are picked up when it finishes
+    if (!reloading.empty())
+        return;
+
+    std::vector<AsyncSampleLoader::Request> reqs;
+    for (const auto &[id, smp] : samples)
+    {
+        if (smp->isEvicted() && smp->reloadRequested.exchange(false, std::memory_order_acq_rel))
+        {
+            reqs.push_back({id, smp->getPath()});
+            reloading.insert(id);
+        }
+        else if (smp->isStreamed() &&
+                 smp->fullyResidentRequested.load(std::memory_order_acquire) &&
+                 !isResidentUpgradePending(id))
+        {
+            reqs.push_back({id, smp->getPath(), true});
+            reloading.insert(id);
+        }
+    }
+    if (reqs.empty())
+        return;
+    reloader.start(std::move(reqs), streamingPreloadFrames, decodedCache.get(), md5SumCache,
+                   mapWavInPlace, compressedHeadFrames);
+}
+
+std::vector<std::shared_ptr<Sample>> SampleManager::integrateEvictedReloads()
+{
+    assert(threadingChecker.isSerialThread());
+    std::vector<AsyncSampleLoader::Result> done;
+    reloader.takeCompleted(done);
+
+    std::vector<std::shared_ptr<Sample>> res;
+    for (auto &r : done)
+    {
+        reloading.erase(r.id);
+        auto it = samples.find(r.id);
+        if (it == samples.end())
+            continue;
+        if (!it->second->isEvicted())
+        {
+            if (!it->second->isStreamed() || !it->second->fullyResidentRequested)
+                continue;
+            if (!r.sample)
+            {
+                // Stays streamed, and flagged, so this isn't retried on every trigger
+                SCLOG("Unable to load streamed sample " << r.path.u8string()
+                                                        << " fully resident");
+                continue;
+            }
+            residentUpgrades.push_back({it->second, std::move(r.sample)});
+            continue;
+        }
+        if (!r.sample)
+        {
+            // Left evicted; the next trigger tries again
+            SCLOG("Unable to reload evicted sample " << r.path.u8string());
+            continue;
+        }
+
+        if (r.sample->isStreamed())
+            streamer->registerSample(*r.sample);
+        markTriggered(*r.sample);
+        retiredSamples.push_back(std::move(it->second));
+        it->second = r.sample;
+        res.push_back(std::move(r.sample));
+    }
+
+    if (!res.empty())
+        updateSampleMemory();
+    if (reloading.empty())
+        startEvictedReloads();
+    return res;
+}
+
+bool SampleManager::isResidentUpgradePending(SampleID id) const
+{
+    for (const auto &c : residentUpgrades)
+        if (c.sample->id == id)
+            return true;
+    if (upgrading)
+        for (const auto &c : upgrading->candidates)
+            if (c.sample->id == id)
+                return true;
+    return false;
+}
+
+std::shared_ptr<SampleManager::Eviction> SampleManager::beginResidentUpgrade()
+{
+    assert(threadingChecker.isSerialThread());
+    if (!hasResidentUpgrades())
+        return nullptr;
+
+    auto up = std::make_shared<Eviction>();
+    up->candidates = std::exchange(residentUpgrades, {});
+    for (auto &c : up->candidates)
+        c.playing = false;
+    std::sort(up->candidates.begin(), up->candidates.end(),
+              [](const auto &a, const auto &b) { return a.sample.get() < b.sample.get(); });
+    upgrading = up;
+    return up;
+}
+
+void SampleManager::completeResidentUpgrade(const Eviction &up)
+{
+    assert(threadingChecker.isSerialThread());
+    size_t count{0};
+    for (const auto &c : up.candidates)
+    {
+        // A reset or an eviction since the upgrade began means this isn't ours to replace
+        auto it = samples.find(c.sample->id);
+        if (it == samples.end() || it->second != c.sample)
+            continue;
+        if (c.playing)
+        {
+            residentUpgrades.push_back(c);
+            continue;
+        }
+
+        streamer->unregisterSample(c.sample->id);
+        c.standIn->lastTriggered = c.sample->lastTriggered.load(std::memory_order_relaxed);
+        it->second = c.standIn;
+        count++;
+    }
+    upgrading.reset();
+    if (count > 0)
+    {
+        updateSampleMemory();
+        SCLOG("Made " << count << " streamed samples fully resident for looped or reversed "
+                      << "playback");
+    }
+}
+
 void SampleManager::updateSampleMemory()
 {
     uint64_t res = 0;
     for (const auto &[id, smp] : samples)
     {
-        res += smp->sample_length * smp->channels * (smp->bitDepth == Sample::BD_I16 ? 4 : 8);
+        res += smp->getDataSize();
+        summaryBuilder.queue(smp);
     }
     sampleMemoryInBytes = res;
 }
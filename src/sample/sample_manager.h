@@ -30,11 +30,17 @@
 
 #include "utils.h"
 #include "sample.h"
+#include "sample_streamer.h"
+#include "async_sample_loader.h"
+#include "sample_summary.h"
+#include "decoded_sample_cache.h"
 
 #include "infrastructure/filesystem_import.h"
 
 #include <filesystem>
+#include <chrono>
 #include <unordered_map>
+#include <unordered_set>
 #include <optional>
 #include <vector>
 #include <utility>
@@ -73,7 +79,10 @@ struct ZipArchiveHolder : scxt::MoveableOnly<ZipArchiveHolder>
 struct SampleManager : MoveableOnly<SampleManager>
 {
     const ThreadingChecker &threadingChecker;
-    SampleManager(const ThreadingChecker &t) : threadingChecker(t) {}
+    SampleManager(const ThreadingChecker &t)
+        : threadingChecker(t), streamer(std::make_unique<SampleStreamer>())
+    {
+    }
     ~SampleManager();
 
     std::optional<SampleID> loadSampleByFileAddress(const Sample::SampleFileAddress &);
@@ -82,6 +91,12 @@ struct SampleManager : MoveableOnly<SampleManager>
 
     std::optional<SampleID> loadSampleByPath(const fs::path &);
     std::optional<SampleID> loadSampleByPathToID(const fs::path &, const SampleID &id);
+    /*
+     * loadSampleByPath for many files at once. Files not already loaded get their ids in
+     * order, exactly as calling loadSampleByPath on each in turn would, and are then decoded
+     * together on an AsyncSampleLoader; this returns once they are all installed.
+     */
+    std::vector<std::optional<SampleID>> loadSamplesByPath(const std::vector<fs::path> &);
 
     std::optional<SampleID> loadSampleFromSF2(const fs::path &,
                                               sf2::File *f, // if this is null I will re-open it
@@ -112,6 +127,11 @@ struct SampleManager : MoveableOnly<SampleManager>
         {
             res.emplace_back(k, v->getSampleFileAddress());
         }
+        // Samples still decoding are part of the patch too
+        for (const auto &[k, a] : pendingLoads)
+        {
+            res.emplace_back(k, a);
+        }
         return res;
     }
     void restoreFromSampleAddressesAndIDs(const sampleAddressesAndIds_t &);
@@ -120,6 +140,14 @@ struct SampleManager : MoveableOnly<SampleManager>
 
     void reset()
     {
+        asyncLoader.cancel();
+        pendingLoads.clear();
+        reloader.cancel();
+        reloading.clear();
+        retiredSamples.clear();
+        residentUpgrades.clear();
+        upgrading.reset();
+        streamer->unregisterAll();
         samples.clear();
         sf2FilesByPath.clear();
         streamingVersion = 0x2112'01'01;
@@ -133,7 +161,162 @@ struct SampleManager : MoveableOnly<SampleManager>
 
     std::atomic<uint64_t> sampleMemoryInBytes{0};
 
+    /*
+     * Disk streaming. With a non-zero preload, files which support it keep only this
+     * many frames resident and stream the rest through the streamer. Changing the
+     * preload only affects samples loaded afterwards.
+     */
+    uint32_t streamingPreloadFrames{0};
+    void setStreamingPreloadFrames(uint32_t f) { streamingPreloadFrames = f; }
+    std::unique_ptr<SampleStreamer> streamer;
+
+    /*
+     * Mapped wav playback. When set, mono and stereo PCM16, PCM24 and float32 wavs which aren't
+     * streamed are played straight from the mapped file rather than copied into memory,
+     * leaving the OS to page them. Like the preload, only affects later loads.
+     */
+    bool mapWavInPlace{false};
+    void setMapWavInPlace(bool m) { mapWavInPlace = m; }
+
+    /*
+     * Compressed sample memory. With a non-zero head, integer samples loaded from files which
+     * aren't streamed or mapped keep only this many frames as PCM and hold the rest losslessly
+     * compressed, decoded into voice windows by the streamer (see Sample::compressBeyond).
+     * Like the preload, only affects later loads.
+     */
+    uint32_t compressedHeadFrames{0};
+    void setCompressedHeadFrames(uint32_t f) { compressedHeadFrames = f; }
+
+    /*
+     * Decoded sample cache for formats which need decoding; see DecodedSampleCache.
+     * Without one every load decodes from scratch, and a zero budget means without one.
+     */
+    void setupDecodedSampleCache(const fs::path &directory, uint64_t budgetBytes)
+    {
+        if (budgetBytes == 0)
+            decodedCache.reset();
+        else
+            decodedCache = std::make_unique<DecodedSampleCache>(directory, budgetBytes);
+    }
+    std::unique_ptr<DecodedSampleCache> decodedCache;
+
+    /*
+     * File MD5s are looked up here before hashing, when set (the engine hands in its
+     * BrowserDB). Background loads use it too, so clearing it cancels them.
+     */
+    void setMD5SumCache(infrastructure::MD5SumCache *c)
+    {
+        if (!c)
+            asyncLoader.cancel();
+        md5SumCache = c;
+    }
+    infrastructure::MD5SumCache *md5SumCache{nullptr};
+
+    /*
+     * Deferred decodes. While deferFileDecodes is set, restoring a file based sample
+     * (wav, flac, mp3, aiff) just records it as pending under its id. startPendingLoads()
+     * then decodes the pending set on the AsyncSampleLoader and integrateCompletedLoads()
+     * installs whatever has finished, returning the new samples so the engine can attach
+     * them to their zones. SF2 and multisample entries share open archives and still load
+     * inline. All of these are serialization thread only.
+     */
+    bool deferFileDecodes{false};
+    void startPendingLoads();
+    std::vector<std::shared_ptr<Sample>> integrateCompletedLoads();
+    bool hasPendingLoads() const { return !pendingLoads.empty(); }
+    size_t pendingLoadTotal() const { return asyncLoader.totalCount(); }
+    size_t pendingLoadCompleted() const { return asyncLoader.completedCount(); }
+
+    /*
+     * Sample memory budget. With a non-zero budget, sampleMemoryInBytes is held under it by
+     * evicting the least recently triggered file samples which no voice is playing. An
+     * evicted sample is replaced by its stand in (Sample::createEvictedStandIn) so zones,
+     * the UI and saving see the same sample; triggering it plays nothing for that zone,
+     * counts a miss and asks for a background reload which swaps the data back in. SF2 and
+     * multisample samples are never evicted.
+     *
+     * Eviction has to swap zone pointers on the audio thread, so the engine drives it:
+     * beginEviction picks the samples, the engine swaps every zone not playing them to
+     * their stand ins, and completeEviction installs the stand ins here. Reloads run the
+     * same way round through integrateEvictedReloads. Both are serialization thread only.
+     */
+    uint64_t memoryBudgetBytes{0};
+    void setMemoryBudgetBytes(uint64_t b) { memoryBudgetBytes = b; }
+    bool wantsEviction() const;
+
+    struct Eviction
+    {
+        struct Candidate
+        {
+            std::shared_ptr<Sample> sample, standIn;
+            bool playing{false}; // set on the audio thread; a playing sample isn't swapped
+        };
+        // Sorted by sample address, for find()
+        std::vector<Candidate> candidates;
+        Candidate *find(const Sample *s);
+    };
+    std::shared_ptr<Eviction> beginEviction();
+    void completeEviction(const Eviction &);
+
+    // Audio thread, as a voice starts on s or would have were s resident
+    void noteSampleTriggered(Sample &s)
+    {
+        markTriggered(s);
+        if (!s.isEvicted())
+        {
+            residentHits.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        evictedMisses.fetch_add(1, std::memory_order_relaxed);
+        if (!s.reloadRequested.exchange(true, std::memory_order_acq_rel))
+            reloadRequestedFlag.store(true, std::memory_order_release);
+    }
+    std::atomic<uint64_t> residentHits{0}, evictedMisses{0};
+    // The audio thread forwards this to the serialization thread, which calls startEvictedReloads
+    bool takeReloadRequest()
+    {
+        return reloadRequestedFlag.exchange(false, std::memory_order_acq_rel);
+    }
+
+    void startEvictedReloads();
+    // The reloaded samples, for the engine to attach to their zones
+    std::vector<std::shared_ptr<Sample>> integrateEvictedReloads();
+    bool hasEvictedReloads() const { return !reloading.empty(); }
+    // Stand ins the reloads replaced. Zones still point at them until the engine reattaches
+    std::vector<std::shared_ptr<Sample>> takeRetiredSamples()
+    {
+        return std::exchange(retiredSamples, {});
+    }
+
+    /*
+     * A streamed sample only plays forward through a window, so a voice which loops or plays
+     * backwards beyond its resident head is held inside the head. The voice asks here (audio
+     * thread) for the whole sample to be made resident instead. The reload request carries
+     * it to startEvictedReloads, which loads the sample again without the preload, and
+     * integrateEvictedReloads queues the result as a resident upgrade. The engine swaps those
+     * in like an eviction: beginResidentUpgrade picks them up, zones not playing the streamed
+     * sample move to the resident one and completeResidentUpgrade installs it, keeping any
+     * still playing for the next try. Compressed samples are loaded again as plain PCM.
+     */
+    void requestFullyResident(Sample &s)
+    {
+        if (!s.isStreamed())
+            return;
+        if (!s.fullyResidentRequested.exchange(true, std::memory_order_acq_rel))
+            reloadRequestedFlag.store(true, std::memory_order_release);
+    }
+    bool hasResidentUpgrades() const { return !residentUpgrades.empty() && !upgrading; }
+    std::shared_ptr<Eviction> beginResidentUpgrade();
+    void completeResidentUpgrade(const Eviction &);
+
+    /*
+     * Every sample installed here is queued for its SampleSummary on a background thread,
+     * so waveform drawing and analytics rarely have to build one themselves.
+     */
+    void waitForSampleSummaries() { summaryBuilder.wait(); }
+
   private:
+    // Also queues any new samples with the summaryBuilder
     void updateSampleMemory();
 
     std::unordered_map<SampleID, std::shared_ptr<Sample>> samples;
@@ -142,6 +325,30 @@ struct SampleManager : MoveableOnly<SampleManager>
         sf2FilesByPath; // last is the md5sum
 
     std::unordered_map<std::string, std::unique_ptr<ZipArchiveHolder>> zipArchives;
+
+    std::optional<SampleID> findPendingByPath(const fs::path &p) const;
+    std::unordered_map<SampleID, Sample::SampleFileAddress> pendingLoads;
+    AsyncSampleLoader asyncLoader;
+
+    void markTriggered(Sample &s)
+    {
+        s.lastTriggered.store(triggerClock.fetch_add(1, std::memory_order_relaxed) + 1,
+                              std::memory_order_relaxed);
+    }
+    std::atomic<uint64_t> triggerClock{0};
+    std::atomic<bool> reloadRequestedFlag{false};
+    std::shared_ptr<Eviction> evicting;
+    std::chrono::steady_clock::time_point lastEviction{};
+    std::unordered_set<SampleID> reloading;
+    AsyncSampleLoader reloader;
+    std::vector<std::shared_ptr<Sample>> retiredSamples;
+    // sample is the streamed one, standIn its fully resident replacement
+    std::vector<Eviction::Candidate> residentUpgrades;
+    std::shared_ptr<Eviction> upgrading;
+    bool isResidentUpgradePending(SampleID id) const;
+
+    // Last, so it stops before anything it might be reading goes
+    SampleSummaryBuilder summaryBuilder;
 };
 } // namespace scxt::sample
 #endif // SHORTCIRCUIT_SAMPLE_MANAGER_H
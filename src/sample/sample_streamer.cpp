@@ -0,0 +1,378 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "sample_streamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "sst/basic-blocks/mechanics/endian-ops.h"
+#include "loaders/riff_wave.h"
+#include "compressed_sample_store.h"
+
+namespace scxt::sample
+{
+// Fine in a cpp
+using namespace sst::basic_blocks::mechanics;
+
+SampleStreamer::~SampleStreamer() { stop(); }
+
+void SampleStreamer::start()
+{
+    if (readerThread)
+        return;
+
+    for (auto &b : buffers)
+    {
+        for (auto &d : b.data)
+        {
+            d = std::make_unique<float[]>(StreamingVoiceBuffer::bufferFrames);
+            memset(d.get(), 0, StreamingVoiceBuffer::bufferFrames * sizeof(float));
+        }
+    }
+    buffersReady.store(true, std::memory_order_release);
+
+    keepRunning = true;
+    readerThread = std::make_unique<std::thread>([this]() { runReader(); });
+}
+
+void SampleStreamer::stop()
+{
+    if (!readerThread)
+        return;
+    {
+        std::lock_guard<std::mutex> g(wakeMutex);
+        keepRunning = false;
+    }
+    wakeCV.notify_all();
+    readerThread->join();
+    readerThread.reset();
+}
+
+void SampleStreamer::registerSample(const Sample &s)
+{
+    if (!s.isStreamed())
+        return;
+
+    // Compressed samples decode from their store, which the source shares, so need no file
+    std::unique_ptr<infrastructure::FileMapView> map;
+    if (!s.isCompressed())
+    {
+        map = std::make_unique<infrastructure::FileMapView>(s.getPath());
+        if (!map->isMapped())
+        {
+            SCLOG("Unable to map '" << s.getPath().u8string() << "' for streaming");
+            return;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> g(sourcesMutex);
+        auto &src = sources[s.id];
+        src.format = s.streaming;
+        src.bitDepth = s.bitDepth;
+        src.channels = s.channels;
+        src.sampleLength = s.sample_length;
+        src.map = std::move(map);
+    }
+    start();
+}
+
+void SampleStreamer::unregisterSample(const SampleID &id)
+{
+    std::lock_guard<std::mutex> g(sourcesMutex);
+    sources.erase(id);
+}
+
+void SampleStreamer::unregisterAll()
+{
+    std::lock_guard<std::mutex> g(sourcesMutex);
+    sources.clear();
+}
+
+StreamingVoiceBuffer *SampleStreamer::acquire(const Sample &s, int64_t startFrame)
+{
+    if (!buffersReady.load(std::memory_order_acquire))
+        return nullptr;
+
+    for (auto &b : buffers)
+    {
+        // A released window may still have a fill in flight; leave it be until that lands
+        if (b.inUse || b.fillPending.load(std::memory_order_acquire))
+            continue;
+
+        b.inUse = true;
+        b.sampleID = s.id;
+        b.bitDepth = s.bitDepth;
+        b.channels = s.channels;
+        b.windowStart = std::max((int64_t)0, startFrame);
+
+        auto start = b.windowStart - StreamingVoiceBuffer::padFrames;
+        b.validFrom.store(start, std::memory_order_release);
+        b.validTo.store(start, std::memory_order_release);
+        service(&b, b.windowStart);
+        return &b;
+    }
+
+    windowsExhausted.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+void SampleStreamer::release(StreamingVoiceBuffer *b)
+{
+    if (b)
+        b->inUse = false;
+}
+
+void SampleStreamer::service(StreamingVoiceBuffer *b, int64_t readPosition)
+{
+    static constexpr int64_t half{StreamingVoiceBuffer::windowFrames / 2};
+    static constexpr int64_t pad{StreamingVoiceBuffer::padFrames};
+
+    if (b->fillPending.load(std::memory_order_acquire))
+        return;
+
+    // Once the read point is past the middle of the window slide it along by whole
+    // half windows, keeping whatever data we already have which still lands inside
+    auto into = readPosition - pad - b->windowStart;
+    if (into >= half)
+    {
+        auto shift = (into / half) * half;
+        auto newStart = b->windowStart + shift;
+        auto validFrom = std::max(b->validFrom.load(std::memory_order_relaxed), newStart - pad);
+        auto validTo = b->validTo.load(std::memory_order_relaxed);
+
+        if (validTo > validFrom)
+        {
+            auto bpf = b->bytesPerFrame();
+            auto srcIdx = validFrom - b->windowStart + pad;
+            auto dstIdx = validFrom - newStart + pad;
+            auto count = validTo - validFrom;
+            for (int c = 0; c < b->channels; ++c)
+            {
+                auto *d = reinterpret_cast<uint8_t *>(b->data[c].get());
+                memmove(d + dstIdx * bpf, d + srcIdx * bpf, count * bpf);
+            }
+        }
+        else
+        {
+            validFrom = newStart - pad;
+            validTo = validFrom;
+        }
+        b->windowStart = newStart;
+        b->validFrom.store(validFrom, std::memory_order_release);
+        b->validTo.store(validTo, std::memory_order_release);
+    }
+
+    auto windowEnd = b->windowStart + StreamingVoiceBuffer::windowFrames + pad;
+    if (b->validTo.load(std::memory_order_relaxed) < windowEnd)
+    {
+        b->fillTo = windowEnd;
+        b->fillPending.store(true, std::memory_order_release);
+        wakeReader();
+    }
+}
+
+void SampleStreamer::wakeReader()
+{
+    // Pairs with the fence in runReader: either the reader sees our fillPending on its
+    // rescan or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (readerSleeping.load(std::memory_order_relaxed))
+    {
+        wakeRequested.store(true, std::memory_order_release);
+        wakeCV.notify_one();
+    }
+}
+
+void SampleStreamer::runReader()
+{
+    uint64_t lastUnderruns{0}, lastFallbacks{0}, lastExhausted{0};
+    while (keepRunning)
+    {
+        bool filled{false};
+        for (auto &b : buffers)
+        {
+            if (b.fillPending.load(std::memory_order_acquire))
+            {
+                fill(b);
+                filled = true;
+            }
+        }
+        if (filled)
+            continue;
+
+        auto u = underruns.load(std::memory_order_relaxed);
+        auto f = fallbacks.load(std::memory_order_relaxed);
+        auto e = windowsExhausted.load(std::memory_order_relaxed);
+        if (u != lastUnderruns)
+            SCLOG("Sample streaming: " << u - lastUnderruns << " blocks underran");
+        if (e != lastExhausted)
+            SCLOG("Sample streaming: " << e - lastExhausted << " voices found all "
+                                       << maxVoices
+                                       << " streaming windows in use and played only the head");
+        if (f != lastFallbacks)
+            SCLOG("Sample streaming: " << f - lastFallbacks
+                                       << " voices held inside the resident head");
+        lastUnderruns = u;
+        lastFallbacks = f;
+        lastExhausted = e;
+
+        readerSleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool pending{false};
+        for (auto &b : buffers)
+            pending = pending || b.fillPending.load(std::memory_order_relaxed);
+        if (!pending)
+        {
+            // The audio thread can't take wakeMutex, so a notify can land between the
+            // predicate and the wait. The timeout bounds how long such a request sits.
+            using namespace std::chrono_literals;
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCV.wait_for(lock, 5ms, [this]() {
+                return wakeRequested.load(std::memory_order_acquire) || !keepRunning;
+            });
+        }
+        readerSleeping.store(false, std::memory_order_relaxed);
+        wakeRequested.store(false, std::memory_order_relaxed);
+    }
+}
+
+void SampleStreamer::fill(StreamingVoiceBuffer &b)
+{
+    static constexpr int64_t pad{StreamingVoiceBuffer::padFrames};
+
+    auto from = b.validTo.load(std::memory_order_acquire);
+    auto to = b.fillTo;
+    auto bpf = b.bytesPerFrame();
+
+    {
+        std::lock_guard<std::mutex> g(sourcesMutex);
+        auto sit = sources.find(b.sampleID);
+        const Source *src = (sit == sources.end()) ? nullptr : &(sit->second);
+
+        for (int c = 0; c < b.channels; ++c)
+        {
+            auto *dest = reinterpret_cast<uint8_t *>(b.data[c].get()) +
+                         (from - b.windowStart + pad) * (int64_t)bpf;
+
+            // Frames before the top or after the end of the sample are the zero pad
+            // the generator expects, as are frames of a sample which has gone away
+            auto lo = std::clamp(from, (int64_t)0, to);
+            auto hi = src ? std::clamp(to, lo, (int64_t)src->sampleLength) : lo;
+            if (lo > from)
+                memset(dest, 0, (lo - from) * bpf);
+            if (hi < to)
+                memset(dest + (hi - from) * bpf, 0, (to - hi) * bpf);
+            if (hi <= lo)
+                continue;
+
+            readFrames(src->format, b.bitDepth, src->map.get(), c, lo, hi,
+                       dest + (lo - from) * bpf);
+        }
+    }
+
+    b.validTo.store(to, std::memory_order_release);
+    b.fillPending.store(false, std::memory_order_release);
+}
+
+void SampleStreamer::readFrames(const Sample::StreamingSource &fmt, Sample::BitDepth bitDepth,
+                                infrastructure::FileMapView *fileMap, int c, int64_t lo,
+                                int64_t hi, uint8_t *dest)
+{
+    if (hi <= lo)
+        return;
+
+    if (fmt.compressed)
+    {
+        fmt.compressed->decode(c, lo, hi, dest);
+        return;
+    }
+
+    auto *fileData = reinterpret_cast<const uint8_t *>(fileMap->data()) + fmt.dataOffset;
+    auto bytesPerChannel = fmt.bitsPerSample / 8;
+    auto *in = fileData + lo * fmt.blockAlign + c * bytesPerChannel;
+    auto n = hi - lo;
+    auto stride = fmt.blockAlign;
+
+    // These conversions match the Sample::load_data_* family exactly so streamed
+    // frames are identical to the resident head they continue
+    if (bitDepth == Sample::BD_I16)
+    {
+        auto *out = reinterpret_cast<int16_t *>(dest);
+        if (fmt.bitsPerSample == 8)
+        {
+            for (int64_t i = 0; i < n; ++i)
+                out[i] = (((short)*(in + i * stride)) - 128) << 8;
+        }
+        else
+        {
+            for (int64_t i = 0; i < n; ++i)
+                out[i] = endian_read_int16LE(*(short *)(in + i * stride));
+        }
+    }
+    else if (bitDepth == Sample::BD_I24)
+    {
+        // Only 24 bit PCM loads as I24, and it stays packed
+        for (int64_t i = 0; i < n; ++i)
+            memcpy(dest + i * 3, in + i * stride, 3);
+    }
+    else
+    {
+        auto *out = reinterpret_cast<float *>(dest);
+        if (fmt.formatTag == WAVE_FORMAT_IEEE_FLOAT && fmt.bitsPerSample == 64)
+        {
+            for (int64_t i = 0; i < n; ++i)
+                out[i] = (float)(*(double *)(in + i * stride));
+        }
+        else if (fmt.formatTag == WAVE_FORMAT_IEEE_FLOAT)
+        {
+            for (int64_t i = 0; i < n; ++i)
+                out[i] = *(float *)(in + i * stride);
+        }
+        else if (fmt.bitsPerSample == 24)
+        {
+            for (int64_t i = 0; i < n; ++i)
+            {
+                auto *cval = in + i * stride;
+                int value = (cval[2] << 16) | (cval[1] << 8) | cval[0];
+                value -= (value & 0x800000) << 1;
+                out[i] = 0.00000011920928955078f * float(value);
+            }
+        }
+        else
+        {
+            for (int64_t i = 0; i < n; ++i)
+            {
+                int x = endian_read_int32LE(*(int *)(in + i * stride));
+                out[i] = (4.6566128730772E-10f) * (float)x;
+            }
+        }
+    }
+}
+} // namespace scxt::sample
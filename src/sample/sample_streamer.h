@@ -0,0 +1,173 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_SAMPLE_SAMPLE_STREAMER_H
+#define SCXT_SRC_SAMPLE_SAMPLE_STREAMER_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "utils.h"
+#include "configuration.h"
+#include "dsp/resampling.h"
+#include "infrastructure/file_map_view.h"
+#include "sample.h"
+
+namespace scxt::sample
+{
+/**
+ * A StreamingVoiceBuffer is the window onto a streamed sample which a single voice reads
+ * through once it plays past the resident head of the sample. It holds windowFrames frames
+ * starting at windowStart with FIRoffset frames of context on either side, laid out just
+ * like Sample::sampleData, so the generator can read it with its usual absolute indexing
+ * through dataPointerFor().
+ *
+ * The audio thread owns the window position. The reader thread only ever writes the frames
+ * [validTo, fillTo) and only while fillPending is set; the audio thread never slides the
+ * window while a fill is pending.
+ */
+struct StreamingVoiceBuffer
+{
+    static constexpr int32_t windowFrames{8192};
+    static constexpr int32_t padFrames{(int32_t)dsp::FIRoffset};
+    static constexpr int32_t bufferFrames{windowFrames + 2 * padFrames};
+
+    SampleID sampleID;
+    Sample::BitDepth bitDepth{Sample::BD_F32};
+    uint8_t channels{1};
+
+    int64_t windowStart{0};
+    int64_t fillTo{0};
+    std::atomic<int64_t> validFrom{0}, validTo{0};
+    std::atomic<bool> fillPending{false};
+    bool inUse{false}; // audio thread only
+
+    // Storage is float sized; I16 data just uses the front half
+    std::array<std::unique_ptr<float[]>, 2> data;
+
+    size_t bytesPerFrame() const { return Sample::bitDepthByteSize(bitDepth); }
+    void *dataPointerFor(int channel) const
+    {
+        if (channel >= channels)
+            return nullptr;
+        // The generator indexes by absolute sample position, so hand it a pointer
+        // such that [windowStart] lands on the first frame after the pre-pad
+        auto base = reinterpret_cast<intptr_t>(data[channel].get());
+        return reinterpret_cast<void *>(base +
+                                        (padFrames - windowStart) * (intptr_t)bytesPerFrame());
+    }
+};
+
+/**
+ * The SampleStreamer owns the per-voice streaming windows and the reader thread which
+ * fills them from disk, or for compressed samples from their CompressedSampleStore.
+ * Streamed samples (see Sample::StreamingSource) are registered with it on the
+ * serialization thread at load; voices acquire a window on the audio thread when they
+ * need to play past a sample's resident head, and ask for it to be kept topped up with
+ * service() each block. A request is just the window's fillPending flag, which the reader
+ * thread scans for, so voices rendering on different threads can each service their own
+ * window without sharing a queue. An idle reader sleeps until a request wakes it.
+ *
+ * If a voice needs frames the reader hasn't delivered yet that is an underrun, which the
+ * voice reports with reportUnderrun(). A voice which can't stream at all (reportFallback)
+ * plays only the resident head, and windowsExhausted counts those which found every window
+ * taken. All three are counted, logged from the reader thread and shown to the UI through
+ * the engine's sharedUIMemoryState.
+ */
+struct SampleStreamer : MoveableOnly<SampleStreamer>
+{
+    SampleStreamer() = default;
+    ~SampleStreamer();
+
+    // Serialization thread
+    void registerSample(const Sample &s);
+    void unregisterSample(const SampleID &id);
+    void unregisterAll();
+
+    // Audio thread
+    StreamingVoiceBuffer *acquire(const Sample &s, int64_t startFrame);
+    void release(StreamingVoiceBuffer *b);
+    void service(StreamingVoiceBuffer *b, int64_t readPosition);
+    bool covers(const StreamingVoiceBuffer *b, int64_t fromFrame, int64_t toFrame) const
+    {
+        return fromFrame >= b->validFrom.load(std::memory_order_acquire) &&
+               toFrame < b->validTo.load(std::memory_order_acquire);
+    }
+    void reportUnderrun() { underruns.fetch_add(1, std::memory_order_relaxed); }
+    void reportFallback() { fallbacks.fetch_add(1, std::memory_order_relaxed); }
+
+    std::atomic<uint64_t> underruns{0};
+    std::atomic<uint64_t> fallbacks{0};
+    std::atomic<uint64_t> windowsExhausted{0};
+
+    /*
+     * The frames [lo, hi) of channel c of a streamed sample, from its compressed store or
+     * else its file mapped in fileMap, converted to bitDepth at dest. The reader fills
+     * windows with this and SampleSummary reads past the resident head with it.
+     */
+    static void readFrames(const Sample::StreamingSource &format, Sample::BitDepth bitDepth,
+                           infrastructure::FileMapView *fileMap, int c, int64_t lo,
+                           int64_t hi, uint8_t *dest);
+
+  private:
+    void start();
+    void stop();
+    void runReader();
+    void fill(StreamingVoiceBuffer &b);
+    // Audio thread, after setting a fillPending. Only touches the CV if the reader sleeps
+    void wakeReader();
+
+    struct Source
+    {
+        Sample::StreamingSource format;
+        Sample::BitDepth bitDepth{Sample::BD_F32};
+        uint8_t channels{1};
+        uint32_t sampleLength{0};
+        std::unique_ptr<infrastructure::FileMapView> map;
+    };
+
+    std::mutex sourcesMutex;
+    std::unordered_map<SampleID, Source> sources;
+
+    std::array<StreamingVoiceBuffer, maxVoices> buffers;
+    std::atomic<bool> buffersReady{false};
+
+    std::unique_ptr<std::thread> readerThread;
+    std::atomic<bool> keepRunning{false};
+    std::mutex wakeMutex;
+    std::condition_variable wakeCV;
+    std::atomic<bool> readerSleeping{false}, wakeRequested{false};
+};
+} // namespace scxt::sample
+
+#endif // SCXT_SRC_SAMPLE_SAMPLE_STREAMER_H
@@ -0,0 +1,344 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "sample_summary.h"
+#include "sample.h"
+#include "sample_streamer.h"
+
+#include <limits>
+
+namespace scxt::sample
+{
+namespace
+{
+// count values of bit depth bd at d, stride values apart, into res
+void scanData(Sample::BitDepth bd, const uint8_t *d, size_t stride, size_t count,
+              SampleSummary::Range &res)
+{
+    if (!d || count == 0)
+        return;
+
+    auto scan = [&](auto valueAt) {
+        auto first = valueAt(0);
+        float mn = first, mx = first;
+        double sq = 0.0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto v = valueAt(i);
+            mn = std::min(mn, v);
+            mx = std::max(mx, v);
+            sq += (double)v * v;
+        }
+        res.add(SampleSummary::Bucket{mn, mx, sq}, count);
+    };
+
+    switch (bd)
+    {
+    case Sample::BD_I16:
+    {
+        auto v = reinterpret_cast<const int16_t *>(d);
+        scan([v, stride](size_t i) {
+            return static_cast<float>(v[i * stride]) / std::numeric_limits<int16_t>::max();
+        });
+    }
+    break;
+    case Sample::BD_F32:
+    {
+        auto v = reinterpret_cast<const float *>(d);
+        scan([v, stride](size_t i) { return v[i * stride]; });
+    }
+    break;
+    case Sample::BD_I24:
+        scan([d, stride](size_t i) { return Sample::unpackI24(d + i * stride * 3); });
+        break;
+    }
+}
+
+/*
+ * The frames of a streamed sample past its resident head, read a chunk at a time from its
+ * compressed store or its file just as the SampleStreamer reads them for voices
+ */
+struct StreamedFrames
+{
+    static constexpr size_t chunkFrames{SampleSummary::baseBucketFrames * 64};
+
+    explicit StreamedFrames(Sample &s) : s(s)
+    {
+        if (!s.isCompressed())
+        {
+            map = std::make_unique<infrastructure::FileMapView>(s.getPath());
+            if (!map->isMapped())
+                SCLOG("Unable to map '" << s.getPath().u8string() << "' to summarize it");
+        }
+        buffer.resize(chunkFrames * Sample::bitDepthByteSize(s.bitDepth));
+    }
+
+    // [start, end) of channel c, which mustn't cross a chunk; null if the file is gone
+    const uint8_t *read(int c, size_t start, size_t end)
+    {
+        if (map && !map->isMapped())
+            return nullptr;
+        if (c != chunkChannel || start < chunkStart || end > chunkEnd)
+        {
+            chunkChannel = c;
+            chunkStart = start - start % chunkFrames;
+            chunkEnd = std::min(chunkStart + chunkFrames, s.getSampleLength());
+            SampleStreamer::readFrames(s.streaming, s.bitDepth, map.get(), c,
+                                       (int64_t)chunkStart, (int64_t)chunkEnd, buffer.data());
+        }
+        return buffer.data() + (start - chunkStart) * Sample::bitDepthByteSize(s.bitDepth);
+    }
+
+  private:
+    Sample &s;
+    std::unique_ptr<infrastructure::FileMapView> map;
+    std::vector<uint8_t> buffer;
+    int chunkChannel{-1};
+    size_t chunkStart{0}, chunkEnd{0};
+};
+
+/*
+ * The frames [start, end) of channel c as one bucket; the caller keeps end in range. The
+ * resident frames come from sampleData and any past them through streamed, or a reader
+ * made for the call if that is null.
+ */
+SampleSummary::Bucket scanFrames(Sample &s, int c, size_t start, size_t end,
+                                 StreamedFrames *streamed = nullptr)
+{
+    SampleSummary::Range res;
+    auto resident = std::min(end, s.getResidentSampleLength());
+    if (start < resident)
+    {
+        const uint8_t *d{nullptr};
+        switch (s.bitDepth)
+        {
+        case Sample::BD_I16:
+            d = reinterpret_cast<const uint8_t *>(s.GetSamplePtrI16(c));
+            break;
+        case Sample::BD_F32:
+            d = reinterpret_cast<const uint8_t *>(s.GetSamplePtrF32(c));
+            break;
+        case Sample::BD_I24:
+            d = s.GetSamplePtrI24(c);
+            break;
+        }
+        auto stride = s.getFrameStride();
+        if (d)
+            d += start * stride * Sample::bitDepthByteSize(s.bitDepth);
+        scanData(s.bitDepth, d, stride, resident - start, res);
+    }
+
+    start = std::max(start, resident);
+    if (start < end)
+    {
+        std::unique_ptr<StreamedFrames> own;
+        if (!streamed)
+        {
+            own = std::make_unique<StreamedFrames>(s);
+            streamed = own.get();
+        }
+        while (start < end)
+        {
+            auto chunkEnd = std::min(end, (start / StreamedFrames::chunkFrames + 1) *
+                                              StreamedFrames::chunkFrames);
+            scanData(s.bitDepth, streamed->read(c, start, chunkEnd), 1, chunkEnd - start, res);
+            start = chunkEnd;
+        }
+    }
+    return {res.min, res.max, res.sumSquares};
+}
+} // namespace
+
+std::shared_ptr<const SampleSummary> SampleSummary::build(Sample &s)
+{
+    auto res = std::make_shared<SampleSummary>();
+    // A streamed sample is summarized in full, reading past its head from disk
+    res->frames = s.isStreamed() && !s.isEvicted() ? s.getSampleLength()
+                                                   : s.getResidentSampleLength();
+    res->channels = std::clamp((int)s.channels, 0, 2);
+    if (res->frames == 0 || res->channels == 0)
+        return res;
+
+    std::unique_ptr<StreamedFrames> streamed;
+    if (res->frames > s.getResidentSampleLength())
+        streamed = std::make_unique<StreamedFrames>(s);
+
+    auto nBuckets = (res->frames + baseBucketFrames - 1) / baseBucketFrames;
+    auto &base = res->levels.emplace_back();
+    for (int c = 0; c < res->channels; ++c)
+    {
+        base[c].resize(nBuckets);
+        for (size_t b = 0; b < nBuckets; ++b)
+        {
+            auto start = b * baseBucketFrames;
+            base[c][b] = scanFrames(s, c, start, std::min(start + baseBucketFrames, res->frames),
+                                    streamed.get());
+        }
+    }
+
+    while (nBuckets > 1)
+    {
+        auto below = res->levels.size() - 1;
+        nBuckets = (nBuckets + levelFactor - 1) / levelFactor;
+        res->levels.emplace_back();
+        for (int c = 0; c < res->channels; ++c)
+        {
+            const auto &from = res->levels[below][c];
+            auto &to = res->levels.back()[c];
+            to.resize(nBuckets);
+            for (size_t b = 0; b < nBuckets; ++b)
+            {
+                auto start = b * levelFactor;
+                auto end = std::min(start + levelFactor, from.size());
+                auto &t = to[b];
+                t = from[start];
+                for (auto i = start + 1; i < end; ++i)
+                {
+                    t.min = std::min(t.min, from[i].min);
+                    t.max = std::max(t.max, from[i].max);
+                    t.sumSquares += from[i].sumSquares;
+                }
+            }
+        }
+    }
+    return res;
+}
+
+size_t SampleSummary::bucketFrames(size_t level) const
+{
+    auto res = baseBucketFrames;
+    for (size_t i = 0; i < level; ++i)
+        res *= levelFactor;
+    return res;
+}
+
+SampleSummary::Range SampleSummary::whole(int channel) const
+{
+    Range res;
+    if (levels.empty() || channel < 0 || channel >= channels)
+        return res;
+    res.add(levels.back()[channel][0], frames);
+    return res;
+}
+
+SampleSummary::Range SampleSummary::range(Sample &s, int channel, size_t start,
+                                          size_t end) const
+{
+    Range res;
+    end = std::min(end, frames);
+    if (levels.empty() || channel < 0 || channel >= channels || start >= end)
+        return res;
+    accumulate(s, channel, (int)levels.size() - 1, start, end, res);
+    return res;
+}
+
+void SampleSummary::accumulate(Sample &s, int channel, int level, size_t start, size_t end,
+                               Range &into) const
+{
+    if (start >= end)
+        return;
+    if (level < 0)
+    {
+        into.add(scanFrames(s, channel, start, end), end - start);
+        return;
+    }
+
+    // The whole buckets of this level inside [start, end). The short last bucket of a level
+    // ends at frames so counts as whole when end does too.
+    auto bf = bucketFrames(level);
+    const auto &buckets = levels[level][channel];
+    auto first = (start + bf - 1) / bf;
+    auto last = end >= frames ? buckets.size() : end / bf;
+    if (first >= last)
+    {
+        accumulate(s, channel, level - 1, start, end, into);
+        return;
+    }
+
+    auto wholeStart = first * bf;
+    auto wholeEnd = std::min(last * bf, frames);
+    accumulate(s, channel, level - 1, start, wholeStart, into);
+    for (auto b = first; b < last; ++b)
+        into.add(buckets[b], std::min((b + 1) * bf, frames) - b * bf);
+    accumulate(s, channel, level - 1, wholeEnd, end, into);
+}
+
+SampleSummaryBuilder::~SampleSummaryBuilder()
+{
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+void SampleSummaryBuilder::queue(const std::shared_ptr<Sample> &s)
+{
+    if (!s || !s->claimSummaryBuild())
+        return;
+
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        pending.push_back(s);
+        if (!worker.joinable())
+            worker = std::thread([this]() { run(); });
+    }
+    cv.notify_one();
+}
+
+void SampleSummaryBuilder::wait()
+{
+    std::unique_lock<std::mutex> l(mutex);
+    idleCv.wait(l, [this]() { return stopping || (pending.empty() && !building); });
+}
+
+void SampleSummaryBuilder::run()
+{
+    std::unique_lock<std::mutex> l(mutex);
+    while (true)
+    {
+        cv.wait(l, [this]() { return stopping || !pending.empty(); });
+        if (stopping)
+            break;
+
+        auto next = std::move(pending.front());
+        pending.pop_front();
+        building = true;
+        l.unlock();
+        // The sample may have gone already, and if not this may hold the last reference
+        if (auto s = next.lock())
+            s->getSummary();
+        l.lock();
+        building = false;
+        if (pending.empty())
+            idleCv.notify_all();
+    }
+    idleCv.notify_all();
+}
+} // namespace scxt::sample
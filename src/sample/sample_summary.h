@@ -0,0 +1,151 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_SAMPLE_SAMPLE_SUMMARY_H
+#define SCXT_SRC_SAMPLE_SAMPLE_SUMMARY_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "utils.h"
+
+namespace scxt::sample
+{
+struct Sample;
+
+/**
+ * A min / max / sum of squares pyramid over the frames of a sample, so the waveform
+ * display and the sample analytics answer in time proportional to what they ask for
+ * rather than to the sample length. A streamed sample is summarized in full, reading the
+ * frames past its resident head from its file or compressed store.
+ *
+ * Level 0 summarizes baseBucketFrames frames a bucket and each level above summarizes
+ * levelFactor buckets of the one below, up to a single bucket covering the sample. The
+ * last bucket of a level may be short. Values are normalized as the analytics always
+ * have: I16 over INT16_MAX, I24 as Sample::unpackI24, F32 as is.
+ *
+ * A summary is immutable once built; a Sample builds its own on first use (see
+ * Sample::getSummary) or the SampleSummaryBuilder builds it ahead of time.
+ */
+struct SampleSummary : MoveableOnly<SampleSummary>
+{
+    static constexpr size_t baseBucketFrames{256};
+    static constexpr size_t levelFactor{16};
+
+    struct Bucket
+    {
+        float min{0.f}, max{0.f};
+        double sumSquares{0.0};
+    };
+
+    struct Range
+    {
+        float min{0.f}, max{0.f};
+        double sumSquares{0.0};
+        size_t frames{0};
+
+        void add(const Bucket &b, size_t bucketFrames)
+        {
+            if (bucketFrames == 0)
+                return;
+            min = frames ? std::min(min, b.min) : b.min;
+            max = frames ? std::max(max, b.max) : b.max;
+            sumSquares += b.sumSquares;
+            frames += bucketFrames;
+        }
+        void add(const Range &r) { add(Bucket{r.min, r.max, r.sumSquares}, r.frames); }
+
+        float peak() const { return std::max(std::abs(min), std::abs(max)); }
+        float rms() const { return frames ? (float)std::sqrt(sumSquares / frames) : 0.f; }
+    };
+
+    // Summarizes s, whose data mustn't change while this runs
+    static std::shared_ptr<const SampleSummary> build(Sample &s);
+
+    size_t frames{0};
+    int channels{0};
+
+    /*
+     * The frames [start, end) of a channel, clamped to the summary. Whole buckets come from
+     * the pyramid and the ragged ends from the sample data (or file, past a streamed head),
+     * so the result is exact and costs at most about 2 * levelFactor buckets a level plus
+     * 2 * baseBucketFrames frames. s must be the sample this was built from.
+     */
+    Range range(Sample &s, int channel, size_t start, size_t end) const;
+    // The whole channel, straight from the top of the pyramid
+    Range whole(int channel) const;
+
+    size_t levelCount() const { return levels.size(); }
+    size_t bucketFrames(size_t level) const;
+    const std::vector<Bucket> &bucketsAt(size_t level, int channel) const
+    {
+        return levels[level][channel];
+    }
+
+  private:
+    void accumulate(Sample &s, int channel, int level, size_t start, size_t end,
+                    Range &into) const;
+
+    // levels[level][channel]
+    std::vector<std::array<std::vector<Bucket>, 2>> levels;
+};
+
+/**
+ * Builds sample summaries on a background thread so they are usually ready before anyone
+ * asks. The thread starts with the first queued sample and only holds weak references, so
+ * a sample dropped before its turn is skipped.
+ */
+struct SampleSummaryBuilder : MoveableOnly<SampleSummaryBuilder>
+{
+    SampleSummaryBuilder() = default;
+    ~SampleSummaryBuilder();
+
+    // Queues s unless it has been queued before
+    void queue(const std::shared_ptr<Sample> &s);
+    // Blocks until the queue is empty
+    void wait();
+
+  private:
+    void run();
+
+    std::mutex mutex;
+    std::condition_variable cv, idleCv;
+    std::deque<std::weak_ptr<Sample>> pending;
+    bool building{false}, stopping{false};
+    std::thread worker;
+};
+} // namespace scxt::sample
+
+#endif // SCXT_SRC_SAMPLE_SAMPLE_SUMMARY_H
@@ -28,29 +28,37 @@
 #include "sfz_import.h"
 #include "selection/selection_manager.h"
 #include "sfz_parse.h"
+#include "sfz_tokenizer.h"
 #include "messaging/messaging.h"
 #include "engine/engine.h"
 #include <cctype>
+#include <unordered_map>
 
 namespace scxt::sfz_support
 {
-int parseMidiNote(const std::string &s)
+// Values are views into the sfz text so aren't null terminated where the value ends
+static double toDouble(std::string_view v) { return std::atof(std::string(v).c_str()); }
+static long toLong(std::string_view v) { return std::atol(std::string(v).c_str()); }
+
+int parseMidiNote(std::string_view s)
 {
     static constexpr int noteShift[7] = {-3, -1, 0, 2, 4, 5, 7};
     static constexpr int octShift[7] = {1, 1, 0, 0, 0, 0, 0};
+    if (s.empty())
+        return 0;
     if ((s[0] >= 'a' && s[0] <= 'g') || (s[0] >= 'A' && s[0] <= 'G'))
     {
         auto bn = std::clamp((int)std::tolower(s[0]) - (int)'a', 0, 7);
         int oct = 4;
         auto diff = 0;
-        if (s[1] == '#' || s[1] == 'b')
+        if (s.size() > 1 && (s[1] == '#' || s[1] == 'b'))
         {
             diff = s[1] == '#' ? 1 : 0;
-            oct = std::atol(s.c_str() + 2);
+            oct = toLong(s.substr(2));
         }
         else
         {
-            oct = std::atol(s.c_str() + 1);
+            oct = toLong(s.substr(1));
         }
 
         // C4 is 60 so
@@ -60,28 +68,151 @@ int parseMidiNote(const std::string &s)
 
         return res;
     }
-    return std::atol(s.c_str());
+    return toLong(s);
 }
 
-bool importSFZ(const fs::path &f, engine::Engine &e)
+PreparedSFZ prepareSFZImport(const fs::path &f, engine::Engine &e, bool concurrentDecode)
 {
     assert(e.getMessageController()->threadingChecker.isSerialThread());
 
-    SFZParser parser;
+    PreparedSFZ res;
+    res.file = f;
+    res.doc.tokenize(f);
+    const auto &sections = res.doc.sections;
+    res.regionSamples.resize(sections.size());
 
-    auto doc = parser.parse(f);
     auto rootDir = f.parent_path();
     auto sampleDir = rootDir;
 
+    // The distinct files in the order the regions first ask for them, which is the order
+    // loading them one region at a time would assign their ids
+    std::vector<fs::path> toLoad;
+    std::vector<size_t> regionLoadIndex(sections.size(), 0);
+    std::unordered_map<std::string, size_t> loadIndexByPath;
+
+    const SFZTokenizer::Section *groupSection{nullptr};
+    for (size_t i = 0; i < sections.size(); ++i)
+    {
+        const auto &r = sections[i];
+        auto list = res.doc.opCodesOf(r);
+        if (r.type == SFZParser::Header::group)
+        {
+            groupSection = &r;
+        }
+        else if (r.type == SFZParser::Header::control)
+        {
+            for (const auto &oc : list)
+            {
+                if (oc.id == SFZOpcode::default_path)
+                {
+                    auto vv = std::string(oc.value);
+                    std::replace(vv.begin(), vv.end(), '\\', '/');
+                    sampleDir = rootDir / vv;
+                    SCLOG("Control: Resetting sample dir to " << sampleDir);
+                }
+                else
+                {
+                    SCLOG("    Skipped OpCode <control>: " << oc.name << " -> " << oc.value);
+                }
+            }
+        }
+        if (r.type != SFZParser::Header::region)
+            continue;
+
+        // Find the sample
+        std::string sampleFileString = "<-->";
+        if (groupSection)
+        {
+            for (auto &oc : res.doc.opCodesOf(*groupSection))
+            {
+                if (oc.id == SFZOpcode::sample)
+                {
+                    sampleFileString = oc.value;
+                }
+            }
+        }
+        for (auto &oc : list)
+        {
+            if (oc.id == SFZOpcode::sample)
+            {
+                sampleFileString = oc.value;
+            }
+        }
+        // fs always works with / and on windows also works with back. Quotes are
+        // stripped by the parser now
+        std::replace(sampleFileString.begin(), sampleFileString.end(), '\\', '/');
+
+        auto &rs = res.regionSamples[i];
+        rs.sampleFile = fs::path{sampleFileString};
+        auto samplePath = (sampleDir / rs.sampleFile).lexically_normal();
+        if (fs::exists(samplePath))
+        {
+            rs.path = samplePath;
+            rs.status = PreparedSFZ::RegionSample::SKIP;
+        }
+        else if (fs::exists(rs.sampleFile))
+        {
+            rs.path = rs.sampleFile;
+            rs.status = PreparedSFZ::RegionSample::ABORT;
+        }
+        else
+        {
+            SCLOG("Unable to load either '" << samplePath.u8string() << "' or '"
+                                            << rs.sampleFile.u8string() << "'");
+            // The import stops at this region, so nothing after it is needed
+            break;
+        }
+
+        auto [it, added] = loadIndexByPath.emplace(rs.path.u8string(), toLoad.size());
+        if (added)
+            toLoad.push_back(rs.path);
+        regionLoadIndex[i] = it->second;
+    }
+
+    std::vector<std::optional<SampleID>> ids;
+    if (concurrentDecode)
+    {
+        ids = e.getSampleManager()->loadSamplesByPath(toLoad);
+    }
+    else
+    {
+        for (const auto &p : toLoad)
+            ids.push_back(e.getSampleManager()->loadSampleByPath(p));
+    }
+
+    for (size_t i = 0; i < sections.size(); ++i)
+    {
+        auto &rs = res.regionSamples[i];
+        if (rs.path.empty())
+            continue;
+
+        const auto &id = ids[regionLoadIndex[i]];
+        if (id.has_value())
+        {
+            rs.id = *id;
+            rs.status = PreparedSFZ::RegionSample::LOADED;
+        }
+    }
+    return res;
+}
+
+bool applySFZImport(const PreparedSFZ &prep, engine::Engine &e)
+{
+    assert(e.getMessageController()->threadingChecker.isSerialThread());
+
+    const auto &doc = prep.doc;
+    const auto &sections = doc.sections;
     auto pt = std::clamp(e.getSelectionManager()->selectedPart, (int16_t)0, (int16_t)numParts);
 
     auto &part = e.getPatch()->getPart(pt);
 
     int groupId = -1;
     int firstGroupWithZonesAdded = -1;
-    SFZParser::opCodes_t currentGroupOpcodes;
-    for (const auto &[r, list] : doc)
+    SFZTokenizer::OpCodes currentGroupOpcodes{nullptr, nullptr};
+    for (size_t di = 0; di < sections.size(); ++di)
     {
+        const auto &r = sections[di];
+        auto list = doc.opCodesOf(r);
         if (r.type != SFZParser::Header::region)
         {
             SCLOG("Header ----- <" << r.name << "> (" << list.size() << " opcodes) -------");
@@ -95,7 +226,7 @@ bool importSFZ(const fs::path &f, engine::Engine &e)
             auto &group = part->getGroup(groupId);
             for (auto &oc : list)
             {
-                if (oc.name == "group_label" || oc.name == "name")
+                if (oc.id == SFZOpcode::group_label || oc.id == SFZOpcode::name)
                 {
                     group->name = oc.value;
                 }
@@ -115,69 +246,28 @@ bool importSFZ(const fs::path &f, engine::Engine &e)
             }
             auto &group = part->getGroup(groupId);
 
-            // Find the sample
-            std::string sampleFileString = "<-->";
-            for (auto &oc : currentGroupOpcodes)
-            {
-                if (oc.name == "sample")
-                {
-                    sampleFileString = oc.value;
-                }
-            }
-            for (auto &oc : list)
-            {
-                if (oc.name == "sample")
-                {
-                    sampleFileString = oc.value;
-                }
-            }
-            // fs always works with / and on windows also works with back. Quotes are
-            // stripped by the parser now
-            std::replace(sampleFileString.begin(), sampleFileString.end(), '\\', '/');
-            auto sampleFile = fs::path{sampleFileString};
-            auto samplePath = (sampleDir / sampleFile).lexically_normal();
-
-            SampleID sid;
-            if (fs::exists(samplePath))
+            const auto &rs = prep.regionSamples[di];
+            if (rs.status == PreparedSFZ::RegionSample::SKIP)
             {
-                auto lsid = e.getSampleManager()->loadSampleByPath(samplePath);
-                if (lsid.has_value())
-                {
-                    sid = *lsid;
-                }
-                else
-                {
-                    SCLOG("Cannot load Sample : " << samplePath.u8string());
-                    break;
-                }
+                SCLOG("Cannot load Sample : " << rs.path.u8string());
+                break;
             }
-            else if (fs::exists(sampleFile))
+            else if (rs.status == PreparedSFZ::RegionSample::ABORT)
             {
-                auto lsid = e.getSampleManager()->loadSampleByPath(sampleFile);
-                if (lsid.has_value())
-                {
-                    sid = *lsid;
-                }
-                else
-                {
-                    SCLOG("Cannot load Sample : " << sampleFile);
-                    return false;
-                }
-            }
-            else
-            {
-                SCLOG("Unable to load either '" << samplePath.u8string() << "' or '"
-                                                << sampleFile.u8string() << "'");
+                if (!rs.path.empty())
+                    SCLOG("Cannot load Sample : " << rs.path.u8string());
                 return false;
             }
+            auto sid = rs.id;
+            const auto &sampleFile = rs.sampleFile;
 
             // OK so do we have a sequence position > 1
             int roundRobinPosition{-1};
             for (auto &oc : list)
             {
-                if (oc.name == "seq_position")
+                if (oc.id == SFZOpcode::seq_position)
                 {
-                    auto pos = std::atoi(oc.value.c_str());
+                    auto pos = (int)toLong(oc.value);
                     if (pos > 1)
                     {
                         roundRobinPosition = pos;
@@ -190,25 +280,25 @@ bool importSFZ(const fs::path &f, engine::Engine &e)
                 int16_t rk{0}, ks{0}, ke{0}, vs{0}, ve{0};
                 for (auto &oc : list)
                 {
-                    if (oc.name == "pitch_keycenter")
+                    if (oc.id == SFZOpcode::pitch_keycenter)
                     {
                         rk = parseMidiNote(oc.value);
                     }
-                    else if (oc.name == "lokey")
+                    else if (oc.id == SFZOpcode::lokey)
                     {
                         ks = parseMidiNote(oc.value);
                     }
-                    else if (oc.name == "hikey")
+                    else if (oc.id == SFZOpcode::hikey)
                     {
                         ke = parseMidiNote(oc.value);
                     }
-                    else if (oc.name == "lovel")
+                    else if (oc.id == SFZOpcode::lovel)
                     {
-                        vs = std::atol(oc.value.c_str());
+                        vs = toLong(oc.value);
                     }
-                    else if (oc.name == "hivel")
+                    else if (oc.id == SFZOpcode::hivel)
                     {
-                        ve = std::atol(oc.value.c_str());
+                        ve = toLong(oc.value);
                     }
                 }
 
@@ -244,56 +334,57 @@ bool importSFZ(const fs::path &f, engine::Engine &e)
                 zn->mapping.velocityRange.velStart = 0;
                 zn->mapping.velocityRange.velEnd = 127;
 
+                using namedOpCodes_t = std::pair<std::string_view, SFZTokenizer::OpCodes>;
                 for (const auto &[n, ls] :
-                     {std::make_pair(std::string("Group"), currentGroupOpcodes), {"Region", list}})
+                     {namedOpCodes_t{"Group", currentGroupOpcodes}, {"Region", list}})
                 {
                     for (auto &oc : ls)
                     {
-                        if (oc.name == "pitch_keycenter")
+                        if (oc.id == SFZOpcode::pitch_keycenter)
                         {
                             zn->mapping.rootKey = parseMidiNote(oc.value);
                         }
-                        else if (oc.name == "lokey")
+                        else if (oc.id == SFZOpcode::lokey)
                         {
                             zn->mapping.keyboardRange.keyStart = parseMidiNote(oc.value);
                         }
-                        else if (oc.name == "hikey")
+                        else if (oc.id == SFZOpcode::hikey)
                         {
                             zn->mapping.keyboardRange.keyEnd = parseMidiNote(oc.value);
                         }
-                        else if (oc.name == "key")
+                        else if (oc.id == SFZOpcode::key)
                         {
                             auto pmn = parseMidiNote(oc.value);
                             zn->mapping.rootKey = pmn;
                             zn->mapping.keyboardRange.keyStart = pmn;
                             zn->mapping.keyboardRange.keyEnd = pmn;
                         }
-                        else if (oc.name == "lovel")
+                        else if (oc.id == SFZOpcode::lovel)
                         {
-                            zn->mapping.velocityRange.velStart = std::atol(oc.value.c_str());
+                            zn->mapping.velocityRange.velStart = toLong(oc.value);
                         }
-                        else if (oc.name == "hivel")
+                        else if (oc.id == SFZOpcode::hivel)
                         {
-                            zn->mapping.velocityRange.velEnd = std::atol(oc.value.c_str());
+                            zn->mapping.velocityRange.velEnd = toLong(oc.value);
                         }
-                        else if (oc.name == "sample" || oc.name == "seq_position")
+                        else if (oc.id == SFZOpcode::sample || oc.id == SFZOpcode::seq_position)
                         {
                             // dealt with above
                         }
-                        else if (oc.name == "ampeg_sustain")
+                        else if (oc.id == SFZOpcode::ampeg_sustain)
                         {
-                            zn->egStorage[0].s = std::atof(oc.value.c_str()) * 0.01;
+                            zn->egStorage[0].s = toDouble(oc.value) * 0.01;
                         }
-                        else if (oc.name == "volume")
+                        else if (oc.id == SFZOpcode::volume)
                         {
-                            zn->mapping.amplitude = std::atof(oc.value.c_str()); // decibels
+                            zn->mapping.amplitude = toDouble(oc.value); // decibels
                         }
-                        else if (oc.name == "tune")
+                        else if (oc.id == SFZOpcode::tune)
                         {
                             // Tune is supplied in cents. Our pitch offset is in semitones
-                            zn->mapping.pitchOffset = std::atof(oc.value.c_str()) * 0.01;
+                            zn->mapping.pitchOffset = toDouble(oc.value) * 0.01;
                         }
-                        else if (oc.name == "loop_mode")
+                        else if (oc.id == SFZOpcode::loop_mode)
                         {
                             if (oc.value == "loop_continuous")
                             {
@@ -309,15 +400,15 @@ bool importSFZ(const fs::path &f, engine::Engine &e)
                         }
 
 #define APPLYEG(v, d, t)                                                                           \
-    else if (oc.name == v)                                                                         \
+    else if (oc.id == v)                                                                           \
     {                                                                                              \
         zn->egStorage[d].t =                                                                       \
-            scxt::modulation::secondsToNormalizedEnvTime(std::atof(oc.value.c_str()));             \
+            scxt::modulation::secondsToNormalizedEnvTime(toDouble(oc.value));                      \
     }
 
-                        APPLYEG("ampeg_attack", 0, a)
-                        APPLYEG("ampeg_decay", 0, d)
-                        APPLYEG("ampeg_release", 0, r)
+                        APPLYEG(SFZOpcode::ampeg_attack, 0, a)
+                        APPLYEG(SFZOpcode::ampeg_decay, 0, d)
+                        APPLYEG(SFZOpcode::ampeg_release, 0, r)
                         else
                         {
                             if (n != "Group")
@@ -336,24 +427,8 @@ bool importSFZ(const fs::path &f, engine::Engine &e)
         }
         break;
         case SFZParser::Header::control:
-        {
-            for (const auto &oc : list)
-            {
-                if (oc.name == "default_path")
-                {
-                    auto vv = oc.value;
-                    std::replace(vv.begin(), vv.end(), '\\', '/');
-                    sampleDir = rootDir / vv;
-                    SCLOG("Control: Resetting sample dir to " << sampleDir);
-                    ;
-                }
-                else
-                {
-                    SCLOG("    Skipped OpCode <control>: " << oc.name << " -> " << oc.value);
-                }
-            }
-        }
-        break;
+            // default_path was applied when the samples were resolved
+            break;
         default:
         {
             SCLOG("Ignoring SFZ Header " << r.name << " with " << list.size() << " keywords");
@@ -370,4 +445,9 @@ bool importSFZ(const fs::path &f, engine::Engine &e)
         pt, firstGroupWithZonesAdded, 0, true, true, true));
     return true;
 }
+
+bool importSFZ(const fs::path &f, engine::Engine &e)
+{
+    return applySFZImport(prepareSFZImport(f, e), e);
+}
 } // namespace scxt::sfz_support
\ No newline at end of file
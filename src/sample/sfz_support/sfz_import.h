@@ -28,12 +28,48 @@
 #ifndef SCXT_SRC_SAMPLE_SFZ_SUPPORT_SFZ_IMPORT_H
 #define SCXT_SRC_SAMPLE_SFZ_SUPPORT_SFZ_IMPORT_H
 
+#include <optional>
+#include <vector>
+
 #include "filesystem/import.h"
 #include <engine/engine.h>
+#include "sfz_parse.h"
+#include "sfz_tokenizer.h"
 
 namespace scxt::sfz_support
 {
+/*
+ * SFZ import runs in two phases. prepareSFZImport parses the file, resolves the sample of
+ * every region and loads each distinct sample once, decoding them concurrently; it touches
+ * no engine structure so it can run while the audio thread plays. applySFZImport then
+ * builds the groups and zones in one pass and needs the audio thread stopped. importSFZ
+ * does both. All of these run on the serialization thread.
+ */
+struct PreparedSFZ
+{
+    struct RegionSample
+    {
+        enum Status
+        {
+            LOADED,
+            SKIP,  // the sample didn't load; the region is dropped
+            ABORT, // the sample is missing; the import stops here
+        } status{ABORT};
+        SampleID id;
+        fs::path sampleFile; // as written in the sfz
+        fs::path path;       // where it was found; empty if it wasn't
+    };
+
+    fs::path file;
+    SFZTokenizer doc;
+    // One per section of doc; only meaningful for regions
+    std::vector<RegionSample> regionSamples;
+};
+
+// concurrentDecode false loads the samples one at a time, as import used to
+PreparedSFZ prepareSFZImport(const fs::path &, engine::Engine &, bool concurrentDecode = true);
+bool applySFZImport(const PreparedSFZ &, engine::Engine &);
 bool importSFZ(const fs::path &, engine::Engine &);
-}
+} // namespace scxt::sfz_support
 
 #endif // SHORTCIRCUITXT_SFZ_IMPORT_H
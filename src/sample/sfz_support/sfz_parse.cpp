@@ -26,6 +26,7 @@
  */
 
 #include "sfz_parse.h"
+#include "sfz_tokenizer.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -246,186 +247,39 @@ SFZParser::document_t SFZParser::parse(const std::string &contents)
 #if PARSE_WITH_CRAPPY_CODE
 namespace scxt::sfz_support
 {
-
-SFZParser::document_t SFZParser::parse(const std::string &s)
+// The hand written parser is SFZTokenizer now; a document is a copy of its tokens
+static SFZParser::document_t toDocument(const SFZTokenizer &t)
 {
-    enum ParseState
-    {
-        NOTHING,
-        IN_SLCOM,
-        IN_MLCOM,
-        IN_REGION,
-    } state{NOTHING};
-
-    document_t res;
-
-    auto lookAheadForOpcode = [&](auto from, auto &opcode) {
-        opcode.clear();
-        while (from < s.size() && s[from] != ' ' && s[from] != '\n' && s[from] != '\r')
-        {
-            if (s[from] == '=')
-                return true;
-            opcode += s[from];
-            from++;
-        }
-        return false;
-    };
-
-    auto readUntilEndOfKey = [&](auto from, bool isSample) -> std::pair<std::string, int> {
-        std::ostringstream oss;
-        std::string tmp;
-        auto mightBeOpcode{false};
-        while (from < s.size())
-        {
-            auto c = s[from];
-            auto cn = from < s.size() - 1 ? s[from + 1] : c;
-            if (c == ' ')
-            {
-                mightBeOpcode = true;
-                oss << c;
-            }
-            else if (c == '/' && cn == '*')
-            {
-                return {oss.str(), from};
-            }
-            else if (c == '/' && (!isSample || cn == '/'))
-            {
-                return {oss.str(), from};
-            }
-            else if (c == '<')
-            {
-                return {oss.str(), from};
-            }
-            else if (c == '\n' || c == '\r')
-            {
-                return {oss.str(), from};
-            }
-            else if (mightBeOpcode && lookAheadForOpcode(from, tmp))
-            {
-                return {oss.str(), from - 1};
-            }
-            else
-            {
-                oss << c;
-            }
-            from++;
-        }
-        return {oss.str(), from};
-    };
-
-    auto stripTrailingAndQuotes = [](const auto &s) {
-        auto ep = s.size() - 1;
-        while (ep >= 0 && (s[ep] == ' ' || s[ep] == '\n' || s[ep] == '\r'))
-        {
-            ep--;
-        }
-        auto res = s.substr(0, ep + 1);
-        if (!res.empty())
-        {
-            if (res.size() > 1 && res[0] == '"' && res.back() == '"')
-            {
-                res = res.substr(1, res.size() - 2);
-            }
-        }
-        return res;
-    };
-
-    auto e = s.size();
-    std::string opcode;
-    for (auto cp = 0; cp < e; ++cp)
+    SFZParser::document_t res;
+    res.reserve(t.sections.size());
+    for (const auto &sec : t.sections)
     {
-        auto c = s[cp];
-        auto cn = (cp < e - 1) ? s[cp + 1] : c;
-
-        switch (state)
-        {
-        case NOTHING:
-        {
-            if (c == '/' && cn == '*')
-            {
-                state = IN_MLCOM;
-                cp++;
-            }
-            else if (c == '/')
-            {
-                state = IN_SLCOM;
-            }
-            else if (c == '<')
-            {
-                state = IN_REGION;
-                res.push_back({{}, {}});
-            }
-            else if (c == ' ' || c == '\n' || c == '\r')
-            {
-            }
-            else if (lookAheadForOpcode(cp, opcode))
-            {
-                cp += opcode.size() + 1;
-                auto [key, pos] = readUntilEndOfKey(cp, opcode == "sample");
-                cp = pos - 1;
-                OpCode oc;
-                oc.name = opcode;
-                oc.value = stripTrailingAndQuotes(key);
-                res.back().second.push_back(oc);
-            }
-            else
-            {
-                // TODO: Report Syntax Error
-            }
-        }
-        break;
-        case IN_REGION:
-        {
-            if (c == '>')
-            {
-                state = NOTHING;
-#define HDR_HELPER(a)                                                                              \
-    if (res.back().first.name == #a)                                                               \
-        res.back().first.type = Header::a;
-                HDR_HELPER(region);
-                HDR_HELPER(group);
-                HDR_HELPER(control);
-                HDR_HELPER(global);
-                HDR_HELPER(curve);
-                HDR_HELPER(effect);
-                HDR_HELPER(master);
-                HDR_HELPER(midi);
-                HDR_HELPER(sample);
-                HDR_HELPER(unknown);
-            }
-            else if (c != ' ')
-            {
-                res.back().first.name += c;
-            }
-            else
-            {
-                // TODO Report Syntax Error
-            }
-        }
-        break;
-        case IN_SLCOM:
-        {
-            if (c == '\n' || c == '\r')
-            {
-                state = NOTHING;
-            }
-        }
-        break;
-        case IN_MLCOM:
-        {
-            if (c == '*' && cn == '/')
-            {
-                state = NOTHING;
-                cp += 2;
-            }
-        }
-        break;
-        }
+        SFZParser::section_t s;
+        s.first.type = sec.type;
+        s.first.name = std::string(sec.name);
+        s.second.reserve(sec.opCodeCount);
+        for (const auto &oc : t.opCodesOf(sec))
+            s.second.push_back({std::string(oc.name), std::string(oc.value)});
+        res.push_back(std::move(s));
     }
     return res;
 }
-#endif
+
+SFZParser::document_t SFZParser::parse(const std::string &s)
+{
+    SFZTokenizer t;
+    t.tokenizeText(s);
+    return toDocument(t);
+}
 
+SFZParser::document_t SFZParser::parse(const fs::path &f)
+{
+    SFZTokenizer t;
+    if (!t.tokenize(f))
+        return {};
+    return toDocument(t);
+}
+#else
 SFZParser::document_t SFZParser::parse(const fs::path &f)
 {
     std::ifstream ifs;
@@ -434,4 +288,5 @@ SFZParser::document_t SFZParser::parse(const fs::path &f)
     sstr << ifs.rdbuf();
     return parse(sstr.str());
 }
-} // namespace scxt::sfz_support
\ No newline at end of file
+#endif
+} // namespace scxt::sfz_support
@@ -0,0 +1,480 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "sfz_tokenizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "infrastructure/file_map_view.h"
+#include "utils.h"
+
+namespace scxt::sfz_support
+{
+SFZOpcode internSFZOpcode(std::string_view name)
+{
+    static const std::unordered_map<std::string_view, SFZOpcode> ids{
+        {"sample", SFZOpcode::sample},
+        {"lokey", SFZOpcode::lokey},
+        {"hikey", SFZOpcode::hikey},
+        {"key", SFZOpcode::key},
+        {"pitch_keycenter", SFZOpcode::pitch_keycenter},
+        {"lovel", SFZOpcode::lovel},
+        {"hivel", SFZOpcode::hivel},
+        {"seq_position", SFZOpcode::seq_position},
+        {"ampeg_attack", SFZOpcode::ampeg_attack},
+        {"ampeg_decay", SFZOpcode::ampeg_decay},
+        {"ampeg_release", SFZOpcode::ampeg_release},
+        {"ampeg_sustain", SFZOpcode::ampeg_sustain},
+        {"volume", SFZOpcode::volume},
+        {"tune", SFZOpcode::tune},
+        {"loop_mode", SFZOpcode::loop_mode},
+        {"group_label", SFZOpcode::group_label},
+        {"name", SFZOpcode::name},
+        {"default_path", SFZOpcode::default_path},
+    };
+    auto it = ids.find(name);
+    return it == ids.end() ? SFZOpcode::unknown : it->second;
+}
+
+namespace
+{
+// Tabs are whitespace here, which they weren't in the original parser
+inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+inline bool isEOL(char c) { return c == '\n' || c == '\r'; }
+inline bool isWhite(char c) { return isSpace(c) || isEOL(c); }
+inline bool isIdentifier(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '_';
+}
+
+std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && isWhite(s.front()))
+        s.remove_prefix(1);
+    while (!s.empty() && isWhite(s.back()))
+        s.remove_suffix(1);
+    return s;
+}
+
+SFZParser::Header::Type headerType(std::string_view n)
+{
+    using H = SFZParser::Header;
+#define HDR_HELPER(a)                                                                              \
+    if (n == #a)                                                                                   \
+        return H::a;
+    HDR_HELPER(region);
+    HDR_HELPER(group);
+    HDR_HELPER(control);
+    HDR_HELPER(global);
+    HDR_HELPER(curve);
+    HDR_HELPER(effect);
+    HDR_HELPER(master);
+    HDR_HELPER(midi);
+    HDR_HELPER(sample);
+#undef HDR_HELPER
+    return H::unknown;
+}
+} // namespace
+
+SFZTokenizer::SFZTokenizer() = default;
+SFZTokenizer::~SFZTokenizer() = default;
+SFZTokenizer::SFZTokenizer(SFZTokenizer &&) noexcept = default;
+
+bool SFZTokenizer::tokenize(const fs::path &file)
+{
+    includeRoot = file.parent_path();
+
+    auto mv = std::make_unique<infrastructure::FileMapView>(file);
+    if (mv->isMapped())
+    {
+        std::string_view text{(const char *)mv->data(), mv->dataSize()};
+        maps.push_back(std::move(mv));
+        filesTokenized++;
+        preprocess(text, 0);
+        finish();
+        return true;
+    }
+
+    // Empty files don't map; read what's there, or fail
+    std::ifstream ifs(file, std::ios::binary);
+    if (!ifs)
+        return false;
+    std::string contents{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+    filesTokenized++;
+    preprocess(store(contents), 0);
+    finish();
+    return true;
+}
+
+void SFZTokenizer::tokenizeText(std::string_view text, const fs::path &root)
+{
+    includeRoot = root;
+    preprocess(text, 0);
+    finish();
+}
+
+/*
+ * Split the text at the lines the preprocessor cares about - directives, and lines with
+ * a $variable once something is #define'd - and hand everything between them straight to
+ * the lexer. A file with neither is lexed as a single run.
+ */
+void SFZTokenizer::preprocess(std::string_view text, int depth)
+{
+    bytesTokenized += text.size();
+
+    const char *s = text.data();
+    const size_t e = text.size();
+    size_t runStart{0}, pos{0};
+    std::string expanded;
+
+    while (pos < e)
+    {
+        auto p = defines.empty() ? text.find('#', pos) : text.find_first_of("#$", pos);
+        if (p == std::string_view::npos)
+            break;
+
+        auto lineStart = p;
+        while (lineStart > runStart && !isEOL(s[lineStart - 1]))
+            lineStart--;
+        auto lineEnd = p;
+        while (lineEnd < e && !isEOL(s[lineEnd]))
+            lineEnd++;
+        auto line = text.substr(lineStart, lineEnd - lineStart);
+
+        auto firstChar = lineStart;
+        while (firstChar < p && isSpace(s[firstChar]))
+            firstChar++;
+        auto directive = s[p] == '#' && firstChar == p;
+        auto hasVariable = !defines.empty() && line.find('$') != std::string_view::npos;
+        if (!directive && !hasVariable)
+        {
+            pos = lineEnd;
+            continue;
+        }
+
+        lex(text.substr(runStart, lineStart - runStart));
+        if (directive && state == NOTHING)
+        {
+            auto d = line.substr(p - lineStart + 1);
+            if (d.substr(0, 7) == "include")
+                include(d.substr(7), depth);
+            else if (d.substr(0, 6) == "define")
+                define(d.substr(6));
+            // and any other directive is dropped
+        }
+        else if (expand(line, expanded))
+        {
+            lex(store(expanded));
+        }
+        else
+        {
+            lex(line);
+        }
+        runStart = lineEnd;
+        pos = lineEnd;
+    }
+    lex(text.substr(runStart));
+}
+
+void SFZTokenizer::include(std::string_view d, int depth)
+{
+    auto q0 = d.find('"');
+    auto q1 = q0 == std::string_view::npos ? q0 : d.find('"', q0 + 1);
+    if (q1 == std::string_view::npos)
+    {
+        SCLOG("SFZ: Malformed #include" << d);
+        return;
+    }
+    if (depth >= maxIncludeDepth)
+    {
+        SCLOG("SFZ: #include nested too deeply at " << d);
+        return;
+    }
+
+    auto name = std::string(d.substr(q0 + 1, q1 - q0 - 1));
+    std::replace(name.begin(), name.end(), '\\', '/');
+    auto path = includeRoot / fs::path(name);
+
+    auto mv = std::make_unique<infrastructure::FileMapView>(path);
+    if (!mv->isMapped())
+    {
+        SCLOG("SFZ: Unable to #include '" << path.u8string() << "'");
+        return;
+    }
+    std::string_view text{(const char *)mv->data(), mv->dataSize()};
+    maps.push_back(std::move(mv));
+    filesTokenized++;
+    preprocess(text, depth + 1);
+}
+
+void SFZTokenizer::define(std::string_view d)
+{
+    d = trim(d);
+    if (d.empty() || d[0] != '$')
+    {
+        SCLOG("SFZ: Malformed #define " << d);
+        return;
+    }
+    size_t n{1};
+    while (n < d.size() && isIdentifier(d[n]))
+        n++;
+    defines[std::string(d.substr(1, n - 1))] = std::string(trim(d.substr(n)));
+}
+
+// Replace each $name which is exactly a defined name. Returns false if nothing changed.
+bool SFZTokenizer::expand(std::string_view line, std::string &into) const
+{
+    bool changed{false};
+    into.clear();
+    size_t i{0};
+    while (i < line.size())
+    {
+        auto d = line.find('$', i);
+        if (d == std::string_view::npos)
+            break;
+        auto n = d + 1;
+        while (n < line.size() && isIdentifier(line[n]))
+            n++;
+        auto it = defines.find(std::string(line.substr(d + 1, n - d - 1)));
+        into.append(line.substr(i, d - i));
+        if (it != defines.end())
+        {
+            into.append(it->second);
+            changed = true;
+        }
+        else
+        {
+            into.append(line.substr(d, n - d));
+        }
+        i = n;
+    }
+    into.append(line.substr(i));
+    return changed;
+}
+
+void SFZTokenizer::beginSection()
+{
+    sections.emplace_back();
+    sections.back().firstOpCode = (uint32_t)opCodes.size();
+}
+
+void SFZTokenizer::endSection(std::string_view name)
+{
+    auto &sec = sections.back();
+    sec.name = name;
+    sec.type = headerType(name);
+}
+
+void SFZTokenizer::lex(std::string_view text)
+{
+    const char *s = text.data();
+    const size_t e = text.size();
+
+    // Does a name= start at from? Returns the position of the '='
+    auto lookAheadForOpcode = [&](size_t from) -> size_t {
+        while (from < e && !isWhite(s[from]))
+        {
+            if (s[from] == '=')
+                return from;
+            from++;
+        }
+        return std::string_view::npos;
+    };
+
+    // A value ends at a comment, a header, the end of the line or the next name=
+    auto readUntilEndOfValue = [&](size_t from, bool isSample) -> size_t {
+        bool mightBeOpcode{false};
+        size_t noOpcodeBefore{0};
+        while (from < e)
+        {
+            auto c = s[from];
+            auto cn = from + 1 < e ? s[from + 1] : c;
+            if (isSpace(c))
+            {
+                mightBeOpcode = true;
+            }
+            else if (c == '/' && (cn == '*' || !isSample || cn == '/'))
+            {
+                return from;
+            }
+            else if (c == '<' || isEOL(c))
+            {
+                return from;
+            }
+            else if (mightBeOpcode && from >= noOpcodeBefore)
+            {
+                auto eq = lookAheadForOpcode(from);
+                if (eq != std::string_view::npos)
+                    return from;
+                // nothing in the rest of this word can start an opcode either
+                noOpcodeBefore = from;
+                while (noOpcodeBefore < e && !isWhite(s[noOpcodeBefore]))
+                    noOpcodeBefore++;
+            }
+            from++;
+        }
+        return from;
+    };
+
+    size_t cp{0};
+    while (cp < e)
+    {
+        auto c = s[cp];
+        auto cn = (cp + 1 < e) ? s[cp + 1] : c;
+
+        switch (state)
+        {
+        case NOTHING:
+        {
+            if (c == '/' && cn == '*')
+            {
+                state = IN_MLCOM;
+                cp += 2;
+            }
+            else if (c == '/')
+            {
+                state = IN_SLCOM;
+                cp++;
+            }
+            else if (c == '<')
+            {
+                state = IN_HEADER;
+                headerPieces.clear();
+                beginSection();
+                cp++;
+            }
+            else if (isWhite(c))
+            {
+                cp++;
+            }
+            else if (auto eq = lookAheadForOpcode(cp); eq != std::string_view::npos)
+            {
+                auto name = text.substr(cp, eq - cp);
+                auto id = internSFZOpcode(name);
+                auto vs = eq + 1;
+                auto ve = readUntilEndOfValue(vs, id == SFZOpcode::sample);
+                cp = ve;
+
+                while (ve > vs && isWhite(s[ve - 1]))
+                    ve--;
+                if (ve - vs > 1 && s[vs] == '"' && s[ve - 1] == '"')
+                {
+                    vs++;
+                    ve--;
+                }
+
+                // The original parser would crash on an opcode before any header; skip it
+                if (!sections.empty())
+                {
+                    opCodes.push_back({id, name, text.substr(vs, ve - vs)});
+                    sections.back().opCodeCount++;
+                }
+            }
+            else
+            {
+                // Not an opcode; nothing starts until the next comment, header or word
+                // TODO: Report Syntax Error
+                while (cp < e && !isWhite(s[cp]) && s[cp] != '/' && s[cp] != '<')
+                    cp++;
+            }
+        }
+        break;
+        case IN_HEADER:
+        {
+            auto hs = cp;
+            while (cp < e && s[cp] != '>' && !isWhite(s[cp]))
+                cp++;
+            if (cp < e && s[cp] == '>' && headerPieces.empty())
+            {
+                endSection(text.substr(hs, cp - hs));
+                state = NOTHING;
+                cp++;
+                break;
+            }
+            headerPieces.append(s + hs, cp - hs);
+            if (cp < e && s[cp] == '>')
+            {
+                endSection(store(headerPieces));
+                state = NOTHING;
+            }
+            // and whitespace in a header name is dropped
+            // TODO Report Syntax Error
+            cp++;
+        }
+        break;
+        case IN_SLCOM:
+        {
+            while (cp < e && !isEOL(s[cp]))
+                cp++;
+            if (cp < e)
+                state = NOTHING;
+        }
+        break;
+        case IN_MLCOM:
+        {
+            while (cp < e && !(s[cp] == '*' && cp + 1 < e && s[cp + 1] == '/'))
+                cp++;
+            if (cp < e)
+            {
+                state = NOTHING;
+                cp += 2;
+            }
+        }
+        break;
+        }
+    }
+}
+
+void SFZTokenizer::finish()
+{
+    // A header left open at the end of the file keeps what it had, as SFZParser did
+    if (state == IN_HEADER && !sections.empty())
+        sections.back().name = store(headerPieces);
+    state = NOTHING;
+    headerPieces.clear();
+}
+
+std::string_view SFZTokenizer::store(std::string_view s)
+{
+    static constexpr size_t arenaBlockSize{64 * 1024};
+    if (s.empty())
+        return {};
+    if (arenaUsed + s.size() > arenaSize)
+    {
+        arenaSize = std::max(arenaBlockSize, s.size());
+        arenaBlocks.push_back(std::make_unique<char[]>(arenaSize));
+        arenaUsed = 0;
+    }
+    auto d = arenaBlocks.back().get() + arenaUsed;
+    std::memcpy(d, s.data(), s.size());
+    arenaUsed += s.size();
+    return {d, s.size()};
+}
+} // namespace scxt::sfz_support
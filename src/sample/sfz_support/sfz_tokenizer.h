@@ -0,0 +1,167 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_SRC_SAMPLE_SFZ_SUPPORT_SFZ_TOKENIZER_H
+#define SCXT_SRC_SAMPLE_SFZ_SUPPORT_SFZ_TOKENIZER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "filesystem/import.h"
+#include "utils.h"
+#include "sfz_parse.h"
+
+namespace scxt::infrastructure
+{
+class FileMapView;
+}
+
+namespace scxt::sfz_support
+{
+/*
+ * The opcodes the importer acts on, interned once by the tokenizer so the importer can
+ * switch on an id rather than compare strings. Anything else is unknown and keeps its name.
+ */
+enum class SFZOpcode : uint16_t
+{
+    unknown,
+    sample,
+    lokey,
+    hikey,
+    key,
+    pitch_keycenter,
+    lovel,
+    hivel,
+    seq_position,
+    ampeg_attack,
+    ampeg_decay,
+    ampeg_release,
+    ampeg_sustain,
+    volume,
+    tune,
+    loop_mode,
+    group_label,
+    name,
+    default_path
+};
+SFZOpcode internSFZOpcode(std::string_view name);
+
+/**
+ * SFZTokenizer turns sfz text into headers and opcodes without copying it. Files are
+ * mapped and stay mapped for the tokenizer's lifetime, and every name and value is a
+ * string_view into the mapping. Only text the tokenizer has to rewrite (a line with a
+ * #define'd $variable in it, a header name broken by spaces) is copied, into an arena.
+ * Opcodes live in one flat array which each section indexes into.
+ *
+ * The ARIA preprocessor lines are handled as the text streams through: #define $name value
+ * substitutes $name on every later line, and #include "file" tokenizes that file in place,
+ * relative to the top level file's directory, so a multi file instrument is a single pass.
+ *
+ * Otherwise the rules are SFZParser's: a value runs to the end of the line, a comment, a
+ * header or the next name=, so values may contain spaces; only sample= values may contain
+ * a single '/'; trailing space and surrounding quotes are dropped.
+ */
+struct SFZTokenizer : MoveableOnly<SFZTokenizer>
+{
+    struct OpCode
+    {
+        SFZOpcode id{SFZOpcode::unknown};
+        std::string_view name;
+        std::string_view value;
+    };
+    struct Section
+    {
+        SFZParser::Header::Type type{SFZParser::Header::unknown};
+        std::string_view name;
+        uint32_t firstOpCode{0};
+        uint32_t opCodeCount{0};
+    };
+    struct OpCodes
+    {
+        const OpCode *b, *e;
+        const OpCode *begin() const { return b; }
+        const OpCode *end() const { return e; }
+        size_t size() const { return e - b; }
+    };
+
+    SFZTokenizer();
+    ~SFZTokenizer();
+    SFZTokenizer(SFZTokenizer &&) noexcept;
+
+    // Returns false if the file can't be read
+    bool tokenize(const fs::path &file);
+    // text must outlive the tokenizer. #include paths are relative to includeRoot
+    void tokenizeText(std::string_view text, const fs::path &includeRoot = {});
+
+    std::vector<Section> sections;
+    std::vector<OpCode> opCodes;
+    OpCodes opCodesOf(const Section &s) const
+    {
+        auto b = opCodes.data() + s.firstOpCode;
+        return {b, b + s.opCodeCount};
+    }
+
+    size_t bytesTokenized{0};
+    size_t filesTokenized{0};
+
+  private:
+    static constexpr int maxIncludeDepth{16};
+
+    void preprocess(std::string_view text, int depth);
+    void include(std::string_view directive, int depth);
+    void define(std::string_view directive);
+    bool expand(std::string_view line, std::string &into) const;
+    void lex(std::string_view s);
+    void finish();
+    void beginSection();
+    void endSection(std::string_view name);
+
+    std::string_view store(std::string_view s);
+
+    enum LexState
+    {
+        NOTHING,
+        IN_SLCOM,
+        IN_MLCOM,
+        IN_HEADER
+    } state{NOTHING};
+    std::string headerPieces;
+
+    fs::path includeRoot;
+    std::unordered_map<std::string, std::string> defines;
+
+    std::vector<std::unique_ptr<infrastructure::FileMapView>> maps;
+    std::vector<std::unique_ptr<char[]>> arenaBlocks;
+    size_t arenaUsed{0}, arenaSize{0};
+};
+} // namespace scxt::sfz_support
+
+#endif // SCXT_SRC_SAMPLE_SFZ_SUPPORT_SFZ_TOKENIZER_H
@@ -55,15 +55,12 @@ Voice::~Voice()
         SCLOG("WARNING: Destroying assigned voice. (OK in shutdown)");
     }
 #endif
-    for (auto i = 0; i < engine::processorCount; ++i)
-    {
-        dsp::processor::unspawnProcessor(processors[i]);
-        processors[i] = nullptr;
-    }
+    releaseProcessors();
 }
 
 void Voice::cleanupVoice()
 {
+    releaseStreaming();
     zone->removeVoice(this);
     zone = nullptr;
     isVoiceAssigned = false;
@@ -73,17 +70,28 @@ void Voice::cleanupVoice()
     // We cleanup processors here since they may have, say,
     // memory pool resources checked out that others could
     // use which they don't need to hold onto
+    releaseProcessors();
+}
+
+void Voice::releaseProcessors()
+{
     for (auto i = 0; i < engine::processorCount; ++i)
     {
         dsp::processor::unspawnProcessor(processors[i]);
         processors[i] = nullptr;
+
+        if (processorPlacementStorage[i])
+        {
+            engine->getMemoryPool()->returnBlock(processorPlacementStorage[i],
+                                                 processorPlacementSize[i]);
+            processorPlacementStorage[i] = nullptr;
+            processorPlacementSize[i] = 0;
+        }
     }
 }
 
 void Voice::voiceStarted()
 {
-    forceOversample = zone->parentGroup->outputInfo.oversample;
-
     lfosActive = zone->lfosActive;
     egsActive = zone->egsActive;
 
@@ -102,7 +110,8 @@ void Voice::voiceStarted()
     endpoints->bindTargetBaseValues(modMatrix, *zone);
     modMatrix.process();
 
-    // These probably need to happen after the modulator is set up
+    // These probably need to happen after the modulator is set up. initializeGenerator
+    // also picks forceOversample, which the processors spawn with.
     initializeGenerator();
     initializeProcessors();
 
@@ -118,7 +127,7 @@ void Voice::voiceStarted()
             stepLfos[i].setSampleRate(sampleRate, sampleRateInv);
 
             stepLfos[i].assign(&zone->modulatorStorage[i], endpoints->lfo[i].rateP,
-                               &engine->transport, engine->rng);
+                               &engine->transport, zone->parentGroup->parentPart->rng);
         }
         else if (lfoEvaluator[i] == CURVE)
         {
@@ -157,9 +166,24 @@ bool Voice::process()
         return processWithOS<false>();
 }
 
+/*
+ * Zero an envelope block ahead of a voice's first frame and ramp from there to where the
+ * envelope got to by the end of the block, so the attack starts with the sound.
+ */
+template <int N> static void holdEnvelopeUntil(float *cache, int lead)
+{
+    auto target = cache[N - 1];
+    auto dRamp = target / (N - lead);
+    for (int i = 0; i < lead; ++i)
+        cache[i] = 0.f;
+    for (int i = lead; i < N; ++i)
+        cache[i] = (i - lead + 1) * dRamp;
+}
+
 template <bool OS> bool Voice::processWithOS()
 {
     namespace mech = sst::basic_blocks::mechanics;
+    engine::RenderProfiler::VoiceScope profile;
 
     if (!isVoicePlaying || !isVoiceAssigned || !zone)
     {
@@ -167,6 +191,18 @@ template <bool OS> bool Voice::processWithOS()
         return true;
     }
 
+    // A voice starting part way into this block runs its envelopes for just the frames
+    // it sounds
+    auto setEnvelopeBlockFraction = [this](float f) {
+        envelopeBlockFraction = f;
+        for (auto &l : curveLfos)
+            l.envelopeBlockFraction = f;
+        for (auto &l : envLfos)
+            l.envelopeBlockFraction = f;
+    };
+    if (startOffset > 0)
+        setEnvelopeBlockFraction(1.f - (float)startOffset / blockSize);
+
     // Run Modulators - these run at base rate never oversampled
     for (auto i = 0; i < engine::lfosPerZone; ++i)
     {
@@ -176,7 +212,7 @@ template <bool OS> bool Voice::processWithOS()
         }
         if (lfoEvaluator[i] == STEP)
         {
-            stepLfos[i].process(blockSize);
+            // Already advanced, with the zone's other voices, in Zone::processVoiceStepLFOs
         }
         else if (lfoEvaluator[i] == CURVE)
         {
@@ -238,6 +274,16 @@ template <bool OS> bool Voice::processWithOS()
         eg2.processBlock(*eg2p.aP, *eg2p.hP, *eg2p.dP, *eg2p.sP, *eg2p.rP, *eg2p.asP, *eg2p.dsP,
                          *eg2p.rsP, envGate);
     }
+    if (startOffset > 0)
+    {
+        // and holds the amplitude envelope at zero until its first frame
+        if constexpr (OS)
+        {
+            holdEnvelopeUntil<blockSize << 1>(aegOS.outputCache, startOffset << 1);
+        }
+        holdEnvelopeUntil<blockSize>(aeg.outputCache, startOffset);
+        setEnvelopeBlockFraction(1.f);
+    }
     updateTransportPhasors();
 
     // TODO and probably just want to process the envelopes here
@@ -245,6 +291,7 @@ template <bool OS> bool Voice::processWithOS()
 
     auto fpitch = calculateVoicePitch();
     calculateGeneratorRatio(fpitch);
+    auto fullRatio = GD.ratio;
     if (useOversampling)
         GD.ratio = GD.ratio >> 1;
     fpitch -= 69;
@@ -263,17 +310,70 @@ template <bool OS> bool Voice::processWithOS()
         GD.playbackInvertedBounds =
             1.f / std::max(1, GD.playbackUpperBound - GD.playbackLowerBound);
     }
-    if (!GD.isFinished && Generator)
+    if (!OS && !generatorHasRun && generatorWantsOversampling(fullRatio) != useOversampling)
     {
-        Generator(&GD, &GDIO);
+        // Nothing has sounded yet to crossfade from, so take the new rate outright
+        useOversampling = !useOversampling;
+        GD.ratio = useOversampling ? fullRatio >> 1 : fullRatio;
+        GD.blockSize = blockSize * (useOversampling ? 2 : 1);
+        halfRate.reset();
+    }
 
-        if (useOversampling && !OS)
+    if (!GD.isFinished && Generator && (!streamBuffer || updateStreamingWindow()))
+    {
+        if (!OS && generatorWantsOversampling(fullRatio) != useOversampling)
         {
-            halfRate.process_block_D2(output[0], output[1], blockSize << 1);
+            switchGeneratorRate(fullRatio);
         }
+        else
+        {
+            if (startOffset > 0)
+            {
+                // Start part way into the block, leaving silence ahead of the first frame
+                auto lead = startOffset * (useOversampling ? 2 : 1);
+                memset(output, 0, sizeof(output));
+                GD.blockSize -= lead;
+                GDIO.outputL = output[0] + lead;
+                GDIO.outputR = output[1] + lead;
+                Generator(&GD, &GDIO);
+                GD.blockSize += lead;
+                GDIO.outputL = output[0];
+                GDIO.outputR = output[1];
+            }
+            else
+            {
+                Generator(&GD, &GDIO);
+            }
+
+            if (useOversampling && !OS)
+            {
+                halfRate.process_block_D2(output[0], output[1], blockSize << 1);
+            }
+        }
+        generatorHasRun = true;
+        startOffset = 0;
     }
     else
+    {
         memset(output, 0, sizeof(output));
+        if (streamBuffer && !generatorHasRun && !GD.isFinished && envGate)
+        {
+            // Still waiting on the stream, so the envelopes start again with the sound
+            aeg.attackFrom(0.0);
+            if (egsActive[1])
+            {
+                eg2.attackFrom(0.0);
+            }
+            if constexpr (OS)
+            {
+                aegOS.attackFrom(0.0);
+            }
+        }
+        else
+        {
+            startOffset = 0;
+        }
+    }
 
     // TODO Ringout - this is obvioulsy wrong
     if (GD.isFinished)
@@ -528,6 +628,8 @@ void Voice::panOutputsBy(bool chainIsMono, const lipol &plip)
 
 void Voice::initializeGenerator()
 {
+    generatorHasRun = false;
+
     if (sampleIndex < 0)
     {
         // For now we just null out the generator and deal but an alternate
@@ -536,6 +638,7 @@ void Voice::initializeGenerator()
         Generator = nullptr;
         GD.isFinished = false;
         monoGenerator = true;
+        forceOversample = chooseOversampling();
         return;
     }
 
@@ -556,11 +659,18 @@ void Voice::initializeGenerator()
         GDIO.sampleDataL = s->GetSamplePtrF32(0);
         GDIO.sampleDataR = s->GetSamplePtrF32(1);
     }
+    else if (s->bitDepth == sample::Sample::BD_I24)
+    {
+        GDIO.sampleDataL = s->GetSamplePtrI24(0);
+        GDIO.sampleDataR = s->GetSamplePtrI24(1);
+    }
     else
     {
         assert(false);
     }
     GDIO.waveSize = s->sample_length;
+    GDIO.interleavedStride = s->mappedStride;
+    GDIO.packed24 = s->bitDepth == sample::Sample::BD_I24;
 
     GD.samplePos = variantData.startSample;
     GD.sampleSubPos = 0;
@@ -589,20 +699,183 @@ void Voice::initializeGenerator()
 
     GD.interpolationType = INTERPOLATION_METHOD;
 
-    // TODO: This constant came from SC. Wonder why it is this value. There was a comment
+    // TODO: The ratio threshold came from SC. Wonder why it is this value. There was a comment
     // comparing with 167777216 so any speedup at all.
-    useOversampling = std::abs(GD.ratio) > 18000000 || forceOversample;
+    forceOversample = chooseOversampling();
+    useOversampling = forceOversample || std::abs(GD.ratio) > generatorOversampleRatio;
     GD.blockSize = blockSize * (useOversampling ? 2 : 1);
 
+    releaseStreaming();
+    if (s->isStreamed())
+    {
+        initializeStreaming(*s);
+    }
+
     Generator = nullptr;
 
     monoGenerator = s->channels == 1;
-    Generator = dsp::GetFPtrGeneratorSample(!monoGenerator, s->bitDepth == sample::Sample::BD_F32,
+    // Packed 24 bit plays through the float generator
+    Generator = dsp::GetFPtrGeneratorSample(!monoGenerator, s->bitDepth != sample::Sample::BD_I16,
                                             variantData.loopActive,
                                             variantData.loopDirection == engine::Zone::FORWARD_ONLY,
                                             variantData.loopMode == engine::Zone::LOOP_WHILE_GATED);
 }
 
+bool Voice::chooseOversampling() const
+{
+    // A base rate group wants base rate voices. The generator can still oversample alone.
+    if (!zone->parentGroup->outputInfo.oversample)
+        return false;
+
+    if (engine->voiceOversampling == engine::Engine::ALWAYS)
+        return true;
+
+    // Pitched up far enough that the generator oversamples anyway, so run the chain at 2x
+    // too rather than go down to base rate and have the zone bring us back up
+    if (sampleIndex >= 0 && std::abs(GD.ratio) > generatorOversampleRatio)
+        return true;
+
+    for (auto i = 0; i < engine::processorCount; ++i)
+    {
+        const auto &ps = zone->processorStorage[i];
+        if (ps.isActive && ps.type != dsp::processor::proct_none &&
+            dsp::processor::getProcessorNeedsOversampling(ps.type))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Voice::switchGeneratorRate(int32_t ratio)
+{
+    // Render this block at the old rate, then again from the same starting state at the new
+    // rate, and crossfade. The half rate filter starts cold when we go up; the fade in
+    // covers its settling.
+    auto nextGD = GD;
+
+    Generator(&GD, &GDIO);
+    if (useOversampling)
+    {
+        halfRate.process_block_D2(output[0], output[1], blockSize << 1);
+    }
+
+    useOversampling = !useOversampling;
+    nextGD.ratio = useOversampling ? ratio >> 1 : ratio;
+    nextGD.blockSize = blockSize * (useOversampling ? 2 : 1);
+
+    float next alignas(16)[2][blockSize << 1];
+    memset(next, 0, sizeof(next));
+    auto nextIO = GDIO;
+    nextIO.outputL = next[0];
+    nextIO.outputR = next[1];
+    Generator(&nextGD, &nextIO);
+    if (useOversampling)
+    {
+        halfRate.reset();
+        halfRate.process_block_D2(next[0], next[1], blockSize << 1);
+    }
+
+    static constexpr float dFade{1.f / blockSize};
+    for (int c = 0; c < (monoGenerator ? 1 : 2); ++c)
+    {
+        for (int i = 0; i < blockSize; ++i)
+        {
+            auto f = (i + 1) * dFade;
+            output[c][i] = output[c][i] * (1.f - f) + next[c][i] * f;
+        }
+    }
+
+    GD = nextGD;
+}
+
+void Voice::initializeStreaming(sample::Sample &s)
+{
+    static constexpr int64_t pad{dsp::FIRoffset};
+    auto &streamer = engine->getSampleManager()->streamer;
+
+    streamResidentLength = s.getResidentSampleLength();
+    streamHead[0] = GDIO.sampleDataL;
+    streamHead[1] = GDIO.sampleDataR;
+
+    auto needsMoreThanHead = [this](auto p) { return p + pad >= streamResidentLength; };
+
+    // The streaming window only moves forward, so a voice which loops or plays backwards
+    // outside the resident region can't stream. Keep it inside the head rather than read
+    // past the end of the resident data, and ask for the whole sample to be made resident
+    // so later voices play it in full.
+    auto &variantData = zone->variantData.variants[sampleIndex];
+    if ((variantData.loopActive && needsMoreThanHead(GD.loopUpperBound)) ||
+        (GD.direction < 0 && needsMoreThanHead(GD.playbackUpperBound)))
+    {
+        auto lim = (int32_t)std::max((int64_t)1, streamResidentLength - pad - 1);
+        GD.playbackUpperBound = std::min(GD.playbackUpperBound, lim);
+        GD.loopUpperBound = std::min(GD.loopUpperBound, lim);
+        GD.loopLowerBound = std::min(GD.loopLowerBound, GD.loopUpperBound);
+        GD.samplePos = std::min(GD.samplePos, lim);
+        streamer->reportFallback();
+        engine->getSampleManager()->requestFullyResident(s);
+        return;
+    }
+
+    if (!needsMoreThanHead(GD.playbackUpperBound))
+        return;
+
+    // Start the window so it overlaps the end of the head by half a window, which
+    // gives the reader that long to deliver before we need it
+    static constexpr int64_t halfWindow{sample::StreamingVoiceBuffer::windowFrames / 2};
+    auto startFrame = std::min((int64_t)GD.samplePos, streamResidentLength - halfWindow);
+    streamBuffer = streamer->acquire(s, startFrame);
+    if (!streamBuffer)
+    {
+        // Every window is taken (counted as windowsExhausted), so play just the head
+        auto lim = (int32_t)std::max((int64_t)1, streamResidentLength - pad - 1);
+        GD.playbackUpperBound = std::min(GD.playbackUpperBound, lim);
+        GD.samplePos = std::min(GD.samplePos, lim);
+        streamer->reportFallback();
+    }
+}
+
+bool Voice::updateStreamingWindow()
+{
+    static constexpr int64_t pad{dsp::FIRoffset};
+    auto &streamer = engine->getSampleManager()->streamer;
+
+    streamer->service(streamBuffer, GD.samplePos);
+
+    // The furthest the generator can read this block
+    auto advance = (((int64_t)std::abs(GD.ratio) * GD.blockSize) >> 24) + 2;
+    auto lo = (int64_t)GD.samplePos - pad;
+    auto hi = (int64_t)GD.samplePos + advance + pad;
+
+    if (hi < streamResidentLength)
+    {
+        GDIO.sampleDataL = streamHead[0];
+        GDIO.sampleDataR = streamHead[1];
+        return true;
+    }
+
+    if (!streamer->covers(streamBuffer, lo, hi))
+    {
+        // Hold position and play silence until the reader catches up
+        streamer->reportUnderrun();
+        return false;
+    }
+
+    GDIO.sampleDataL = streamBuffer->dataPointerFor(0);
+    GDIO.sampleDataR = streamBuffer->dataPointerFor(1);
+    return true;
+}
+
+void Voice::releaseStreaming()
+{
+    if (streamBuffer)
+    {
+        engine->getSampleManager()->streamer->release(streamBuffer);
+        streamBuffer = nullptr;
+    }
+}
+
 float Voice::calculateVoicePitch()
 {
     auto fpitch = key + *endpoints->mappingTarget.pitchOffsetP;
@@ -680,18 +953,23 @@ void Voice::initializeProcessors()
         memcpy(&processorIntParams[i][0], zone->processorStorage[i].intParams.data(),
                sizeof(processorIntParams[i]));
 
-        if ((processorIsActive[i] && processorType[i] != dsp::processor::proct_none) ||
-            (processorType[i] == dsp::processor::proct_none && !processorIsActive[i]))
-        {
-            processors[i] = dsp::processor::spawnProcessorInPlace(
-                processorType[i], zone->getEngine()->getMemoryPool().get(),
-                processorPlacementStorage[i], dsp::processor::processorMemoryBufferSize,
-                zone->processorStorage[i], endpoints->processorTarget[i].fp, processorIntParams[i],
-                forceOversample, false);
-        }
-        else
-        {
-            processors[i] = nullptr;
+        processors[i] = nullptr;
+        auto memSize = dsp::processor::getProcessorMemorySize(processorType[i], forceOversample);
+        if (processorIsActive[i] && memSize > 0)
+        {
+            // The zone reserved a block per voice at this size when it took the type
+            // (dsp::processor::reserveVoiceMemory), so this doesn't allocate
+            auto &pool = zone->getEngine()->getMemoryPool();
+            processorPlacementStorage[i] = pool->checkoutBlock(memSize);
+            processorPlacementSize[i] = memSize;
+
+            if (processorPlacementStorage[i])
+            {
+                processors[i] = dsp::processor::spawnProcessorInPlace(
+                    processorType[i], pool.get(), processorPlacementStorage[i], memSize,
+                    zone->processorStorage[i], endpoints->processorTarget[i].fp,
+                    processorIntParams[i], forceOversample, false);
+            }
         }
         if (processors[i])
         {
@@ -28,6 +28,8 @@
 #ifndef SCXT_SRC_VOICE_VOICE_H
 #define SCXT_SRC_VOICE_VOICE_H
 
+#include <cstdlib>
+
 #include "engine/zone.h"
 #include "engine/engine.h"
 #include "dsp/data_tables.h"
@@ -55,13 +57,39 @@ struct alignas(16) Voice : MoveableOnly<Voice>,
     engine::Engine::pathToZone_t zonePath{};
     int8_t sampleIndex{0}; // int since - == no sample
 
+    /*
+     * Whether the generator, AEG and processor chain run at 2x. Chosen once at voice start
+     * by chooseOversampling, since processors can't change rate mid voice. A voice whose
+     * rate differs from its group's is converted by the zone (Zone::processWithOS).
+     */
     bool forceOversample{true};
+    bool chooseOversampling() const;
 
     dsp::GeneratorState GD;
     dsp::GeneratorIO GDIO;
     dsp::GeneratorFPtr Generator;
     bool monoGenerator{false};
 
+    /*
+     * If our sample is streamed and we play past its resident head we read through
+     * a streaming window instead. streamHead holds the resident data pointers.
+     */
+    sample::StreamingVoiceBuffer *streamBuffer{nullptr};
+    void *streamHead[2]{nullptr, nullptr};
+    int64_t streamResidentLength{0};
+    void initializeStreaming(sample::Sample &s);
+    bool updateStreamingWindow();
+    void releaseStreaming();
+
+    /*
+     * Frames into its first block at which this voice starts (see
+     * Engine::eventSampleOffset). The generator renders silence up to there and the
+     * envelopes hold at zero. It is kept until the generator first runs, so a voice
+     * waiting on its stream starts at the offset in the block it first sounds in.
+     */
+    int16_t startOffset{0};
+    bool generatorHasRun{false};
+
     sst::filters::HalfRate::HalfRateFilter halfRate;
 
     int16_t channel{0};
@@ -81,8 +109,12 @@ struct alignas(16) Voice : MoveableOnly<Voice>,
     inline float envelope_rate_linear_nowrap(float f)
     {
         // Super sneaky: this works for Oversample also since blockSize += and samplerate *2
-        return blockSize * sampleRateInv * dsp::twoToTheXTable.twoToThe(-f);
+        return envelopeBlockFraction * blockSize * sampleRateInv *
+               dsp::twoToTheXTable.twoToThe(-f);
     }
+    // The share of this block the voice sounds for; less than one only in a block it
+    // starts part way into, so its envelopes advance by just the frames it plays
+    float envelopeBlockFraction{1.f};
 
     inline const sst::basic_blocks::tables::TwoToTheXProvider &twoToTheXProvider()
     {
@@ -101,7 +133,8 @@ struct alignas(16) Voice : MoveableOnly<Voice>,
     ~Voice();
 
     /**
-     * Generate the next blocksize of data into output
+     * Generate the next blocksize of data into output. Step LFOs are not advanced here;
+     * the owning zone does that for all its voices first (Zone::processVoiceStepLFOs).
      * @return false if you cant
      */
     bool process();
@@ -132,14 +165,17 @@ struct alignas(16) Voice : MoveableOnly<Voice>,
      */
     dsp::processor::Processor *processors[engine::processorCount]{};
     dsp::processor::ProcessorType processorType[engine::processorCount]{};
-    uint8_t processorPlacementStorage alignas(
-        16)[engine::processorCount][dsp::processor::processorMemoryBufferSize];
+    // Checked out of the engine memory pool at the size the type needs, only for occupied
+    // slots. Keeping these inline made every voice 64k whatever it was playing.
+    uint8_t *processorPlacementStorage[engine::processorCount]{};
+    size_t processorPlacementSize[engine::processorCount]{};
     int32_t processorIntParams alignas(
         16)[engine::processorCount][dsp::processor::maxProcessorIntParams];
     bool processorIsActive[engine::processorCount]{false, false, false, false};
     bool processorConsumesMono[engine::processorCount]{false, false, false, false};
 
     void initializeProcessors();
+    void releaseProcessors();
 
     using lipol = sst::basic_blocks::dsp::lipol_sse<blockSize, false>;
     using lipolOS = sst::basic_blocks::dsp::lipol_sse<blockSize << 1, false>;
@@ -156,9 +192,20 @@ struct alignas(16) Voice : MoveableOnly<Voice>,
     lipolOS processorLevelOS[engine::processorCount];
 
     /*
-     * Voice State on Creation
+     * Whether the generator runs at 2x. Always true if forceOversample; otherwise the
+     * generator oversamples (and halfRate brings it back down) while the ratio is above
+     * generatorOversampleRatio, dropping back below generatorBaseRateRatio. The gap keeps a
+     * wobbling pitch from toggling every block, and switchGeneratorRate crossfades the change.
      */
     bool useOversampling{false};
+    static constexpr int32_t generatorOversampleRatio{18000000}; // 1 << 24 is unity
+    static constexpr int32_t generatorBaseRateRatio{17500000};
+    bool generatorWantsOversampling(int32_t ratio) const
+    {
+        auto r = std::abs(ratio);
+        return useOversampling ? r >= generatorBaseRateRatio : r > generatorOversampleRatio;
+    }
+    void switchGeneratorRate(int32_t ratio);
 
     /*
      * Voice Playback State Model.
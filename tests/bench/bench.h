@@ -0,0 +1,120 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_TESTS_BENCH_BENCH_H
+#define SCXT_TESTS_BENCH_BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "configuration.h"
+
+namespace scxt::engine
+{
+struct Engine;
+}
+
+namespace scxt::bench
+{
+struct Result
+{
+    std::string suite, name;
+    int64_t iterations{0};
+    double nsPerBlock{0};
+};
+
+/*
+ * A deliberately small harness. Each benchmark is a callable which renders one block;
+ * we warm it up, then call it in batches until minSeconds has elapsed and report the
+ * mean time per call. No statistics beyond that - compare runs on the same machine.
+ */
+struct Runner
+{
+    double minSeconds{0.25};
+    std::string filter;
+    double sampleRate{48000};
+    std::vector<Result> results;
+
+    bool wants(const std::string &suite, const std::string &name) const
+    {
+        return filter.empty() || (suite + "/" + name).find(filter) != std::string::npos;
+    }
+
+    template <typename F> void run(const std::string &suite, const std::string &name, F &&blockFn)
+    {
+        if (!wants(suite, name))
+            return;
+
+        using clock_t = std::chrono::steady_clock;
+        static constexpr int batch{64};
+
+        for (int i = 0; i < batch; ++i)
+            blockFn();
+
+        int64_t its{0};
+        auto start = clock_t::now();
+        double elapsed{0};
+        while (elapsed < minSeconds)
+        {
+            for (int i = 0; i < batch; ++i)
+                blockFn();
+            its += batch;
+            elapsed = std::chrono::duration<double>(clock_t::now() - start).count();
+        }
+
+        Result r;
+        r.suite = suite;
+        r.name = name;
+        r.iterations = its;
+        r.nsPerBlock = elapsed * 1e9 / its;
+        report(r);
+        results.push_back(r);
+    }
+
+    // One block of audio at sampleRate, which is the budget a block must come in under
+    double realtimeNsPerBlock() const { return 1e9 * scxt::blockSize / sampleRate; }
+
+    void report(const Result &r) const;
+    bool writeJSON(const std::string &path) const;
+};
+
+void benchGenerators(Runner &r);
+void benchSampleStore(Runner &r);
+void benchPCMConvert(Runner &r);
+void benchProcessors(Runner &r, engine::Engine &e);
+void benchBusEffects(Runner &r, engine::Engine &e);
+void benchModMatrix(Runner &r, engine::Engine &e);
+void benchVoices(Runner &r);
+
+// An engine with the calling thread playing the serialization and audio roles
+std::unique_ptr<engine::Engine> makeBenchEngine(double sampleRate);
+} // namespace scxt::bench
+
+#endif // SCXT_TESTS_BENCH_BENCH_H
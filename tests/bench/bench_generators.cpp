@@ -0,0 +1,191 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "bench.h"
+#include "dsp/generator.h"
+#include "dsp/data_tables.h"
+
+namespace scxt::bench
+{
+namespace
+{
+// Long enough that an unlooped voice rarely hits the end and restarts
+constexpr int waveSize{48000 * 4};
+
+// uint8_t is packed 24 bit, three bytes a value
+template <typename T> struct PaddedSample
+{
+    static constexpr int width{std::is_same_v<T, uint8_t> ? 3 : 1};
+    std::vector<T> l, r;
+    PaddedSample()
+    {
+        std::minstd_rand gen(8675309);
+        std::uniform_real_distribution<float> dist(-1.f, 1.f);
+        l.resize((waveSize + 2 * dsp::FIRoffset) * width, 0);
+        r.resize((waveSize + 2 * dsp::FIRoffset) * width, 0);
+        for (int i = 0; i < waveSize; ++i)
+        {
+            if constexpr (std::is_same_v<T, float>)
+            {
+                l[i + dsp::FIRoffset] = dist(gen);
+                r[i + dsp::FIRoffset] = dist(gen);
+            }
+            else if constexpr (std::is_same_v<T, uint8_t>)
+            {
+                for (auto *d : {&l, &r})
+                {
+                    auto v = (int32_t)(dist(gen) * 8000000);
+                    for (int b = 0; b < 3; ++b)
+                        (*d)[(i + dsp::FIRoffset) * 3 + b] = (uint8_t)(v >> (8 * b));
+                }
+            }
+            else
+            {
+                l[i + dsp::FIRoffset] = (int16_t)(dist(gen) * 32000);
+                r[i + dsp::FIRoffset] = (int16_t)(dist(gen) * 32000);
+            }
+        }
+    }
+};
+
+const char *interpName(dsp::InterpolationTypes t)
+{
+    switch (t)
+    {
+    case dsp::InterpolationTypes::Sinc:
+        return "Sinc";
+    case dsp::InterpolationTypes::Linear:
+        return "Linear";
+    case dsp::InterpolationTypes::ZeroOrderHold:
+        return "ZOH";
+    }
+    return "?";
+}
+
+const char *levelName(dsp::SincKernelLevel l)
+{
+    switch (l)
+    {
+    case dsp::SincKernelLevel::PerSample:
+        return "PerSample";
+    case dsp::SincKernelLevel::SSE2:
+        return "SSE2";
+    case dsp::SincKernelLevel::AVX2:
+        return "AVX2";
+    case dsp::SincKernelLevel::AVX2FMA:
+        return "AVX2FMA";
+    }
+    return "?";
+}
+
+template <typename T>
+void benchSample(Runner &r, const PaddedSample<T> &s, bool stereo, int loopMode,
+                 dsp::InterpolationTypes interp, dsp::SincKernelLevel level)
+{
+    static constexpr bool isFloat{std::is_same_v<T, float>};
+    static constexpr bool isI24{std::is_same_v<T, uint8_t>};
+    static constexpr const char *loopNames[3]{"noloop", "loop", "bidiloop"};
+
+    auto name = std::string() + (stereo ? "stereo" : "mono") + "_" +
+                (isFloat ? "F32" : (isI24 ? "I24" : "I16")) +
+                "_" + loopNames[loopMode] + "_" + interpName(interp);
+    if (interp == dsp::InterpolationTypes::Sinc)
+        name += std::string("_") + levelName(level);
+
+    // A pitch shifted ratio, so the interpolator has real work to do
+    dsp::GeneratorState start;
+    start.direction = 1;
+    start.directionAtOutset = 1;
+    start.ratio = (int32_t)(1.37f * (1 << 24));
+    start.isFinished = false;
+    start.playbackLowerBound = 0;
+    start.playbackUpperBound = waveSize - 1;
+    start.playbackInvertedBounds = 1.f / (waveSize - 1);
+    start.loopLowerBound = waveSize / 4;
+    start.loopUpperBound = waveSize - 1;
+    start.loopInvertedBounds = 1.f / (start.loopUpperBound - start.loopLowerBound);
+    start.loopFade = 512;
+    start.interpolationType = interp;
+
+    alignas(16) float outL[blockSize], outR[blockSize];
+    dsp::GeneratorIO io;
+    io.outputL = outL;
+    io.outputR = outR;
+    io.sampleDataL = (void *)(s.l.data() + dsp::FIRoffset * s.width);
+    io.sampleDataR = (void *)(s.r.data() + dsp::FIRoffset * s.width);
+    io.waveSize = waveSize;
+    io.packed24 = isI24;
+
+    // Packed 24 bit runs through the float generator
+    auto fn = dsp::GetFPtrGeneratorSample(stereo, isFloat || isI24, loopMode > 0, loopMode != 2,
+                                          false, level);
+    auto gd = start;
+    r.run("generator", name, [&]() {
+        if (gd.isFinished)
+            gd = start;
+        fn(&gd, &io);
+    });
+}
+} // namespace
+
+void benchGenerators(Runner &r)
+{
+    PaddedSample<int16_t> i16;
+    PaddedSample<float> f32;
+    PaddedSample<uint8_t> i24;
+
+    auto best = dsp::bestSincKernelLevel();
+    auto fastest = dsp::fastestSincKernelLevel();
+    for (auto interp : {dsp::InterpolationTypes::Sinc, dsp::InterpolationTypes::Linear,
+                        dsp::InterpolationTypes::ZeroOrderHold})
+    {
+        for (auto level : {dsp::SincKernelLevel::PerSample, dsp::SincKernelLevel::SSE2,
+                           dsp::SincKernelLevel::AVX2, dsp::SincKernelLevel::AVX2FMA})
+        {
+            // Kernel levels only differ for sinc, and levels past fastest clamp to it
+            if (interp != dsp::InterpolationTypes::Sinc && level != best)
+                continue;
+            if ((int)level > (int)fastest)
+                continue;
+
+            for (auto stereo : {false, true})
+            {
+                for (auto loopMode : {0, 1, 2})
+                {
+                    benchSample(r, i16, stereo, loopMode, interp, level);
+                    benchSample(r, f32, stereo, loopMode, interp, level);
+                    benchSample(r, i24, stereo, loopMode, interp, level);
+                }
+            }
+        }
+    }
+}
+} // namespace scxt::bench
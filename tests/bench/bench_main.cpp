@@ -0,0 +1,160 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+/*
+ * scxt-bench: micro-benchmarks for the generator kernels, compressed sample store, PCM
+ * conversion, voice processors, bus effects, the voice mod matrix and whole voices. Results
+ * print as they run and can be written as JSON (--json out.json) for tracking across commits
+ * and sst-* bumps.
+ *
+ *   scxt-bench [--json path] [--filter substring] [--seconds per-benchmark]
+ *
+ * The filter matches against "suite/name", so "--filter processor/" or "--filter Sinc"
+ * narrows a run.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+#include "bench.h"
+#include "engine/engine.h"
+#include "messaging/messaging.h"
+
+namespace scxt::bench
+{
+void Runner::report(const Result &r) const
+{
+    std::cout << std::left << std::setw(12) << r.suite << std::setw(48) << r.name << std::right
+              << std::fixed << std::setprecision(1) << std::setw(10) << r.nsPerBlock
+              << " ns/block " << std::setprecision(3) << std::setw(8)
+              << 100.0 * r.nsPerBlock / realtimeNsPerBlock() << "% of realtime" << std::endl;
+}
+
+bool Runner::writeJSON(const std::string &path) const
+{
+    std::ofstream of(path);
+    if (!of.is_open())
+        return false;
+
+    auto now = std::time(nullptr);
+    char ts[64];
+    std::strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    of << "{\n"
+       << "  \"timestamp\": \"" << ts << "\",\n"
+       << "  \"sampleRate\": " << sampleRate << ",\n"
+       << "  \"blockSize\": " << scxt::blockSize << ",\n"
+#if BUILD_IS_DEBUG
+       << "  \"buildIsDebug\": true,\n"
+#else
+       << "  \"buildIsDebug\": false,\n"
+#endif
+       << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const auto &r = results[i];
+        // names are streaming names and our own ascii labels, so no escaping is needed
+        of << "    {\"suite\": \"" << r.suite << "\", \"name\": \"" << r.name
+           << "\", \"iterations\": " << r.iterations << ", \"nsPerBlock\": "
+           << std::setprecision(3) << std::fixed << r.nsPerBlock << ", \"percentRealtime\": "
+           << 100.0 * r.nsPerBlock / realtimeNsPerBlock() << "}"
+           << (i + 1 == results.size() ? "\n" : ",\n");
+    }
+    of << "  ]\n}\n";
+    return true;
+}
+
+std::unique_ptr<engine::Engine> makeBenchEngine(double sampleRate)
+{
+    // As in scxt-render this thread plays every role
+    auto engine = std::make_unique<engine::Engine>();
+    auto &cont = engine->getMessageController();
+    cont->stop();
+    cont->threadingChecker.registerAsSerialThread();
+    cont->threadingChecker.registerAsAudioThread();
+    engine->runningEnvironment = "scxt-bench";
+    engine->prepareToPlay(sampleRate);
+    return engine;
+}
+} // namespace scxt::bench
+
+int main(int argc, char **argv)
+{
+    using namespace scxt;
+
+    bench::Runner runner;
+    std::string jsonPath;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        auto arg = std::string(argv[i]);
+        auto hasValue = i + 1 < argc;
+        if (arg == "--json" && hasValue)
+            jsonPath = argv[++i];
+        else if (arg == "--filter" && hasValue)
+            runner.filter = argv[++i];
+        else if (arg == "--seconds" && hasValue)
+            runner.minSeconds = std::atof(argv[++i]);
+        else
+        {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--json path] [--filter substring] [--seconds per-benchmark]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    // The processors, bus effects and matrix all want an engine for the memory pool,
+    // tempo and sample rate. The voices make their own, since they load a patch.
+    auto engine = bench::makeBenchEngine(runner.sampleRate);
+
+    bench::benchGenerators(runner);
+    bench::benchSampleStore(runner);
+    bench::benchPCMConvert(runner);
+    bench::benchProcessors(runner, *engine);
+    bench::benchBusEffects(runner, *engine);
+    bench::benchModMatrix(runner, *engine);
+    engine.reset();
+    bench::benchVoices(runner);
+
+    if (!jsonPath.empty())
+    {
+        if (!runner.writeJSON(jsonPath))
+        {
+            std::cerr << "Unable to write " << jsonPath << std::endl;
+            return 2;
+        }
+        std::cout << "Wrote " << runner.results.size() << " results to " << jsonPath
+                  << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include <iterator>
+#include <memory>
+
+#include "bench.h"
+#include "engine/engine.h"
+#include "engine/group.h"
+#include "engine/part.h"
+#include "engine/zone.h"
+#include "modulation/mod_curves.h"
+#include "voice/voice.h"
+
+namespace scxt::bench
+{
+void benchModMatrix(Runner &r, engine::Engine &e)
+{
+    if (!r.wants("mod_matrix", "full_routing"))
+        return;
+
+    const auto &part = e.getPatch()->getPart(0);
+    auto gidx = part->addGroup() - 1;
+    const auto &group = part->getGroup(gidx);
+    group->addZone(std::make_unique<engine::Zone>());
+    auto *zone = group->getZone(group->getZones().size() - 1).get();
+
+    auto voice = std::make_unique<voice::Voice>(&e, zone);
+    voice->endpoints = std::make_unique<voice::modulation::MatrixEndpoints>(nullptr);
+    auto &ep = *voice->endpoints;
+    const auto &src = ep.sources;
+
+    // Every row active, half of them with a via and a curve, spread over the source and
+    // target kinds a real patch uses
+    using SR = voice::modulation::MatrixConfig::SourceIdentifier;
+    using TG = voice::modulation::MatrixConfig::TargetIdentifier;
+    SR sources[]{src.lfoSources.sources[0],      src.lfoSources.sources[1],
+                 src.lfoSources.sources[2],      src.lfoSources.sources[3],
+                 src.aegSource,                  src.eg2Source,
+                 src.midiSources.modWheelSource, src.midiSources.velocitySource,
+                 src.rngSources.randoms[0],      src.rngSources.randoms[5],
+                 src.transportSources.phasors[0], src.macroSources.macros[0]};
+    TG targets[]{ep.mappingTarget.pitchOffsetT,    ep.mappingTarget.panT,
+                 ep.mappingTarget.ampT,            ep.mappingTarget.playbackRatioT,
+                 ep.outputTarget.panT,             ep.outputTarget.ampT,
+                 ep.processorTarget[0].mixT,       ep.processorTarget[0].fpT[0],
+                 ep.processorTarget[0].fpT[1],     ep.processorTarget[1].outputLevelDbT,
+                 ep.processorTarget[1].fpT[0],     ep.aeg.aT};
+
+    const auto &curves = modulation::ModulationCurves::allCurves;
+    auto &rt = zone->routingTable;
+    for (size_t i = 0; i < rt.routes.size(); ++i)
+    {
+        auto &row = rt.routes[i];
+        row.active = true;
+        row.source = sources[i % std::size(sources)];
+        row.target = targets[i % std::size(targets)];
+        row.depth = 0.1f + 0.05f * i;
+        if (i % 2)
+        {
+            row.sourceVia = sources[(i + 5) % std::size(sources)];
+            if (!curves.empty())
+                row.curve = curves[i % curves.size()];
+        }
+    }
+
+    // The same order Voice::voiceStarted uses
+    ep.sources.bind(voice->modMatrix, *zone, *voice);
+    voice->modMatrix.prepare(zone->routingTable);
+    ep.bindTargetBaseValues(voice->modMatrix, *zone);
+
+    r.run("mod_matrix", "full_routing", [&]() { voice->modMatrix.process(); });
+
+    voice.reset();
+    part->removeGroup(group->id);
+}
+} // namespace scxt::bench
@@ -0,0 +1,112 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "sample/pcm_convert.h"
+
+namespace scxt::bench
+{
+namespace
+{
+constexpr size_t convertFrames{1 << 16};
+
+const char *levelName(sample::pcm::KernelLevel l)
+{
+    switch (l)
+    {
+    case sample::pcm::KernelLevel::Scalar:
+        return "scalar";
+    case sample::pcm::KernelLevel::SSE2:
+        return "SSE2";
+    case sample::pcm::KernelLevel::AVX2:
+        return "AVX2";
+    }
+    return "unknown";
+}
+
+/*
+ * Converting a 64k frame stretch of stereo file data into sample memory, as a wav or aiff
+ * load does, at each kernel level this machine has. Reported per call, with the source
+ * throughput alongside since the realtime percentage means little for a load.
+ */
+void benchFormat(Runner &r, sample::pcm::Format f, const std::string &name)
+{
+    using namespace sample::pcm;
+
+    auto frameBytes = (size_t)sourceBytes(f) * 2;
+    std::vector<uint8_t> src(convertFrames * frameBytes);
+    std::minstd_rand gen(8675309);
+    for (auto &b : src)
+        b = (uint8_t)gen();
+    if (f == Format::F32 || f == Format::F64)
+    {
+        // Random bytes would be full of NaNs and denormals, which no file has
+        for (size_t i = 0; i < convertFrames * 2; ++i)
+        {
+            if (f == Format::F32)
+                ((float *)src.data())[i] = (float)(gen() % 2001) / 1000.f - 1.f;
+            else
+                ((double *)src.data())[i] = (double)(gen() % 2001) / 1000.0 - 1.0;
+        }
+    }
+
+    auto outBytes = sample::Sample::bitDepthByteSize(targetBitDepth(f));
+    std::vector<uint8_t> dest[2]{std::vector<uint8_t>(convertFrames * outBytes),
+                                 std::vector<uint8_t>(convertFrames * outBytes)};
+    void *out[2]{dest[0].data(), dest[1].data()};
+
+    for (auto level : {KernelLevel::Scalar, KernelLevel::SSE2, KernelLevel::AVX2})
+    {
+        if (level > bestKernelLevel())
+            continue;
+        auto label = "stereo_" + name + "_" + levelName(level);
+        if (!r.wants("pcm", label))
+            continue;
+        r.run("pcm", label, [&]() { convert(f, src.data(), 2, convertFrames, out, level); });
+        std::cout << "pcm         " << label << " converts " << std::fixed << std::setprecision(0)
+                  << src.size() / r.results.back().nsPerBlock * 1e3 << " MB/s" << std::endl;
+    }
+}
+} // namespace
+
+void benchPCMConvert(Runner &r)
+{
+    using sample::pcm::Format;
+    benchFormat(r, Format::I16LE, "I16LE");
+    benchFormat(r, Format::I24LE, "I24LE");
+    benchFormat(r, Format::I24BE, "I24BE");
+    benchFormat(r, Format::I32LE, "I32LE");
+    benchFormat(r, Format::F32, "F32");
+    benchFormat(r, Format::F64, "F64");
+}
+} // namespace scxt::bench
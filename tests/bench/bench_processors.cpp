@@ -0,0 +1,154 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#include "bench.h"
+#include "dsp/processor/processor.h"
+#include "engine/engine.h"
+#include "engine/bus.h"
+
+namespace scxt::bench
+{
+namespace
+{
+// A bright, noisy input so filters and waveshapers aren't idling on silence. Sized for
+// the oversampled block.
+struct TestSignal
+{
+    alignas(16) float L[blockSize << 1], R[blockSize << 1];
+    TestSignal()
+    {
+        std::minstd_rand gen(2112);
+        std::uniform_real_distribution<float> dist(-0.1f, 0.1f);
+        for (int i = 0; i < (blockSize << 1); ++i)
+        {
+            auto saw = 2.f * std::fmod(i * 0.0171f, 1.f) - 1.f;
+            L[i] = 0.5f * saw + dist(gen);
+            R[i] = 0.5f * saw + dist(gen);
+        }
+    }
+};
+
+void benchProcessor(Runner &r, engine::Engine &e, dsp::processor::ProcessorType t,
+                    bool oversample, const TestSignal &in)
+{
+    namespace proc = dsp::processor;
+
+    auto name = std::string(proc::getProcessorStreamingName(t)) + (oversample ? "_2x" : "_1x");
+    if (!r.wants("processor", name))
+        return;
+
+    alignas(16) static uint8_t memory[proc::processorMemoryBufferSize];
+    float fp[maxProcessorFloatParams]{};
+    int ip[maxProcessorIntParams]{};
+    proc::ProcessorStorage ps;
+    ps.type = t;
+    auto *pool = e.getMemoryPool().get();
+
+    // First pass sets up default parameters the way a zone does when a processor is chosen
+    auto *p = proc::spawnProcessorInPlace(t, pool, memory, proc::processorMemoryBufferSize, ps,
+                                          fp, ip, false, true);
+    if (!p)
+        return;
+    p->setSampleRate(e.getSampleRate());
+    p->setTempoPointer(&e.transport.tempo);
+    p->init();
+    ps.isKeytracked = p->getDefaultKeytrack();
+    p->setKeytrack(ps.isKeytracked);
+    p->init_params();
+    if (p->supportsMakingParametersConsistent())
+        p->makeParametersConsistent();
+    proc::unspawnProcessor(p);
+
+    // and the second spawns it as a voice does
+    p = proc::spawnProcessorInPlace(t, pool, memory, proc::processorMemoryBufferSize, ps, fp, ip,
+                                    oversample, false);
+    p->setSampleRate(e.getSampleRate() * (oversample ? 2 : 1));
+    p->setTempoPointer(&e.transport.tempo);
+    p->init();
+    p->setKeytrack(ps.isKeytracked);
+
+    alignas(16) float outL[blockSize << 1], outR[blockSize << 1];
+    auto *inL = const_cast<float *>(in.L);
+    auto *inR = const_cast<float *>(in.R);
+    r.run("processor", name, [&]() { p->process_stereo(inL, inR, outL, outR, 0.f); });
+
+    proc::unspawnProcessor(p);
+}
+} // namespace
+
+void benchProcessors(Runner &r, engine::Engine &e)
+{
+    namespace proc = dsp::processor;
+
+    static TestSignal in;
+    for (int i = proc::proct_none + 1; i < proc::proct_num_types; ++i)
+    {
+        auto t = (proc::ProcessorType)i;
+        if (!proc::isProcessorImplemented(t))
+            continue;
+        benchProcessor(r, e, t, false, in);
+        benchProcessor(r, e, t, true, in);
+    }
+}
+
+void benchBusEffects(Runner &r, engine::Engine &e)
+{
+    alignas(16) float srcL[blockSize], srcR[blockSize], L[blockSize], R[blockSize];
+    for (int i = 0; i < blockSize; ++i)
+    {
+        srcL[i] = 0.5f * std::sin(i * 0.05f);
+        srcR[i] = 0.5f * std::cos(i * 0.031f);
+    }
+
+    for (int i = engine::AvailableBusEffects::none + 1; i <= engine::AvailableBusEffects::bonsai;
+         ++i)
+    {
+        auto t = (engine::AvailableBusEffects)i;
+        auto name = engine::toStringAvailableBusEffects(t);
+        if (!r.wants("bus_effect", name))
+            continue;
+
+        engine::BusEffectStorage storage;
+        auto fx = engine::createEffect(t, &e, &storage);
+        if (!fx)
+            continue;
+        fx->init(true);
+
+        // Bus effects process in place, so each block copies in fresh input; the copy is
+        // noise next to any of these effects
+        r.run("bus_effect", name, [&]() {
+            std::memcpy(L, srcL, sizeof(L));
+            std::memcpy(R, srcR, sizeof(R));
+            fx->process(L, R);
+        });
+    }
+}
+} // namespace scxt::bench
@@ -0,0 +1,120 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "sample/compressed_sample_store.h"
+#include "sample/sample_streamer.h"
+
+namespace scxt::bench
+{
+namespace
+{
+constexpr uint32_t storeFrames{48000 * 10};
+
+// Two decaying partials over a noise floor around -86dB, which is roughly what an
+// instrument sample asks of the predictor. White noise would show the worst case.
+std::vector<uint8_t> makeChannel(sample::Sample::BitDepth bd, int channel)
+{
+    auto bpf = sample::Sample::bitDepthByteSize(bd);
+    auto scale = bd == sample::Sample::BD_I24 ? 8388607.0 : 32767.0;
+    std::vector<uint8_t> res(storeFrames * bpf);
+    std::minstd_rand gen(8675309 + channel);
+    std::uniform_real_distribution<double> noise(-1.0, 1.0);
+    for (uint32_t i = 0; i < storeFrames; ++i)
+    {
+        auto env = std::exp(-(double)i / 96000.0);
+        auto v = env * (0.5 * std::sin(i * 0.031 * (channel + 1)) + 0.2 * std::sin(i * 0.173)) +
+                 0.00005 * noise(gen);
+        auto q = (int32_t)std::lround(v * scale);
+        for (int b = 0; b < bpf; ++b)
+            res[i * bpf + b] = (uint8_t)(q >> (8 * b));
+    }
+    return res;
+}
+
+/*
+ * The cost to one voice of keeping its window topped up, per audio block. The streamer
+ * refills half a window at a time, so each call advances a block and every
+ * half-window's worth of blocks does a fill: a copy from plain PCM, or a decode.
+ */
+void benchStore(Runner &r, sample::Sample::BitDepth bd)
+{
+    static constexpr int64_t half{sample::StreamingVoiceBuffer::windowFrames / 2};
+
+    std::vector<uint8_t> pcm[2]{makeChannel(bd, 0), makeChannel(bd, 1)};
+    const void *data[2]{pcm[0].data(), pcm[1].data()};
+    auto store = sample::CompressedSampleStore::encode(bd, 2, data, 0, storeFrames);
+
+    auto bdName = sample::Sample::bitDepthName(bd);
+    std::cout << "store       " << bdName << " stereo compresses to " << std::fixed
+              << std::setprecision(1)
+              << 100.0 * store->getSizeInBytes() / store->getUncompressedSizeInBytes()
+              << "% of PCM" << std::endl;
+
+    auto bpf = sample::Sample::bitDepthByteSize(bd);
+    std::vector<uint8_t> window[2]{std::vector<uint8_t>(half * bpf),
+                                   std::vector<uint8_t>(half * bpf)};
+    int64_t pos{0}, filledTo{0};
+    auto advance = [&](auto &&fill) {
+        pos += blockSize;
+        if (pos + half > filledTo)
+        {
+            if (filledTo + half > storeFrames)
+                pos = filledTo = 0;
+            for (int c = 0; c < 2; ++c)
+                fill(c, filledTo, window[c].data());
+            filledTo += half;
+        }
+    };
+
+    r.run("store", std::string("stereo_") + bdName + "_PCM_copy", [&]() {
+        advance([&](int c, int64_t from, uint8_t *dest) {
+            memcpy(dest, pcm[c].data() + from * bpf, half * bpf);
+        });
+    });
+    r.run("store", std::string("stereo_") + bdName + "_compressed_decode", [&]() {
+        advance([&](int c, int64_t from, uint8_t *dest) {
+            store->decode(c, from, from + half, dest);
+        });
+    });
+}
+} // namespace
+
+void benchSampleStore(Runner &r)
+{
+    benchStore(r, sample::Sample::BD_I16);
+    benchStore(r, sample::Sample::BD_I24);
+}
+} // namespace scxt::bench
@@ -0,0 +1,149 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+/*
+ * Whole voices: a chord of N voices, each a sample through a filter, rendered through
+ * Engine::processAudio just as a host block is. Voice::process, its processors from the
+ * memory pool, the matrix and the part and bus mixing are all in the number, so this is
+ * what changes to the voice layout should be judged by.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "bench.h"
+#include "engine/engine.h"
+#include "engine/group.h"
+#include "engine/part.h"
+#include "engine/zone.h"
+#include "messaging/messaging.h"
+#include "sst/voicemanager/midi1_to_voicemanager.h"
+
+namespace scxt::bench
+{
+namespace
+{
+static constexpr uint32_t sampleFrames{48000};
+
+// Mono PCM16 of a few partials, looped over its back half by the zones below
+bool writeVoiceWav(const fs::path &p)
+{
+    std::ofstream of(p, std::ios::binary);
+    if (!of.is_open())
+        return false;
+
+    auto u32 = [&of](uint32_t v) { of.write((const char *)&v, 4); };
+    auto u16 = [&of](uint16_t v) { of.write((const char *)&v, 2); };
+    of.write("RIFF", 4);
+    u32(36 + sampleFrames * 2);
+    of.write("WAVEfmt ", 8);
+    u32(16);
+    u16(1);
+    u16(1);
+    u32(48000);
+    u32(48000 * 2);
+    u16(2);
+    u16(16);
+    of.write("data", 4);
+    u32(sampleFrames * 2);
+    for (uint32_t i = 0; i < sampleFrames; ++i)
+    {
+        auto v = 0.4 * std::sin(i * 0.0575) + 0.2 * std::sin(i * 0.173) + 0.1 * std::sin(i * 0.61);
+        u16((uint16_t)(int16_t)(v * 32767));
+    }
+    return of.good();
+}
+
+void allNotes(engine::Engine &e, int keys, bool on)
+{
+    for (int k = 0; k < keys; ++k)
+    {
+        uint8_t msg[3]{(uint8_t)(on ? 0x90 : 0x80), (uint8_t)k, (uint8_t)(on ? 100 : 0)};
+        sst::voicemanager::applyMidi1Message(e.voiceManager, 0, msg);
+    }
+}
+} // namespace
+
+void benchVoices(Runner &r)
+{
+    static constexpr int voiceCounts[]{16, 64, maxVoices};
+    auto nameFor = [](int n) { return "svf_" + std::to_string(n); };
+    bool any{false};
+    for (auto n : voiceCounts)
+        any = any || r.wants("voice", nameFor(n));
+    if (!any)
+        return;
+
+    auto wav = fs::temp_directory_path() / "scxt_bench_voices.wav";
+    if (!writeVoiceWav(wav))
+        return;
+
+    auto engine = makeBenchEngine(r.sampleRate);
+    auto &cont = engine->getMessageController();
+
+    // Two zones over the whole keyboard, so a note on every key starts maxVoices voices
+    for (int i = 0; i < 2; ++i)
+        engine->loadSampleIntoSelectedPartAndGroup(wav, 60, {0, 127});
+    for (int i = 0; i < 16; ++i)
+    {
+        engine->processAudio();
+        cont->runSerializationHousekeeping();
+    }
+    const auto &group = engine->getPatch()->getPart(0)->getGroup(0);
+    for (const auto &z : group->getZones())
+    {
+        auto &v = z->variantData.variants[0];
+        v.loopActive = true;
+        v.startLoop = sampleFrames / 2;
+        v.endLoop = sampleFrames - 1;
+        z->setProcessorType(0, dsp::processor::proct_SuperSVF);
+    }
+
+    for (auto n : voiceCounts)
+    {
+        auto name = nameFor(n);
+        if (!r.wants("voice", name))
+            continue;
+
+        allNotes(*engine, n / 2, true);
+        engine->processAudio();
+        r.run("voice", name, [&]() { engine->processAudio(); });
+
+        allNotes(*engine, n / 2, false);
+        for (int i = 0; i < 48000 && engine->activeVoices > 0; ++i)
+        {
+            engine->processAudio();
+            cont->runSerializationHousekeeping();
+        }
+    }
+
+    engine.reset();
+    fs::remove(wav);
+}
+} // namespace scxt::bench
@@ -0,0 +1,347 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "sample/decoded_sample_cache.h"
+#include "sample/sample.h"
+#include "sample/sample_manager.h"
+#include "infrastructure/md5support.h"
+#include "test_support.h"
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <tuple>
+
+using namespace scxt;
+
+namespace
+{
+constexpr uint32_t frames{4000};
+
+auto fillWith(int seed)
+{
+    return [seed](auto f, auto c) { return (((f + seed) * 7 + c * 3) % 20000) / 32768.0; };
+}
+
+fs::path entryFor(const fs::path &dir, const std::string &md5)
+{
+    return dir / (md5 + "-" + sample::Sample::bitDepthName(sample::Sample::BD_I16) + ".scdc");
+}
+
+void requireSameData(sample::Sample &a, sample::Sample &b)
+{
+    REQUIRE(a.bitDepth == b.bitDepth);
+    REQUIRE(a.channels == b.channels);
+    REQUIRE(a.sample_rate == b.sample_rate);
+    REQUIRE(a.sample_length == b.sample_length);
+    for (int c = 0; c < a.channels; ++c)
+    {
+        auto pa = a.GetSamplePtrI16(c), pb = b.GetSamplePtrI16(c);
+        for (size_t i = 0; i < a.sample_length; ++i)
+        {
+            INFO("channel " << c << " frame " << i);
+            REQUIRE(pa[i] == pb[i]);
+        }
+    }
+}
+
+// What the BrowserDB does, without the database
+struct MapMD5SumCache : infrastructure::MD5SumCache
+{
+    std::map<fs::path, std::tuple<uint64_t, int64_t, std::string>> entries;
+
+    std::optional<std::string> lookupMD5Sum(const fs::path &path, uint64_t size,
+                                            int64_t mtime) override
+    {
+        auto it = entries.find(path);
+        if (it == entries.end() || std::get<0>(it->second) != size ||
+            std::get<1>(it->second) != mtime)
+            return std::nullopt;
+        return std::get<2>(it->second);
+    }
+    void storeMD5Sum(const fs::path &path, uint64_t size, int64_t mtime,
+                     const std::string &md5) override
+    {
+        entries[path] = {size, mtime, md5};
+    }
+};
+} // namespace
+
+TEST_CASE("Decoded Sample Cache Round Trip", "[sample]")
+{
+    test::TempPath dir("scxt_test_decoded_cache");
+    auto cacheDir = dir.path() / "cache";
+    fs::create_directories(dir);
+
+    auto src = dir.path() / "source.wav";
+    test::writeTestWav(src, frames, 2, 16, fillWith(0));
+    sample::Sample decoded;
+    REQUIRE(decoded.load(src));
+    decoded.meta.key_root = 62;
+    decoded.meta.rootkey_present = true;
+    decoded.meta.loop_start = 100;
+    decoded.meta.loop_end = 3000;
+    decoded.meta.loop_present = true;
+    auto md5 = infrastructure::createMD5SumFromFile(src);
+    REQUIRE(!md5.empty());
+
+    sample::DecodedSampleCache cache(cacheDir, 1 << 20);
+    REQUIRE(cache.getCachedBytes() == 0);
+
+    SECTION("A miss is stored through a temp file and a later load maps it")
+    {
+        sample::Sample miss;
+        REQUIRE(!cache.load(md5, miss));
+        REQUIRE(!cache.load("", miss));
+        REQUIRE(!miss.sampleData[0]);
+
+        cache.store(md5, decoded);
+        REQUIRE(fs::exists(entryFor(cacheDir, md5)));
+        REQUIRE(cache.getCachedBytes() == fs::file_size(entryFor(cacheDir, md5)));
+        for (const auto &de : fs::directory_iterator(cacheDir))
+        {
+            INFO(de.path().u8string());
+            REQUIRE(de.path().extension() == ".scdc");
+        }
+
+        sample::Sample hit;
+        REQUIRE(cache.load(md5, hit));
+        REQUIRE(hit.mappedSampleData);
+        auto base = static_cast<uint8_t *>(hit.mappedSampleData->data());
+        auto end = base + hit.mappedSampleData->dataSize();
+        for (int c = 0; c < 2; ++c)
+        {
+            auto p = static_cast<uint8_t *>(hit.sampleData[c]);
+            REQUIRE(p >= base);
+            REQUIRE(p < end);
+        }
+        requireSameData(decoded, hit);
+        REQUIRE(hit.meta.key_root == 62);
+        REQUIRE(hit.meta.rootkey_present);
+        REQUIRE(hit.meta.loop_start == 100);
+        REQUIRE(hit.meta.loop_end == 3000);
+        REQUIRE(hit.meta.loop_present);
+
+        // Storing the same content again doesn't count its bytes twice
+        auto bytes = cache.getCachedBytes();
+        cache.store(md5, decoded);
+        REQUIRE(cache.getCachedBytes() == bytes);
+    }
+
+    SECTION("Entries survive into a new cache over the same directory")
+    {
+        cache.store(md5, decoded);
+        sample::DecodedSampleCache again(cacheDir, 1 << 20);
+        REQUIRE(again.getCachedBytes() == cache.getCachedBytes());
+
+        sample::Sample hit;
+        REQUIRE(again.load(md5, hit));
+        requireSameData(decoded, hit);
+    }
+}
+
+TEST_CASE("Decoded Sample Cache Invalidation", "[sample]")
+{
+    test::TempPath dir("scxt_test_decoded_cache_invalid");
+    auto cacheDir = dir.path() / "cache";
+    fs::create_directories(dir);
+
+    auto src = dir.path() / "source.wav";
+    test::writeTestWav(src, frames, 1, 16, fillWith(0));
+
+    MapMD5SumCache md5Cache;
+    sample::DecodedSampleCache cache(cacheDir, 1 << 20);
+
+    auto md5 = infrastructure::createMD5SumFromFile(src, &md5Cache);
+    sample::Sample decoded;
+    REQUIRE(decoded.load(src));
+    cache.store(md5, decoded);
+    REQUIRE(infrastructure::createMD5SumFromFile(src, &md5Cache) == md5);
+
+    auto rewrite = [&](uint32_t n, int seed) {
+        auto when = fs::last_write_time(src);
+        test::writeTestWav(src, n, 1, 16, fillWith(seed));
+        fs::last_write_time(src, when + std::chrono::seconds(1));
+        auto changed = infrastructure::createMD5SumFromFile(src, &md5Cache);
+        REQUIRE(changed != md5);
+
+        sample::Sample miss;
+        REQUIRE(!cache.load(changed, miss));
+        REQUIRE(!miss.sampleData[0]);
+
+        sample::Sample redecoded;
+        REQUIRE(redecoded.load(src));
+        cache.store(changed, redecoded);
+        sample::Sample hit;
+        REQUIRE(cache.load(changed, hit));
+        requireSameData(redecoded, hit);
+    };
+
+    SECTION("A change of size misses") { rewrite(frames + 100, 0); }
+    SECTION("A change of mtime with the same size misses") { rewrite(frames, 1); }
+}
+
+TEST_CASE("Decoded Sample Cache Rejects Malformed Entries", "[sample]")
+{
+    test::TempPath dir("scxt_test_decoded_cache_malformed");
+    auto cacheDir = dir.path() / "cache";
+    fs::create_directories(dir);
+
+    auto src = dir.path() / "source.wav";
+    test::writeTestWav(src, frames, 2, 16, fillWith(0));
+    sample::Sample decoded;
+    REQUIRE(decoded.load(src));
+    auto md5 = infrastructure::createMD5SumFromFile(src);
+
+    {
+        sample::DecodedSampleCache cache(cacheDir, 1 << 20);
+        cache.store(md5, decoded);
+    }
+    auto entry = entryFor(cacheDir, md5);
+    auto size = fs::file_size(entry);
+
+    auto overwrite = [&](size_t at, const std::string &bytes) {
+        std::fstream f(entry, std::ios::binary | std::ios::in | std::ios::out);
+        f.seekp(at);
+        f.write(bytes.data(), bytes.size());
+    };
+
+    SECTION("Truncated in the data") { fs::resize_file(entry, size - 64); }
+    SECTION("Truncated in the header") { fs::resize_file(entry, 16); }
+    SECTION("Empty") { fs::resize_file(entry, 0); }
+    SECTION("Too long") { fs::resize_file(entry, size + 64); }
+    SECTION("Bad magic") { overwrite(0, "XXXX"); }
+    SECTION("Wrong version") { overwrite(4, std::string("\x7f\0\0\0", 4)); }
+    SECTION("Wrong length in the header")
+    {
+        // sampleLength sits after magic, version, bitDepth, channels and sampleRate
+        overwrite(20, std::string("\x01\0\0\0", 4));
+    }
+
+    // As found on the next run
+    sample::DecodedSampleCache cache(cacheDir, 1 << 20);
+    REQUIRE(cache.getCachedBytes() == fs::file_size(entry));
+
+    sample::Sample s;
+    REQUIRE(!cache.load(md5, s));
+    REQUIRE(!s.sampleData[0]);
+    REQUIRE(!s.sampleData[1]);
+    REQUIRE(!s.mappedSampleData);
+    REQUIRE(!fs::exists(entry));
+    REQUIRE(cache.getCachedBytes() == 0);
+
+    // and the next decode is stored afresh
+    cache.store(md5, decoded);
+    REQUIRE(cache.load(md5, s));
+    requireSameData(decoded, s);
+}
+
+TEST_CASE("Decoded Sample Cache Budget", "[sample]")
+{
+    test::TempPath dir("scxt_test_decoded_cache_budget");
+    auto cacheDir = dir.path() / "cache";
+    fs::create_directories(dir);
+
+    auto src = dir.path() / "source.wav";
+    test::writeTestWav(src, frames, 2, 16, fillWith(0));
+    sample::Sample decoded;
+    REQUIRE(decoded.load(src));
+
+    std::vector<std::string> md5s{std::string(32, 'a'), std::string(32, 'b'),
+                                  std::string(32, 'c')};
+    uint64_t entryBytes{0};
+    {
+        sample::DecodedSampleCache cache(cacheDir, 1 << 20);
+        for (const auto &m : md5s)
+            cache.store(m, decoded);
+        entryBytes = fs::file_size(entryFor(cacheDir, md5s[0]));
+        REQUIRE(cache.getCachedBytes() == 3 * entryBytes);
+    }
+
+    // Age them a before c before b
+    auto now = fs::file_time_type::clock::now();
+    fs::last_write_time(entryFor(cacheDir, md5s[0]), now - std::chrono::seconds(300));
+    fs::last_write_time(entryFor(cacheDir, md5s[1]), now - std::chrono::seconds(100));
+    fs::last_write_time(entryFor(cacheDir, md5s[2]), now - std::chrono::seconds(200));
+
+    auto present = [&]() {
+        std::string res;
+        for (const auto &m : md5s)
+            res += fs::exists(entryFor(cacheDir, m)) ? m[0] : '-';
+        return res;
+    };
+
+    SECTION("Opening over budget evicts oldest first")
+    {
+        sample::DecodedSampleCache cache(cacheDir, 2 * entryBytes - 1);
+        REQUIRE(present() == "-b-");
+        REQUIRE(cache.getCachedBytes() == entryBytes);
+    }
+
+    SECTION("A hit counts as use")
+    {
+        {
+            sample::DecodedSampleCache cache(cacheDir, 1 << 20);
+            sample::Sample hit;
+            REQUIRE(cache.load(md5s[0], hit));
+        }
+        sample::DecodedSampleCache cache(cacheDir, 2 * entryBytes - 1);
+        REQUIRE(present() == "a--");
+    }
+
+    SECTION("Storing past the budget evicts")
+    {
+        sample::DecodedSampleCache cache(cacheDir, 3 * entryBytes + entryBytes / 2);
+        REQUIRE(present() == "abc");
+        cache.store(std::string(32, 'd'), decoded);
+        REQUIRE(present() == "-bc");
+        REQUIRE(fs::exists(entryFor(cacheDir, std::string(32, 'd'))));
+        REQUIRE(cache.getCachedBytes() == 3 * entryBytes);
+    }
+}
+
+TEST_CASE("Decoded Sample Cache Zero Budget", "[sample]")
+{
+    test::TempPath dir("scxt_test_decoded_cache_zero");
+    auto cacheDir = dir.path() / "cache";
+
+    ThreadingChecker tc;
+    sample::SampleManager sm(tc);
+
+    // What the engine does with decodedSampleCacheMB == 0
+    sm.setupDecodedSampleCache(cacheDir, 0);
+    REQUIRE(!sm.decodedCache);
+    REQUIRE(!fs::exists(cacheDir));
+
+    sm.setupDecodedSampleCache(cacheDir, 1 << 20);
+    REQUIRE(sm.decodedCache);
+    REQUIRE(fs::exists(cacheDir));
+
+    sm.setupDecodedSampleCache(cacheDir, 0);
+    REQUIRE(!sm.decodedCache);
+}
@@ -0,0 +1,200 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "engine/engine.h"
+#include "messaging/messaging.h"
+#include "sst/voicemanager/midi1_to_voicemanager.h"
+#include "test_support.h"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+using namespace scxt;
+
+namespace
+{
+static constexpr int noteBlock{4};
+
+/*
+ * Play key once at each possible in-block offset, dispatched in block noteBlock, and hand
+ * check the offset and the main bus left channel from the start of the render. The note is
+ * then released and left to die away, ready for the next offset.
+ */
+void playAtEachOffset(engine::Engine &engine, uint8_t key, int renderBlocks,
+                      const std::function<void()> &afterNoteOn,
+                      const std::function<void(int, const std::vector<float> &)> &check)
+{
+    auto &cont = engine.getMessageController();
+    const auto &main = engine.getPatch()->busses.mainBus.output;
+
+    for (int offset = 0; offset < blockSize; ++offset)
+    {
+        INFO("Offset " << offset);
+        std::vector<float> rendered;
+        for (int b = 0; b < renderBlocks; ++b)
+        {
+            if (b == noteBlock)
+            {
+                uint8_t on[3]{0x90, key, 100};
+                engine.setEventSampleOffset(offset);
+                sst::voicemanager::applyMidi1Message(engine.voiceManager, 0, on);
+                engine.setEventSampleOffset(0);
+                afterNoteOn();
+            }
+            engine.processAudio();
+            rendered.insert(rendered.end(), main[0], main[0] + blockSize);
+        }
+
+        check(offset, rendered);
+
+        uint8_t off[3]{0x80, key, 0};
+        sst::voicemanager::applyMidi1Message(engine.voiceManager, 0, off);
+        for (int i = 0; i < 48000 && engine.activeVoices > 0; ++i)
+        {
+            engine.processAudio();
+            cont->runSerializationHousekeeping();
+        }
+        REQUIRE(engine.activeVoices == 0);
+
+        // and let any effect or filter tails settle to exact silence
+        for (int i = 0; i < 1000; ++i)
+            engine.processAudio();
+    }
+}
+
+// Silent up to the note's frame and sounding from it, or the frame after should the
+// envelope's first value be zero
+void requireStartsAt(int noteFrame, const std::vector<float> &rendered)
+{
+    for (int i = 0; i < noteFrame; ++i)
+        REQUIRE(rendered[i] == 0.f);
+    REQUIRE((rendered[noteFrame] != 0.f || rendered[noteFrame + 1] != 0.f));
+}
+
+// A second of mono PCM16 DC, so a voice is non zero from its first frame
+void writeDCWav(const fs::path &p)
+{
+    test::writeTestWav(p, 48000, 1, 16, [](auto, auto) { return 0.5; });
+}
+
+void settle(engine::Engine &engine)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        engine.processAudio();
+        engine.getMessageController()->runSerializationHousekeeping();
+    }
+}
+} // namespace
+
+/*
+ * An offline render in the style of scxt-render: this thread plays every role, so the
+ * result is exact. A note dispatched with each possible in-block offset must be silent up
+ * to its frame and sounding from it, where without offsets it would start on the block grid.
+ */
+TEST_CASE("Sample Accurate Note Starts", "[engine]")
+{
+    test::TempPath p("scxt_test_event_timing.wav");
+    writeDCWav(p);
+
+    auto engine = test::makeOfflineEngine();
+    engine->loadSampleIntoSelectedPartAndGroup(p);
+    settle(*engine);
+
+    SECTION("At The Root Key")
+    {
+        playAtEachOffset(*engine, 60, 8, [] {}, [](int offset, const auto &rendered) {
+            requireStartsAt(noteBlock * blockSize + offset, rendered);
+        });
+    }
+
+    SECTION("With A Rate Switch In The First Block")
+    {
+        // A semitone up starts the generator at base rate. A full bend, arriving after the
+        // note on with twelve semitones of range, pushes it over the oversampling threshold
+        // by the voice's first block.
+        auto &part = engine->getPatch()->getPart(0);
+        part->getGroup(0)->getZone(0)->mapping.pbUp = 12;
+
+        playAtEachOffset(
+            *engine, 61, 8,
+            [&engine, &part]() {
+                part->pitchBendSmoother.setImmediateValue(0.f);
+                uint8_t bend[3]{0xE0, 0x7F, 0x7F};
+                sst::voicemanager::applyMidi1Message(engine->voiceManager, 0, bend);
+            },
+            [](int offset, const auto &rendered) {
+                requireStartsAt(noteBlock * blockSize + offset, rendered);
+            });
+    }
+
+    engine.reset();
+}
+
+TEST_CASE("Sample Accurate Streamed Note Starts", "[engine]")
+{
+    test::TempPath p("scxt_test_event_timing_streamed.wav");
+    writeDCWav(p);
+
+    auto engine = test::makeOfflineEngine();
+    engine->getSampleManager()->setStreamingPreloadFrames(8192);
+    engine->loadSampleIntoSelectedPartAndGroup(p);
+    settle(*engine);
+
+    auto &zone = engine->getPatch()->getPart(0)->getGroup(0)->getZone(0);
+    REQUIRE(zone->samplePointers[0]->isStreamed());
+
+    SECTION("Starting In The Resident Head")
+    {
+        playAtEachOffset(*engine, 60, 8, [] {}, [](int offset, const auto &rendered) {
+            requireStartsAt(noteBlock * blockSize + offset, rendered);
+        });
+    }
+
+    SECTION("Starting Past The Resident Head")
+    {
+        // The voice may have to wait blocks on the reader thread, but it still starts at
+        // its offset in whichever block it first sounds in
+        zone->variantData.variants[0].startSample = 30000;
+
+        static constexpr int renderBlocks{400};
+        playAtEachOffset(*engine, 60, renderBlocks, [] {}, [](int offset, const auto &rendered) {
+            auto noteFrame = noteBlock * blockSize + offset;
+            auto first = std::find_if(rendered.begin(), rendered.end(),
+                                      [](auto f) { return f != 0.f; }) -
+                         rendered.begin();
+            REQUIRE(first >= noteFrame);
+            REQUIRE(first < (int)rendered.size());
+            auto into = (first - noteFrame) % blockSize;
+            REQUIRE((into == 0 || into == 1));
+        });
+    }
+
+    engine.reset();
+}
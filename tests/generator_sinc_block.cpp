@@ -0,0 +1,173 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "dsp/generator.h"
+#include "dsp/data_tables.h"
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace scxt;
+
+namespace
+{
+constexpr int waveSize{6000};
+
+template <typename T> struct PaddedSample
+{
+    // FIRoffset zeros either side, as the generator expects
+    std::vector<T> l, r;
+    PaddedSample(uint32_t seed)
+    {
+        std::minstd_rand gen(seed);
+        std::uniform_real_distribution<float> dist(-1.f, 1.f);
+        l.resize(waveSize + 2 * dsp::FIRoffset, 0);
+        r.resize(waveSize + 2 * dsp::FIRoffset, 0);
+        for (int i = 0; i < waveSize; ++i)
+        {
+            if constexpr (std::is_same_v<T, float>)
+            {
+                l[i + dsp::FIRoffset] = dist(gen);
+                r[i + dsp::FIRoffset] = dist(gen);
+            }
+            else
+            {
+                l[i + dsp::FIRoffset] = (int16_t)(dist(gen) * 32000);
+                r[i + dsp::FIRoffset] = (int16_t)(dist(gen) * 32000);
+            }
+        }
+    }
+};
+
+// Loop mode 0 is no loop, 1 forward, 2 bidirectional. The loop runs to the end of the
+// sample with a crossfade so the fade and loop end paths are crossed too.
+template <typename T>
+std::vector<float> render(const PaddedSample<T> &s, dsp::SincKernelLevel level, bool stereo,
+                          int loopMode, float ratio)
+{
+    dsp::GeneratorState gd;
+    gd.direction = 1;
+    gd.directionAtOutset = 1;
+    gd.ratio = (int32_t)(ratio * (1 << 24));
+    gd.isFinished = false;
+    gd.playbackLowerBound = 0;
+    gd.playbackUpperBound = waveSize - 1;
+    gd.loopLowerBound = 1000;
+    gd.loopUpperBound = waveSize - 1;
+    gd.loopInvertedBounds = 1.f / (gd.loopUpperBound - gd.loopLowerBound);
+    gd.loopFade = 300;
+    gd.interpolationType = dsp::InterpolationTypes::Sinc;
+
+    float outL[blockSize], outR[blockSize];
+    dsp::GeneratorIO io;
+    io.outputL = outL;
+    io.outputR = outR;
+    io.sampleDataL = (void *)(s.l.data() + dsp::FIRoffset);
+    io.sampleDataR = (void *)(s.r.data() + dsp::FIRoffset);
+    io.waveSize = waveSize;
+
+    auto gen = dsp::GetFPtrGeneratorSample(stereo, std::is_same_v<T, float>, loopMode > 0,
+                                           loopMode != 2, false, level);
+    std::vector<float> res;
+    for (int b = 0; b < 2 * waveSize / blockSize; ++b)
+    {
+        gen(&gd, &io);
+        for (int i = 0; i < blockSize; ++i)
+        {
+            res.push_back(outL[i]);
+            if (stereo)
+                res.push_back(outR[i]);
+        }
+    }
+    return res;
+}
+
+template <typename T> void compareLevel(dsp::SincKernelLevel level, bool exact)
+{
+    PaddedSample<T> s(2112);
+    for (auto ratio : {1.f, 1.37f, 0.61f})
+    {
+        for (auto stereo : {false, true})
+        {
+            for (auto loopMode : {0, 1, 2})
+            {
+                INFO("ratio=" << ratio << " stereo=" << stereo << " loopMode=" << loopMode);
+                auto ref = render(s, dsp::SincKernelLevel::PerSample, stereo, loopMode, ratio);
+                auto blk = render(s, level, stereo, loopMode, ratio);
+                REQUIRE(ref.size() == blk.size());
+
+                int mismatches{0};
+                float maxDiff{0.f};
+                for (size_t k = 0; k < ref.size(); ++k)
+                {
+                    mismatches += ref[k] != blk[k];
+                    maxDiff = std::max(maxDiff, std::fabs(ref[k] - blk[k]));
+                }
+                if (exact)
+                    REQUIRE(mismatches == 0);
+                else
+                    REQUIRE(maxDiff < 1e-5f);
+            }
+        }
+    }
+}
+} // namespace
+
+TEST_CASE("Block Sinc Kernels", "[generator]")
+{
+    dsp::sincTable.init();
+    auto fastest = dsp::fastestSincKernelLevel();
+
+    SECTION("The Default Level Is Bit Identical")
+    {
+        REQUIRE(dsp::bestSincKernelLevel() <= dsp::SincKernelLevel::AVX2);
+        REQUIRE(dsp::bestSincKernelLevel() <= fastest);
+    }
+
+    SECTION("SSE2 Matches Per Sample")
+    {
+        compareLevel<float>(dsp::SincKernelLevel::SSE2, true);
+        compareLevel<int16_t>(dsp::SincKernelLevel::SSE2, true);
+    }
+
+    SECTION("AVX2 Matches Per Sample")
+    {
+        if (fastest < dsp::SincKernelLevel::AVX2)
+            return;
+        compareLevel<float>(dsp::SincKernelLevel::AVX2, true);
+        compareLevel<int16_t>(dsp::SincKernelLevel::AVX2, true);
+    }
+
+    SECTION("AVX2 FMA Is Within Rounding")
+    {
+        if (fastest < dsp::SincKernelLevel::AVX2FMA)
+            return;
+        compareLevel<float>(dsp::SincKernelLevel::AVX2FMA, false);
+        compareLevel<int16_t>(dsp::SincKernelLevel::AVX2FMA, true);
+    }
+}
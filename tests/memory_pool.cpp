@@ -0,0 +1,150 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "engine/memory_pool.h"
+#include "configuration.h"
+#include <thread>
+#include <vector>
+
+using namespace scxt;
+
+TEST_CASE("Memory Pool Size Classes", "[memory]")
+{
+    SECTION("Pre-reserved class serves checkouts without misses")
+    {
+        engine::MemoryPool pool;
+        pool.preReservePool(4000);
+        REQUIRE(pool.getSizeClassCount() == 1);
+
+        auto st = pool.getSizeClassStats(0);
+        REQUIRE(st.blockSize >= 4000);
+        REQUIRE(st.capacity == engine::MemoryPool::initialPoolSize);
+        REQUIRE(st.available == (int32_t)engine::MemoryPool::initialPoolSize);
+
+        std::vector<uint8_t *> blocks;
+        for (auto i = 0U; i < engine::MemoryPool::initialPoolSize; ++i)
+        {
+            auto b = pool.checkoutBlock(4000);
+            REQUIRE(b);
+            b[0] = 1;
+            b[3999] = 2;
+            blocks.push_back(b);
+        }
+        REQUIRE(pool.getTotalMisses() == 0);
+        REQUIRE(pool.getSizeClassStats(0).available == 0);
+        REQUIRE(pool.isRefillRequested());
+
+        for (auto b : blocks)
+            pool.returnBlock(b, 4000);
+        REQUIRE(pool.getSizeClassStats(0).available ==
+                (int32_t)engine::MemoryPool::initialPoolSize);
+    }
+
+    SECTION("Reserving more blocks grows an existing class")
+    {
+        engine::MemoryPool pool;
+        pool.preReservePool(3000);
+        pool.preReservePool(3000, maxVoices);
+        REQUIRE(pool.getSizeClassStats(0).capacity == maxVoices);
+
+        // and asking for fewer than it has leaves it be
+        pool.preReservePool(3000, 8);
+        REQUIRE(pool.getSizeClassStats(0).capacity == maxVoices);
+
+        std::vector<uint8_t *> blocks;
+        for (auto i = 0U; i < maxVoices; ++i)
+            blocks.push_back(pool.checkoutBlock(3000));
+        REQUIRE(pool.getTotalMisses() == 0);
+        for (auto b : blocks)
+            pool.returnBlock(b, 3000);
+    }
+
+    SECTION("Sizes round into shared classes")
+    {
+        engine::MemoryPool pool;
+        pool.preReservePool(100);
+        pool.preReservePool(200);
+        pool.preReservePool(5000);
+        REQUIRE(pool.getSizeClassCount() == 2);
+    }
+
+    SECTION("Empty class misses then refill restores headroom")
+    {
+        engine::MemoryPool pool;
+        pool.preReservePool(2048);
+
+        std::vector<uint8_t *> blocks;
+        for (auto i = 0U; i < engine::MemoryPool::initialPoolSize + 3; ++i)
+            blocks.push_back(pool.checkoutBlock(2048));
+        REQUIRE(pool.getTotalMisses() == 3);
+        REQUIRE(pool.getSizeClassStats(0).misses == 3);
+
+        REQUIRE(pool.takeRefillRequest());
+        REQUIRE(!pool.isRefillRequested());
+        pool.refill();
+        REQUIRE(pool.getSizeClassStats(0).available >= engine::MemoryPool::lowWaterMark);
+
+        for (auto b : blocks)
+            pool.returnBlock(b, 2048);
+        auto st = pool.getSizeClassStats(0);
+        REQUIRE(st.available == (int32_t)st.capacity);
+
+        blocks.clear();
+        for (auto i = 0U; i < engine::MemoryPool::initialPoolSize + 3; ++i)
+            blocks.push_back(pool.checkoutBlock(2048));
+        REQUIRE(pool.getTotalMisses() == 3);
+        for (auto b : blocks)
+            pool.returnBlock(b, 2048);
+    }
+
+    SECTION("Concurrent checkout and return keep the free list intact")
+    {
+        engine::MemoryPool pool;
+        pool.preReservePool(1024);
+        pool.refill();
+
+        auto worker = [&pool]() {
+            for (int i = 0; i < 20000; ++i)
+            {
+                auto a = pool.checkoutBlock(1024);
+                auto b = pool.checkoutBlock(1024);
+                a[0] = (uint8_t)i;
+                b[0] = (uint8_t)i;
+                pool.returnBlock(a, 1024);
+                pool.returnBlock(b, 1024);
+            }
+        };
+        std::thread t1(worker), t2(worker);
+        t1.join();
+        t2.join();
+
+        auto st = pool.getSizeClassStats(0);
+        REQUIRE(st.available == (int32_t)st.capacity);
+        REQUIRE(st.checkouts == 80000);
+    }
+}
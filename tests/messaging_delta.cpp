@@ -0,0 +1,261 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "messaging/messaging.h"
+#include "json/engine_traits.h"
+#include "json/selection_traits.h"
+#include <chrono>
+#include <iostream>
+
+using namespace scxt;
+namespace cmsg = scxt::messaging::client;
+using cmsg::detail::client_message_value;
+
+namespace
+{
+client_message_value decode(const std::string &s)
+{
+    using namespace tao::json;
+    events::transformer<events::to_basic_value<cmsg::detail::client_message_traits>> consumer;
+    cmsg::encoder::events::from_string(consumer, s);
+    return std::move(consumer.value);
+}
+
+// Encode both ends as the wire would, then rebuild 'to' on the decoded 'from'
+bool roundTrips(const client_message_value &from, const client_message_value &to)
+{
+    auto patch = cmsg::detail::makeDelta(from, to);
+    auto base = decode(cmsg::encoder::to_string(from));
+    if (!cmsg::detail::applyDelta(base, decode(cmsg::encoder::to_string(patch))))
+        return false;
+    return cmsg::encoder::to_string(base) == cmsg::encoder::to_string(to);
+}
+
+client_message_value arrayOf(std::initializer_list<int> l)
+{
+    client_message_value res = tao::json::empty_array;
+    for (auto i : l)
+        res.get_array().emplace_back(i);
+    return res;
+}
+
+struct TwoThousandZones
+{
+    engine::Engine::pgzStructure_t structure;
+    engine::Part::zoneMappingSummary_t summary;
+
+    TwoThousandZones()
+    {
+        for (int g = 0; g < 20; ++g)
+        {
+            structure.emplace_back(selection::SelectionManager::ZoneAddress(0, g, -1),
+                                   "Group " + std::to_string(g));
+            for (int z = 0; z < 100; ++z)
+            {
+                auto addr = selection::SelectionManager::ZoneAddress(0, g, z);
+                auto nm = "Piano_" + std::to_string(g) + "_" + std::to_string(z) + ".wav";
+                structure.emplace_back(addr, nm);
+
+                engine::KeyboardRange kr(20 + z, 20 + z);
+                engine::VelocityRange vr(g * 6, g * 6 + 5);
+                summary.emplace_back(addr, engine::Part::zoneMappingItem_t{kr, vr, nm});
+            }
+        }
+    }
+};
+} // namespace
+
+TEST_CASE("Client Message Deltas", "[messaging]")
+{
+    SECTION("Unchanged values produce an unchanged patch")
+    {
+        client_message_value a = {{"name", "zone"}, {"keys", arrayOf({1, 2, 3})}};
+        auto patch = cmsg::detail::makeDelta(a, a);
+        REQUIRE(patch.get_array().size() == 1);
+        REQUIRE(patch.get_array()[0].as<int64_t>() == cmsg::detail::delta_unchanged);
+        REQUIRE(roundTrips(a, a));
+    }
+
+    SECTION("Object members are patched, added and removed")
+    {
+        client_message_value a = {{"a", 1}, {"b", "two"}, {"c", 3.0}, {"d", false}, {"e", 5}};
+        client_message_value b = {{"a", 1}, {"b", "three"}, {"c", 3.0}, {"d", false}, {"f", 6}};
+        auto patch = cmsg::detail::makeDelta(a, b);
+        REQUIRE(patch.get_array()[0].as<int64_t>() == cmsg::detail::delta_object);
+        REQUIRE(roundTrips(a, b));
+    }
+
+    SECTION("Arrays grow, shrink and patch in place")
+    {
+        auto a = arrayOf({1, 2, 3, 4, 5, 6, 7, 8});
+        REQUIRE(roundTrips(a, arrayOf({1, 2, 3, 4, 5, 6, 7, 9})));
+        REQUIRE(roundTrips(a, arrayOf({1, 2, 3, 4, 5, 6, 7, 8, 9})));
+        REQUIRE(roundTrips(a, arrayOf({1, 2, 3, 4, 5, 6, 7})));
+        REQUIRE(roundTrips(a, arrayOf({9, 8, 7, 6, 5, 4, 3, 2})));
+    }
+
+    SECTION("Nested structures and type changes")
+    {
+        client_message_value a = {{"zone", {{"keys", arrayOf({60, 72})}, {"name", "x"}}},
+                                  {"other", 1}};
+        client_message_value b = {{"zone", {{"keys", arrayOf({60, 73})}, {"name", "x"}}},
+                                  {"other", "now a string"}};
+        REQUIRE(roundTrips(a, b));
+        REQUIRE(roundTrips(b, a));
+        REQUIRE(roundTrips(a, arrayOf({1})));
+    }
+
+    SECTION("A patch against the wrong baseline is rejected")
+    {
+        client_message_value a = {{"a", 1}, {"b", 2}, {"c", 3}};
+        client_message_value b = {{"a", 1}, {"b", 2}, {"c", 4}};
+        auto patch = cmsg::detail::makeDelta(a, b);
+        auto wrong = arrayOf({1, 2, 3});
+        REQUIRE(!cmsg::detail::applyDelta(wrong, patch));
+    }
+
+    SECTION("Zone structure edits make small deltas")
+    {
+        TwoThousandZones a;
+        auto b = a;
+        b.structure[1234].second = "Renamed.wav";
+        std::get<0>(b.summary[1000].second).keyEnd += 2;
+
+        client_message_value sa = a.structure, sb = b.structure;
+        client_message_value ma = a.summary, mb = b.summary;
+        REQUIRE(roundTrips(sa, sb));
+        REQUIRE(roundTrips(ma, mb));
+
+        auto full = cmsg::encoder::to_string(sb);
+        auto delta = cmsg::encoder::to_string(cmsg::detail::makeDelta(sa, sb));
+        REQUIRE(delta.size() * 100 < full.size());
+    }
+}
+
+TEST_CASE("Client Message Delta Resync", "[messaging]")
+{
+    auto engine = std::make_unique<engine::Engine>();
+    auto &mc = *engine->getMessageController();
+    mc.stop();
+    mc.deltaEncodeClientMessages = true;
+
+    TwoThousandZones a;
+    auto sid = cmsg::s2c_send_pgz_structure;
+    REQUIRE(cmsg::deltaEncodeSerializationMessage(sid));
+
+    auto receive = [&](const std::string &wire) {
+        auto jv = decode(wire);
+        auto ok = cmsg::detail::resolveSerializationDelta(sid, jv, mc);
+        return std::make_pair(ok, jv);
+    };
+    auto rename = [&](int which, const std::string &nm) {
+        a.structure[which].second = nm;
+        return cmsg::detail::encodeSerializationToClient(sid, a.structure, mc);
+    };
+
+    // The first message is whole, the next ones deltas against it
+    auto first = receive(cmsg::detail::encodeSerializationToClient(sid, a.structure, mc));
+    REQUIRE(first.first);
+    auto second = rename(10, "Second.wav");
+    REQUIRE(decode(second).get_object().count("delta") == 1);
+    REQUIRE(receive(second).first);
+
+    // Lose one delta on the way, so the one after it no longer applies and is dropped
+    rename(20, "Lost.wav");
+    auto afterLoss = receive(rename(30, "AfterLoss.wav"));
+    REQUIRE(!afterLoss.first);
+    REQUIRE(!mc.clientDeltaBaselines->values[sid].has_value());
+
+    // ...which asked the serialization side to forget its baseline, so the next is whole
+    cmsg::doResyncSerializationMessage((int32_t)sid, mc);
+    auto recovered = receive(rename(40, "Recovered.wav"));
+    REQUIRE(recovered.first);
+    REQUIRE(recovered.second.get_object().count("delta") == 0);
+    client_message_value expected = a.structure;
+    REQUIRE(cmsg::encoder::to_string(recovered.second.at("object")) ==
+            cmsg::encoder::to_string(expected));
+
+    // and we are back to deltas
+    auto next = rename(50, "Next.wav");
+    REQUIRE(decode(next).get_object().count("delta") == 1);
+    REQUIRE(receive(next).first);
+}
+
+/*
+ * Not run by default; use scxt-test "[benchmark]". Compares what a 2000 zone part costs
+ * to send as JSON text, as full msgpack (the default wire format) and as a msgpack delta
+ * after a one zone edit, including the client side decode.
+ */
+TEST_CASE("Client Message Delta Benchmark", "[.][benchmark]")
+{
+    TwoThousandZones a;
+    auto b = a;
+    b.structure[1234].second = "Renamed.wav";
+    std::get<0>(b.summary[1000].second).keyEnd += 2;
+
+    client_message_value sa = a.summary, sb = b.summary;
+
+    static constexpr int iterations{50};
+    auto time = [](auto &&f) {
+        auto st = std::chrono::high_resolution_clock::now();
+        size_t bytes{0};
+        for (int i = 0; i < iterations; ++i)
+            bytes = f();
+        auto en = std::chrono::high_resolution_clock::now();
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(en - st).count();
+        return std::make_pair(bytes, us / iterations);
+    };
+
+    auto json = time([&]() {
+        client_message_value v = b.summary;
+        auto s = tao::json::to_string(v);
+        auto d = tao::json::from_string(s);
+        return s.size();
+    });
+    auto msgpack = time([&]() {
+        client_message_value v = b.summary;
+        auto s = cmsg::encoder::to_string(v);
+        auto d = decode(s);
+        return s.size();
+    });
+    auto delta = time([&]() {
+        client_message_value v = b.summary;
+        auto s = cmsg::encoder::to_string(cmsg::detail::makeDelta(sa, v));
+        auto base = sa;
+        cmsg::detail::applyDelta(base, decode(s));
+        return s.size();
+    });
+
+    std::cout << "2000 zone mapping summary, one zone edited; bytes / us per send+receive\n"
+              << "  json    : " << json.first << " / " << json.second << "\n"
+              << "  msgpack : " << msgpack.first << " / " << msgpack.second << "\n"
+              << "  delta   : " << delta.first << " / " << delta.second << std::endl;
+
+    REQUIRE(delta.first < msgpack.first);
+    REQUIRE(msgpack.first < json.first);
+}
@@ -0,0 +1,172 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "engine/engine.h"
+#include "engine/part_render_pool.h"
+#include "messaging/messaging.h"
+#include "sst/voicemanager/midi1_to_voicemanager.h"
+#include "test_support.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <vector>
+
+using namespace scxt;
+
+namespace
+{
+static constexpr int partsInUse{4};
+
+/*
+ * An offline engine with a zone over the whole keyboard in each of the first partsInUse
+ * parts, each its own wav. Parts 2 and 3 are one shots, so their voices end by themselves
+ * part way through a render.
+ */
+std::unique_ptr<engine::Engine> makeMultiPartEngine(const std::vector<fs::path> &wavs, int workers)
+{
+    auto engine = test::makeOfflineEngine();
+    auto &sm = *engine->getSampleManager();
+    for (int p = 0; p < partsInUse; ++p)
+    {
+        auto sid = sm.loadSampleByPath(wavs[p]);
+        REQUIRE(sid.has_value());
+
+        auto z = std::make_unique<engine::Zone>(*sid);
+        z->mapping.keyboardRange = engine::KeyboardRange(0, 127);
+        z->mapping.velocityRange = engine::VelocityRange(0, 127);
+        z->mapping.rootKey = 60;
+        z->attachToSample(sm);
+        if (p >= 2)
+            z->variantData.variants[0].playMode = engine::Zone::ONE_SHOT;
+
+        const auto &part = engine->getPatch()->getPart(p);
+        part->guaranteeGroupCount(1);
+        part->getGroup(0)->addZone(std::move(z));
+    }
+
+    engine->getPartRenderPool()->start(workers);
+    for (int i = 0; i < 8; ++i)
+    {
+        engine->processAudio();
+        engine->getMessageController()->runSerializationHousekeeping();
+    }
+    return engine;
+}
+} // namespace
+
+/*
+ * The pool only changes which thread renders a part, so a patch rendered with workers must
+ * match the same patch rendered on the audio thread alone sample for sample, on every part
+ * bus and the main bus, including as voices end on the workers and their cleanup waits for
+ * the audio thread (Part::deferVoiceCleanup).
+ */
+TEST_CASE("Part Render Pool Matches Serial Rendering", "[engine]")
+{
+    std::deque<test::TempPath> temps;
+    std::vector<fs::path> wavs;
+    for (int p = 0; p < partsInUse; ++p)
+    {
+        temps.emplace_back("scxt_test_part_render_pool_" + std::to_string(p) + ".wav");
+        wavs.push_back(temps.back().path());
+        auto hz = 110.0 * (p + 2);
+        test::writeTestWav(wavs.back(), 6000 - p * 1000, 2, 16, [hz](auto i, auto c) {
+            return 0.3 * std::sin(2.0 * M_PI * hz * i / 48000.0 + c);
+        });
+    }
+
+    auto serial = makeMultiPartEngine(wavs, 0);
+    auto pooled = makeMultiPartEngine(wavs, 3);
+    REQUIRE(serial->getPartRenderPool()->getWorkerCount() == 0);
+    REQUIRE(pooled->getPartRenderPool()->getWorkerCount() == 3);
+
+    auto send = [&](uint8_t status, uint8_t key) {
+        uint8_t msg[3]{status, key, (uint8_t)(status == 0x90 ? 100 : 0)};
+        for (auto *e : {serial.get(), pooled.get()})
+            sst::voicemanager::applyMidi1Message(e->voiceManager, 0, msg);
+    };
+
+    auto sameBus = [](const engine::Bus &a, const engine::Bus &b) {
+        return std::equal(a.output[0], a.output[0] + blockSize, b.output[0]) &&
+               std::equal(a.output[1], a.output[1] + blockSize, b.output[1]);
+    };
+
+    int mismatchedBlocks{0}, peakVoices{0};
+    bool partsSounded[partsInUse]{};
+    for (int b = 0; b < 3000; ++b)
+    {
+        // A chord, a note while it still sounds, then the releases
+        if (b == 2)
+        {
+            for (auto k : {60, 64, 67})
+                send(0x90, k);
+        }
+        if (b == 40)
+            send(0x90, 72);
+        if (b == 150)
+        {
+            for (auto k : {60, 64})
+                send(0x80, k);
+        }
+        if (b == 300)
+        {
+            for (auto k : {67, 72})
+                send(0x80, k);
+        }
+
+        for (auto *e : {serial.get(), pooled.get()})
+        {
+            e->processAudio();
+            e->getMessageController()->runSerializationHousekeeping();
+        }
+
+        const auto &sb = serial->getPatch()->busses, &pb = pooled->getPatch()->busses;
+        auto same = sameBus(sb.mainBus, pb.mainBus);
+        for (int p = 0; p < partsInUse; ++p)
+        {
+            same = same && sameBus(sb.partBusses[p], pb.partBusses[p]);
+            partsSounded[p] = partsSounded[p] || sb.partBusses[p].output[0][0] != 0.f;
+        }
+        if (!same && mismatchedBlocks++ == 0)
+            UNSCOPED_INFO("First mismatch in block " << b);
+
+        REQUIRE(serial->activeVoices == pooled->activeVoices);
+        peakVoices = std::max(peakVoices, (int)serial->activeVoices);
+        if (b > 300 && serial->activeVoices == 0)
+            break;
+    }
+
+    REQUIRE(mismatchedBlocks == 0);
+    REQUIRE(peakVoices == 4 * partsInUse);
+    for (auto s : partsSounded)
+        REQUIRE(s);
+    REQUIRE(pooled->activeVoices == 0);
+
+    pooled.reset();
+    serial.reset();
+}
@@ -0,0 +1,196 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "sample/pcm_convert.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace scxt;
+using namespace scxt::sample;
+
+namespace
+{
+const pcm::Format allFormats[]{pcm::Format::U8,    pcm::Format::I8,    pcm::Format::I16LE,
+                               pcm::Format::I16BE, pcm::Format::I24LE, pcm::Format::I24BE,
+                               pcm::Format::I32LE, pcm::Format::I32BE, pcm::Format::F32,
+                               pcm::Format::F64};
+
+// Random bytes for the integer formats; finite values in -2..2 for the float ones
+std::vector<uint8_t> makeSource(pcm::Format f, size_t values, uint32_t seed)
+{
+    std::vector<uint8_t> res(values * pcm::sourceBytes(f));
+    std::mt19937 gen(seed);
+    if (f == pcm::Format::F32 || f == pcm::Format::F64)
+    {
+        std::uniform_real_distribution<double> dist(-2.0, 2.0);
+        for (size_t i = 0; i < values; ++i)
+        {
+            auto d = dist(gen);
+            if (f == pcm::Format::F32)
+            {
+                auto v = (float)d;
+                memcpy(res.data() + i * 4, &v, 4);
+            }
+            else
+            {
+                memcpy(res.data() + i * 8, &d, 8);
+            }
+        }
+    }
+    else
+    {
+        std::uniform_int_distribution<int> dist(0, 255);
+        for (auto &b : res)
+            b = (uint8_t)dist(gen);
+    }
+    return res;
+}
+
+struct Converted
+{
+    std::vector<uint8_t> data[2];
+    void *out[2]{nullptr, nullptr};
+    Converted(pcm::Format f, size_t frames)
+    {
+        for (int c = 0; c < 2; ++c)
+        {
+            // Stray writes past the frames would show up in the trailing guard bytes
+            data[c].resize(frames * Sample::bitDepthByteSize(pcm::targetBitDepth(f)) + 16, 0xaa);
+            out[c] = data[c].data();
+        }
+    }
+};
+} // namespace
+
+TEST_CASE("PCM Conversion Kernels", "[sample]")
+{
+    for (auto f : allFormats)
+    {
+        for (int channels = 1; channels <= 2; ++channels)
+        {
+            for (size_t frames : {0, 1, 3, 17, 64, 1000, 4099})
+            {
+                INFO("format " << (int)f << " channels " << channels << " frames " << frames);
+                auto src = makeSource(f, frames * channels, 2112 + frames);
+
+                Converted ref(f, frames);
+                pcm::convert(f, src.data(), channels, frames, ref.out, pcm::KernelLevel::Scalar);
+
+                for (auto level : {pcm::KernelLevel::SSE2, pcm::KernelLevel::AVX2})
+                {
+                    if (level > pcm::bestKernelLevel())
+                        continue;
+                    INFO("level " << (int)level);
+                    Converted res(f, frames);
+                    pcm::convert(f, src.data(), channels, frames, res.out, level);
+                    for (int c = 0; c < channels; ++c)
+                        REQUIRE(res.data[c] == ref.data[c]);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("PCM Conversion Matches The Channel Loaders", "[sample]")
+{
+    static constexpr unsigned int frames{777};
+    using loadFn_t = bool (Sample::*)(int, void *, unsigned int, unsigned int);
+    std::vector<std::pair<pcm::Format, loadFn_t>> loaders{
+        {pcm::Format::U8, &Sample::load_data_ui8},
+        {pcm::Format::I8, &Sample::load_data_i8},
+        {pcm::Format::I16LE, &Sample::load_data_i16},
+        {pcm::Format::I16BE, &Sample::load_data_i16BE},
+        {pcm::Format::I24LE, &Sample::load_data_i24},
+        {pcm::Format::I24BE, &Sample::load_data_i24BE},
+        {pcm::Format::I32LE, &Sample::load_data_i32},
+        {pcm::Format::I32BE, &Sample::load_data_i32BE},
+        {pcm::Format::F32, &Sample::load_data_f32},
+        {pcm::Format::F64, &Sample::load_data_f64}};
+    auto framesOf = [](Sample &s, int c) -> const void * {
+        switch (s.bitDepth)
+        {
+        case Sample::BD_I16:
+            return s.GetSamplePtrI16(c);
+        case Sample::BD_I24:
+            return s.GetSamplePtrI24(c);
+        case Sample::BD_F32:
+            return s.GetSamplePtrF32(c);
+        }
+        return nullptr;
+    };
+
+    for (const auto &[f, loadFn] : loaders)
+    {
+        for (int channels = 1; channels <= 2; ++channels)
+        {
+            INFO("format " << (int)f << " channels " << channels);
+            auto src = makeSource(f, frames * channels, 8675309);
+            auto vb = pcm::sourceBytes(f);
+
+            Sample byChannel, interleaved;
+            for (int c = 0; c < channels; ++c)
+                (byChannel.*loadFn)(c, src.data() + c * vb, frames, vb * channels);
+            REQUIRE(interleaved.load_data_interleaved(f, channels, src.data(), frames));
+            REQUIRE(interleaved.bitDepth == byChannel.bitDepth);
+
+            auto bytes = frames * Sample::bitDepthByteSize(byChannel.bitDepth);
+            for (int c = 0; c < channels; ++c)
+            {
+                REQUIRE(framesOf(interleaved, c));
+                REQUIRE(memcmp(framesOf(interleaved, c), framesOf(byChannel, c), bytes) == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE("PCM Conversion Across Threads", "[sample]")
+{
+    // Just over the threshold with a frame count no chunking divides evenly
+    auto f = pcm::Format::I24LE;
+    size_t frames = pcm::parallelThresholdBytes / 6 + 12345;
+    auto src = makeSource(f, frames * 2, 90210);
+
+    Converted ref(f, frames), res(f, frames);
+    pcm::convert(f, src.data(), 2, frames, ref.out, pcm::KernelLevel::Scalar);
+    pcm::convertParallel(f, src.data(), 2, frames, res.out);
+    for (int c = 0; c < 2; ++c)
+        REQUIRE(res.data[c] == ref.data[c]);
+
+    // Loader workers convert on their own thread, with the same result
+    Converted guarded(f, frames);
+    {
+        pcm::SingleThreadedGuard g;
+        REQUIRE(pcm::convertOnCallingThreadOnly);
+        pcm::convertParallel(f, src.data(), 2, frames, guarded.out);
+    }
+    REQUIRE(!pcm::convertOnCallingThreadOnly);
+    for (int c = 0; c < 2; ++c)
+        REQUIRE(guarded.data[c] == ref.data[c]);
+}
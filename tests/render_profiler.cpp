@@ -0,0 +1,93 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "engine/engine.h"
+#include "messaging/messaging.h"
+#include "sst/voicemanager/midi1_to_voicemanager.h"
+#include "test_support.h"
+
+#include <string>
+
+using namespace scxt;
+
+TEST_CASE("Render Profile Attributes Voices To Their Part And Group", "[engine]")
+{
+    // A second of mono PCM16 at half scale
+    test::TempPath p("scxt_test_render_profiler.wav");
+    test::writeTestWav(p, 48000, 1, 16, [](auto i, auto) { return (i & 64) ? 0.5 : -0.5; });
+
+    auto engine = test::makeOfflineEngine();
+    auto &cont = engine->getMessageController();
+
+    engine->loadSampleIntoSelectedPartAndGroup(p);
+    for (int i = 0; i < 8; ++i)
+    {
+        engine->processAudio();
+        cont->runSerializationHousekeeping();
+    }
+
+    const auto &prof = engine->getRenderProfiler();
+    engine::RenderProfiler::Snapshot snap;
+    REQUIRE(!prof->snapshot(snap));
+
+    prof->start();
+    uint8_t on[3]{0x90, 60, 100};
+    sst::voicemanager::applyMidi1Message(engine->voiceManager, 0, on);
+    static constexpr int blocks{100};
+    for (int i = 0; i < blocks; ++i)
+        engine->processAudio();
+
+    // Stopping publishes on the next block, which is not itself profiled
+    prof->stop();
+    engine->processAudio();
+
+    REQUIRE(prof->snapshot(snap));
+    REQUIRE(snap.blocks == blocks);
+    REQUIRE(snap.patchNanos > 0);
+
+    auto folded = prof->report(*engine);
+    INFO(folded);
+    REQUIRE(folded.find("patch;part 1;group 1;zones;voices ") != std::string::npos);
+    REQUIRE(folded.find("patch;part 2") == std::string::npos);
+
+    // Every line is a stack and a positive count
+    size_t pos{0};
+    while (pos < folded.size())
+    {
+        auto eol = folded.find('\n', pos);
+        REQUIRE(eol != std::string::npos);
+        auto line = folded.substr(pos, eol - pos);
+        auto sp = line.rfind(' ');
+        REQUIRE(sp != std::string::npos);
+        REQUIRE(line.substr(0, 5) == "patch");
+        REQUIRE(std::stoll(line.substr(sp + 1)) > 0);
+        pos = eol + 1;
+    }
+
+    engine.reset();
+}
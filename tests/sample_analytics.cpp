@@ -27,8 +27,10 @@
 
 #include "catch2/catch2.hpp"
 #include "dsp/sample_analytics.h"
+#include "sample/sample_summary.h"
 #include <limits>
 #include <cmath>
+#include <random>
 
 using namespace scxt;
 
@@ -114,3 +116,89 @@ TEST_CASE("Sample Analytics", "[sample]")
                      Catch::WithinRel(saw_rms, tolerance));
     }
 }
+
+TEST_CASE("Sample Summary", "[sample]")
+{
+    // A stereo I16 sample whose length isn't a whole number of buckets at any level
+    std::vector<int16_t> data[2];
+    const size_t length = 100000;
+    std::mt19937 gen(2112);
+    std::uniform_int_distribution<int> dist(-30000, 30000);
+    const auto smp = std::make_shared<sample::Sample>();
+    for (int c = 0; c < 2; ++c)
+    {
+        data[c].resize(length);
+        for (auto &d : data[c])
+            d = (int16_t)dist(gen);
+        smp->allocateI16(c, length);
+        smp->load_data_i16(c, data[c].data(), length, sizeof(int16_t));
+    }
+    smp->sample_length = length;
+    smp->channels = 2;
+    smp->sample_loaded = true;
+
+    auto bruteForce = [&](int c, size_t start, size_t end) {
+        sample::SampleSummary::Range res;
+        for (auto i = start; i < end; ++i)
+        {
+            auto v = static_cast<float>(data[c][i]) / std::numeric_limits<int16_t>::max();
+            res.add({v, v, (double)v * v}, 1);
+        }
+        return res;
+    };
+
+    auto summary = smp->getSummary();
+    REQUIRE(summary->frames == length);
+    REQUIRE(summary->channels == 2);
+    REQUIRE(summary->bucketsAt(summary->levelCount() - 1, 0).size() == 1);
+
+    SECTION("Ranges Match The Data")
+    {
+        std::uniform_int_distribution<size_t> pos(0, length);
+        for (int i = 0; i < 200; ++i)
+        {
+            auto a = pos(gen), b = pos(gen);
+            if (a > b)
+                std::swap(a, b);
+            for (int c = 0; c < 2; ++c)
+            {
+                auto r = summary->range(*smp, c, a, b);
+                auto e = bruteForce(c, a, b);
+                REQUIRE(r.frames == e.frames);
+                REQUIRE(r.min == e.min);
+                REQUIRE(r.max == e.max);
+                REQUIRE_THAT(r.sumSquares, Catch::WithinRel(e.sumSquares, 1e-9));
+            }
+        }
+        REQUIRE(summary->range(*smp, 0, length, length + 10).frames == 0);
+        REQUIRE(summary->range(*smp, 1, 10, length + 10).frames == length - 10);
+    }
+
+    SECTION("Whole Matches The Data")
+    {
+        for (int c = 0; c < 2; ++c)
+        {
+            auto w = summary->whole(c);
+            auto e = bruteForce(c, 0, length);
+            REQUIRE(w.min == e.min);
+            REQUIRE(w.max == e.max);
+            REQUIRE_THAT(w.sumSquares, Catch::WithinRel(e.sumSquares, 1e-9));
+        }
+    }
+
+    SECTION("Built In The Background")
+    {
+        const auto other = std::make_shared<sample::Sample>();
+        other->allocateI16(0, length);
+        other->load_data_i16(0, data[0].data(), length, sizeof(int16_t));
+        other->sample_length = length;
+        other->channels = 1;
+        other->sample_loaded = true;
+
+        sample::SampleSummaryBuilder builder;
+        builder.queue(other);
+        builder.wait();
+        REQUIRE(other->hasSummary());
+        REQUIRE(other->getSummary()->whole(0).max == summary->whole(0).max);
+    }
+}
@@ -0,0 +1,259 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "sample/sample.h"
+#include "sample/sample_manager.h"
+#include "sample/sample_streamer.h"
+#include "sample/compressed_sample_store.h"
+#include "sample/sample_summary.h"
+#include "dsp/generator.h"
+#include "dsp/data_tables.h"
+#include "test_support.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace scxt;
+
+namespace
+{
+// A stereo PCM16 or PCM24 wav of two decaying partials over a little noise, which is
+// roughly what an instrument sample asks of the predictor
+void writePartialsWav(const fs::path &p, uint32_t frames, uint16_t bits)
+{
+    std::minstd_rand gen(2112);
+    std::uniform_real_distribution<double> noise(-1.0, 1.0);
+    test::writeTestWav(p, frames, 2, bits, [&](auto i, auto c) {
+        auto env = std::exp(-(double)i / 30000.0);
+        return env * (0.5 * std::sin(i * 0.031 * (c + 1)) + 0.2 * std::sin(i * 0.173)) +
+               0.00005 * noise(gen);
+    });
+}
+} // namespace
+
+TEST_CASE("Compressed Sample Store Round Trips", "[sample]")
+{
+    auto bits = GENERATE(16, 24);
+    static constexpr uint32_t frames{50000};
+    test::TempPath p("scxt_test_compressed_store.wav");
+    writePartialsWav(p, frames, (uint16_t)bits);
+
+    auto s = std::make_shared<sample::Sample>();
+    REQUIRE(s->load(p));
+    auto bd = s->bitDepth;
+    REQUIRE(bd == (bits == 16 ? sample::Sample::BD_I16 : sample::Sample::BD_I24));
+    auto bpf = sample::Sample::bitDepthByteSize(bd);
+
+    const void *data[2];
+    for (int c = 0; c < 2; ++c)
+        data[c] = bd == sample::Sample::BD_I16 ? (void *)s->GetSamplePtrI16(c)
+                                               : (void *)s->GetSamplePtrI24(c);
+
+    static constexpr uint32_t first{1234};
+    auto store = sample::CompressedSampleStore::encode(bd, 2, data, first, frames);
+    REQUIRE(store);
+    REQUIRE(store->getSizeInBytes() < store->getUncompressedSizeInBytes() * 2 / 3);
+
+    // Reads which start and end anywhere, including outside the stored range, must match
+    // the source exactly and be zero outside it
+    std::minstd_rand gen(90210);
+    std::vector<uint8_t> out(20000 * bpf);
+    for (int t = 0; t < 200; ++t)
+    {
+        auto c = t % 2;
+        auto from = (int64_t)(gen() % (frames + 100)) - 50;
+        auto to = from + (int64_t)(gen() % 20000);
+        store->decode(c, from, to, out.data());
+        auto *src = static_cast<const uint8_t *>(data[c]);
+        for (auto i = from; i < to; ++i)
+        {
+            for (int b = 0; b < bpf; ++b)
+            {
+                auto expected = (i < first || i >= frames) ? 0 : src[i * bpf + b];
+                REQUIRE(out[(i - from) * bpf + b] == expected);
+            }
+        }
+    }
+}
+
+TEST_CASE("Compressed Samples Stream Like The Full Load", "[sample]")
+{
+    static constexpr uint32_t frames{60000}, head{4096};
+    test::TempPath p("scxt_test_compressed_sample.wav");
+    writePartialsWav(p, frames, 16);
+
+    auto full = std::make_shared<sample::Sample>();
+    REQUIRE(full->load(p));
+
+    auto compressed = std::make_shared<sample::Sample>();
+    REQUIRE(compressed->load(p));
+    REQUIRE(compressed->compressBeyond(head));
+    REQUIRE(compressed->isCompressed());
+    REQUIRE(compressed->isStreamed());
+    REQUIRE(compressed->getSampleLength() == frames);
+    REQUIRE(compressed->getResidentSampleLength() == head);
+    REQUIRE(compressed->getDataSize() < full->getDataSize() * 6 / 10);
+    for (int c = 0; c < 2; ++c)
+        for (uint32_t i = 0; i < head; ++i)
+            REQUIRE(compressed->GetSamplePtrI16(c)[i] == full->GetSamplePtrI16(c)[i]);
+
+    // Compressing twice, or compressing a streamed sample, does nothing
+    REQUIRE(!compressed->compressBeyond(head));
+
+    sample::SampleStreamer streamer;
+    streamer.registerSample(*compressed);
+
+    auto *b = streamer.acquire(*compressed, head / 2);
+    REQUIRE(b);
+
+    int64_t pos = head / 2;
+    static constexpr int64_t step{512};
+    while (pos < frames)
+    {
+        auto lo = pos - (int64_t)dsp::FIRoffset;
+        auto hi = std::min(pos + step + (int64_t)dsp::FIRoffset, (int64_t)frames + 4);
+        auto tries{0};
+        streamer.service(b, pos);
+        while (!streamer.covers(b, lo, hi) && tries++ < 1000)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            streamer.service(b, pos);
+        }
+        REQUIRE(streamer.covers(b, lo, hi));
+
+        for (int c = 0; c < 2; ++c)
+        {
+            auto *w = (int16_t *)b->dataPointerFor(c);
+            auto *d = full->GetSamplePtrI16(c);
+            for (auto i = lo; i < hi; ++i)
+            {
+                auto expected = (i < 0 || i >= frames) ? 0 : d[i];
+                REQUIRE(w[i] == expected);
+            }
+        }
+        pos += step;
+    }
+
+    streamer.release(b);
+
+    // and its summary decodes past the head to cover the whole sample
+    auto fs = full->getSummary(), cs = compressed->getSummary();
+    REQUIRE(cs->frames == frames);
+    for (int c = 0; c < 2; ++c)
+    {
+        REQUIRE(cs->whole(c).min == fs->whole(c).min);
+        REQUIRE(cs->whole(c).max == fs->whole(c).max);
+        REQUIRE(cs->whole(c).sumSquares == fs->whole(c).sumSquares);
+        auto cr = cs->range(*compressed, c, head - 100, frames - 7);
+        REQUIRE(cr.sumSquares == fs->range(*full, c, head - 100, frames - 7).sumSquares);
+    }
+}
+
+TEST_CASE("Looped Compressed Samples Render Like PCM", "[sample]")
+{
+    static constexpr uint32_t frames{60000}, head{4096};
+    dsp::sincTable.init();
+    test::TempPath p("scxt_test_compressed_loop.wav");
+    writePartialsWav(p, frames, 16);
+
+    auto pcm = std::make_shared<sample::Sample>();
+    REQUIRE(pcm->load(p));
+
+    ThreadingChecker tc;
+    sample::SampleManager sm(tc);
+    sm.setCompressedHeadFrames(head);
+    auto id = sm.loadSampleByPath(p);
+    REQUIRE(id.has_value());
+    auto zone = sm.getSample(*id);
+    REQUIRE(zone->isCompressed());
+
+    // A voice looping beyond the head asks for the whole sample, as Voice does
+    sm.requestFullyResident(*zone);
+    REQUIRE(sm.takeReloadRequest());
+    sm.startEvictedReloads();
+    for (int tries = 0; sm.hasEvictedReloads() && tries < 1000; ++tries)
+    {
+        sm.integrateEvictedReloads();
+        if (sm.hasEvictedReloads())
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    auto up = sm.beginResidentUpgrade();
+    REQUIRE(up);
+    auto c = up->find(zone.get());
+    REQUIRE(c);
+    zone = c->standIn;
+    sm.completeResidentUpgrade(*up);
+    REQUIRE(sm.getSample(*id) == zone);
+    REQUIRE(!zone->isCompressed());
+    REQUIRE(!zone->isStreamed());
+    REQUIRE(zone->getDataSize() == pcm->getDataSize());
+
+    // A forward loop over the back half, played through it several times
+    auto render = [](const std::shared_ptr<sample::Sample> &s) {
+        auto n = (int32_t)s->sample_length;
+        dsp::GeneratorState gd;
+        gd.direction = 1;
+        gd.directionAtOutset = 1;
+        gd.ratio = (int32_t)(1.37f * (1 << 24));
+        gd.isFinished = false;
+        gd.playbackLowerBound = 0;
+        gd.playbackUpperBound = n - 1;
+        gd.loopLowerBound = n / 2;
+        gd.loopUpperBound = n - 1;
+        gd.loopInvertedBounds = 1.f / (gd.loopUpperBound - gd.loopLowerBound);
+        gd.loopFade = 0;
+        gd.interpolationType = dsp::InterpolationTypes::Sinc;
+
+        float outL[blockSize], outR[blockSize];
+        dsp::GeneratorIO io;
+        io.outputL = outL;
+        io.outputR = outR;
+        io.sampleDataL = s->GetSamplePtrI16(0);
+        io.sampleDataR = s->GetSamplePtrI16(1);
+        io.waveSize = n;
+
+        auto gen = dsp::GetFPtrGeneratorSample(true, false, true, true, false,
+                                               dsp::bestSincKernelLevel());
+        std::vector<float> res;
+        for (int b = 0; b < 2 * n / blockSize; ++b)
+        {
+            gen(&gd, &io);
+            res.insert(res.end(), outL, outL + blockSize);
+            res.insert(res.end(), outR, outR + blockSize);
+        }
+        return res;
+    };
+    REQUIRE(render(zone) == render(pcm));
+
+    zone.reset();
+    sm.reset();
+}
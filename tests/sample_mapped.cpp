@@ -0,0 +1,224 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "sample/sample.h"
+#include "dsp/generator.h"
+#include "dsp/data_tables.h"
+#include "test_support.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace scxt;
+
+namespace
+{
+// Stereo PCM16, PCM24 or (bits == 32) float32 with deterministic, uncorrelated channels.
+// Every format holds the same values once scaled to float.
+void writeMappedWav(const fs::path &p, uint32_t frames, uint16_t bits)
+{
+    test::writeTestWav(p, frames, 2, bits, [](auto i, auto c) {
+        return c == 0 ? ((i * 7) % 30000) / 32768.0 : -(double)((i * 13) % 30000) / 32768.0;
+    });
+}
+
+void setSampleData(dsp::GeneratorIO &io, const std::shared_ptr<sample::Sample> &s)
+{
+    if (s->bitDepth == sample::Sample::BD_I16)
+    {
+        io.sampleDataL = s->GetSamplePtrI16(0);
+        io.sampleDataR = s->GetSamplePtrI16(1);
+    }
+    else if (s->bitDepth == sample::Sample::BD_I24)
+    {
+        io.sampleDataL = s->GetSamplePtrI24(0);
+        io.sampleDataR = s->GetSamplePtrI24(1);
+    }
+    else
+    {
+        io.sampleDataL = s->GetSamplePtrF32(0);
+        io.sampleDataR = s->GetSamplePtrF32(1);
+    }
+    io.waveSize = s->sample_length;
+    io.interleavedStride = s->mappedStride;
+    io.packed24 = s->bitDepth == sample::Sample::BD_I24;
+}
+
+// Loop mode 0 is no loop, 1 forward, 2 bidirectional. The loop runs to the end of the
+// sample with a crossfade so the edge and fade paths are crossed too.
+std::vector<float> render(const std::shared_ptr<sample::Sample> &s, dsp::InterpolationTypes it,
+                          dsp::SincKernelLevel level, int loopMode, float ratio)
+{
+    auto n = (int32_t)s->sample_length;
+    dsp::GeneratorState gd;
+    gd.direction = 1;
+    gd.directionAtOutset = 1;
+    gd.ratio = (int32_t)(ratio * (1 << 24));
+    gd.isFinished = false;
+    gd.playbackLowerBound = 0;
+    gd.playbackUpperBound = n - 1;
+    gd.loopLowerBound = n / 4;
+    gd.loopUpperBound = n - 1;
+    gd.loopInvertedBounds = 1.f / (gd.loopUpperBound - gd.loopLowerBound);
+    gd.loopFade = n / 8;
+    gd.interpolationType = it;
+
+    float outL[blockSize], outR[blockSize];
+    dsp::GeneratorIO io;
+    io.outputL = outL;
+    io.outputR = outR;
+    setSampleData(io, s);
+
+    auto gen = dsp::GetFPtrGeneratorSample(true, s->bitDepth != sample::Sample::BD_I16,
+                                           loopMode > 0, loopMode != 2, false, level);
+    std::vector<float> res;
+    for (int b = 0; b < 3 * n / blockSize; ++b)
+    {
+        gen(&gd, &io);
+        res.insert(res.end(), outL, outL + blockSize);
+        res.insert(res.end(), outR, outR + blockSize);
+    }
+    return res;
+}
+} // namespace
+
+TEST_CASE("Mapped Wav Playback", "[sample]")
+{
+    static constexpr uint32_t frames{3000};
+    dsp::sincTable.init();
+
+    auto bits = GENERATE(16, 24, 32);
+    test::TempPath p("scxt_test_mapped.wav");
+    writeMappedWav(p, frames, bits);
+
+    auto copied = std::make_shared<sample::Sample>();
+    REQUIRE(copied->load(p));
+    REQUIRE(!copied->isMappedInPlace());
+
+    auto mapped = std::make_shared<sample::Sample>();
+    REQUIRE(mapped->load(p, 0, nullptr, nullptr, true));
+    REQUIRE(mapped->isMappedInPlace());
+    REQUIRE(mapped->getFrameStride() == 2);
+    REQUIRE(mapped->bitDepth == copied->bitDepth);
+    REQUIRE(mapped->sample_length == frames);
+
+    SECTION("Mapped Frames Match The Copy")
+    {
+        auto stride = mapped->getFrameStride();
+        for (int c = 0; c < 2; ++c)
+        {
+            for (uint32_t i = 0; i < frames; ++i)
+            {
+                if (bits == 32)
+                    REQUIRE(mapped->GetSamplePtrF32(c)[i * stride] ==
+                            copied->GetSamplePtrF32(c)[i]);
+                else if (bits == 24)
+                    REQUIRE(memcmp(mapped->GetSamplePtrI24(c) + i * stride * 3,
+                                   copied->GetSamplePtrI24(c) + i * 3, 3) == 0);
+                else
+                    REQUIRE(mapped->GetSamplePtrI16(c)[i * stride] ==
+                            copied->GetSamplePtrI16(c)[i]);
+            }
+        }
+    }
+
+    SECTION("Interleaved Generator Matches Planar")
+    {
+        for (auto it : {dsp::InterpolationTypes::Sinc, dsp::InterpolationTypes::Linear,
+                        dsp::InterpolationTypes::ZeroOrderHold})
+        {
+            for (auto level : {dsp::SincKernelLevel::PerSample, dsp::bestSincKernelLevel()})
+            {
+                for (auto ratio : {1.f, 1.37f, 0.61f})
+                {
+                    for (auto loopMode : {0, 1, 2})
+                    {
+                        INFO("interp=" << (int)it << " level=" << (int)level
+                                       << " ratio=" << ratio << " loopMode=" << loopMode);
+                        auto ref = render(copied, it, level, loopMode, ratio);
+                        auto map = render(mapped, it, level, loopMode, ratio);
+                        REQUIRE(ref == map);
+                    }
+                }
+            }
+        }
+    }
+
+    SECTION("Streaming Takes Precedence")
+    {
+        auto streamed = std::make_shared<sample::Sample>();
+        REQUIRE(streamed->load(p, 512, nullptr, nullptr, true));
+        REQUIRE(streamed->isStreamed());
+        REQUIRE(!streamed->isMappedInPlace());
+    }
+}
+
+TEST_CASE("Packed 24 Bit Samples", "[sample]")
+{
+    static constexpr uint32_t frames{3000};
+    dsp::sincTable.init();
+
+    test::TempPath p24("scxt_test_i24.wav"), pf("scxt_test_f32.wav");
+    writeMappedWav(p24, frames, 24);
+    writeMappedWav(pf, frames, 32);
+
+    auto i24 = std::make_shared<sample::Sample>();
+    REQUIRE(i24->load(p24));
+    auto f32 = std::make_shared<sample::Sample>();
+    REQUIRE(f32->load(pf));
+
+    REQUIRE(i24->bitDepth == sample::Sample::BD_I24);
+    REQUIRE(i24->getDataSize() == frames * 2 * 3);
+    REQUIRE(f32->getDataSize() == frames * 2 * 4);
+
+    SECTION("Values Unpack To The Float Load")
+    {
+        for (int c = 0; c < 2; ++c)
+            for (uint32_t i = 0; i < frames; ++i)
+                REQUIRE(sample::Sample::unpackI24(i24->GetSamplePtrI24(c) + i * 3) ==
+                        f32->GetSamplePtrF32(c)[i]);
+    }
+
+    SECTION("Generator Matches The Float Load")
+    {
+        for (auto it : {dsp::InterpolationTypes::Sinc, dsp::InterpolationTypes::Linear,
+                        dsp::InterpolationTypes::ZeroOrderHold})
+        {
+            for (auto level : {dsp::SincKernelLevel::PerSample, dsp::bestSincKernelLevel()})
+            {
+                for (auto loopMode : {0, 1, 2})
+                {
+                    INFO("interp=" << (int)it << " level=" << (int)level
+                                   << " loopMode=" << loopMode);
+                    REQUIRE(render(i24, it, level, loopMode, 1.37f) ==
+                            render(f32, it, level, loopMode, 1.37f));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,156 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "sample/sample_manager.h"
+#include "test_support.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace scxt;
+
+TEST_CASE("Sample Memory Budget", "[sample]")
+{
+    static constexpr uint32_t frames{10000};
+    static constexpr uint64_t bytesEach{frames * 2 * sizeof(int16_t)};
+
+    test::TempPath dir("scxt_test_budget");
+    fs::create_directories(dir);
+
+    ThreadingChecker tc;
+    sample::SampleManager sm(tc);
+
+    std::vector<fs::path> paths;
+    std::vector<SampleID> ids;
+    for (int i = 0; i < 3; ++i)
+    {
+        paths.push_back(dir.path() / ("sample_" + std::to_string(i) + ".wav"));
+        test::writeTestWav(paths.back(), frames, 2, 16,
+                           [](auto f, auto c) { return ((f * 2 + c) * 11 % 20000) / 32768.0; });
+        auto id = sm.loadSampleByPath(paths.back());
+        REQUIRE(id.has_value());
+        ids.push_back(*id);
+    }
+    REQUIRE(sm.sampleMemoryInBytes == 3 * bytesEach);
+    REQUIRE(!sm.wantsEviction());
+
+    // Loading counts as use, so after these the last loaded sample is the least recent
+    sm.noteSampleTriggered(*sm.getSample(ids[0]));
+    sm.noteSampleTriggered(*sm.getSample(ids[1]));
+    REQUIRE(sm.residentHits == 2);
+    REQUIRE(sm.evictedMisses == 0);
+
+    sm.setMemoryBudgetBytes(3 * bytesEach - 1);
+    REQUIRE(sm.wantsEviction());
+
+    // What the engine does on the audio thread, for a zone holding each sample
+    auto zones = std::vector<std::shared_ptr<sample::Sample>>{
+        sm.getSample(ids[0]), sm.getSample(ids[1]), sm.getSample(ids[2])};
+    auto swapZones = [&zones](sample::SampleManager::Eviction &ev) {
+        for (auto &z : zones)
+        {
+            auto c = ev.find(z.get());
+            if (c && !c->playing)
+                z = c->standIn;
+        }
+    };
+
+    SECTION("A Playing Sample Is Kept")
+    {
+        auto ev = sm.beginEviction();
+        REQUIRE(ev);
+        REQUIRE(ev->candidates.size() == 1);
+        REQUIRE(ev->candidates[0].sample->id == ids[2]);
+        REQUIRE(!sm.wantsEviction());
+
+        ev->find(zones[2].get())->playing = true;
+        swapZones(*ev);
+        sm.completeEviction(*ev);
+        REQUIRE(!sm.getSample(ids[2])->isEvicted());
+        REQUIRE(sm.sampleMemoryInBytes == 3 * bytesEach);
+        REQUIRE(zones[2] == sm.getSample(ids[2]));
+    }
+
+    SECTION("Least Recently Triggered Is Evicted And Reloads")
+    {
+        auto ev = sm.beginEviction();
+        REQUIRE(ev);
+        swapZones(*ev);
+        sm.completeEviction(*ev);
+
+        auto standIn = sm.getSample(ids[2]);
+        REQUIRE(standIn->isEvicted());
+        REQUIRE(zones[2] == standIn);
+        REQUIRE(standIn->getSampleLength() == frames);
+        REQUIRE(standIn->getResidentSampleLength() == 0);
+        REQUIRE(standIn->getPath() == paths[2]);
+        REQUIRE(sm.sampleMemoryInBytes == 2 * bytesEach);
+        REQUIRE(sm.getSampleAddressesAndIDs().size() == 3);
+        REQUIRE(!sm.getSample(ids[0])->isEvicted());
+        REQUIRE(!sm.getSample(ids[1])->isEvicted());
+
+        // A miss asks for one reload however often it is triggered
+        sm.noteSampleTriggered(*zones[2]);
+        REQUIRE(sm.evictedMisses == 1);
+        REQUIRE(sm.takeReloadRequest());
+        sm.noteSampleTriggered(*zones[2]);
+        REQUIRE(sm.evictedMisses == 2);
+        REQUIRE(!sm.takeReloadRequest());
+
+        sm.startEvictedReloads();
+        REQUIRE(sm.hasEvictedReloads());
+        std::vector<std::shared_ptr<sample::Sample>> loaded;
+        for (int tries = 0; loaded.empty() && tries < 1000; ++tries)
+        {
+            loaded = sm.integrateEvictedReloads();
+            if (loaded.empty())
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        REQUIRE(loaded.size() == 1);
+        REQUIRE(!sm.hasEvictedReloads());
+        REQUIRE(loaded[0]->id == ids[2]);
+        REQUIRE(!loaded[0]->isEvicted());
+        REQUIRE(sm.getSample(ids[2]) == loaded[0]);
+        REQUIRE(sm.sampleMemoryInBytes == 3 * bytesEach);
+
+        auto retired = sm.takeRetiredSamples();
+        REQUIRE(retired.size() == 1);
+        REQUIRE(retired[0] == standIn);
+
+        // Reloading made it the most recent, so the next pass picks another
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        auto next = sm.beginEviction();
+        REQUIRE(next);
+        REQUIRE(next->candidates.size() == 1);
+        REQUIRE(next->candidates[0].sample->id == ids[0]);
+        sm.completeEviction(*next);
+    }
+
+    zones.clear();
+    sm.reset();
+}
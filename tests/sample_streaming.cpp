@@ -0,0 +1,212 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "sample/sample.h"
+#include "sample/sample_manager.h"
+#include "sample/sample_streamer.h"
+#include "sample/sample_summary.h"
+#include "test_support.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace scxt;
+
+namespace
+{
+// Stereo PCM16 with deterministic, uncorrelated channels
+void writeStreamingWav(const fs::path &p, uint32_t frames)
+{
+    test::writeTestWav(p, frames, 2, 16, [](auto i, auto c) {
+        return c == 0 ? ((i * 7) % 30000) / 32768.0 : -(double)((i * 13) % 30000) / 32768.0;
+    });
+}
+} // namespace
+
+TEST_CASE("Sample Streaming", "[sample]")
+{
+    static constexpr uint32_t frames{40000}, preload{2048};
+    test::TempPath p("scxt_test_streaming.wav");
+    writeStreamingWav(p, frames);
+
+    auto full = std::make_shared<sample::Sample>();
+    REQUIRE(full->load(p));
+    REQUIRE(!full->isStreamed());
+    REQUIRE(full->getResidentSampleLength() == frames);
+
+    auto streamed = std::make_shared<sample::Sample>();
+    REQUIRE(streamed->load(p, preload));
+
+    SECTION("Streamed Sample Keeps Only The Head")
+    {
+        REQUIRE(streamed->isStreamed());
+        REQUIRE(streamed->getSampleLength() == frames);
+        REQUIRE(streamed->getResidentSampleLength() == preload);
+        REQUIRE(streamed->getDataSize() == preload * 2 * sizeof(int16_t));
+        for (int c = 0; c < 2; ++c)
+            for (uint32_t i = 0; i < preload; ++i)
+                REQUIRE(streamed->GetSamplePtrI16(c)[i] == full->GetSamplePtrI16(c)[i]);
+    }
+
+    SECTION("Streamed Windows Match The Full Load")
+    {
+        sample::SampleStreamer streamer;
+        streamer.registerSample(*streamed);
+
+        auto *b = streamer.acquire(*streamed, preload / 2);
+        REQUIRE(b);
+
+        int64_t pos = preload / 2;
+        static constexpr int64_t step{512};
+        while (pos < frames)
+        {
+            auto lo = pos - (int64_t)dsp::FIRoffset;
+            auto hi = std::min(pos + step + (int64_t)dsp::FIRoffset, (int64_t)frames + 4);
+            auto tries{0};
+            streamer.service(b, pos);
+            while (!streamer.covers(b, lo, hi) && tries++ < 1000)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                streamer.service(b, pos);
+            }
+            REQUIRE(streamer.covers(b, lo, hi));
+
+            for (int c = 0; c < 2; ++c)
+            {
+                auto *w = (int16_t *)b->dataPointerFor(c);
+                auto *d = full->GetSamplePtrI16(c);
+                for (auto i = lo; i < hi; ++i)
+                {
+                    // Past either end of the sample we expect the zero pad
+                    auto expected = (i < 0 || i >= frames) ? 0 : d[i];
+                    REQUIRE(w[i] == expected);
+                }
+            }
+            pos += step;
+        }
+
+        streamer.release(b);
+    }
+
+    SECTION("Streamed Samples Are Summarized In Full")
+    {
+        auto fs = full->getSummary(), ss = streamed->getSummary();
+        REQUIRE(ss->frames == frames);
+        for (int c = 0; c < 2; ++c)
+        {
+            REQUIRE(ss->whole(c).min == fs->whole(c).min);
+            REQUIRE(ss->whole(c).max == fs->whole(c).max);
+            REQUIRE(ss->whole(c).sumSquares == fs->whole(c).sumSquares);
+
+            // Ragged ends inside the head, across its end and past it
+            for (auto [a, b] : {std::pair<size_t, size_t>{100, 1900}, {1000, 9000},
+                                {preload + 77, frames - 33}})
+            {
+                auto sr = ss->range(*streamed, c, a, b), fr = fs->range(*full, c, a, b);
+                REQUIRE(sr.frames == fr.frames);
+                REQUIRE(sr.min == fr.min);
+                REQUIRE(sr.max == fr.max);
+                REQUIRE(sr.sumSquares == fr.sumSquares);
+            }
+        }
+    }
+}
+
+TEST_CASE("Looped Streamed Samples Are Made Fully Resident", "[sample]")
+{
+    static constexpr uint32_t frames{40000}, preload{2048};
+    test::TempPath p("scxt_test_streaming_resident.wav");
+    writeStreamingWav(p, frames);
+
+    ThreadingChecker tc;
+    sample::SampleManager sm(tc);
+    sm.setStreamingPreloadFrames(preload);
+    auto id = sm.loadSampleByPath(p);
+    REQUIRE(id.has_value());
+    auto zone = sm.getSample(*id);
+    REQUIRE(zone->isStreamed());
+
+    // What a voice looping past the head asks for; once however often it asks
+    sm.requestFullyResident(*zone);
+    REQUIRE(sm.takeReloadRequest());
+    sm.requestFullyResident(*zone);
+    REQUIRE(!sm.takeReloadRequest());
+
+    sm.startEvictedReloads();
+    REQUIRE(sm.hasEvictedReloads());
+    for (int tries = 0; sm.hasEvictedReloads() && tries < 1000; ++tries)
+    {
+        REQUIRE(sm.integrateEvictedReloads().empty());
+        if (sm.hasEvictedReloads())
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    REQUIRE(sm.hasResidentUpgrades());
+
+    // Pending upgrades aren't asked for again
+    sm.startEvictedReloads();
+    REQUIRE(!sm.hasEvictedReloads());
+
+    auto swapZone = [&zone](sample::SampleManager::Eviction &ev) {
+        auto c = ev.find(zone.get());
+        if (c && !c->playing)
+            zone = c->standIn;
+    };
+
+    // A voice still on the streamed sample holds the upgrade back for another try
+    auto up = sm.beginResidentUpgrade();
+    REQUIRE(up);
+    REQUIRE(!sm.hasResidentUpgrades());
+    up->find(zone.get())->playing = true;
+    swapZone(*up);
+    sm.completeResidentUpgrade(*up);
+    REQUIRE(sm.getSample(*id)->isStreamed());
+    REQUIRE(sm.hasResidentUpgrades());
+
+    up = sm.beginResidentUpgrade();
+    REQUIRE(up);
+    swapZone(*up);
+    sm.completeResidentUpgrade(*up);
+    REQUIRE(!sm.hasResidentUpgrades());
+
+    auto resident = sm.getSample(*id);
+    REQUIRE(zone == resident);
+    REQUIRE(!resident->isStreamed());
+    REQUIRE(resident->getResidentSampleLength() == frames);
+    REQUIRE(sm.sampleMemoryInBytes == frames * 2 * sizeof(int16_t));
+
+    auto full = std::make_shared<sample::Sample>();
+    REQUIRE(full->load(p));
+    for (int c = 0; c < 2; ++c)
+        for (uint32_t i = 0; i < frames; ++i)
+            REQUIRE(resident->GetSamplePtrI16(c)[i] == full->GetSamplePtrI16(c)[i]);
+
+    zone.reset();
+    resident.reset();
+    sm.reset();
+}
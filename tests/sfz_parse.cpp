@@ -27,6 +27,15 @@
 
 #include "catch2/catch2.hpp"
 #include "sample/sfz_support/sfz_parse.h"
+#include "sample/sfz_support/sfz_import.h"
+#include "sample/sfz_support/sfz_tokenizer.h"
+#include "engine/engine.h"
+#include "messaging/messaging.h"
+#include "test_support.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
 
 TEST_CASE("SFZ Tokens", "[sfz]")
 {
@@ -255,4 +264,161 @@ group=1 off_by=1 off_mode=normal
         auto res = p.parse(anSFZ);
         REQUIRE(res.size() == 15);
     }
-}
\ No newline at end of file
+}
+
+namespace
+{
+// Everything the import sets, with samples named by file since ids differ across engines
+std::vector<std::string> describeImport(const scxt::engine::Engine &e)
+{
+    std::vector<std::string> res;
+    const auto &part = e.getPatch()->getPart(0);
+    for (const auto &g : part->getGroups())
+    {
+        res.push_back("group " + g->name);
+        for (const auto &z : g->getZones())
+        {
+            std::ostringstream oss;
+            const auto &m = z->mapping;
+            oss << "zone " << m.rootKey << " " << m.keyboardRange.keyStart << "-"
+                << m.keyboardRange.keyEnd << " " << m.velocityRange.velStart << "-"
+                << m.velocityRange.velEnd << " " << m.amplitude << " " << m.pitchOffset << " "
+                << z->egStorage[0].a << " " << z->egStorage[0].d << " " << z->egStorage[0].s
+                << " " << z->egStorage[0].r;
+            for (const auto &v : z->variantData.variants)
+            {
+                if (!v.active)
+                    continue;
+                auto smp = e.getSampleManager()->getSample(v.sampleID);
+                REQUIRE(smp);
+                oss << " [" << smp->getPath().filename().u8string() << " " << v.loopActive
+                    << "]";
+            }
+            res.push_back(oss.str());
+        }
+    }
+    return res;
+}
+} // namespace
+
+/*
+ * The two phase import decodes every distinct sample up front and concurrently. Built
+ * from the advanced fixture above, with a round robin and some reused samples added, it
+ * should make exactly what loading one region at a time does.
+ */
+TEST_CASE("SFZ Concurrent Import Matches Sequential Import", "[sfz]")
+{
+    scxt::test::TempPath tmp("scxt_test_sfz_import");
+    const auto &dir = tmp.path();
+    fs::create_directories(dir / "samples");
+
+    std::vector<std::string> names{"d4_p",    "d4_mf",   "d4_f",    "e4_p",    "e4_mf",
+                                   "e4_f",    "d4_ft_p", "d4_ft_f", "e4_ft_p", "e4_ft_f"};
+    for (size_t i = 0; i < names.size(); ++i)
+        scxt::test::writeTestWav(dir / "samples" / (names[i] + ".wav"), 4800, 1, 16,
+                           [i](auto, auto) { return 1000.0 * (i + 1) / 32768.0; });
+
+    std::string anSFZ = R"SFZ(
+<control>default_path=samples/
+<global>ampeg_release=0.3 amp_veltrack=0 sw_lokey=48 sw_hikey=49
+group=1 off_by=1 off_mode=normal
+<group>lokey=50 hikey=51 pitch_keycenter=50 sw_last=48 group_label=Dee
+<region>sample=d4_p.wav xfin_locc1=0 xfin_hicc1=42 xfout_locc1=43 xfout_hicc1=85
+<region>sample=d4_mf.wav xfin_locc1=43 xfin_hicc1=85 xfout_locc1=86 xfout_hicc1=127
+<region>sample=d4_f.wav xfin_locc1=86 xfin_hicc1=127
+<group>lokey=52 hikey=53 pitch_keycenter=52 sw_last=48
+<region>sample=e4_p.wav xfin_locc1=0 xfin_hicc1=42 xfout_locc1=43 xfout_hicc1=85
+<region>sample=e4_mf.wav xfin_locc1=43 xfin_hicc1=85 xfout_locc1=86 xfout_hicc1=127
+<region>sample=e4_f.wav xfin_locc1=86 xfin_hicc1=127
+<group>lokey=50 hikey=51 pitch_keycenter=50 sw_last=49
+<region>sample=d4_ft_p.wav xfin_locc1=0 xfin_hicc1=63 xfout_locc1=64 xfout_hicc1=127
+<region>sample=d4_ft_f.wav xfin_locc1=64 xfin_hicc1=127
+<group>lokey=52 hikey=53 pitch_keycenter=52 sw_last=49
+<region>sample=e4_ft_p.wav xfin_locc1=0 xfin_hicc1=63 xfout_locc1=64 xfout_hicc1=127
+<region>sample=e4_ft_f.wav xfin_locc1=64 xfin_hicc1=127
+<group>name=Reuse ampeg_attack=0.1
+<region>sample=d4_p.wav key=c5 tune=-25 volume=-3 loop_mode=loop_continuous
+<region>sample=e4_ft_f.wav lokey=72 hikey=72 pitch_keycenter=72 hivel=127 seq_position=2
+<region>sample=..\samples\d4_mf.wav lokey=a5 hikey=b5 pitch_keycenter=a#5 ampeg_sustain=50
+)SFZ";
+    auto sfzPath = dir / "fixture.sfz";
+    {
+        std::ofstream of(sfzPath);
+        of << anSFZ;
+    }
+
+    auto sequential = scxt::test::makeOfflineEngine();
+    auto seqPrep = scxt::sfz_support::prepareSFZImport(sfzPath, *sequential, false);
+    REQUIRE(scxt::sfz_support::applySFZImport(seqPrep, *sequential));
+
+    auto concurrent = scxt::test::makeOfflineEngine();
+    REQUIRE(scxt::sfz_support::importSFZ(sfzPath, *concurrent));
+
+    auto expected = describeImport(*sequential);
+    auto got = describeImport(*concurrent);
+    REQUIRE(got == expected);
+    auto zoneCount = std::count_if(got.begin(), got.end(),
+                                   [](const auto &s) { return s.substr(0, 5) == "zone "; });
+    REQUIRE(zoneCount == 12);
+    REQUIRE(std::count_if(got.begin(), got.end(), [](const auto &s) {
+                return s.find("[d4_p.wav ") != std::string::npos &&
+                       s.find("[e4_ft_f.wav ") != std::string::npos;
+            }) == 1);
+
+    // Each distinct file is loaded once
+    REQUIRE(concurrent->getSampleManager()->getSampleAddressesAndIDs().size() == names.size());
+    REQUIRE(sequential->getSampleManager()->getSampleAddressesAndIDs().size() == names.size());
+
+    sequential.reset();
+    concurrent.reset();
+}
+
+TEST_CASE("SFZ Tokenizer Preprocessor", "[sfz]")
+{
+    namespace sfz = scxt::sfz_support;
+
+    scxt::test::TempPath tmp("scxt_test_sfz_tokenizer");
+    const auto &dir = tmp.path();
+    fs::create_directories(dir / "inc");
+
+    auto write = [](const fs::path &p, const std::string &s) {
+        std::ofstream ofs(p, std::ios::binary);
+        ofs << s;
+    };
+    write(dir / "main.sfz", R"SFZ(// defines apply to every line after them
+#define $KEY 60
+#define $NAME  piano
+<group>group_label=$NAME lokey=$KEY
+#include "inc\regions.sfzh"
+<region>sample=last.wav key=$KEYS custom=$UNSET
+)SFZ");
+    write(dir / "inc" / "regions.sfzh", R"SFZ(<region>sample=$NAME_1.wav key=$KEY
+  #define $KEY 62
+<region>sample=$NAME_2.wav key=$KEY)SFZ");
+
+    sfz::SFZTokenizer t;
+    REQUIRE(t.tokenize(dir / "main.sfz"));
+    REQUIRE(t.filesTokenized == 2);
+    REQUIRE(t.sections.size() == 4);
+
+    auto values = [&t](size_t i) {
+        std::vector<std::pair<sfz::SFZOpcode, std::string>> res;
+        for (const auto &oc : t.opCodesOf(t.sections[i]))
+            res.emplace_back(oc.id, std::string(oc.value));
+        return res;
+    };
+    using V = std::vector<std::pair<sfz::SFZOpcode, std::string>>;
+
+    REQUIRE(t.sections[0].type == sfz::SFZParser::Header::group);
+    REQUIRE(values(0) ==
+            V{{sfz::SFZOpcode::group_label, "piano"}, {sfz::SFZOpcode::lokey, "60"}});
+    REQUIRE(t.sections[1].type == sfz::SFZParser::Header::region);
+    REQUIRE(values(1) == V{{sfz::SFZOpcode::sample, "$NAME_1.wav"}, {sfz::SFZOpcode::key, "60"}});
+    REQUIRE(values(2) == V{{sfz::SFZOpcode::sample, "$NAME_2.wav"}, {sfz::SFZOpcode::key, "62"}});
+
+    // Only whole names are replaced and unknown opcodes keep their name
+    REQUIRE(values(3) == V{{sfz::SFZOpcode::sample, "last.wav"},
+                           {sfz::SFZOpcode::key, "$KEYS"},
+                           {sfz::SFZOpcode::unknown, "$UNSET"}});
+    REQUIRE(t.opCodesOf(t.sections[3]).begin()[2].name == "custom");
+}
@@ -0,0 +1,83 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "modulation/modulators/steplfo.h"
+#include "tuning/equal.h"
+#include <cstring>
+#include <vector>
+
+using namespace scxt;
+namespace mm = scxt::modulation::modulators;
+
+TEST_CASE("Step LFO Batch Matches Scalar", "[modulation]")
+{
+    tuning::equalTuning.init();
+    sst::basic_blocks::dsp::RNG rng;
+
+    // An odd count so the last batch is partial, with every preset's smoothing
+    // and a spread of rates so steps wrap at different blocks
+    static constexpr int nLfos{11};
+    std::vector<modulation::ModulatorStorage> storage(nLfos);
+    std::vector<float> rates(nLfos);
+    std::vector<mm::StepLFO> scalar(nLfos), batched(nLfos);
+
+    for (int i = 0; i < nLfos; ++i)
+    {
+        auto preset = (mm::LFOPresets)(1 + i % (mm::n_lfopresets - 1));
+        mm::load_lfo_preset(preset, storage[i].stepLfoStorage, rng);
+        storage[i].stepLfoStorage.smooth += (i % 3) * 0.35f - 0.7f;
+        if (i % 4 == 3)
+            storage[i].triggerMode = modulation::ModulatorStorage::ONESHOT;
+        rates[i] = -2.f + i * 0.7f;
+
+        for (auto *l : {&scalar[i], &batched[i]})
+        {
+            l->setSampleRate(48000, 1.0 / 48000);
+            l->assign(&storage[i], &rates[i], nullptr, rng);
+        }
+    }
+
+    std::vector<mm::StepLFO *> ptrs;
+    for (auto &l : batched)
+        ptrs.push_back(&l);
+
+    for (int blk = 0; blk < 5000; ++blk)
+    {
+        for (auto &l : scalar)
+            l.process(blockSize);
+        mm::processStepLFOBatch(ptrs.data(), ptrs.size());
+
+        for (int i = 0; i < nLfos; ++i)
+        {
+            INFO("block " << blk << " lfo " << i);
+            REQUIRE(batched[i].state == scalar[i].state);
+            REQUIRE(batched[i].phase == scalar[i].phase);
+            REQUIRE(batched[i].output == Approx(scalar[i].output).margin(1e-6));
+        }
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "test_support.h"
+
+#include "catch2/catch2.hpp"
+#include "engine/engine.h"
+#include "messaging/messaging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace scxt::test
+{
+TempPath::TempPath(const std::string &name) : p(fs::temp_directory_path() / name)
+{
+    std::error_code ec;
+    fs::remove_all(p, ec);
+}
+
+TempPath::~TempPath()
+{
+    std::error_code ec;
+    fs::remove_all(p, ec);
+}
+
+void writeTestWav(const fs::path &path, uint32_t frames, uint16_t channels, uint16_t bits,
+                  const wavFill_t &fill)
+{
+    REQUIRE((bits == 16 || bits == 24 || bits == 32));
+    auto isFloat = bits == 32;
+
+    auto *f = fopen(path.u8string().c_str(), "wb");
+    REQUIRE(f);
+
+    auto w32 = [f](uint32_t v) { fwrite(&v, 4, 1, f); };
+    auto w16 = [f](uint16_t v) { fwrite(&v, 2, 1, f); };
+
+    uint32_t rate{48000}, dataSize{frames * channels * bits / 8};
+    fwrite("RIFF", 1, 4, f);
+    w32(36 + dataSize);
+    fwrite("WAVEfmt ", 1, 8, f);
+    w32(16);
+    w16(isFloat ? 3 : 1);
+    w16(channels);
+    w32(rate);
+    w32(rate * channels * bits / 8);
+    w16(channels * bits / 8);
+    w16(bits);
+    fwrite("data", 1, 4, f);
+    w32(dataSize);
+
+    auto scale = std::ldexp(1.0, bits - 1);
+    for (uint32_t i = 0; i < frames; ++i)
+    {
+        for (uint16_t c = 0; c < channels; ++c)
+        {
+            auto v = fill(i, c);
+            if (isFloat)
+            {
+                auto fv = (float)v;
+                fwrite(&fv, 4, 1, f);
+            }
+            else
+            {
+                auto q = (int32_t)std::clamp(std::llround(v * scale), -(long long)scale,
+                                             (long long)scale - 1);
+                fwrite(&q, bits / 8, 1, f);
+            }
+        }
+    }
+    fclose(f);
+}
+
+std::unique_ptr<engine::Engine> makeOfflineEngine(double sampleRate)
+{
+    auto engine = std::make_unique<engine::Engine>();
+    auto &cont = engine->getMessageController();
+    cont->stop();
+    cont->threadingChecker.registerAsSerialThread();
+    cont->threadingChecker.registerAsAudioThread();
+    engine->runningEnvironment = "scxt-test";
+    engine->prepareToPlay(sampleRate);
+    return engine;
+}
+} // namespace scxt::test
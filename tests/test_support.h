@@ -0,0 +1,79 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#ifndef SCXT_TESTS_TEST_SUPPORT_H
+#define SCXT_TESTS_TEST_SUPPORT_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "utils.h"
+#include "infrastructure/filesystem_import.h"
+
+namespace scxt::engine
+{
+struct Engine;
+}
+
+namespace scxt::test
+{
+/*
+ * A path in the temp directory which is cleared when made and removed (with anything
+ * under it) when it goes out of scope, so a failing REQUIRE doesn't leave files behind.
+ */
+struct TempPath : MoveableOnly<TempPath>
+{
+    explicit TempPath(const std::string &name);
+    ~TempPath();
+
+    const fs::path &path() const { return p; }
+    operator const fs::path &() const { return p; }
+
+  private:
+    fs::path p;
+};
+
+/*
+ * Write a RIFF wav. bits is 16 or 24 for PCM or 32 for float. fill(frame, channel) gives
+ * each sample in [-1, 1]; PCM scales by 2^(bits-1) and clamps, so a fill of n / 32768.0
+ * lands exactly on the 16 bit value n (and n * 256 at 24 bits).
+ */
+using wavFill_t = std::function<double(uint32_t frame, uint16_t channel)>;
+void writeTestWav(const fs::path &path, uint32_t frames, uint16_t channels, uint16_t bits,
+                  const wavFill_t &fill);
+
+/*
+ * An engine for offline tests in the style of scxt-render: the messaging thread is
+ * stopped and the calling thread plays the serialization and audio roles, so call
+ * processAudio and runSerializationHousekeeping yourself.
+ */
+std::unique_ptr<engine::Engine> makeOfflineEngine(double sampleRate = 48000);
+} // namespace scxt::test
+
+#endif // SCXT_TESTS_TEST_SUPPORT_H
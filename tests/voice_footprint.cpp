@@ -0,0 +1,103 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "voice/voice.h"
+#include "engine/engine.h"
+#include "messaging/messaging.h"
+#include "sst/voicemanager/midi1_to_voicemanager.h"
+#include "test_support.h"
+
+#include <memory>
+
+using namespace scxt;
+
+namespace
+{
+// What the four inline placement buffers used to add to every voice
+constexpr size_t inlineProcessorBytes{engine::processorCount *
+                                      dsp::processor::processorMemoryBufferSize};
+} // namespace
+
+TEST_CASE("Voice Footprint", "[voice]")
+{
+    INFO("sizeof(Voice) = " << sizeof(voice::Voice));
+    REQUIRE(sizeof(voice::Voice) < inlineProcessorBytes);
+}
+
+/*
+ * Every voice spawn checks its processor out of the pool, so a chord of every voice the
+ * engine has must find a block for each one already reserved.
+ */
+TEST_CASE("A Full Chord Of Voices Does Not Miss The Pool", "[voice]")
+{
+    test::TempPath p("scxt_test_voice_burst.wav");
+    test::writeTestWav(p, 48000, 1, 16, [](auto, auto) { return 0.25; });
+
+    auto engine = test::makeOfflineEngine();
+    auto &cont = engine->getMessageController();
+
+    // Two zones over the whole keyboard, so a note on every key starts maxVoices voices
+    for (int i = 0; i < 2; ++i)
+        engine->loadSampleIntoSelectedPartAndGroup(p, 60, {0, 127});
+    for (int i = 0; i < 8; ++i)
+    {
+        engine->processAudio();
+        cont->runSerializationHousekeeping();
+    }
+
+    const auto &group = engine->getPatch()->getPart(0)->getGroup(0);
+    REQUIRE(group->getZones().size() == 2);
+    for (const auto &z : group->getZones())
+        z->setProcessorType(0, dsp::processor::proct_SuperSVF);
+
+    const auto &pool = engine->getMemoryPool();
+    auto missesBefore = pool->getTotalMisses();
+
+    for (int k = 0; k < 128; ++k)
+    {
+        uint8_t on[3]{0x90, (uint8_t)k, 100};
+        sst::voicemanager::applyMidi1Message(engine->voiceManager, 0, on);
+    }
+    engine->processAudio();
+    REQUIRE(engine->activeVoices == maxVoices);
+    REQUIRE(pool->getTotalMisses() == missesBefore);
+
+    for (int k = 0; k < 128; ++k)
+    {
+        uint8_t off[3]{0x80, (uint8_t)k, 0};
+        sst::voicemanager::applyMidi1Message(engine->voiceManager, 0, off);
+    }
+    for (int i = 0; i < 48000 && engine->activeVoices > 0; ++i)
+    {
+        engine->processAudio();
+        cont->runSerializationHousekeeping();
+    }
+    REQUIRE(engine->activeVoices == 0);
+
+    engine.reset();
+}
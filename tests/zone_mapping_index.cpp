@@ -0,0 +1,148 @@
+/*
+ * Shortcircuit XT - a Surge Synth Team product
+ *
+ * A fully featured creative sampler, available as a standalone
+ * and plugin for multiple platforms.
+ *
+ * Copyright 2019 - 2024, Various authors, as described in the github
+ * transaction log.
+ *
+ * ShortcircuitXT is released under the Gnu General Public Licence
+ * V3 or later (GPL-3.0-or-later). The license is found in the file
+ * "LICENSE" in the root of this repository or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Individual sections of code which comprises ShortcircuitXT in this
+ * repository may also be used under an MIT license. Please see the
+ * section  "Licensing" in "README.md" for details.
+ *
+ * ShortcircuitXT is inspired by, and shares code with, the
+ * commercial product Shortcircuit 1 and 2, released by VemberTech
+ * in the mid 2000s. The code for Shortcircuit 2 was opensourced in
+ * 2020 at the outset of this project.
+ *
+ * All source for ShortcircuitXT is available at
+ * https://github.com/surge-synthesizer/shortcircuit-xt
+ */
+
+#include "catch2/catch2.hpp"
+#include "engine/engine.h"
+#include "messaging/messaging.h"
+#include "test_support.h"
+
+using namespace scxt;
+
+/*
+ * The index must give findZone exactly the zones, in exactly the order, of the scan it
+ * replaces, for every channel, key and velocity, and after every kind of patch change:
+ * from the stale generation fallback before the rebuild lands and from the index after.
+ */
+TEST_CASE("Zone Mapping Index Matches The Full Scan", "[engine]")
+{
+    auto engine = test::makeOfflineEngine();
+    auto &cont = engine->getMessageController();
+    const auto &patch = engine->getPatch();
+
+    for (int p = 0; p < 3; ++p)
+        patch->getPart(p)->guaranteeGroupCount(2);
+    patch->getPart(1)->configuration.channel = 1;
+    patch->getPart(2)->configuration.mute = true;
+
+    auto addZone = [&](int p, int g, int ks, int ke, int vs, int ve) {
+        auto z = std::make_unique<engine::Zone>();
+        z->mapping.keyboardRange = engine::KeyboardRange(ks, ke);
+        z->mapping.velocityRange = engine::VelocityRange(vs, ve);
+        auto id = z->id;
+        patch->getPart(p)->getGroup(g)->addZone(std::move(z));
+        return id;
+    };
+
+    // Velocity layers, and zones overlapping them and each other, in several groups
+    addZone(0, 0, 36, 72, 0, 63);
+    addZone(0, 0, 36, 72, 64, 127);
+    auto wide = addZone(0, 0, 48, 96, 0, 127);
+    addZone(0, 1, 60, 60, 100, 127);
+    addZone(0, 1, 0, 127, 0, 127);
+    addZone(1, 0, 20, 80, 30, 90);
+    auto layer = addZone(1, 1, 50, 70, 0, 40);
+    addZone(2, 0, 0, 127, 0, 127);
+
+    auto rebuild = [&]() {
+        cont->runSerializationHousekeeping();
+        engine->processAudio();
+        cont->runSerializationHousekeeping();
+    };
+
+    auto requireIndexMatchesScan = [&](bool expectIndex) {
+        REQUIRE(engine->isZoneMappingIndexCurrent() == expectIndex);
+
+        std::array<engine::Engine::pathToZone_t, maxVoices> byIndex, byScan;
+        int mismatches{0};
+        size_t found{0};
+        for (int16_t ch = 0; ch < 3; ++ch)
+        {
+            for (int16_t key = 0; key < 128; ++key)
+            {
+                for (int16_t vel = 0; vel < 128; ++vel)
+                {
+                    auto n = engine->findZone(ch, key, -1, vel, byIndex);
+                    auto m = engine->findZoneByScan(ch, key, -1, vel, byScan);
+                    auto same = n == m;
+                    for (size_t i = 0; same && i < n; ++i)
+                        same = byIndex[i].part == byScan[i].part &&
+                               byIndex[i].group == byScan[i].group &&
+                               byIndex[i].zone == byScan[i].zone;
+                    if (!same && mismatches++ == 0)
+                    {
+                        UNSCOPED_INFO("First mismatch at channel " << ch << " key " << key
+                                                                   << " velocity " << vel);
+                    }
+                    found += n;
+                }
+            }
+        }
+        REQUIRE(mismatches == 0);
+        REQUIRE(found > 0);
+    };
+
+    rebuild();
+    requireIndexMatchesScan(true);
+
+    SECTION("After A Zone Add")
+    {
+        addZone(1, 0, 40, 100, 0, 127);
+        requireIndexMatchesScan(false);
+        rebuild();
+        requireIndexMatchesScan(true);
+    }
+
+    SECTION("After A Zone Remove")
+    {
+        REQUIRE(patch->getPart(0)->getGroup(0)->removeZone(wide) != nullptr);
+        requireIndexMatchesScan(false);
+        rebuild();
+        requireIndexMatchesScan(true);
+    }
+
+    SECTION("After A Mapping Edit")
+    {
+        // As the zone mapping messages do it, on the audio thread
+        auto &z = patch->getPart(1)->getGroup(1)->getZone(layer);
+        z->mapping.keyboardRange = engine::KeyboardRange(0, 30);
+        z->mapping.velocityRange = engine::VelocityRange(64, 127);
+        engine->invalidateZoneMappingIndex();
+        requireIndexMatchesScan(false);
+        rebuild();
+        requireIndexMatchesScan(true);
+    }
+
+    SECTION("After Zones Swap")
+    {
+        patch->getPart(0)->getGroup(0)->swapZonesByIndex(0, 2);
+        requireIndexMatchesScan(false);
+        rebuild();
+        requireIndexMatchesScan(true);
+    }
+
+    engine.reset();
+}